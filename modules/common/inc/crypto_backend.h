@@ -0,0 +1,261 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifndef CRYPTO_BACKEND_H
+#define CRYPTO_BACKEND_H
+
+/*
+ * Symmetric crypto shared by the EDHOC and the OSCORE module.
+ *
+ * It is part of the common module, an application linking both modules
+ * has one backend for both. Like the crypto wrapper functions of the
+ * modules, all functions are weak and can be replaced by the application.
+ *
+ * A backend provides the primitives worth an implementation per CPU:
+ * AES-CCM, optionally with keys prepared in advance, and the SHA-256
+ * compression function. When it is first used, the
+ * fastest backend the CPU supports is selected:
+ *  - crypto_backend_portable, TinyCrypt AES-CCM if built with
+ *    -DEDHOC_WITH_TINYCRYPT_AND_C25519 or -DOSCORE_WITH_TINYCRYPT and
+ *    SHA-256 in C
+ *  - crypto_backend_x86_64(), AES-NI and SHA-NI, built with
+ *    -DCRYPTO_WITH_X86_64
+ *  - crypto_backend_armv8(), SHA-256 of the ARMv8 Cryptography Extensions,
+ *    built with -DCRYPTO_WITH_ARMV8
+ * An application can register a backend of its own, e.g., for a crypto
+ * accelerator. SHA-256, HMAC and HKDF are built on the selected backend.
+ */
+
+#include <stdint.h>
+
+/*Indicates what kind of operation a symmetric cipher will execute*/
+enum aes_operation {
+    ENCRYPT,
+    DECRYPT,
+};
+
+#define CRYPTO_BACKEND_OK 0
+#define CRYPTO_BACKEND_ERROR -1       /*unsupported parameters*/
+#define CRYPTO_BACKEND_AUTH_FAILED -2 /*the tag does not match*/
+
+#define CRYPTO_SHA256_SIZE 32
+#define CRYPTO_SHA256_BLOCK_SIZE 64
+
+/*size of the state of a prepared AES-128 key, see aes_key_init()*/
+#define CRYPTO_AES_KEY_STATE_SIZE 192
+
+struct crypto_backend {
+    const char *name;
+
+    /**
+     * @brief   AES-128-CCM
+     * @param   op ENCRYPT or DECRYPT
+     * @param   key the 16 byte key
+     * @param   nonce the nonce
+     * @param   nonce_len length of nonce, 7 to 13
+     * @param   aad additional authenticated data
+     * @param   aad_len length of aad
+     * @param   in the plaintext, or the ciphertext followed by the tag
+     * @param   in_len length of in
+     * @param   out the ciphertext followed by the tag (in_len + tag_len
+     *          bytes), or the plaintext (in_len - tag_len bytes). On an
+     *          authentication failure out is cleared.
+     * @param   tag_len length of the tag, 4 to 16 and even
+     * @retval  a CRYPTO_BACKEND_* code
+     */
+    int (*aes_ccm)(
+        enum aes_operation op,
+        const uint8_t *key,
+        const uint8_t *nonce, uint8_t nonce_len,
+        const uint8_t *aad, uint32_t aad_len,
+        const uint8_t *in, uint32_t in_len,
+        uint8_t *out, uint8_t tag_len);
+
+    /**
+     * @brief   Prepares an AES-128 key for aes_ccm_key(), e.g., expands the
+     *          key schedule. NULL if the backend has no prepared keys, then
+     *          aes_ccm() is used.
+     * @param   state CRYPTO_AES_KEY_STATE_SIZE bytes, 8 byte aligned. It
+     *          must not contain pointers into itself, it is copied.
+     * @param   key the 16 byte key
+     */
+    void (*aes_key_init)(uint8_t *state, const uint8_t *key);
+
+    /**
+     * @brief   AES-128-CCM with a key prepared by aes_key_init(), the other
+     *          parameters are the ones of aes_ccm()
+     */
+    int (*aes_ccm_key)(
+        enum aes_operation op,
+        const uint8_t *state,
+        const uint8_t *nonce, uint8_t nonce_len,
+        const uint8_t *aad, uint32_t aad_len,
+        const uint8_t *in, uint32_t in_len,
+        uint8_t *out, uint8_t tag_len);
+
+    /**
+     * @brief   SHA-256 compression function
+     * @param   state the chaining value
+     * @param   in the message blocks
+     * @param   blocks number of 64 byte blocks in in
+     */
+    void (*sha256_blocks)(
+        uint32_t state[8], const uint8_t *in, uint32_t blocks);
+};
+
+extern const struct crypto_backend crypto_backend_portable;
+
+/*the functions of crypto_backend_portable, for backends which replace only
+some of them*/
+int crypto_aes_ccm_portable(
+    enum aes_operation op,
+    const uint8_t *key,
+    const uint8_t *nonce, uint8_t nonce_len,
+    const uint8_t *aad, uint32_t aad_len,
+    const uint8_t *in, uint32_t in_len,
+    uint8_t *out, uint8_t tag_len);
+void crypto_aes_key_init_portable(uint8_t *state, const uint8_t *key);
+int crypto_aes_ccm_key_portable(
+    enum aes_operation op,
+    const uint8_t *state,
+    const uint8_t *nonce, uint8_t nonce_len,
+    const uint8_t *aad, uint32_t aad_len,
+    const uint8_t *in, uint32_t in_len,
+    uint8_t *out, uint8_t tag_len);
+void crypto_sha256_blocks_portable(
+    uint32_t state[8], const uint8_t *in, uint32_t blocks);
+
+#ifdef CRYPTO_WITH_X86_64
+/**
+ * @brief   Returns a backend with the instruction set extensions of the
+ *          running CPU, NULL if it has none of them
+ */
+const struct crypto_backend *crypto_backend_x86_64(void);
+#endif
+
+#ifdef CRYPTO_WITH_ARMV8
+/**
+ * @brief   Returns a backend with the SHA-256 instructions if the running
+ *          CPU has them, otherwise NULL
+ */
+const struct crypto_backend *crypto_backend_armv8(void);
+#endif
+
+/**
+ * @brief   Returns the backend in use. On the first call the fastest backend
+ *          the CPU supports is selected.
+ */
+const struct crypto_backend *crypto_backend_get(void);
+
+/**
+ * @brief   Replaces the backend in use. Should be called before any crypto
+ *          is used, the states of running hash calculations are not
+ *          portable between backends.
+ * @param   b the backend, NULL to select the fastest built-in backend again.
+ *          Must stay valid as long as it is in use.
+ */
+void crypto_backend_register(const struct crypto_backend *b);
+
+/**
+ * An AES-128 key which is prepared once and used for many messages, e.g., the
+ * Sender Key of an OSCORE security context. It stays with the backend which
+ * prepared it. It is plain memory, it can be copied and needs no free.
+ */
+struct crypto_aes_key {
+    const struct crypto_backend *backend;
+    uint8_t key[16];
+    union {
+        uint8_t bytes[CRYPTO_AES_KEY_STATE_SIZE];
+        uint64_t align;
+    } state;
+};
+
+/**
+ * @brief   Prepares a key with the backend in use
+ * @param   k the prepared key
+ * @param   key the 16 byte key
+ */
+void crypto_aes_key_init(struct crypto_aes_key *k, const uint8_t *key);
+
+/**
+ * @brief   AES-128-CCM with a prepared key, the other parameters are the ones
+ *          of crypto_backend.aes_ccm()
+ * @retval  a CRYPTO_BACKEND_* code
+ */
+int crypto_aes_ccm_key(
+    const struct crypto_aes_key *k,
+    enum aes_operation op,
+    const uint8_t *nonce, uint8_t nonce_len,
+    const uint8_t *aad, uint32_t aad_len,
+    const uint8_t *in, uint32_t in_len,
+    uint8_t *out, uint8_t tag_len);
+
+/**
+ * State of an incremental SHA-256 calculation. It does not contain pointers
+ * and can be forked by a plain assignment.
+ */
+struct crypto_sha256 {
+    uint32_t state[8];
+    uint64_t len; /*number of bytes absorbed*/
+    uint8_t buf[CRYPTO_SHA256_BLOCK_SIZE];
+};
+
+void crypto_sha256_init(struct crypto_sha256 *s);
+void crypto_sha256_update(
+    struct crypto_sha256 *s, const uint8_t *in, uint32_t in_len);
+/*s is invalidated*/
+void crypto_sha256_final(struct crypto_sha256 *s, uint8_t *out);
+void crypto_sha256(const uint8_t *in, uint32_t in_len, uint8_t *out);
+
+/**
+ * HMAC-SHA256. crypto_hmac_sha256_init() absorbs the padded key into the
+ * inner and the outer hash, a keyed state can be copied to compute several
+ * MACs with the same key without processing the key again.
+ */
+struct crypto_hmac_sha256 {
+    struct crypto_sha256 inner;
+    struct crypto_sha256 outer;
+};
+
+void crypto_hmac_sha256_init(
+    struct crypto_hmac_sha256 *h, const uint8_t *key, uint32_t key_len);
+void crypto_hmac_sha256_update(
+    struct crypto_hmac_sha256 *h, const uint8_t *in, uint32_t in_len);
+/*h is invalidated*/
+void crypto_hmac_sha256_final(struct crypto_hmac_sha256 *h, uint8_t *out);
+
+/**
+ * @brief   HKDF-Extract with HMAC-SHA256
+ * @param   salt the salt, a missing or empty salt is replaced by 32 zeros
+ * @param   salt_len length of salt
+ * @param   ikm the input keying material
+ * @param   ikm_len length of ikm
+ * @param   prk the 32 byte PRK
+ */
+void crypto_hkdf_sha256_extract(
+    const uint8_t *salt, uint32_t salt_len,
+    const uint8_t *ikm, uint32_t ikm_len,
+    uint8_t *prk);
+
+/**
+ * @brief   HKDF-Expand with HMAC-SHA256
+ * @param   k the HMAC state keyed with the PRK
+ * @param   info the info
+ * @param   info_len length of info
+ * @param   out the output keying material
+ * @param   out_len length of out, at most 255 * 32
+ * @retval  a CRYPTO_BACKEND_* code
+ */
+int crypto_hkdf_sha256_expand(
+    const struct crypto_hmac_sha256 *k,
+    const uint8_t *info, uint32_t info_len,
+    uint8_t *out, uint64_t out_len);
+
+#endif
@@ -0,0 +1,107 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifndef FIBER_H
+#define FIBER_H
+
+/*
+ * Fibers on hosts with <ucontext.h>, the common part of the crypto tasks of
+ * EDHOC and OSCORE (see crypto_async.h of the modules). Built with
+ * -DEDHOC_WITH_ASYNC_CRYPTO or -DOSCORE_WITH_ASYNC_CRYPTO.
+ *
+ * A fiber runs a function on a stack of its own. The function can wait for
+ * an operation computed elsewhere: it calls fiber_wait_begin(), hands the
+ * operation over and calls fiber_wait(), which switches back to the caller
+ * of fiber_start() or fiber_resume(). Whoever computes the operation calls
+ * fiber_wake() when it is done, possibly from another thread, which calls
+ * the ready callback of the fiber. The owner then continues the fiber with
+ * fiber_resume().
+ */
+#if defined(EDHOC_WITH_ASYNC_CRYPTO) || defined(OSCORE_WITH_ASYNC_CRYPTO)
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <ucontext.h>
+
+/**
+ * A function which can be suspended. A fiber must always be started and
+ * resumed by the same thread.
+ */
+struct fiber {
+    ucontext_t caller, ctx;
+    void *stack;
+    uint32_t stack_size;
+    void (*ready)(struct fiber *f, void *arg);
+    void *ready_arg;
+    void (*fn)(struct fiber *f);
+    uint32_t state; /*see fiber.c*/
+};
+
+/**
+ * @brief   Initializes a fiber
+ * @param   f the fiber
+ * @param   stack stack of the fiber
+ * @param   stack_size size of stack
+ * @param   ready called by fiber_wake() when the fiber can be resumed. It is
+ *          called from the thread of the waker and must not resume the
+ *          fiber itself but wake up its owner. May be NULL.
+ * @param   ready_arg argument of ready
+ */
+void fiber_init(
+    struct fiber *f, void *stack, uint32_t stack_size,
+    void (*ready)(struct fiber *f, void *arg), void *ready_arg);
+
+/**
+ * @brief   Runs fn(f) on the stack of the fiber until it returns or waits.
+ *          A fiber can be started again after fn returned.
+ * @param   f the fiber
+ * @param   fn the function
+ * @retval  true if fn returned, false if it waits
+ */
+bool fiber_start(struct fiber *f, void (*fn)(struct fiber *f));
+
+/**
+ * @brief   Continues a waiting fiber after its ready callback was called
+ * @param   f the fiber
+ * @retval  true if fn returned, false if it waits again
+ */
+bool fiber_resume(struct fiber *f);
+
+/**
+ * @brief   Returns the fiber running on the calling thread, NULL outside of
+ *          a fiber and between fiber_wait_begin() and fiber_wait()
+ */
+struct fiber *fiber_current(void);
+
+/**
+ * @brief   Prepares the running fiber to wait for an operation. To be
+ *          followed by fiber_wait() once the operation is handed over, the
+ *          operation may be completed with fiber_wake() in between.
+ * @retval  the running fiber
+ */
+struct fiber *fiber_wait_begin(void);
+
+/**
+ * @brief   Switches back to the owner until fiber_wake() is called
+ * @param   f the fiber returned by fiber_wait_begin()
+ * @param   handed_over false if the operation was not handed over, the
+ *          fiber then continues right away
+ */
+void fiber_wait(struct fiber *f, bool handed_over);
+
+/**
+ * @brief   Ends the wait of a fiber, to be called once per fiber_wait()
+ *          with handed_over set
+ * @param   f the fiber
+ */
+void fiber_wake(struct fiber *f);
+
+#endif
+#endif
@@ -8,20 +8,15 @@
    option. This file may not be copied, modified, or distributed
    except according to those terms.
 */
+
+#ifndef COMMON_PRINT_UTIL_H
+#define COMMON_PRINT_UTIL_H
+
 #include <stdint.h>
-#include <string.h>
 
-#include "../inc/error.h"
+/**
+ *@brief prints an array for debug pourposes 
+ */
+void print_array(uint8_t* in_data, uint16_t in_len);
 
-EdhocError _memcpy_s(
-    uint8_t *dest,
-    uint64_t destSize,
-    const uint8_t *src,
-    uint64_t count) {
-    if (destSize < count) {
-        return DestBufferToSmall;
-    } else {
-        memcpy(dest, src, count);
-    }
-    return 0;
-}
\ No newline at end of file
+#endif
@@ -21,7 +21,7 @@ struct byte_array NULL_ARRAY = {
     .ptr = NULL,
 };
 
-bool array_equals(struct byte_array* left, struct byte_array* right) {
+bool array_equals(const struct byte_array* left, const struct byte_array* right) {
     if (left->len != right->len) {
         return false;
     }
@@ -0,0 +1,389 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#include "../inc/crypto_backend.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(EDHOC_WITH_TINYCRYPT_AND_C25519) || defined(OSCORE_WITH_TINYCRYPT)
+#define CRYPTO_BACKEND_WITH_TINYCRYPT
+#include <tinycrypt/aes.h>
+#include <tinycrypt/ccm_mode.h>
+#include <tinycrypt/constants.h>
+#endif
+
+/*the backend in use, NULL until it is selected*/
+static const struct crypto_backend *crypto_backend_selected = NULL;
+
+#ifdef CRYPTO_BACKEND_WITH_TINYCRYPT
+/*the TinyCrypt key schedule must fit into a prepared key*/
+typedef char aes_key_state_size_check
+    [(sizeof(struct tc_aes_key_sched_struct) <= CRYPTO_AES_KEY_STATE_SIZE)
+         ? 1
+         : -1];
+#endif
+
+void __attribute__((weak)) crypto_aes_key_init_portable(
+    uint8_t *state, const uint8_t *key) {
+#ifdef CRYPTO_BACKEND_WITH_TINYCRYPT
+    tc_aes128_set_encrypt_key((struct tc_aes_key_sched_struct *)state, key);
+#else
+    (void)state;
+    (void)key;
+#endif
+}
+
+int __attribute__((weak)) crypto_aes_ccm_key_portable(
+    enum aes_operation op,
+    const uint8_t *state,
+    const uint8_t *nonce, uint8_t nonce_len,
+    const uint8_t *aad, uint32_t aad_len,
+    const uint8_t *in, uint32_t in_len,
+    uint8_t *out, uint8_t tag_len) {
+#ifdef CRYPTO_BACKEND_WITH_TINYCRYPT
+    struct tc_ccm_mode_struct c;
+
+    /*TinyCrypt supports 13 byte nonces only*/
+    if (tc_ccm_config(&c, (struct tc_aes_key_sched_struct *)state,
+                      (uint8_t *)nonce, nonce_len,
+                      tag_len) != TC_CRYPTO_SUCCESS) {
+        return CRYPTO_BACKEND_ERROR;
+    }
+
+    if (op == DECRYPT) {
+        if (in_len < tag_len) return CRYPTO_BACKEND_ERROR;
+        if (tc_ccm_decryption_verification(out, in_len - tag_len, aad,
+                                           aad_len, in, in_len,
+                                           &c) != TC_CRYPTO_SUCCESS) {
+            memset(out, 0, in_len - tag_len);
+            return CRYPTO_BACKEND_AUTH_FAILED;
+        }
+    } else {
+        if (tc_ccm_generation_encryption(out, in_len + tag_len, aad, aad_len,
+                                         in, in_len,
+                                         &c) != TC_CRYPTO_SUCCESS) {
+            return CRYPTO_BACKEND_ERROR;
+        }
+    }
+    return CRYPTO_BACKEND_OK;
+#else
+    return CRYPTO_BACKEND_ERROR;
+#endif
+}
+
+int __attribute__((weak)) crypto_aes_ccm_portable(
+    enum aes_operation op,
+    const uint8_t *key,
+    const uint8_t *nonce, uint8_t nonce_len,
+    const uint8_t *aad, uint32_t aad_len,
+    const uint8_t *in, uint32_t in_len,
+    uint8_t *out, uint8_t tag_len) {
+    union {
+        uint8_t bytes[CRYPTO_AES_KEY_STATE_SIZE];
+        uint64_t align;
+    } state;
+    volatile uint8_t *p = state.bytes;
+    int r;
+
+    crypto_aes_key_init_portable(state.bytes, key);
+    r = crypto_aes_ccm_key_portable(op, state.bytes, nonce, nonce_len, aad,
+                                    aad_len, in, in_len, out, tag_len);
+    for (uint32_t i = 0; i < sizeof(state); i++) p[i] = 0;
+    return r;
+}
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static inline uint32_t ror(uint32_t x, uint8_t n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static inline uint32_t load_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline void store_be32(uint8_t *p, uint32_t x) {
+    p[0] = (uint8_t)(x >> 24);
+    p[1] = (uint8_t)(x >> 16);
+    p[2] = (uint8_t)(x >> 8);
+    p[3] = (uint8_t)x;
+}
+
+void __attribute__((weak)) crypto_sha256_blocks_portable(
+    uint32_t state[8], const uint8_t *in, uint32_t blocks) {
+    uint32_t w[64], a, b, c, d, e, f, g, h, t1, t2;
+    uint8_t i;
+
+    while (blocks--) {
+        for (i = 0; i < 16; i++) {
+            w[i] = load_be32(in + 4 * i);
+        }
+        for (i = 16; i < 64; i++) {
+            w[i] = w[i - 16] + w[i - 7] +
+                   (ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^
+                    (w[i - 15] >> 3)) +
+                   (ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10));
+        }
+
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        f = state[5];
+        g = state[6];
+        h = state[7];
+        for (i = 0; i < 64; i++) {
+            t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) +
+                 ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+            t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) +
+                 ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+        in += CRYPTO_SHA256_BLOCK_SIZE;
+    }
+}
+
+const struct crypto_backend crypto_backend_portable
+    __attribute__((weak)) = {
+        .name = "portable",
+        .aes_ccm = crypto_aes_ccm_portable,
+        .aes_key_init = crypto_aes_key_init_portable,
+        .aes_ccm_key = crypto_aes_ccm_key_portable,
+        .sha256_blocks = crypto_sha256_blocks_portable,
+};
+
+/**
+ * @brief   Returns the fastest built-in backend the CPU supports
+ */
+static const struct crypto_backend *backend_detect(void) {
+    const struct crypto_backend *b = NULL;
+#ifdef CRYPTO_WITH_X86_64
+    b = crypto_backend_x86_64();
+#endif
+#ifdef CRYPTO_WITH_ARMV8
+    if (b == NULL) b = crypto_backend_armv8();
+#endif
+    return b != NULL ? b : &crypto_backend_portable;
+}
+
+const struct crypto_backend *__attribute__((weak)) crypto_backend_get(void) {
+    const struct crypto_backend *b =
+        __atomic_load_n(&crypto_backend_selected, __ATOMIC_ACQUIRE);
+
+    if (b == NULL) {
+        /*threads racing here select the same backend*/
+        b = backend_detect();
+        __atomic_store_n(&crypto_backend_selected, b, __ATOMIC_RELEASE);
+    }
+    return b;
+}
+
+void __attribute__((weak)) crypto_backend_register(
+    const struct crypto_backend *b) {
+    __atomic_store_n(&crypto_backend_selected, b, __ATOMIC_RELEASE);
+}
+
+void __attribute__((weak)) crypto_aes_key_init(
+    struct crypto_aes_key *k, const uint8_t *key) {
+    k->backend = crypto_backend_get();
+    memcpy(k->key, key, sizeof(k->key));
+    if (k->backend->aes_key_init != NULL) {
+        k->backend->aes_key_init(k->state.bytes, key);
+    }
+}
+
+int __attribute__((weak)) crypto_aes_ccm_key(
+    const struct crypto_aes_key *k,
+    enum aes_operation op,
+    const uint8_t *nonce, uint8_t nonce_len,
+    const uint8_t *aad, uint32_t aad_len,
+    const uint8_t *in, uint32_t in_len,
+    uint8_t *out, uint8_t tag_len) {
+    /*a backend registered by the application may not prepare keys*/
+    if (k->backend->aes_key_init == NULL || k->backend->aes_ccm_key == NULL) {
+        return k->backend->aes_ccm(op, k->key, nonce, nonce_len, aad, aad_len,
+                                   in, in_len, out, tag_len);
+    }
+    return k->backend->aes_ccm_key(op, k->state.bytes, nonce, nonce_len, aad,
+                                   aad_len, in, in_len, out, tag_len);
+}
+
+void __attribute__((weak)) crypto_sha256_init(struct crypto_sha256 *s) {
+    static const uint32_t iv[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                   0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                   0x1f83d9ab, 0x5be0cd19};
+    memcpy(s->state, iv, sizeof(iv));
+    s->len = 0;
+}
+
+void __attribute__((weak)) crypto_sha256_update(
+    struct crypto_sha256 *s, const uint8_t *in, uint32_t in_len) {
+    const struct crypto_backend *b = crypto_backend_get();
+    uint32_t used = (uint32_t)(s->len % CRYPTO_SHA256_BLOCK_SIZE);
+    uint32_t n;
+
+    if (in_len == 0) return;
+    s->len += in_len;
+    if (used != 0) {
+        n = CRYPTO_SHA256_BLOCK_SIZE - used;
+        if (in_len < n) {
+            memcpy(s->buf + used, in, in_len);
+            return;
+        }
+        memcpy(s->buf + used, in, n);
+        b->sha256_blocks(s->state, s->buf, 1);
+        in += n;
+        in_len -= n;
+    }
+    /*whole blocks are compressed without copying them*/
+    n = in_len / CRYPTO_SHA256_BLOCK_SIZE;
+    if (n != 0) {
+        b->sha256_blocks(s->state, in, n);
+        in += n * CRYPTO_SHA256_BLOCK_SIZE;
+        in_len -= n * CRYPTO_SHA256_BLOCK_SIZE;
+    }
+    memcpy(s->buf, in, in_len);
+}
+
+void __attribute__((weak)) crypto_sha256_final(
+    struct crypto_sha256 *s, uint8_t *out) {
+    uint32_t used = (uint32_t)(s->len % CRYPTO_SHA256_BLOCK_SIZE);
+    uint64_t bits = s->len * 8;
+    uint8_t i;
+
+    /*padding: 0x80, zeros and the length in bits as a 64 bit integer*/
+    s->buf[used++] = 0x80;
+    if (used > CRYPTO_SHA256_BLOCK_SIZE - 8) {
+        memset(s->buf + used, 0, CRYPTO_SHA256_BLOCK_SIZE - used);
+        crypto_backend_get()->sha256_blocks(s->state, s->buf, 1);
+        used = 0;
+    }
+    memset(s->buf + used, 0, CRYPTO_SHA256_BLOCK_SIZE - 8 - used);
+    store_be32(s->buf + CRYPTO_SHA256_BLOCK_SIZE - 8, (uint32_t)(bits >> 32));
+    store_be32(s->buf + CRYPTO_SHA256_BLOCK_SIZE - 4, (uint32_t)bits);
+    crypto_backend_get()->sha256_blocks(s->state, s->buf, 1);
+
+    for (i = 0; i < 8; i++) {
+        store_be32(out + 4 * i, s->state[i]);
+    }
+    memset(s, 0, sizeof(*s));
+}
+
+void __attribute__((weak)) crypto_sha256(
+    const uint8_t *in, uint32_t in_len, uint8_t *out) {
+    struct crypto_sha256 s;
+    crypto_sha256_init(&s);
+    crypto_sha256_update(&s, in, in_len);
+    crypto_sha256_final(&s, out);
+}
+
+void __attribute__((weak)) crypto_hmac_sha256_init(
+    struct crypto_hmac_sha256 *h, const uint8_t *key, uint32_t key_len) {
+    uint8_t pad[CRYPTO_SHA256_BLOCK_SIZE];
+    uint8_t i;
+
+    /*"keys longer than B bytes are first hashed using H"*/
+    memset(pad, 0, sizeof(pad));
+    if (key_len > CRYPTO_SHA256_BLOCK_SIZE) {
+        crypto_sha256(key, key_len, pad);
+    } else if (key_len != 0) {
+        memcpy(pad, key, key_len);
+    }
+
+    for (i = 0; i < CRYPTO_SHA256_BLOCK_SIZE; i++) pad[i] ^= 0x36;
+    crypto_sha256_init(&h->inner);
+    crypto_sha256_update(&h->inner, pad, sizeof(pad));
+    for (i = 0; i < CRYPTO_SHA256_BLOCK_SIZE; i++) pad[i] ^= 0x36 ^ 0x5c;
+    crypto_sha256_init(&h->outer);
+    crypto_sha256_update(&h->outer, pad, sizeof(pad));
+    memset(pad, 0, sizeof(pad));
+}
+
+void __attribute__((weak)) crypto_hmac_sha256_update(
+    struct crypto_hmac_sha256 *h, const uint8_t *in, uint32_t in_len) {
+    crypto_sha256_update(&h->inner, in, in_len);
+}
+
+void __attribute__((weak)) crypto_hmac_sha256_final(
+    struct crypto_hmac_sha256 *h, uint8_t *out) {
+    uint8_t t[CRYPTO_SHA256_SIZE];
+
+    crypto_sha256_final(&h->inner, t);
+    crypto_sha256_update(&h->outer, t, sizeof(t));
+    crypto_sha256_final(&h->outer, out);
+    memset(t, 0, sizeof(t));
+}
+
+void __attribute__((weak)) crypto_hkdf_sha256_extract(
+    const uint8_t *salt, uint32_t salt_len,
+    const uint8_t *ikm, uint32_t ikm_len,
+    uint8_t *prk) {
+    struct crypto_hmac_sha256 h;
+    /*"Note that [RFC5869] specifies that if the salt is not provided, it is
+    set to a string of zeros." HMAC pads a key of zeros with zeros anyway.*/
+    crypto_hmac_sha256_init(&h, salt, salt == NULL ? 0 : salt_len);
+    crypto_hmac_sha256_update(&h, ikm, ikm_len);
+    crypto_hmac_sha256_final(&h, prk);
+}
+
+int __attribute__((weak)) crypto_hkdf_sha256_expand(
+    const struct crypto_hmac_sha256 *k,
+    const uint8_t *info, uint32_t info_len,
+    uint8_t *out, uint64_t out_len) {
+    struct crypto_hmac_sha256 h;
+    uint8_t t[CRYPTO_SHA256_SIZE];
+    uint64_t done;
+    uint8_t i;
+
+    /*"L length of output keying material in octets (<= 255*HashLen)"*/
+    if (out_len > 255 * CRYPTO_SHA256_SIZE) return CRYPTO_BACKEND_ERROR;
+
+    for (i = 1, done = 0; done < out_len; i++, done += CRYPTO_SHA256_SIZE) {
+        /*the keyed state is copied, the key is not processed again*/
+        h = *k;
+        if (i > 1) crypto_hmac_sha256_update(&h, t, sizeof(t));
+        crypto_hmac_sha256_update(&h, info, info_len);
+        crypto_hmac_sha256_update(&h, &i, 1);
+        crypto_hmac_sha256_final(&h, t);
+        memcpy(out + done, t,
+               out_len - done < sizeof(t) ? out_len - done : sizeof(t));
+    }
+    memset(t, 0, sizeof(t));
+    return CRYPTO_BACKEND_OK;
+}
@@ -0,0 +1,110 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifdef CRYPTO_WITH_ARMV8
+
+/*
+ * Backend for AArch64 CPUs with the SHA-256 instructions of the ARMv8
+ * Cryptography Extensions. The instructions are enabled per function, the
+ * library can be built for a baseline CPU and uses them where the running
+ * CPU has them. AES-CCM stays portable.
+ */
+
+#ifndef __aarch64__
+#error "CRYPTO_WITH_ARMV8 requires an AArch64 target"
+#endif
+
+#include <arm_neon.h>
+
+#if defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_SHA2
+#define HWCAP_SHA2 (1 << 6)
+#endif
+#endif
+
+#include "../inc/crypto_backend.h"
+
+#if defined(__clang__)
+#define SHA2 __attribute__((target("sha2")))
+#else
+#define SHA2 __attribute__((target("+crypto")))
+#endif
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+/*m[] holds the last 16 words of the message schedule, four rounds use one
+vector of it and replace it by the one four vectors ahead*/
+SHA2 static void armv8_sha256_blocks(
+    uint32_t state[8], const uint8_t *in, uint32_t blocks) {
+    uint32x4_t abcd = vld1q_u32(&state[0]), efgh = vld1q_u32(&state[4]);
+    uint32x4_t abcd_save, efgh_save, t, k, m[4];
+    uint8_t i;
+
+    for (; blocks != 0; blocks--, in += CRYPTO_SHA256_BLOCK_SIZE) {
+        abcd_save = abcd;
+        efgh_save = efgh;
+        for (i = 0; i < 4; i++) {
+            m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(in + 16 * i)));
+        }
+        for (i = 0; i < 16; i++) {
+            k = vaddq_u32(m[i & 3], vld1q_u32(&sha256_k[4 * i]));
+            if (i < 12) {
+                m[i & 3] = vsha256su1q_u32(
+                    vsha256su0q_u32(m[i & 3], m[(i + 1) & 3]),
+                    m[(i + 2) & 3], m[(i + 3) & 3]);
+            }
+            t = abcd;
+            abcd = vsha256hq_u32(abcd, efgh, k);
+            efgh = vsha256h2q_u32(efgh, t, k);
+        }
+        abcd = vaddq_u32(abcd, abcd_save);
+        efgh = vaddq_u32(efgh, efgh_save);
+    }
+
+    vst1q_u32(&state[0], abcd);
+    vst1q_u32(&state[4], efgh);
+}
+
+static const struct crypto_backend crypto_backend_sha2 = {
+    .name = "ARMv8 SHA2",
+    .aes_ccm = crypto_aes_ccm_portable,
+    .aes_key_init = crypto_aes_key_init_portable,
+    .aes_ccm_key = crypto_aes_ccm_key_portable,
+    .sha256_blocks = armv8_sha256_blocks,
+};
+
+const struct crypto_backend *__attribute__((weak)) crypto_backend_armv8(
+    void) {
+#if defined(__ARM_FEATURE_SHA2) || defined(__APPLE__)
+    /*the target has the instructions in any case*/
+    return &crypto_backend_sha2;
+#elif defined(__linux__)
+    if (getauxval(AT_HWCAP) & HWCAP_SHA2) return &crypto_backend_sha2;
+    return NULL;
+#else
+    /*no portable way to ask the CPU, an application which knows it has the
+    instructions replaces this function*/
+    return NULL;
+#endif
+}
+
+#endif
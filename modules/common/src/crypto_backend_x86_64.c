@@ -0,0 +1,363 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifdef CRYPTO_WITH_X86_64
+
+/*
+ * Backend for x86-64 CPUs. The instructions are enabled per function, the
+ * library can be built for a baseline CPU and uses the extensions where the
+ * running CPU has them.
+ *
+ * AES-CCM uses AES-NI. The CBC-MAC of a block depends on the previous one,
+ * the counter mode keystream does not. The two AES computations of a block
+ * are interleaved round by round, so that the CTR block is computed in the
+ * latency of the CBC-MAC block. A prepared key is the expanded key
+ * schedule.
+ *
+ * SHA-256 uses the SHA extensions (SHA-NI). A CPU can have either of the
+ * extensions, each is used where it is present and the portable
+ * implementation otherwise.
+ */
+
+#include <cpuid.h>
+#include <immintrin.h>
+#include <string.h>
+
+#include "../inc/crypto_backend.h"
+
+#define AESNI __attribute__((target("aes,sse4.1")))
+#define SHANI __attribute__((target("sha,sse4.1")))
+
+AESNI static inline __m128i aes128_key_step(__m128i k, __m128i t) {
+    t = _mm_shuffle_epi32(t, 0xff);
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    return _mm_xor_si128(k, t);
+}
+
+#define AES128_KEY_STEP(rk, i, rcon) \
+    rk[i] = aes128_key_step(rk[i - 1],   \
+                            _mm_aeskeygenassist_si128(rk[i - 1], rcon))
+
+AESNI static void aes128_key_expand(const uint8_t *key, __m128i rk[11]) {
+    rk[0] = _mm_loadu_si128((const __m128i *)key);
+    AES128_KEY_STEP(rk, 1, 0x01);
+    AES128_KEY_STEP(rk, 2, 0x02);
+    AES128_KEY_STEP(rk, 3, 0x04);
+    AES128_KEY_STEP(rk, 4, 0x08);
+    AES128_KEY_STEP(rk, 5, 0x10);
+    AES128_KEY_STEP(rk, 6, 0x20);
+    AES128_KEY_STEP(rk, 7, 0x40);
+    AES128_KEY_STEP(rk, 8, 0x80);
+    AES128_KEY_STEP(rk, 9, 0x1b);
+    AES128_KEY_STEP(rk, 10, 0x36);
+}
+
+AESNI static inline __m128i aes128_encrypt(const __m128i rk[11], __m128i b) {
+    uint8_t i;
+    b = _mm_xor_si128(b, rk[0]);
+    for (i = 1; i < 10; i++) b = _mm_aesenc_si128(b, rk[i]);
+    return _mm_aesenclast_si128(b, rk[10]);
+}
+
+/*encrypts two independent blocks*/
+AESNI static inline void aes128_encrypt2(
+    const __m128i rk[11], __m128i *a, __m128i *b) {
+    __m128i x = _mm_xor_si128(*a, rk[0]), y = _mm_xor_si128(*b, rk[0]);
+    uint8_t i;
+    for (i = 1; i < 10; i++) {
+        x = _mm_aesenc_si128(x, rk[i]);
+        y = _mm_aesenc_si128(y, rk[i]);
+    }
+    *a = _mm_aesenclast_si128(x, rk[10]);
+    *b = _mm_aesenclast_si128(y, rk[10]);
+}
+
+/*loads up to 16 bytes, zero padded*/
+AESNI static inline __m128i load_partial(const uint8_t *p, uint32_t len) {
+    uint8_t b[16] = {0};
+    if (len >= 16) return _mm_loadu_si128((const __m128i *)p);
+    memcpy(b, p, len);
+    return _mm_loadu_si128((const __m128i *)b);
+}
+
+AESNI static inline void store_partial(uint8_t *p, __m128i x, uint32_t len) {
+    uint8_t b[16];
+    if (len >= 16) {
+        _mm_storeu_si128((__m128i *)p, x);
+        return;
+    }
+    _mm_storeu_si128((__m128i *)b, x);
+    memcpy(p, b, len);
+}
+
+/*counter block i. The counter is smaller than 2^(8q) and at most 2^28, it
+is ORed into the last four bytes of A_0, which may hold the end of the
+nonce.*/
+AESNI static inline __m128i ctr_block(__m128i a0, uint32_t i) {
+    uint32_t last = (uint32_t)_mm_extract_epi32(a0, 3);
+    return _mm_insert_epi32(a0, (int)(last | __builtin_bswap32(i)), 3);
+}
+
+AESNI static int aesni_ccm_rk(
+    enum aes_operation op,
+    const __m128i rk[11],
+    const uint8_t *nonce, uint8_t nonce_len,
+    const uint8_t *aad, uint32_t aad_len,
+    const uint8_t *in, uint32_t in_len,
+    uint8_t *out, uint8_t tag_len) {
+    __m128i mac, a0, s0, a, x, y, prev = _mm_setzero_si128();
+    uint8_t b[16], t[16];
+    uint8_t q = (uint8_t)(15 - nonce_len); /*size of the length field*/
+    uint32_t len, i, n, j;
+    uint8_t diff = 0;
+
+    if (nonce_len < 7 || nonce_len > 13 || tag_len < 4 || tag_len > 16 ||
+        (tag_len & 1) != 0) {
+        return CRYPTO_BACKEND_ERROR;
+    }
+    if (op == DECRYPT) {
+        if (in_len < tag_len) return CRYPTO_BACKEND_ERROR;
+        len = in_len - tag_len;
+    } else {
+        len = in_len;
+    }
+    if (q < 4 && ((uint64_t)len >> (8 * q)) != 0) return CRYPTO_BACKEND_ERROR;
+
+    /*B_0: flags, nonce and message length*/
+    b[0] = (uint8_t)((aad_len != 0 ? 0x40 : 0) | ((tag_len - 2) / 2) << 3 |
+                     (q - 1));
+    memcpy(b + 1, nonce, nonce_len);
+    for (i = 0; i < q; i++) b[15 - i] = (uint8_t)((uint64_t)len >> (8 * i));
+    mac = aes128_encrypt(rk, _mm_loadu_si128((const __m128i *)b));
+
+    /*the length of the additional data followed by the data itself*/
+    if (aad_len != 0) {
+        memset(b, 0, sizeof(b));
+        if (aad_len < 0xff00) {
+            b[0] = (uint8_t)(aad_len >> 8);
+            b[1] = (uint8_t)aad_len;
+            n = 2;
+        } else {
+            b[0] = 0xff;
+            b[1] = 0xfe;
+            b[2] = (uint8_t)(aad_len >> 24);
+            b[3] = (uint8_t)(aad_len >> 16);
+            b[4] = (uint8_t)(aad_len >> 8);
+            b[5] = (uint8_t)aad_len;
+            n = 6;
+        }
+        i = aad_len < 16 - n ? aad_len : 16 - n;
+        memcpy(b + n, aad, i);
+        mac = aes128_encrypt(
+            rk, _mm_xor_si128(mac, _mm_loadu_si128((const __m128i *)b)));
+        for (; i < aad_len; i += 16) {
+            x = load_partial(aad + i, aad_len - i);
+            mac = aes128_encrypt(rk, _mm_xor_si128(mac, x));
+        }
+    }
+
+    /*A_0, the counter blocks A_i differ in the counter only*/
+    memset(b, 0, sizeof(b));
+    b[0] = (uint8_t)(q - 1);
+    memcpy(b + 1, nonce, nonce_len);
+    a0 = _mm_loadu_si128((const __m128i *)b);
+    s0 = aes128_encrypt(rk, a0);
+
+    for (i = 0, j = 1; i < len; i += 16, j++) {
+        n = len - i < 16 ? len - i : 16;
+        a = ctr_block(a0, j);
+        x = load_partial(in + i, n);
+        if (op == ENCRYPT) {
+            mac = _mm_xor_si128(mac, x);
+            aes128_encrypt2(rk, &mac, &a);
+            y = _mm_xor_si128(x, a);
+        } else {
+            /*the MAC of the previous plaintext block with this keystream*/
+            if (j > 1) {
+                mac = _mm_xor_si128(mac, prev);
+                aes128_encrypt2(rk, &mac, &a);
+            } else {
+                a = aes128_encrypt(rk, a);
+            }
+            y = _mm_xor_si128(x, a);
+            prev = y;
+            if (n < 16) prev = load_partial((const uint8_t *)&y, n);
+        }
+        store_partial(out + i, y, n);
+    }
+    if (op == DECRYPT && len != 0) {
+        mac = aes128_encrypt(rk, _mm_xor_si128(mac, prev));
+    }
+
+    _mm_storeu_si128((__m128i *)t, _mm_xor_si128(mac, s0));
+    if (op == ENCRYPT) {
+        memcpy(out + len, t, tag_len);
+    } else {
+        for (i = 0; i < tag_len; i++) diff |= t[i] ^ in[len + i];
+    }
+    memset(t, 0, sizeof(t));
+    if (diff != 0) {
+        memset(out, 0, len);
+        return CRYPTO_BACKEND_AUTH_FAILED;
+    }
+    return CRYPTO_BACKEND_OK;
+}
+
+AESNI static int aesni_ccm(
+    enum aes_operation op,
+    const uint8_t *key,
+    const uint8_t *nonce, uint8_t nonce_len,
+    const uint8_t *aad, uint32_t aad_len,
+    const uint8_t *in, uint32_t in_len,
+    uint8_t *out, uint8_t tag_len) {
+    __m128i rk[11];
+    int r;
+
+    aes128_key_expand(key, rk);
+    r = aesni_ccm_rk(op, rk, nonce, nonce_len, aad, aad_len, in, in_len, out,
+                     tag_len);
+    memset(rk, 0, sizeof(rk));
+    return r;
+}
+
+/*the prepared key is the expanded key schedule*/
+AESNI static void aesni_key_init(uint8_t *state, const uint8_t *key) {
+    __m128i rk[11];
+    uint8_t i;
+
+    aes128_key_expand(key, rk);
+    for (i = 0; i < 11; i++) _mm_storeu_si128((__m128i *)state + i, rk[i]);
+    memset(rk, 0, sizeof(rk));
+}
+
+AESNI static int aesni_ccm_key(
+    enum aes_operation op,
+    const uint8_t *state,
+    const uint8_t *nonce, uint8_t nonce_len,
+    const uint8_t *aad, uint32_t aad_len,
+    const uint8_t *in, uint32_t in_len,
+    uint8_t *out, uint8_t tag_len) {
+    __m128i rk[11];
+    uint8_t i;
+    int r;
+
+    for (i = 0; i < 11; i++) {
+        rk[i] = _mm_loadu_si128((const __m128i *)state + i);
+    }
+    r = aesni_ccm_rk(op, rk, nonce, nonce_len, aad, aad_len, in, in_len, out,
+                     tag_len);
+    memset(rk, 0, sizeof(rk));
+    return r;
+}
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+/*sha256rnds2 keeps the chaining value as ABEF and CDGH, it is rearranged
+once per call. m[] holds the last 16 words of the message schedule, four
+rounds use one vector of it and replace it by the one four vectors ahead.*/
+SHANI static void shani_sha256_blocks(
+    uint32_t state[8], const uint8_t *in, uint32_t blocks) {
+    const __m128i bswap =
+        _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i abef, cdgh, abef_save, cdgh_save, t, k, m[4];
+    uint8_t i;
+
+    t = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xb1);
+    cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]),
+                             0x1b);
+    abef = _mm_alignr_epi8(t, cdgh, 8);
+    cdgh = _mm_blend_epi16(cdgh, t, 0xf0);
+
+    for (; blocks != 0; blocks--, in += CRYPTO_SHA256_BLOCK_SIZE) {
+        abef_save = abef;
+        cdgh_save = cdgh;
+        for (i = 0; i < 4; i++) {
+            m[i] = _mm_shuffle_epi8(
+                _mm_loadu_si128((const __m128i *)in + i), bswap);
+        }
+        for (i = 0; i < 16; i++) {
+            k = _mm_add_epi32(
+                m[i & 3], _mm_loadu_si128((const __m128i *)&sha256_k[4 * i]));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, k);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh,
+                                         _mm_shuffle_epi32(k, 0x0e));
+            if (i < 12) {
+                t = _mm_add_epi32(
+                    _mm_sha256msg1_epu32(m[i & 3], m[(i + 1) & 3]),
+                    _mm_alignr_epi8(m[(i + 3) & 3], m[(i + 2) & 3], 4));
+                m[i & 3] = _mm_sha256msg2_epu32(t, m[(i + 3) & 3]);
+            }
+        }
+        abef = _mm_add_epi32(abef, abef_save);
+        cdgh = _mm_add_epi32(cdgh, cdgh_save);
+    }
+
+    t = _mm_shuffle_epi32(abef, 0x1b);
+    cdgh = _mm_shuffle_epi32(cdgh, 0xb1);
+    _mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(t, cdgh, 0xf0));
+    _mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(cdgh, t, 8));
+}
+
+static const struct crypto_backend crypto_backend_aesni_shani = {
+    .name = "x86-64 AES-NI SHA-NI",
+    .aes_ccm = aesni_ccm,
+    .aes_key_init = aesni_key_init,
+    .aes_ccm_key = aesni_ccm_key,
+    .sha256_blocks = shani_sha256_blocks,
+};
+
+static const struct crypto_backend crypto_backend_aesni = {
+    .name = "x86-64 AES-NI",
+    .aes_ccm = aesni_ccm,
+    .aes_key_init = aesni_key_init,
+    .aes_ccm_key = aesni_ccm_key,
+    .sha256_blocks = crypto_sha256_blocks_portable,
+};
+
+static const struct crypto_backend crypto_backend_shani = {
+    .name = "x86-64 SHA-NI",
+    .aes_ccm = crypto_aes_ccm_portable,
+    .aes_key_init = crypto_aes_key_init_portable,
+    .aes_ccm_key = crypto_aes_ccm_key_portable,
+    .sha256_blocks = shani_sha256_blocks,
+};
+
+const struct crypto_backend *__attribute__((weak)) crypto_backend_x86_64(
+    void) {
+    unsigned int eax, ebx, ecx, edx;
+    int aes, sha = 0;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return NULL;
+    if (!(ecx & bit_SSE4_1)) return NULL;
+    aes = (ecx & bit_AES) != 0;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        sha = (ebx & bit_SHA) != 0;
+    }
+
+    if (aes && sha) return &crypto_backend_aesni_shani;
+    if (aes) return &crypto_backend_aesni;
+    if (sha) return &crypto_backend_shani;
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,140 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#if defined(EDHOC_WITH_ASYNC_CRYPTO) || defined(OSCORE_WITH_ASYNC_CRYPTO)
+
+#include "../inc/fiber.h"
+
+#include <string.h>
+
+/*
+ * States of a fiber. The function runs on the stack of the fiber until it
+ * returns (FIBER_DONE) or waits for an operation. Between fiber_wait_begin()
+ * and the switch back to the owner the fiber is FIBER_SUSPENDING. If the
+ * operation completes in this window the fiber goes directly to FIBER_READY
+ * and is resumed by the owner without a ready callback. Otherwise the owner
+ * marks it FIBER_SUSPENDED and fiber_wake() calls the ready callback.
+ */
+enum fiber_state {
+    FIBER_IDLE,
+    FIBER_RUNNING,
+    FIBER_SUSPENDING,
+    FIBER_SUSPENDED,
+    FIBER_READY,
+    FIBER_DONE,
+};
+
+static __thread struct fiber *current;
+
+static inline uint32_t state_get(struct fiber *f) {
+    return __atomic_load_n(&f->state, __ATOMIC_ACQUIRE);
+}
+
+static inline void state_set(struct fiber *f, uint32_t s) {
+    __atomic_store_n(&f->state, s, __ATOMIC_RELEASE);
+}
+
+static void fiber_entry(void) {
+    struct fiber *f = current;
+
+    f->fn(f);
+    state_set(f, FIBER_DONE);
+    /*returning continues with uc_link, i.e., f->caller*/
+}
+
+/**
+ * @brief   Switches to a fiber until its function returns or waits
+ * @retval  true if the function returned
+ */
+static bool fiber_switch(struct fiber *f) {
+    struct fiber *prev = current;
+    uint32_t expected;
+
+    while (1) {
+        state_set(f, FIBER_RUNNING);
+        current = f;
+        swapcontext(&f->caller, &f->ctx);
+        current = prev;
+
+        if (state_get(f) == FIBER_DONE) {
+            state_set(f, FIBER_IDLE);
+            return true;
+        }
+        expected = FIBER_SUSPENDING;
+        if (__atomic_compare_exchange_n(&f->state, &expected, FIBER_SUSPENDED,
+                                        false, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        /*FIBER_READY, the operation completed while the fiber switched back*/
+    }
+}
+
+void fiber_init(
+    struct fiber *f, void *stack, uint32_t stack_size,
+    void (*ready)(struct fiber *f, void *arg), void *ready_arg) {
+    memset(f, 0, sizeof(*f));
+    f->stack = stack;
+    f->stack_size = stack_size;
+    f->ready = ready;
+    f->ready_arg = ready_arg;
+    state_set(f, FIBER_IDLE);
+}
+
+bool fiber_start(struct fiber *f, void (*fn)(struct fiber *f)) {
+    f->fn = fn;
+    /*the fiber starts over at fiber_entry() every time*/
+    getcontext(&f->ctx);
+    f->ctx.uc_stack.ss_sp = f->stack;
+    f->ctx.uc_stack.ss_size = f->stack_size;
+    f->ctx.uc_link = &f->caller;
+    makecontext(&f->ctx, fiber_entry, 0);
+    return fiber_switch(f);
+}
+
+bool fiber_resume(struct fiber *f) {
+    return fiber_switch(f);
+}
+
+struct fiber *fiber_current(void) {
+    return current;
+}
+
+struct fiber *fiber_wait_begin(void) {
+    struct fiber *f = current;
+
+    state_set(f, FIBER_SUSPENDING);
+    /*an operation computed while it is handed over must not wait again*/
+    current = NULL;
+    return f;
+}
+
+void fiber_wait(struct fiber *f, bool handed_over) {
+    current = f;
+    if (handed_over && state_get(f) != FIBER_READY) {
+        swapcontext(&f->ctx, &f->caller);
+    }
+    state_set(f, FIBER_RUNNING);
+}
+
+void fiber_wake(struct fiber *f) {
+    /*f may be resumed as soon as it is FIBER_READY*/
+    void (*ready)(struct fiber * f, void *arg) = f->ready;
+    void *ready_arg = f->ready_arg;
+
+    /*a fiber which did not switch back yet is resumed by its owner*/
+    if (__atomic_exchange_n(&f->state, FIBER_READY, __ATOMIC_ACQ_REL) ==
+            FIBER_SUSPENDED &&
+        ready != NULL) {
+        ready(f, ready_arg);
+    }
+}
+
+#endif
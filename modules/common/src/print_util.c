@@ -12,6 +12,8 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "../inc/print_util.h"
+
 void print_array(uint8_t* in_data, uint16_t in_len) {
     //fflush(stdout);
     printf(" (size %u):", in_len);
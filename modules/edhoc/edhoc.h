@@ -14,12 +14,17 @@
 
 #include <stdint.h>
 
-#include "inc/byte_array.h"
+#include "inc/admission.h"
+#include "../common/inc/byte_array.h"
 #include "inc/edhoc_method_type.h"
+#include "inc/ephemeral_key_pool.h"
 #include "inc/error.h"
+#include "inc/revocation_list.h"
 #include "inc/messages.h"
 #include "inc/print_util.h"
 #include "inc/suites.h"
+#include "inc/trace.h"
+#include "inc/workspace.h"
 
 /*define EDHOC_BUF_SIZES_RPK in order to use smaller buffers and save some RAM if need when RPKs are used*/
 #ifndef EDHOC_BUF_SIZES_RPK
@@ -74,6 +79,63 @@
 #define SHA_DEFAULT_SIZE 32
 #define AEAD_KEY_DEFAULT_SIZE 16
 #define AEAD_IV_DEFAULT_SIZE 13
+/*maximal number of certificates in x5chain or x5bag*/
+#define CERT_CHAIN_MAX_DEPTH 4
+
+/*workspace needed by edhoc_initiator_run(), i.e., the sum of the buffers 
+carved from it*/
+#define EDHOC_INITIATOR_WORKSPACE_SIZE                                 \
+    (WORKSPACE_ALIGN_UP(MSG_1_DEFAULT_SIZE) +                          \
+     3 * WORKSPACE_ALIGN_UP(MSG_2_DEFAULT_SIZE) + /*msg2, K_2e, P_2e*/ \
+     WORKSPACE_ALIGN_UP(ID_CRED_DEFAULT_SIZE) +                        \
+     WORKSPACE_ALIGN_UP(A_2M_DEFAULT_SIZE) +                           \
+     WORKSPACE_ALIGN_UP(M_3_DEFAULT_SIZE) +                            \
+     WORKSPACE_ALIGN_UP(PRK_3AE_DEFAULT_SIZE) +                        \
+     WORKSPACE_ALIGN_UP(A_3AE_DEFAULT_SIZE) +                          \
+     2 * WORKSPACE_ALIGN_UP(PRK_3AE_DEFAULT_SIZE + 16 + 3) +           \
+     WORKSPACE_ALIGN_UP(MSG_3_DEFAULT_SIZE))
+
+/*workspace needed by edhoc_responder_run()*/
+#define EDHOC_RESPONDER_WORKSPACE_SIZE                                       \
+    (WORKSPACE_ALIGN_UP(MSG_1_DEFAULT_SIZE) +                                \
+     WORKSPACE_ALIGN_UP(MSG_2_DEFAULT_SIZE) +                                \
+     2 * WORKSPACE_ALIGN_UP(MSG_3_DEFAULT_SIZE) + /*msg3, P_3ae*/            \
+     3 * WORKSPACE_ALIGN_UP(CIPHERTEXT2_DEFAULT_SIZE) + /*P_2e, K_2e, CT_2*/ \
+     2 * WORKSPACE_ALIGN_UP(A_2M_DEFAULT_SIZE) +                             \
+     WORKSPACE_ALIGN_UP(A_3AE_DEFAULT_SIZE) +                                \
+     WORKSPACE_ALIGN_UP(ID_CRED_DEFAULT_SIZE))
+
+/*
+ * State token of the stateless responder, see 
+ * edhoc_responder_stateless_msg2(): epoch || nonce || ciphertext || tag
+ */
+#define EDHOC_STATE_NONCE_SIZE AEAD_IV_DEFAULT_SIZE
+#define EDHOC_STATE_TAG_SIZE 8
+#define EDHOC_STATE_TOKEN_SIZE                                              \
+    (1 + EDHOC_STATE_NONCE_SIZE + 4 + C_I_DEFAULT_SIZE + SHA_DEFAULT_SIZE + \
+     PRK_DEFAULT_SIZE + 1 + EPHEMERAL_KEY_DEFAULT_SIZE + EDHOC_STATE_TAG_SIZE)
+
+/**
+ * Local keys with which the stateless responder seals its state. The keys 
+ * never leave the responder. Each rotation starts a new epoch. Tokens of the 
+ * current and the previous epoch are accepted, i.e., a half-open handshake 
+ * expires after two rotations. A token is accepted only once, the nonces of 
+ * the used tokens are kept per epoch until the epoch is rotated out.
+ *
+ * The handshakes take a reference on the key and the slots of an epoch 
+ * while they copy the key or record a nonce. A rotation retires the 
+ * previous epoch, waits for its references and only then reuses its key and 
+ * slots for the new epoch, which it publishes with a single atomic store.
+ */
+struct edhoc_state_keys {
+    uint8_t key[2][AEAD_KEY_DEFAULT_SIZE]; /*key of epoch e is key[e & 1]*/
+    uint32_t epoch; /*current epoch in the low byte, see responder.c*/
+    uint32_t readers[2]; /*references on key[i] and used[i]*/
+    bool rotating;
+    uint64_t* used[2];  /*nonces of the used tokens of epoch e in used[e & 1], 0 marks a free slot*/
+    uint32_t used_cnt[2]; /*used slots of used[i]*/
+    uint32_t used_num; /*slots per epoch*/
+};
 
 struct other_party_cred {
     struct byte_array id_cred; /*ID_CRED_x of the other party*/
@@ -82,6 +144,21 @@ struct other_party_cred {
     struct byte_array g;       /*authentication static DH pub key of other party */
     struct byte_array ca;      /*use only when authentication with certificates*/
     struct byte_array ca_pk;   /*use only when authentication with certificates*/
+    uint8_t x5t_hash[SHA_DEFAULT_SIZE]; /*SHA-256 thumbprint of cred, see edhoc_x5t_index()*/
+    uint8_t x5t_hash_len;               /*0 if cred is not indexed*/
+};
+
+/*a CA trusted to issue certificates of other parties*/
+struct trust_anchor {
+    struct byte_array subject; /*name of the CA as contained in the issuer field of certificates*/
+    struct byte_array pk;      /*public key of the CA*/
+};
+
+/*trust anchors sorted by subject, see edhoc_trust_anchors_init()*/
+struct trust_anchor_store {
+    struct trust_anchor* anchors;
+    uint16_t num;
+    int64_t now; /*current time in seconds since the epoch, kept up to date by the application*/
 };
 
 struct edhoc_responder_context {
@@ -96,6 +173,10 @@ struct edhoc_responder_context {
     struct byte_array cred_r;
     struct byte_array sk_r; /*sign key -use with method 0 and 2*/
     struct byte_array pk_r; /*coresp. pub key to sk_r -use with method 0 and 2*/
+    struct ephemeral_key_pool* key_pool; /*if not NULL g_y and y are taken from the pool*/
+    struct edhoc_workspace* workspace;   /*if not NULL the handshake buffers are taken from the workspace instead of the stack*/
+    const struct trust_anchor_store* trust_anchors; /*if not NULL certificates are verified with these CAs instead of ca and ca_pk of the other_party_cred*/
+    const struct revocation_list* revoked;          /*if not NULL certificates contained in the list are rejected*/
 };
 
 struct edhoc_initiator_context {
@@ -113,6 +194,10 @@ struct edhoc_initiator_context {
     struct byte_array i;    /* static DH sk -> use only with method 2 or 3*/
     struct byte_array sk_i; /*sign key use with method 0 and 2*/
     struct byte_array pk_i; /*coresp. pub key to sk_r -use with method 0 and 2*/
+    struct ephemeral_key_pool* key_pool; /*if not NULL g_x and x are taken from the pool*/
+    struct edhoc_workspace* workspace;   /*if not NULL the handshake buffers are taken from the workspace instead of the stack*/
+    const struct trust_anchor_store* trust_anchors; /*if not NULL certificates are verified with these CAs instead of ca and ca_pk of the other_party_cred*/
+    const struct revocation_list* revoked;          /*if not NULL certificates contained in the list are rejected*/
 };
 
 /**
@@ -120,6 +205,9 @@ struct edhoc_initiator_context {
  *          
  *          IMPORTANT!!! PROVIDE A GOOD RANDOM SEED! 
  *
+ *          The seed has only 32 bit. Prefer ephemeral_dh_key_pair_gen() or an
+ *          ephemeral_key_pool.
+ *
  * @param   curve DH curve to used
  * @param   seed a random seed
  * @param   sk pointer to a buffer where the secret key will be strored
@@ -129,6 +217,30 @@ EdhocError __attribute__((weak)) ephemeral_dh_key_gen(
     enum ecdh_curve curve, uint32_t seed,
     uint8_t *sk, uint8_t *pk);
 
+/**
+ * @brief   Generates public and private ephemeral DH keys using the output of 
+ *          random_bytes()
+ *
+ * @param   curve DH curve to used
+ * @param   sk pointer to a buffer where the secret key will be strored
+ * @param   pk pointer to a buffer where the public key will be strored
+ */
+EdhocError __attribute__((weak)) ephemeral_dh_key_pair_gen(
+    enum ecdh_curve curve,
+    uint8_t *sk, uint8_t *pk);
+
+/**
+ * @brief   Returns the size of the workspace edhoc_initiator_run() needs, 
+ *          i.e., EDHOC_INITIATOR_WORKSPACE_SIZE as the library was built
+ */
+uint32_t edhoc_initiator_workspace_size(void);
+
+/**
+ * @brief   Returns the size of the workspace edhoc_responder_run() needs, 
+ *          i.e., EDHOC_RESPONDER_WORKSPACE_SIZE as the library was built
+ */
+uint32_t edhoc_responder_workspace_size(void);
+
 /**
  * @brief   Executes the EDHOC protocol on the initiator side
  * @param   c cointer to a structure containing initialization parameters
@@ -154,6 +266,26 @@ EdhocError edhoc_initiator_run(
     uint8_t* prk_4x3m, uint8_t prk_4x3m_len,
     uint8_t* th4, uint8_t th4_len);
 
+/**
+ * @brief   Executes the EDHOC protocol on the initiator side like 
+ *          edhoc_initiator_run() but does not send message 3. Message 3 is
+ *          returned instead so that it can be sent together with the first
+ *          OSCORE request in a combined request (see 
+ *          oscore_combined_request_build()). This saves a round trip.
+ * @param   msg3 buffer for message 3
+ * @param   msg3_len in: size of msg3, out: length of message 3
+ *
+ * For the other parameters see edhoc_initiator_run().
+ */
+EdhocError edhoc_initiator_run_combined(
+    const struct edhoc_initiator_context* c,
+    struct other_party_cred* cred_r_array, uint16_t num_cred_r,
+    uint8_t* err_msg, uint32_t* err_msg_len,
+    uint8_t* ad_2, uint64_t* ad_2_len,
+    uint8_t* prk_4x3m, uint8_t prk_4x3m_len,
+    uint8_t* th4, uint8_t th4_len,
+    uint8_t* msg3, uint32_t* msg3_len);
+
 /**
  * @brief   Executes the EDHOC protocol on the responder side
  * @param   c cointer to a structure containing initialization parameters
@@ -173,6 +305,11 @@ EdhocError edhoc_initiator_run(
  * @param   prk_4x3m_len length of prk_4x3m
  * @param   th4 transcript hash4 used in the exporter interface
  * @param   th4_len length of th4
+ *
+ * Message 3 is received through rx(). If it arrives in a combined 
+ * EDHOC+OSCORE request, rx() returns the message 3 extracted with 
+ * oscore_combined_request_split() and the OSCORE request is processed once 
+ * the OSCORE context was derived.
  */
 EdhocError edhoc_responder_run(
     struct edhoc_responder_context* c,
@@ -184,6 +321,129 @@ EdhocError edhoc_responder_run(
     uint8_t* prk_4x3m, uint16_t prk_4x3m_len,
     uint8_t* th4, uint16_t th4_len);
 
+/**
+ * @brief   Checks the structure of a received message 1 without any 
+ *          cryptographic operation: CBOR encoding, method, length of G_X and 
+ *          C_I, no trailing bytes. A responder calls this before it admits 
+ *          a handshake (see admission.h), so that malformed messages do not 
+ *          cost an ECDH. Message 1 with an unsupported cipher suite passes, 
+ *          the responder answers it with an error message which is cheap.
+ * @param   msg1 the received message 1
+ * @param   msg1_len length of msg1
+ * @retval  an EdhocError code
+ */
+EdhocError edhoc_msg1_prevalidate(uint8_t* msg1, uint32_t msg1_len);
+
+/**
+ * @brief   Initializes the state keys of the stateless responder with a 
+ *          random key
+ * @param   keys the state keys
+ * @param   used caller provided memory for the nonces of the used state 
+ *          tokens. Each of the two accepted epochs gets half of it, i.e., 
+ *          used_len / 2 handshakes can be completed per epoch. Keep it 
+ *          well above the handshakes per rotation interval, the slots are 
+ *          searched linearly from a hash of the nonce.
+ * @param   used_len number of elements of used, at least 2
+ */
+EdhocError edhoc_state_keys_init(
+    struct edhoc_state_keys* keys, uint64_t* used, uint32_t used_len);
+
+/**
+ * @brief   Starts a new epoch with a new random key. State tokens sealed 
+ *          two epochs ago or earlier are rejected afterwards. Thread safe, 
+ *          it can be called from a timer while handshakes use the keys. 
+ *          Tokens of the previous epoch are rejected as soon as the rotation 
+ *          starts. It then waits until no handshake reads the key or the 
+ *          slots of that epoch, which a handshake does only for a few 
+ *          instructions and without waiting for anything. A call while 
+ *          another rotation runs returns right away, the epoch is advanced 
+ *          once. Once all slots of an epoch are used further tokens are 
+ *          rejected with TooManyHandshakes until the epoch is rotated out, 
+ *          see edhoc_state_keys_init().
+ * @param   keys the state keys
+ */
+EdhocError edhoc_state_keys_rotate(struct edhoc_state_keys* keys);
+
+/**
+ * @brief   Like edhoc_state_keys_rotate(), but rotates only if at least 
+ *          min_used slots of the current epoch are used, i.e., min_used 
+ *          handshakes were completed in it. The slots are counted under the 
+ *          rotation, so that callers which race on a full epoch rotate it 
+ *          once, see executor.h.
+ * @param   keys the state keys
+ * @param   min_used used slots that trigger the rotation
+ */
+EdhocError edhoc_state_keys_rotate_used(
+    struct edhoc_state_keys* keys, uint32_t min_used);
+
+/**
+ * @brief   Executes the first half of the EDHOC protocol on the responder 
+ *          side without keeping any state: processes message 1 and creates 
+ *          message 2. The state needed for message 3 is encrypted with the 
+ *          current state key into state_token. The caller sends message 2 
+ *          and carries the token with it so that it is returned together 
+ *          with message 3, e.g., as CoAP token (RFC 8974) of the exchange. 
+ *          Between message 2 and message 3 the responder holds no memory 
+ *          for the handshake.
+ * @param   c cointer to a structure containing initialization parameters
+ * @param   keys the state keys
+ * @param   msg1 the received message 1
+ * @param   msg1_len length of msg1
+ * @param   ad_1 the received in msg1 additional data is provided to the caller 
+ *          through ad_1
+ * @param   ad_1_len length of ad_1
+ * @param   msg2 buffer for message 2. If the selected cipher suite is not 
+ *          supported it contains an error message to be sent and 
+ *          ErrorMessageSent is returned.
+ * @param   msg2_len in: size of msg2, out: length of msg2
+ * @param   state_token buffer of at least EDHOC_STATE_TOKEN_SIZE bytes
+ * @param   state_token_len in: size of state_token, out: length of the token
+ *
+ * The state token is not placed in C_R since C_R is part of TH_2 from 
+ * which the state itself is derived.
+ */
+EdhocError edhoc_responder_stateless_msg2(
+    struct edhoc_responder_context* c,
+    struct edhoc_state_keys* keys,
+    uint8_t* msg1, uint32_t msg1_len,
+    uint8_t* ad_1, uint64_t* ad_1_len,
+    uint8_t* msg2, uint32_t* msg2_len,
+    uint8_t* state_token, uint32_t* state_token_len);
+
+/**
+ * @brief   Executes the second half of the EDHOC protocol on the responder 
+ *          side: restores the state from a state token created by 
+ *          edhoc_responder_stateless_msg2() and processes message 3. Returns 
+ *          InvalidStateToken if the token was modified, has expired or was 
+ *          already used, i.e., a replayed message 3 is rejected. The token is 
+ *          used up as soon as it is opened, also if message 3 is rejected 
+ *          afterwards. Concurrent calls with the same keys are thread safe.
+ * @param   c the same context as in edhoc_responder_stateless_msg2()
+ * @param   keys the state keys, the nonce of the token is recorded
+ * @param   state_token the state token
+ * @param   state_token_len length of state_token
+ * @param   msg3 the received message 3
+ * @param   msg3_len length of msg3
+ * @param   err_msg if an error message is received instead of message 3 it 
+ *          is provided to the caller (ErrorMessageReceived). If the 
+ *          initiator cannot be authenticated err_msg contains the error 
+ *          message to be sent (ResponderAuthenticationFailed).
+ * @param   err_msg_len in: size of err_msg, out: length of err_msg
+ *
+ * For the other parameters see edhoc_responder_run().
+ */
+EdhocError edhoc_responder_stateless_msg3(
+    struct edhoc_responder_context* c,
+    struct edhoc_state_keys* keys,
+    struct other_party_cred* cred_i_array,
+    uint16_t num_cred_i,
+    const uint8_t* state_token, uint32_t state_token_len,
+    uint8_t* msg3, uint32_t msg3_len,
+    uint8_t* err_msg, uint32_t* err_msg_len,
+    uint8_t* ad_3, uint64_t* ad_3_len,
+    uint8_t* prk_4x3m, uint16_t prk_4x3m_len,
+    uint8_t* th4, uint16_t th4_len);
+
 /**
  * @brief   used to create application specific symmetric keys using the 
  *          calculated in edhoc_initiator_run()/edhoc_responder_run() prk_4x3m
@@ -206,4 +466,84 @@ EdhocError edhoc_exporter(
     const char* label,
     uint8_t* out,
     uint16_t out_len);
+
+/**
+ * @brief   derives the OSCORE master secret and master salt in one call. 
+ *          The result is the same as of two edhoc_exporter() calls with the 
+ *          labels "OSCORE Master Secret" and "OSCORE Master Salt", but the 
+ *          HMAC key setup and the encoding of the common part of the HKDF 
+ *          infos are done only once.
+ * @param   app_hash_alg hash algorithm to be used in the derivation
+ * @param   app_aead_alg AEAD algorithm to be used in the derivation
+ * @param   prk_4x3m derived key
+ * @param   prk_4x3m_len length of prk_4x3m
+ * @param   th4 transcripthash see edhoc_initiator_run()/edhoc_responder_run()
+ * @param   th4_len length of th4
+ * @param   master_secret container for the OSCORE master secret
+ * @param   master_secret_len length of the OSCORE master secret
+ * @param   master_salt container for the OSCORE master salt
+ * @param   master_salt_len length of the OSCORE master salt
+ */
+EdhocError edhoc_exporter_oscore(
+    enum hash_alg app_hash_alg,
+    enum aead_alg app_aead_alg,
+    const uint8_t* prk_4x3m, uint16_t prk_4x3m_len,
+    const uint8_t* th4, uint16_t th4_len,
+    uint8_t* master_secret, uint16_t master_secret_len,
+    uint8_t* master_salt, uint16_t master_salt_len);
+
+/**
+ * @brief   EDHOC-KeyUpdate, i.e., PRK_4x3m = HKDF-Extract(nonce, PRK_4x3m).
+ *          Both parties call it with the same nonce and then derive fresh 
+ *          application keys with edhoc_exporter(), e.g., an OSCORE master 
+ *          secret and salt for oscore_context_key_update(). This refreshes 
+ *          the keys without a new handshake. The nonce must not be reused 
+ *          and is exchanged by the application.
+ * @param   app_hash_alg hash algorithm of the HKDF
+ * @param   nonce the nonce
+ * @param   nonce_len length of nonce
+ * @param   prk_4x3m the current PRK_4x3m, overwritten with the updated one
+ * @param   prk_4x3m_len length of prk_4x3m
+ */
+EdhocError edhoc_key_update(
+    enum hash_alg app_hash_alg,
+    const uint8_t* nonce, uint32_t nonce_len,
+    uint8_t* prk_4x3m, uint16_t prk_4x3m_len);
+
+/**
+ * @brief   Computes the SHA-256 thumbprints of the credentials (certificates)
+ *          in cred_array once, so that a peer sending ID_CRED_x = {x5t: 
+ *          [alg, hash]} is resolved by comparing hashes instead of hashing 
+ *          every stored certificate during each handshake. cred_array is 
+ *          sorted in place by thumbprint, so that the certificate is found 
+ *          with a binary search, and must not be reordered afterwards. A 
+ *          matching certificate is taken from the local store and is not 
+ *          verified again. If cred_array is not indexed, the certificates 
+ *          are hashed on demand.
+ * @param   cred_array an array containing credentials 
+ * @param   cred_num number of elements in cred_array
+ */
+EdhocError edhoc_x5t_index(
+    struct other_party_cred* cred_array, uint16_t cred_num);
+
+/**
+ * @brief   Sets up a trust anchor store. The anchors are sorted in place by 
+ *          subject so that the issuer of a certificate is found with a binary 
+ *          search. Certificate chains (x5chain) and bags (x5bag) may contain 
+ *          intermediate CAs, only the last CA on the path must be in the 
+ *          store. Several anchors with the same subject, e.g., during a key 
+ *          rollover, are all tried. anchors must stay valid as long as the 
+ *          store is used. Every certificate on the path must be valid at 
+ *          store->now and every certificate issuing another one must have 
+ *          the keyCertSign key usage. Without a store (ca and ca_pk of the 
+ *          other_party_cred) the validity period is not checked.
+ * @param   store the store
+ * @param   anchors the trusted CAs
+ * @param   num number of elements in anchors
+ * @param   now the current time in seconds since the epoch
+ */
+EdhocError edhoc_trust_anchors_init(
+    struct trust_anchor_store* store,
+    struct trust_anchor* anchors, uint16_t num,
+    int64_t now);
 #endif
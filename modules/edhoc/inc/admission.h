@@ -0,0 +1,75 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <stdint.h>
+
+#include "error.h"
+
+/*
+ * Admission control of a responder. The expensive part of a handshake (ECDH, 
+ * signature) starts only after message 1 passed edhoc_msg1_prevalidate() and 
+ * a token was taken from a token bucket. The bucket limits the rate at which 
+ * handshakes are started, max_active limits how many are running at once. 
+ * The functions do no locking, a caller with several threads serializes the 
+ * calls.
+ */
+
+/*counters of the admission decisions, never reset*/
+struct admission_stats {
+    uint32_t admitted;
+    uint32_t malformed;    /*message 1 failed the structural check*/
+    uint32_t rate_limited; /*the bucket was empty*/
+    uint32_t busy;         /*max_active handshakes were running*/
+};
+
+struct admission {
+    uint32_t rate;       /*handshakes per second added to the bucket*/
+    uint32_t burst;      /*size of the bucket in handshakes*/
+    uint32_t max_active; /*0 for no limit*/
+    uint32_t active;
+    uint64_t tokens; /*in 1/1000 handshakes*/
+    uint32_t last_ms;
+    struct admission_stats stats;
+};
+
+/**
+ * @brief   Initializes an admission control with a full bucket
+ * @param   a the admission control
+ * @param   rate handshakes per second which are admitted in the long run
+ * @param   burst handshakes which are admitted at once after a quiet period
+ * @param   max_active handshakes which may run at the same time, 0 for no 
+ *          limit
+ * @param   now_ms the current time in milliseconds from a monotonic clock, 
+ *          wrap around is allowed
+ */
+void admission_init(
+    struct admission *a,
+    uint32_t rate, uint32_t burst, uint32_t max_active,
+    uint32_t now_ms);
+
+/**
+ * @brief   Takes a token for a new handshake. On success the caller must 
+ *          call admission_release() when the handshake ended.
+ * @param   a the admission control
+ * @param   now_ms the current time in milliseconds, see admission_init()
+ * @retval  EdhocNoError, TooManyHandshakes or HandshakeRateLimited
+ */
+EdhocError admission_acquire(struct admission *a, uint32_t now_ms);
+
+/**
+ * @brief   Marks a handshake admitted with admission_acquire() as ended
+ * @param   a the admission control
+ */
+void admission_release(struct admission *a);
+
+#endif
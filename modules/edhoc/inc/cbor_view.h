@@ -0,0 +1,72 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifndef EDHOC_CBOR_VIEW_H
+#define EDHOC_CBOR_VIEW_H
+
+#include <cbor.h>
+#include <stdint.h>
+
+#include "../../common/inc/byte_array.h"
+#include "error.h"
+
+/**
+ * A decoded CBOR data item. Byte and text strings are not copied, view 
+ * points into the input buffer. For maps and arrays only the head is 
+ * consumed, the elements are the following data items.
+ */
+struct cbor_item {
+    CborType type;
+    int64_t int_val;        /*value of an integer*/
+    uint64_t len;           /*number of elements of a map or an array*/
+    struct byte_array view; /*content of a byte or a text string*/
+};
+
+/**
+ * @brief   Decodes the next data item of a CBOR sequence. On success in is 
+ *          advanced past the item.
+ * @param   in the not yet parsed part of the input buffer
+ * @param   item the decoded data item
+ * @retval  an EdhocError code
+ */
+EdhocError cbor_item_next(struct byte_array *in, struct cbor_item *item);
+
+/**
+ * @brief   Skips the next data item including all elements of nested maps 
+ *          and arrays
+ * @param   in the not yet parsed part of the input buffer
+ * @retval  an EdhocError code
+ */
+EdhocError cbor_item_skip(struct byte_array *in);
+
+/**
+ * @brief   Decodes the next data item which must be a byte string
+ * @param   in the not yet parsed part of the input buffer
+ * @param   out view of the content of the byte string
+ * @retval  an EdhocError code
+ */
+EdhocError cbor_bstr_next(struct byte_array *in, struct byte_array *out);
+
+/**
+ * @brief   Decodes the next data item which must be a bstr_identifier, i.e., 
+ *          a byte string or an integer encoding a single byte identifier as 
+ *          (value - 24). In the second case the identifier is written to 
+ *          single and out points to single.
+ * @param   in the not yet parsed part of the input buffer
+ * @param   single storage for a single byte identifier
+ * @param   out view of the identifier
+ * @retval  an EdhocError code
+ */
+EdhocError cbor_bstr_identifier_next(
+    struct byte_array *in,
+    uint8_t *single,
+    struct byte_array *out);
+
+#endif
@@ -0,0 +1,248 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifndef CRYPTO_ASYNC_H
+#define CRYPTO_ASYNC_H
+
+/*
+ * Asynchronous crypto provider, built with -DEDHOC_WITH_ASYNC_CRYPTO on
+ * hosts with <ucontext.h>.
+ *
+ * A protocol step, e.g., edhoc_responder_stateless_msg2(), is run as a
+ * crypto task on a stack of its own. While the task runs, aead(), sign(),
+ * verify(), shared_secret_derive(), hkdf_extract(), hkdf_expand() and
+ * hkdf_expand_prk() do not compute the result themselves but hand a
+ * struct crypto_op to the provider of the task. If the provider does not
+ * complete the operation right away, the task is suspended and
+ * crypto_task_start() returns CryptoPending to the caller, which can do
+ * other work in the meantime. The provider calls crypto_op_complete() when
+ * the result is ready, possibly from another thread, which in turn calls the
+ * ready callback of the task. The owner then continues the protocol step
+ * with crypto_task_resume(). A task is a fiber of the common module, see
+ * fiber.h, which is shared with the crypto tasks of OSCORE.
+ *
+ * A provider runs an operation with crypto_op_run(), e.g., on a crypto
+ * thread pool, or hands it to an offload engine. Operations which are not
+ * worth the round trip, e.g., a single HKDF-Expand block, can be completed
+ * inside submit().
+ */
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../../common/inc/fiber.h"
+#include "crypto_wrapper.h"
+#include "error.h"
+#include "suites.h"
+
+enum crypto_op_type {
+    CRYPTO_OP_AEAD,
+    CRYPTO_OP_SIGN,
+    CRYPTO_OP_VERIFY,
+    CRYPTO_OP_SHARED_SECRET,
+    CRYPTO_OP_HKDF_EXTRACT,
+    CRYPTO_OP_HKDF_EXPAND,
+    CRYPTO_OP_HKDF_EXPAND_PRK,
+};
+
+struct crypto_task;
+
+/**
+ * A crypto operation handed to a provider. The arguments are the ones of the
+ * synchronous function of the same name, the buffers they point to stay
+ * valid until the operation is completed.
+ */
+struct crypto_op {
+    enum crypto_op_type type;
+    union {
+        struct {
+            enum aes_operation op;
+            const uint8_t *in;
+            uint16_t in_len;
+            const uint8_t *key;
+            uint16_t key_len;
+            uint8_t *nonce;
+            uint16_t nonce_len;
+            const uint8_t *aad;
+            uint16_t aad_len;
+            uint8_t *out;
+            uint16_t out_len;
+            uint8_t *tag;
+            uint16_t tag_len;
+        } aead;
+        struct {
+            enum sign_alg_curve curve;
+            const uint8_t *sk;
+            uint8_t sk_len;
+            const uint8_t *pk;
+            uint8_t pk_len;
+            const uint8_t *msg;
+            uint16_t msg_len;
+            uint8_t *out;
+            uint32_t *out_len;
+        } sign;
+        struct {
+            enum sign_alg_curve curve;
+            const uint8_t *pk;
+            uint8_t pk_len;
+            const uint8_t *msg;
+            uint16_t msg_len;
+            const uint8_t *sgn;
+            uint16_t sgn_len;
+            bool *result;
+        } verify;
+        struct {
+            enum ecdh_curve curve;
+            const uint8_t *sk;
+            uint32_t sk_len;
+            const uint8_t *pk;
+            uint32_t pk_len;
+            uint8_t *shared_secret;
+        } shared_secret;
+        struct {
+            enum hash_alg alg;
+            const uint8_t *salt;
+            uint32_t salt_len;
+            uint8_t *ikm;
+            uint8_t ikm_len;
+            uint8_t *out;
+        } hkdf_extract;
+        struct {
+            enum hash_alg alg;
+            const uint8_t *prk;
+            uint8_t prk_len;
+            const uint8_t *info;
+            uint8_t info_len;
+            uint8_t *out;
+            uint64_t out_len;
+        } hkdf_expand;
+        struct {
+            const struct hkdf_prk *k;
+            const uint8_t *info;
+            uint8_t info_len;
+            uint8_t *out;
+            uint64_t out_len;
+        } hkdf_expand_prk;
+    } u;
+    EdhocError r;            /*result, set by crypto_op_complete()*/
+    struct crypto_task *task; /*the suspended task, set by the library*/
+};
+
+struct crypto_provider {
+    /**
+     * @brief   Starts an operation. crypto_op_complete() must be called
+     *          exactly once for every operation accepted, from any thread and
+     *          possibly before submit() returns.
+     * @param   p the provider
+     * @param   op the operation
+     * @retval  an EdhocError code, on error op is not completed and the
+     *          error is returned to the protocol step
+     */
+    EdhocError (*submit)(struct crypto_provider *p, struct crypto_op *op);
+    void *ctx; /*not used by the library*/
+};
+
+/*a crypto task must have at least this stack, the protocol steps keep their
+buffers on it*/
+#ifndef CRYPTO_TASK_MIN_STACK_SIZE
+#define CRYPTO_TASK_MIN_STACK_SIZE 16384
+#endif
+
+/**
+ * A protocol step which can be suspended while the provider computes. A
+ * task must always be started and resumed by the same thread.
+ */
+struct crypto_task {
+    struct fiber f; /*first member*/
+    struct crypto_provider *provider;
+    void (*ready)(struct crypto_task *t, void *arg);
+    void *ready_arg;
+    EdhocError (*fn)(void *arg);
+    void *arg;
+    EdhocError r;
+};
+
+/**
+ * @brief   Initializes a task
+ * @param   t the task
+ * @param   stack stack of the task, at least CRYPTO_TASK_MIN_STACK_SIZE
+ *          bytes. If the protocol step is run without a workspace, the
+ *          workspace size of the step must be added, e.g.,
+ *          EDHOC_RESPONDER_WORKSPACE_SIZE.
+ * @param   stack_size size of stack
+ * @param   provider the provider the operations are handed to
+ * @param   ready called by crypto_op_complete() when the task can be
+ *          resumed. It is called from the thread of the provider and must
+ *          not resume the task itself but wake up its owner.
+ * @param   ready_arg argument of ready
+ * @retval  an EdhocError code
+ */
+EdhocError crypto_task_init(
+    struct crypto_task *t,
+    void *stack, uint32_t stack_size,
+    struct crypto_provider *provider,
+    void (*ready)(struct crypto_task *t, void *arg), void *ready_arg);
+
+/**
+ * @brief   Runs fn(arg) as the protocol step of a task until it returns or
+ *          waits for the provider. A task can be started again after its
+ *          step returned.
+ * @param   t the task
+ * @param   fn the protocol step
+ * @param   arg argument of fn
+ * @retval  CryptoPending if the step waits for the provider, otherwise the
+ *          return value of fn
+ */
+EdhocError crypto_task_start(
+    struct crypto_task *t, EdhocError (*fn)(void *arg), void *arg);
+
+/**
+ * @brief   Continues a suspended task after its ready callback was called
+ * @param   t the task
+ * @retval  CryptoPending if the step waits for the provider again,
+ *          otherwise the return value of the step
+ */
+EdhocError crypto_task_resume(struct crypto_task *t);
+
+/**
+ * @brief   Completes an operation, to be called by the provider
+ * @param   op the operation
+ * @param   r the result of the operation
+ */
+void crypto_op_complete(struct crypto_op *op, EdhocError r);
+
+/**
+ * @brief   Computes an operation synchronously with aead(), sign(), ... To be
+ *          called by providers which compute in software, e.g., on another
+ *          thread.
+ * @param   op the operation
+ * @retval  the result of the operation
+ */
+EdhocError crypto_op_run(struct crypto_op *op);
+
+/**
+ * @brief   Returns the task running on the calling thread, NULL outside of a
+ *          task and while an operation is computed inside submit()
+ */
+struct crypto_task *crypto_task_current(void);
+
+/**
+ * @brief   Hands an operation to the provider of the running task and
+ *          suspends the task until it is completed. Used by the default
+ *          crypto functions, an application which replaces them can use it
+ *          in the same way.
+ * @param   op the operation
+ * @retval  the result of the operation
+ */
+EdhocError crypto_offload(struct crypto_op *op);
+
+#endif
+#endif
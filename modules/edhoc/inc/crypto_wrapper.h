@@ -11,20 +11,16 @@
 #ifndef CRYPTO_WRAPPER_H
 #define CRYPTO_WRAPPER_H
 
-#include "byte_array.h"
+#include "../../common/inc/byte_array.h"
+#include "../../common/inc/crypto_backend.h"
 #include "error.h"
 #include "suites.h"
 
-/*Indicates what kind of operation a symmetric cipher will execute*/
-enum aes_operation {
-    ENCRYPT,
-    DECRYPT,
-};
-
 /**
  * @brief   Calculates AEAD encryption decryption
  * @param   op opeartion to be executed (ENCRYPT or DECRYPT)
- * @param   in  input message
+ * @param   in  input message, when decrypting the ciphertext followed by 
+ *          the tag
  * @param   in_len length of in
  * @param   key the symmetric key to be used
  * @param   key_len length of key
@@ -32,8 +28,9 @@ enum aes_operation {
  * @param   nonce_len length of nonce
  * @param   aad additional authenticated data
  * @param   aad_len length of add
- * @param   out the cipher text
- * @param   out_len the length of out
+ * @param   out the cipher text, when encrypting followed by the tag, i.e., 
+ *          out must have space for in_len + tag_len bytes
+ * @param   out_len the length of out, DestBufferToSmall if it is too short
  * @param   tag the authentication tag
  * @param   tag_len the length of tag
  * @retval  an EdhocError code 
@@ -95,6 +92,53 @@ EdhocError hkdf_expand(
     const uint8_t *info, const uint8_t info_len,
     uint8_t *out, uint64_t out_len);
 
+/*size of the implementation specific part of struct hkdf_prk, large enough
+for the keyed HMAC-SHA256 state of crypto_backend.h*/
+#ifndef HKDF_PRK_STATE_SIZE
+#define HKDF_PRK_STATE_SIZE 256
+#endif
+
+/**
+ * A PRK prepared for several HKDF-Expand calls. The HMAC key setup is done 
+ * once in hkdf_prk_init() and shared by all hkdf_expand_prk() calls, i.e., 
+ * by all iterations and all labels derived from the same PRK. The state 
+ * contains key material and should be cleared after use.
+ */
+struct hkdf_prk {
+    enum hash_alg alg;
+    union {
+        uint64_t align;
+        uint8_t bytes[HKDF_PRK_STATE_SIZE];
+    } ctx;
+};
+
+/**
+ * @brief   Prepares a PRK for hkdf_expand_prk()
+ * @param   alg hash algorithm to be used
+ * @param   prk input pseudo random key
+ * @param   prk_len length of prk
+ * @param   k the prepared PRK
+ * @retval  an EdhocError code
+ */
+EdhocError hkdf_prk_init(
+    enum hash_alg alg,
+    const uint8_t *prk, uint8_t prk_len,
+    struct hkdf_prk *k);
+
+/**
+ * @brief   HKDF expand function with a PRK prepared by hkdf_prk_init()
+ * @param   k the prepared PRK
+ * @param   info info input parameter
+ * @param   info_len length of info
+ * @param   out the result
+ * @param   out_len length of out
+ * @retval  an EdhocError code
+ */
+EdhocError hkdf_expand_prk(
+    const struct hkdf_prk *k,
+    const uint8_t *info, uint8_t info_len,
+    uint8_t *out, uint64_t out_len);
+
 /**
  * @brief   calculates a hash
  * @param   alg the hash algorithm
@@ -109,6 +153,52 @@ EdhocError hash(
     const uint64_t in_len,
     uint8_t *out);
 
+/*size of the implementation specific part of struct hash_state, large 
+enough for the SHA-256 state of crypto_backend.h*/
+#ifndef HASH_STATE_SIZE
+#define HASH_STATE_SIZE 128
+#endif
+
+/**
+ * State of an incremental hash calculation. The content of ctx is defined 
+ * by the implementation of hash_init(), hash_update() and hash_final() and 
+ * must not contain pointers into the state itself, so that a state can be 
+ * forked by a plain assignment, e.g., to finalize a transcript hash while 
+ * the original state is kept.
+ */
+struct hash_state {
+    enum hash_alg alg;
+    union {
+        uint64_t align;
+        uint8_t bytes[HASH_STATE_SIZE];
+    } ctx;
+};
+
+/**
+ * @brief   Starts an incremental hash calculation
+ * @param   alg the hash algorithm
+ * @param   s the state to be initialized
+ * @retval  an EdhocError code
+ */
+EdhocError hash_init(enum hash_alg alg, struct hash_state *s);
+
+/**
+ * @brief   Absorbs data into an incremental hash calculation
+ * @param   s the state
+ * @param   in input data
+ * @param   in_len length of in
+ * @retval  an EdhocError code
+ */
+EdhocError hash_update(struct hash_state *s, const uint8_t *in, uint32_t in_len);
+
+/**
+ * @brief   Completes an incremental hash calculation. s is invalidated.
+ * @param   s the state
+ * @param   out the hash
+ * @retval  an EdhocError code
+ */
+EdhocError hash_final(struct hash_state *s, uint8_t *out);
+
 /**
  * @brief   Verifies an asymmetric signature
  * @param   curve   the curve to be used
@@ -130,7 +220,11 @@ EdhocError sign(
     uint8_t *out, uint32_t *out_len);
 
 /**
- * @brief   Verifies an asymmetric signature
+ * @brief   Verifies an asymmetric signature. Ed25519 signatures are checked 
+ *          with the cofactored equation [8][S]B = [8]R + [8][k]A of RFC8032 
+ *          section 5.1.7, R and A must be canonical encodings and S must be 
+ *          smaller than the group order. verify_batch() accepts the same 
+ *          signatures. With EDHOC_WITH_OPENSSL libcrypto decides.
  * @param   curve   the curve to be used
  * @param   pk public key
  * @param   pk_len length of pk
@@ -148,5 +242,132 @@ EdhocError verify(
     const uint8_t *sgn, const uint16_t sgn_len,
     bool *result);
 
+/*maximal number of signatures combined in one batch equation, every one
+takes about 400 bytes of stack in verify_batch()*/
+#ifndef VERIFY_BATCH_MAX_SIZE
+#define VERIFY_BATCH_MAX_SIZE 8
+#endif
+
+/*a signature queued for verify_batch()*/
+struct verify_batch_item {
+    const uint8_t *pk;
+    uint8_t pk_len;
+    const uint8_t *msg;
+    uint16_t msg_len;
+    const uint8_t *sgn;
+    uint16_t sgn_len;
+    bool result; /*set by verify_batch()*/
+};
+
+/**
+ * @brief   Verifies a batch of independent signatures, e.g., the signatures 
+ *          in message 3 of concurrent handshakes. With Ed25519 up to 
+ *          VERIFY_BATCH_MAX_SIZE signatures are checked with one randomized 
+ *          multi-scalar multiplication of the equation of verify(). If it 
+ *          fails the signatures of the batch are verified one by one with 
+ *          verify() to find the invalid ones. Other curves are always 
+ *          verified one by one. The batch is computed on the calling 
+ *          thread, also inside a crypto task.
+ * @param   curve the curve to be used
+ * @param   items the signatures, the result of every item is set
+ * @param   items_num number of items
+ * @param   all_valid true if all signatures are valid
+ * @retval  an EdhocError code
+ */
+EdhocError verify_batch(
+    enum sign_alg_curve curve,
+    struct verify_batch_item *items, uint16_t items_num,
+    bool *all_valid);
+
+/**
+ * @brief   Fills a buffer with output of a cryptographically secure random
+ *          number generator. The default implementation uses getrandom() on
+ *          Linux and sys_csrand_get() on Zephyr. On other platforms it must
+ *          be provided by the user.
+ * @param   out buffer for the random bytes
+ * @param   out_len number of random bytes
+ * @retval  an EdhocError code
+ */
+EdhocError random_bytes(uint8_t *out, uint32_t out_len);
+
+#if defined(EDHOC_WITH_TINYCRYPT_AND_C25519) || defined(EDHOC_WITH_P256_64) || \
+    defined(EDHOC_WITH_OPENSSL)
+#define EDHOC_WITH_P256
+#endif
+
+/*size of a P-256 scalar, coordinate or ECDH secret*/
+#define P256_SCALAR_SIZE 32
+/*size of an ES256 signature r || s*/
+#define P256_SIGNATURE_SIZE 64
+
+/*
+The following P-256 primitives are used by shared_secret_derive(), sign(),
+verify() and the ephemeral key generation for cipher suites 2 and 3. They
+are implemented with TinyCrypt in crypto_wrapper.c or, if EDHOC_WITH_P256_64
+is defined, in crypto_wrapper_p256_64.c, or with libcrypto in
+crypto_wrapper_openssl.c if EDHOC_WITH_OPENSSL is defined. Scalars and coordinates are big
+endian. Public keys are accepted as x coordinate only (32 bytes), compressed
+(33 bytes), x || y (64 bytes) or uncompressed (65 bytes) point. A signature
+can not be verified with the x coordinate only.
+*/
+
+/**
+ * @brief   Computes the x coordinate of sk*G
+ * @param   sk private key
+ * @param   pk the x coordinate of the public key
+ * @retval  InvalidPrivateKey if sk is 0 or not smaller than the group order
+ */
+EdhocError p256_public_key(const uint8_t *sk, uint8_t *pk);
+
+/**
+ * @brief   Generates a fresh P-256 key pair with random_bytes()
+ * @param   sk private key
+ * @param   pk the x coordinate of the public key
+ * @retval  an EdhocError code
+ */
+EdhocError p256_key_pair_gen(uint8_t *sk, uint8_t *pk);
+
+/**
+ * @brief   Computes the P-256 ECDH shared secret, i.e., the x coordinate
+ *          of sk*pk
+ * @param   sk private key
+ * @param   pk public key
+ * @param   pk_len length of pk
+ * @param   shared_secret the result
+ * @retval  an EdhocError code
+ */
+EdhocError p256_shared_secret(
+    const uint8_t *sk,
+    const uint8_t *pk, uint32_t pk_len,
+    uint8_t *shared_secret);
+
+/**
+ * @brief   Computes an ES256 signature
+ * @param   sk private key
+ * @param   msg the message to be signed
+ * @param   msg_len length of msg
+ * @param   sgn the signature r || s
+ * @retval  an EdhocError code
+ */
+EdhocError p256_sign(
+    const uint8_t *sk,
+    const uint8_t *msg, uint16_t msg_len,
+    uint8_t *sgn);
+
+/**
+ * @brief   Verifies an ES256 signature
+ * @param   pk public key
+ * @param   pk_len length of pk
+ * @param   msg the signed message
+ * @param   msg_len length of msg
+ * @param   sgn the signature r || s
+ * @param   result true if the signature is valid
+ * @retval  an EdhocError code
+ */
+EdhocError p256_verify(
+    const uint8_t *pk, uint32_t pk_len,
+    const uint8_t *msg, uint16_t msg_len,
+    const uint8_t *sgn,
+    bool *result);
 
 #endif
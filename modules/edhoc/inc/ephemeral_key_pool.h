@@ -0,0 +1,93 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifndef EPHEMERAL_KEY_POOL_H
+#define EPHEMERAL_KEY_POOL_H
+
+#include <stdint.h>
+
+#include "error.h"
+#include "suites.h"
+
+/*number of precomputed key pairs held by a pool, must be a power of two*/
+#ifndef EPHEMERAL_KEY_POOL_SIZE
+#define EPHEMERAL_KEY_POOL_SIZE 16
+#endif
+
+#define EPHEMERAL_KEY_DEFAULT_SIZE 32
+
+struct ephemeral_key_pair {
+    uint8_t sk[EPHEMERAL_KEY_DEFAULT_SIZE];
+    uint8_t pk[EPHEMERAL_KEY_DEFAULT_SIZE];
+};
+
+/**
+ * Ring buffer of precomputed ephemeral DH key pairs.
+ *
+ * The pool has exactly one producer (ephemeral_key_pool_refill() called from
+ * a background thread or an idle hook) and one consumer (the handshakes
+ * using the pool). A key pair is erased from the pool when it is taken, so
+ * it is never handed out twice. Use one pool per handshake thread.
+ */
+struct ephemeral_key_pool {
+    enum ecdh_curve curve;
+    uint32_t head;   /*next slot to fill, written by the producer only*/
+    uint32_t tail;   /*next slot to take, written by the consumer only*/
+    uint32_t misses; /*key pairs generated on demand, see take()*/
+    struct ephemeral_key_pair slots[EPHEMERAL_KEY_POOL_SIZE];
+};
+
+/**
+ * @brief   Initializes an empty key pool
+ * @param   pool the pool
+ * @param   curve DH curve of the key pairs held by the pool
+ * @retval  an EdhocError code
+ */
+EdhocError ephemeral_key_pool_init(
+    struct ephemeral_key_pool *pool,
+    enum ecdh_curve curve);
+
+/**
+ * @brief   Generates fresh key pairs until the pool is full or max_keys key
+ *          pairs were generated. To be called by the producer, e.g., a
+ *          background thread or an idle hook.
+ * @param   pool the pool
+ * @param   max_keys upper bound for the number of generated key pairs
+ * @retval  an EdhocError code
+ */
+EdhocError ephemeral_key_pool_refill(
+    struct ephemeral_key_pool *pool,
+    uint32_t max_keys);
+
+/**
+ * @brief   Returns the number of key pairs ready in the pool
+ * @param   pool the pool
+ */
+uint32_t ephemeral_key_pool_available(struct ephemeral_key_pool *pool);
+
+/**
+ * @brief   Takes a key pair out of the pool. If the pool is empty or curve
+ *          is not the curve of the pool a fresh key pair is generated on
+ *          the spot and pool->misses is incremented.
+ * @param   pool the pool
+ * @param   curve DH curve the key pair is needed for
+ * @param   sk buffer for the secret key
+ * @param   sk_len length of sk
+ * @param   pk buffer for the public key
+ * @param   pk_len length of pk
+ * @retval  an EdhocError code
+ */
+EdhocError ephemeral_key_pool_take(
+    struct ephemeral_key_pool *pool,
+    enum ecdh_curve curve,
+    uint8_t *sk, uint32_t sk_len,
+    uint8_t *pk, uint32_t pk_len);
+
+#endif
@@ -21,6 +21,25 @@ enum role {
     RESPONDER
 };
 
+/**
+ * @brief   creates an error message
+ * @param   role INITIATOR or RESPONDER
+ * @param   c_x connection identifier
+ * @param   c_x_len length of c_x
+ * @param   err_msg_str human readable error message string
+ * @param   err_msg_str_len length of err_msg_str
+ * @param   suites list of suported suites. To be used only after message 1
+ * @param   suites_len length of suites
+ * @param   out buffer for the error message
+ * @param   out_len in: size of out, out: length of the error message
+ */
+EdhocError err_msg_encode(
+    enum role role, uint8_t corr,
+    uint8_t* c_x, uint8_t c_x_len,
+    uint8_t* err_msg_str, uint8_t err_msg_str_len,
+    uint8_t* suites, uint8_t suites_len,
+    uint8_t* out, uint32_t* out_len);
+
 /**
  * @brief   creates and sends an error message
  * @param   role INITIATOR or RESPONDER
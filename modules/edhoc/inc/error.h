@@ -41,6 +41,26 @@ typedef enum EdhocError {
     CborByteStringBufferToSmall = 19,
     ErrorDuringCborDecoding = 20,
     UnsupportedEcdhCurve = 21,
+    ErrorDuringRandomGeneration = 22,
+    UnsupportedSignatureCurve = 23,
+    InvalidPublicKey = 24,
+    InvalidPrivateKey = 25,
+    ErrorDuringSigning = 26,
+    WorkspaceTooSmall = 27,
+    TransportError = 28,
+    UnsupportedHashAlg = 29,
+    CertificateChainTooLong = 30,
+    InvalidRevocationList = 31,
+    CertificateRevoked = 32,
+    InvalidStateToken = 33,
+    HandshakeRateLimited = 34,
+    TooManyHandshakes = 35,
+    MalformedMessage = 36,
+    CryptoPending = 37,
+    CryptoLibraryError = 38,
+    CertificateExpired = 39,
+    InvalidArgument = 40,
+    ThreadCreationFailed = 41,
 } EdhocError;
 
 #endif
@@ -0,0 +1,239 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+/*
+ * Handshake executor for hosts with POSIX threads, built with
+ * -DEDHOC_WITH_EXECUTOR.
+ *
+ * The executor runs the stateless responder (see
+ * edhoc_responder_stateless_msg2()) on a pool of worker threads. The I/O
+ * thread submits a job per received message 1 or message 3 and collects the
+ * finished jobs with edhoc_executor_poll(). Every worker has its own job
+ * queue, workspace and ephemeral key pool. Jobs are distributed round robin,
+ * a worker whose queue is empty steals from the others. The job queues are
+ * bounded FIFOs under a mutex, not work-stealing deques: they are filled by
+ * the I/O thread and not by their worker, and the owner and the thieves
+ * take the oldest job so that handshakes are served in order. Finished jobs are
+ * returned through a lock-free multi-producer single-consumer queue. An idle
+ * worker refills its key pool, so that the ECDH key generation is moved out
+ * of the handshake.
+ *
+ * If the library is also built with -DEDHOC_WITH_ASYNC_CRYPTO, the crypto of
+ * the jobs can be handed to a crypto provider (see crypto_async.h). A worker
+ * then keeps up to EDHOC_EXECUTOR_TASKS jobs in flight and runs other jobs
+ * while the provider computes. The Ed25519 signatures the tasks verify, i.e.,
+ * the ones of message 3 and of the certificates of the initiators, are not
+ * handed to the provider. The worker queues them and verifies them together
+ * with verify_batch() once it can not start another job.
+ *
+ * The workers rotate the state keys (see edhoc_state_keys_rotate()) once
+ * EDHOC_EXECUTOR_ROTATE_FILL percent of the slots of the current epoch are
+ * used, so that a running executor does not run out of slots. The slots of
+ * an epoch must therefore hold well above the handshakes that are in flight
+ * at once, otherwise a token can be rotated out before its message 3 is
+ * processed. The application may in addition rotate from a timer to bound
+ * the lifetime of the tokens, the rotation is thread safe.
+ */
+#ifdef EDHOC_WITH_EXECUTOR
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../edhoc.h"
+#include "crypto_async.h"
+
+/*number of jobs a worker queue holds, must be a power of two*/
+#ifndef EDHOC_EXECUTOR_QUEUE_SIZE
+#define EDHOC_EXECUTOR_QUEUE_SIZE 64
+#endif
+
+/*percent of the slots of an epoch after which the workers rotate the keys*/
+#ifndef EDHOC_EXECUTOR_ROTATE_FILL
+#define EDHOC_EXECUTOR_ROTATE_FILL 50
+#endif
+
+#define EDHOC_JOB_IN_SIZE                                                  \
+    (MSG_1_DEFAULT_SIZE > MSG_3_DEFAULT_SIZE ? MSG_1_DEFAULT_SIZE \
+                                             : MSG_3_DEFAULT_SIZE)
+
+enum edhoc_job_type {
+    EDHOC_JOB_MSG2, /*process message 1 and create message 2*/
+    EDHOC_JOB_MSG3, /*process message 3*/
+};
+
+/**
+ * A step of a responder handshake. The job is owned by the caller and must
+ * not be touched between edhoc_executor_submit() and the moment it is
+ * returned by edhoc_executor_poll().
+ */
+struct edhoc_job {
+    /*set by the caller*/
+    enum edhoc_job_type type;
+    void *user; /*not used by the executor, e.g., the session*/
+    uint8_t in[EDHOC_JOB_IN_SIZE]; /*message 1 or message 3*/
+    uint32_t in_len;
+    /*state token, created by EDHOC_JOB_MSG2 and used by EDHOC_JOB_MSG3*/
+    uint8_t state[EDHOC_STATE_TOKEN_SIZE];
+    uint32_t state_len;
+
+    /*set by the executor*/
+    EdhocError r;
+    /*message 2 or an error message, see edhoc_responder_stateless_msg2()
+    and edhoc_responder_stateless_msg3()*/
+    uint8_t out[MSG_2_DEFAULT_SIZE];
+    uint32_t out_len;
+    uint8_t ad[AD_DEFAULT_SIZE]; /*AD_1 or AD_3*/
+    uint64_t ad_len;
+    uint8_t prk_4x3m[PRK_DEFAULT_SIZE];
+    uint8_t th4[SHA_DEFAULT_SIZE];
+
+    struct edhoc_job *next; /*link in the completion queue*/
+};
+
+/*bounded FIFO of the jobs of a worker*/
+struct edhoc_job_queue {
+    pthread_mutex_t lock;
+    uint32_t head; /*next job to take*/
+    uint32_t tail; /*next free slot*/
+    struct edhoc_job *jobs[EDHOC_EXECUTOR_QUEUE_SIZE];
+};
+
+struct edhoc_executor;
+struct edhoc_worker;
+struct crypto_provider;
+
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+/*jobs a worker keeps in flight while the provider computes for them*/
+#ifndef EDHOC_EXECUTOR_TASKS
+#define EDHOC_EXECUTOR_TASKS 4
+#endif
+
+/*a task keeps the buffers of the responder on its stack*/
+#define EDHOC_EXECUTOR_TASK_STACK_SIZE \
+    (CRYPTO_TASK_MIN_STACK_SIZE + EDHOC_RESPONDER_WORKSPACE_SIZE)
+
+struct edhoc_executor_task {
+    struct crypto_task t;
+    struct edhoc_worker *w;
+    struct edhoc_job *job; /*NULL if the task is free*/
+    struct edhoc_executor_task *next_ready;
+    uint64_t stack[EDHOC_EXECUTOR_TASK_STACK_SIZE / sizeof(uint64_t)];
+};
+#endif
+
+struct edhoc_worker {
+    struct edhoc_executor *ex;
+    pthread_t thread;
+    struct edhoc_job_queue queue;
+    struct ephemeral_key_pool pool;
+    struct edhoc_workspace ws;
+    uint64_t ws_buf[EDHOC_RESPONDER_WORKSPACE_SIZE / sizeof(uint64_t)];
+    uint64_t done;   /*jobs run by this worker*/
+    uint64_t stolen; /*jobs this worker took from another queue*/
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    struct edhoc_executor_task tasks[EDHOC_EXECUTOR_TASKS];
+    struct edhoc_executor_task *ready; /*tasks to resume, under idle_lock*/
+    uint32_t busy;                     /*tasks with a job*/
+    uint64_t suspended; /*times a task waited for the provider*/
+    /*provider of the tasks, queues the Ed25519 verifications and hands the
+    other operations to the provider of the executor*/
+    struct crypto_provider verifier;
+    struct crypto_op *verify_ops[EDHOC_EXECUTOR_TASKS];
+    uint32_t verify_cnt;
+    uint64_t batched; /*signatures verified with verify_batch()*/
+    uint64_t batches; /*calls of verify_batch()*/
+#endif
+};
+
+struct edhoc_executor {
+    struct edhoc_worker *workers;
+    uint32_t num_workers;
+    struct edhoc_responder_context c; /*copied by every worker*/
+    struct other_party_cred *cred_i_array;
+    uint16_t num_cred_i;
+    struct edhoc_state_keys *keys;
+    struct crypto_provider *provider;
+    void (*notify)(void *arg);
+    void *notify_arg;
+
+    uint32_t next;    /*queue of the next submission*/
+    uint32_t pending; /*jobs in the queues*/
+    bool stop;
+    /*idle workers wait for pending jobs*/
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+
+    /*completion queue, producers push at head, the consumer pops at tail*/
+    struct edhoc_job *cq_head;
+    struct edhoc_job *cq_tail;
+    struct edhoc_job cq_stub;
+};
+
+/**
+ * @brief   Starts the worker threads of an executor
+ * @param   ex the executor
+ * @param   workers caller provided memory for num_workers workers
+ * @param   num_workers number of worker threads, e.g., the number of cores
+ * @param   c the responder context. It is copied, workspace and key_pool are
+ *          replaced by the ones of the worker. The credentials it points to
+ *          must stay valid until edhoc_executor_stop() returned.
+ * @param   cred_i_array the credentials of the initiators, see
+ *          edhoc_responder_run(). Entries with x5t ID_CRED_I must be indexed
+ *          with edhoc_x5t_index() before, the workers only read them.
+ * @param   num_cred_i number of elements in cred_i_array
+ * @param   keys the state keys, see edhoc_state_keys_init(). The workers record
+ *          the used tokens in it and rotate it, see above.
+ * @param   curve DH curve of the ephemeral key pools of the workers
+ * @param   provider computes the crypto of the jobs, see crypto_async.h.
+ *          NULL to compute on the workers. Needs EDHOC_WITH_ASYNC_CRYPTO.
+ * @param   notify called by a worker after it finished a job, e.g., to wake
+ *          up the I/O thread. May be NULL.
+ * @param   notify_arg argument of notify
+ * @retval  an EdhocError code, InvalidArgument if num_workers is 0 or a
+ *          provider is passed without EDHOC_WITH_ASYNC_CRYPTO,
+ *          ThreadCreationFailed if a worker thread could not be created
+ */
+EdhocError edhoc_executor_start(
+    struct edhoc_executor *ex,
+    struct edhoc_worker *workers, uint32_t num_workers,
+    const struct edhoc_responder_context *c,
+    struct other_party_cred *cred_i_array, uint16_t num_cred_i,
+    struct edhoc_state_keys *keys,
+    enum ecdh_curve curve,
+    struct crypto_provider *provider,
+    void (*notify)(void *arg), void *notify_arg);
+
+/**
+ * @brief   Hands a job to the workers. Can be called from several threads.
+ * @param   ex the executor
+ * @param   job the job
+ * @retval  an EdhocError code, TooManyHandshakes if all queues are full
+ */
+EdhocError edhoc_executor_submit(struct edhoc_executor *ex, struct edhoc_job *job);
+
+/**
+ * @brief   Returns a finished job. Must be called from one thread only.
+ * @param   ex the executor
+ * @retval  the job or NULL if no job has finished
+ */
+struct edhoc_job *edhoc_executor_poll(struct edhoc_executor *ex);
+
+/**
+ * @brief   Runs the submitted jobs to completion and stops the workers
+ * @param   ex the executor
+ */
+void edhoc_executor_stop(struct edhoc_executor *ex);
+
+#endif
+#endif
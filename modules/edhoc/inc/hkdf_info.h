@@ -12,7 +12,7 @@
 #ifndef HKDF_INFO_H
 #define HKDF_INFO_H
 
-#include "byte_array.h"
+#include "../../common/inc/byte_array.h"
 #include "error.h"
 #include "suites.h"
 
@@ -28,7 +28,7 @@
  * @param   out_len length of out
  * @return  EdhocError
  */
-EdhocError create_hkdf_info(
+EdhocError hkdf_info_encode(
     enum aead_alg aead_alg,
     const uint8_t *th,
     uint8_t th_len,
@@ -37,4 +37,38 @@ EdhocError create_hkdf_info(
     uint8_t *out,
     uint8_t *out_len);
 
+/**
+ * @brief   Encodes the part of the HKDF Info which does not depend on the 
+ *          label, i.e., the array head, the AEAD Algorithm and the 
+ *          transcripthash. Infos for several labels with the same th can 
+ *          share it.
+ * @param   aead_alg AEAD Algorithm
+ * @param   th transcripthash
+ * @param   th_len length of th
+ * @param   out out-array
+ * @param   out_len length of out
+ * @return  EdhocError
+ */
+EdhocError hkdf_info_prefix_encode(
+    enum aead_alg aead_alg,
+    const uint8_t *th,
+    uint8_t th_len,
+    uint8_t *out,
+    uint8_t *out_len);
+
+/**
+ * @brief   Encodes the label and the okm length, which complete an HKDF Info
+ *          started with hkdf_info_prefix_encode()
+ * @param   label human readable label
+ * @param   okm_len length of output keying material
+ * @param   out out-array
+ * @param   out_len length of out
+ * @return  EdhocError
+ */
+EdhocError hkdf_info_label_encode(
+    const char *label,
+    uint64_t okm_len,
+    uint8_t *out,
+    uint8_t *out_len);
+
 #endif
@@ -12,18 +12,27 @@
 #define MEMCPY_S_H
 
 #include <stdint.h>
+#include <string.h>
 
 #include "error.h"
 
 /**
  * @brief memcpy_s (see [1]) may not be available in some setups thus our own 
- * implementation 
+ * implementation. Inline so that it does not clash with the one of the 
+ * OSCORE module when both modules are linked into one binary.
  * [1]: https://docs.microsoft.com/de-de/cpp/c-runtime-library/reference/memcpy-s-wmemcpy-s?view=msvc-160
  */
-EdhocError _memcpy_s(
+static inline EdhocError _memcpy_s(
     uint8_t *dest,
     uint64_t destSize,
     const uint8_t *src,
-    uint64_t count);
+    uint64_t count) {
+    if (destSize < count) {
+        return DestBufferToSmall;
+    } else if (count) {
+        memcpy(dest, src, count);
+    }
+    return EdhocNoError;
+}
 
 #endif
@@ -12,14 +12,21 @@
 #ifndef EDHOC_MESSAGES_H
 #define EDHOC_MESSAGES_H
 
-#include "byte_array.h"
+#include "../../common/inc/byte_array.h"
 
+/*
+ * Parsed messages. The byte_array members are views into the buffer holding 
+ * the received message, nothing is copied. Connection identifiers encoded 
+ * as integer (bstr_identifier) are decoded into the *_single members, the 
+ * corresponding view points there.
+ */
 struct msg_1 {
     uint8_t method_corr;
     struct byte_array suites_i;
     struct byte_array g_x;
     struct byte_array c_i;
     struct byte_array ad_1;
+    uint8_t c_i_single;
 };
 
 struct msg_2 {
@@ -27,6 +34,14 @@ struct msg_2 {
     struct byte_array g_y;
     struct byte_array c_r;
     struct byte_array ciphertext;
+    uint8_t c_i_single;
+    uint8_t c_r_single;
+};
+
+struct msg_3 {
+    struct byte_array c_r;
+    struct byte_array ciphertext;
+    uint8_t c_r_single;
 };
 
 struct error_msg {
@@ -40,4 +40,35 @@ EdhocError okm_calc(
     uint8_t* okm,
     uint64_t okm_len);
 
+/**
+ * @brief   derives a key and an IV from the same PRK and transcripthash, 
+ *          e.g., K_3ae and IV_3ae. The PRK is prepared for the HMAC only 
+ *          once for both.
+ * @param   aead_alg AEAD algorithm
+ * @param   hash_alg HASH algorithm 
+ * @param   label_k label of the key
+ * @param   label_iv label of the IV
+ * @param   prk pseudorandom key
+ * @param   prk_len length of prk
+ * @param   th transcripthash
+ * @param   th_len length of th
+ * @param   k ouput pointer of the key
+ * @param   k_len length of k
+ * @param   iv ouput pointer of the IV
+ * @param   iv_len length of iv
+ */ 
+EdhocError okm_key_iv_calc(
+    enum aead_alg aead_alg,
+    enum hash_alg hash_alg,
+    const char* label_k,
+    const char* label_iv,
+    const uint8_t* prk,
+    uint8_t prk_len,
+    const uint8_t* th,
+    uint8_t th_len,
+    uint8_t* k,
+    uint64_t k_len,
+    uint8_t* iv,
+    uint64_t iv_len);
+
 #endif
\ No newline at end of file
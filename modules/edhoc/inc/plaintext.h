@@ -14,6 +14,7 @@
 #include <cbor.h>
 #include <stdint.h>
 
+#include "../../common/inc/byte_array.h"
 #include "error.h"
 
 /**
@@ -44,16 +45,14 @@ EdhocError id_cred2kid(
  * @param   ptxt_len length of ptxt
  * @param   id_cred_x ID_CRED_x
  * @param   id_cred_x_len length of id_cred_x_len
- * @param   sign_or_mac signature or mac
- * @param   sign_or_mac_len length of sign_or_mac
- * @param   ad axillary data
- * @param   ad_len length of ad
+ * @param   sign_or_mac signature or mac, points into ptxt
+ * @param   ad axillary data, points into ptxt
  */ 
 EdhocError plaintext_split(
     uint8_t* ptxt, const uint16_t ptxt_len,
     uint8_t* id_cred_x, uint64_t* id_cred_x_len,
-    uint8_t* sign_or_mac, uint64_t* sign_or_mac_len,
-    uint8_t* ad, uint64_t* ad_len);
+    struct byte_array* sign_or_mac,
+    struct byte_array* ad);
 
 /**
  * @brief   Encodes a plaintext 
@@ -14,10 +14,8 @@
 
 #include <stdint.h>
 #include <stdio.h>
-/**
- *@brief prints an array for debug pourposes 
- */
-void print_array(uint8_t* in_data, uint16_t in_len);
+
+#include "../../common/inc/print_util.h"
 
 #ifdef EDHOC_DEBUG_PRINT
 #define PRINT_ARRAY(msg, a, a_len) \
@@ -30,11 +30,22 @@ enum id_cred_x_label {
     x5u = 35,
 };
 
+/*COSE hash algorithms supported in x5t*/
+enum x5t_hash_alg {
+    x5t_sha_256 = -16,
+    /*SHA-256 truncated to 64 bits*/
+    x5t_sha_256_64 = -15,
+};
+
 /**
  * @brief   retrives the credential of the other party and its static DH key 
  *          and when static DH authentication is used or public signature key 
  *          when digital signatures are used 
  * @param   static_dh_auth true if static DH authentication is used
+ * @param   trust_anchors the CAs used to verify certificates, if NULL the ca 
+ *          and ca_pk of the elements of cred_array are used
+ * @param   revoked if not NULL certificates contained in this revocation list
+ *          are rejected
  * @param   cred_array an array containing credentials 
  * @param   cred_num number of elements in cred_array
  * @param   id_cred ID_CRED_x
@@ -48,6 +59,8 @@ enum id_cred_x_label {
  */
 EdhocError retrieve_cred(
     bool static_dh_auth,
+    const struct trust_anchor_store* trust_anchors,
+    const struct revocation_list* revoked,
     struct other_party_cred* cred_array, uint16_t cred_num,
     uint8_t* id_cred, uint8_t id_cred_len,
     uint8_t** cred, uint16_t* cred_len,
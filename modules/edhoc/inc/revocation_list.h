@@ -0,0 +1,119 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifndef REVOCATION_LIST_H
+#define REVOCATION_LIST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "error.h"
+
+/*
+ * A revocation list is a flat buffer which is created offline (see
+ * revocation_list_encode()) and can be used in place, e.g., memory mapped
+ * from a file. All integers are big endian.
+ *
+ *  offset  size          content
+ *  0       4             magic "EDRL"
+ *  4       1             version, REVOCATION_LIST_VERSION
+ *  5       1             k, number of bit positions per entry in the filter
+ *  6       1             length of an entry, REVOCATION_HASH_SIZE
+ *  7       1             0
+ *  8       4             m, number of bits of the Bloom filter, a multiple of 8
+ *  12      4             n, number of entries
+ *  16      m / 8         Bloom filter
+ *  16+m/8  n * 16        entries sorted in ascending order
+ *
+ * An entry is the SHA-256 hash of a revoked certificate truncated to
+ * REVOCATION_HASH_SIZE bytes. Bit positions in the filter are derived from
+ * the entry by double hashing, see revocation_list.c.
+ */
+#define REVOCATION_LIST_VERSION 1
+#define REVOCATION_LIST_HEADER_SIZE 16
+#define REVOCATION_HASH_SIZE 16
+#define REVOCATION_BLOOM_MAX_K 16
+
+/**
+ * A view on a revocation list. The buffer is not copied and must stay valid
+ * as long as the view is used. To update the list without a restart a new
+ * view is set up for the new buffer and the revoked pointer of the contexts
+ * is switched between two handshakes.
+ */
+struct revocation_list {
+    const uint8_t *bloom;
+    uint32_t bloom_bits;
+    uint8_t k;
+    const uint8_t *entries;
+    uint32_t entry_num;
+};
+
+/**
+ * @brief   Sets up a view on a revocation list and checks its header and
+ *          length. The entries must be strictly ascending and contained in
+ *          the Bloom filter, as written by revocation_list_encode(), so that
+ *          no revoked entry is missed by a lookup. This costs one pass over
+ *          the entries.
+ * @param   rl the view
+ * @param   buf the revocation list
+ * @param   buf_len length of buf
+ * @retval  an EdhocError code
+ */
+EdhocError revocation_list_init(
+    struct revocation_list *rl,
+    const uint8_t *buf, uint32_t buf_len);
+
+/**
+ * @brief   Checks if an entry is contained in a revocation list. Most
+ *          certificates which are not revoked are rejected by the Bloom
+ *          filter after k bit tests. Only the others are searched in the
+ *          sorted entries.
+ * @param   rl the revocation list
+ * @param   entry a truncated SHA-256 hash of REVOCATION_HASH_SIZE bytes
+ * @param   revoked true if entry is contained in rl
+ */
+void revocation_list_lookup(
+    const struct revocation_list *rl,
+    const uint8_t *entry,
+    bool *revoked);
+
+/**
+ * @brief   Checks if a certificate is revoked
+ * @param   rl the revocation list
+ * @param   cert the certificate
+ * @param   cert_len length of cert
+ * @param   revoked true if the certificate is revoked
+ * @retval  an EdhocError code
+ */
+EdhocError revocation_list_check(
+    const struct revocation_list *rl,
+    const uint8_t *cert, uint32_t cert_len,
+    bool *revoked);
+
+/**
+ * @brief   Creates a revocation list. This is meant to be done offline, e.g.,
+ *          by a host tool which writes out to a file.
+ * @param   entries the truncated SHA-256 hashes of the revoked certificates
+ *          (n * REVOCATION_HASH_SIZE bytes) sorted in ascending order, e.g.,
+ *          with qsort() and memcmp()
+ * @param   entry_num number of entries
+ * @param   bloom_bits size of the Bloom filter in bits, a multiple of 8.
+ *          About 10 bits per entry with k = 7 give 1% false positives.
+ * @param   k number of bit positions per entry
+ * @param   out buffer for the revocation list
+ * @param   out_len in: size of out, out: length of the revocation list
+ * @retval  an EdhocError code
+ */
+EdhocError revocation_list_encode(
+    const uint8_t *entries, uint32_t entry_num,
+    uint32_t bloom_bits, uint8_t k,
+    uint8_t *out, uint32_t *out_len);
+
+#endif
@@ -11,10 +11,41 @@
 #ifndef TH_H
 #define TH_H
 
-#include "byte_array.h"
+#include "../../common/inc/byte_array.h"
+#include "crypto_wrapper.h"
 #include "error.h"
 #include "suites.h"
 
+/**
+ * @brief   starts the calculation of transcript hash th2 by absorbing 
+ *          message 1. Can be called as soon as message 1 was sent or 
+ *          received.
+ * @param   alg hash algorithm to be used
+ * @param   msg1 pointer to a message 1
+ * @param   msg1_len length of message 1
+ * @param   th2_state ouput hash state
+ */
+EdhocError th2_init(
+    enum hash_alg alg,
+    uint8_t* msg1, uint32_t msg1_len,
+    struct hash_state* th2_state);
+
+/**
+ * @brief   completes transcript hash th2 on a copy of th2_state, i.e., 
+ *          th2_state is not modified
+ * @param   th2_state hash state returned by th2_init()
+ * @param   c_i Pointer to the conception identifier of the initiator
+ * @param   g_y Pointer to the public DH parameter
+ * @param   c_r Pointer to the conception identifier of the responder
+ * @param   th2 ouput buffer
+ */
+EdhocError th2_final(
+    const struct hash_state* th2_state,
+    uint8_t* c_i, uint32_t c_i_len,
+    uint8_t* g_y, uint32_t g_y_len,
+    uint8_t* c_r, uint32_t c_r_len,
+    uint8_t* th2);
+
 /**
  * @brief   calculates transcript hash th2 
  * @param   alg hash algorithm to be used
@@ -0,0 +1,171 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifndef TRACE_H
+#define TRACE_H
+
+/*
+ * Handshake instrumentation, built with -DEDHOC_WITH_TRACE.
+ *
+ * The initiator and the responder report the begin and the end of every
+ * phase of a handshake to a hook set with edhoc_trace_hook_set(). The end
+ * event carries the duration and the number of bytes the phase produced or
+ * consumed. edhoc_trace_stats_hook() is a ready-made hook which aggregates
+ * the events into latency histograms per method and phase.
+ *
+ * Without EDHOC_WITH_TRACE the TRACE_* macros expand to nothing. With it but
+ * without a hook, every event costs a load and a branch.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "error.h"
+
+enum edhoc_phase {
+    /*edhoc_initiator_run(), edhoc_responder_run() or a step of the stateless
+    responder, without bytes*/
+    EDHOC_PHASE_HANDSHAKE,
+    EDHOC_PHASE_TX,     /*tx(), bytes sent*/
+    EDHOC_PHASE_RX,     /*waiting in rx(), bytes received*/
+    EDHOC_PHASE_ENCODE, /*CBOR encoding of a message or plaintext*/
+    EDHOC_PHASE_DECODE, /*CBOR decoding of a message or plaintext*/
+    EDHOC_PHASE_DH,     /*ephemeral ECDH, PRK_3e2m/PRK_4x3m with static DH*/
+    EDHOC_PHASE_KDF,    /*PRK_2e, PRK_3e2m/PRK_4x3m without static DH, and
+                        the keys and IVs derived with HKDF*/
+    EDHOC_PHASE_TH,     /*transcript hashes*/
+    EDHOC_PHASE_CRED,   /*retrieve_cred(), incl. certificate verification*/
+    EDHOC_PHASE_MAC,    /*MAC_2/MAC_3 and the data to be signed*/
+    EDHOC_PHASE_SIGN,   /*signature of message 2 or 3*/
+    EDHOC_PHASE_VERIFY, /*verification of Signature_or_MAC_2/3*/
+    EDHOC_PHASE_AEAD,   /*encryption or decryption of ciphertext 3*/
+    EDHOC_PHASE_NUM,
+};
+
+/*method of the events a responder reports before it parsed message 1*/
+#define EDHOC_TRACE_METHOD_UNKNOWN 4
+
+struct edhoc_trace_event {
+    /*the context of the initiator or responder, events of handshakes which
+    run at the same time with one context, e.g., on the executor, can not be
+    told apart*/
+    const void *handshake;
+    uint8_t role;          /*INITIATOR or RESPONDER*/
+    uint8_t method;        /*0 to 3 or EDHOC_TRACE_METHOD_UNKNOWN*/
+    enum edhoc_phase phase;
+    bool end;          /*false for the begin event*/
+    uint64_t time_ns;  /*see edhoc_trace_time_ns()*/
+    /*set in end events only*/
+    uint64_t duration_ns;
+    uint32_t bytes;
+    EdhocError r;
+};
+
+/*state of a running handshake, see TRACE_DECLARE()*/
+struct edhoc_trace {
+    const void *handshake;
+    uint8_t role;
+    uint8_t method;
+    uint64_t begin_ns[EDHOC_PHASE_NUM];
+};
+
+/*histogram bucket 0 counts durations below 1 us, bucket i > 0 durations in
+[2^(i-1), 2^i) us, the last bucket all longer ones*/
+#ifndef EDHOC_TRACE_BUCKETS
+#define EDHOC_TRACE_BUCKETS 32
+#endif
+
+/*aggregated end events, zero initialized*/
+struct edhoc_trace_stats {
+    uint64_t count[EDHOC_TRACE_METHOD_UNKNOWN + 1][EDHOC_PHASE_NUM];
+    uint64_t errors[EDHOC_TRACE_METHOD_UNKNOWN + 1][EDHOC_PHASE_NUM];
+    uint64_t bytes[EDHOC_TRACE_METHOD_UNKNOWN + 1][EDHOC_PHASE_NUM];
+    uint64_t total_ns[EDHOC_TRACE_METHOD_UNKNOWN + 1][EDHOC_PHASE_NUM];
+    uint64_t hist[EDHOC_TRACE_METHOD_UNKNOWN + 1][EDHOC_PHASE_NUM]
+                 [EDHOC_TRACE_BUCKETS];
+};
+
+#ifdef EDHOC_WITH_TRACE
+
+/**
+ * @brief   Sets the hook the events are reported to. Must be called before
+ *          handshakes are started.
+ * @param   hook called from the thread running the handshake, NULL to
+ *          report no events
+ * @param   arg argument of hook
+ */
+void edhoc_trace_hook_set(
+    void (*hook)(const struct edhoc_trace_event *e, void *arg), void *arg);
+
+/**
+ * @brief   Returns the time of the events in nanoseconds. The default uses
+ *          CLOCK_MONOTONIC where available, otherwise it returns 0. It is
+ *          weak and can be replaced, e.g., with a cycle counter.
+ */
+uint64_t edhoc_trace_time_ns(void);
+
+/**
+ * @brief   Reports the begin of a phase, used through TRACE_BEGIN()
+ */
+void edhoc_trace_begin(struct edhoc_trace *t, enum edhoc_phase phase);
+
+/**
+ * @brief   Reports the end of a phase, used through TRACE_END()
+ */
+void edhoc_trace_end(
+    struct edhoc_trace *t, enum edhoc_phase phase, uint32_t bytes,
+    EdhocError r);
+
+/**
+ * @brief   A hook which adds every end event to a struct edhoc_trace_stats.
+ *          The counters are updated atomically, the hook can be used by
+ *          handshakes running on several threads.
+ * @param   e the event
+ * @param   arg the struct edhoc_trace_stats
+ */
+void edhoc_trace_stats_hook(const struct edhoc_trace_event *e, void *arg);
+
+/**
+ * @brief   Returns an upper bound of a latency percentile from the histogram
+ *          of a method and phase
+ * @param   s the statistics
+ * @param   method 0 to 3 or EDHOC_TRACE_METHOD_UNKNOWN
+ * @param   phase the phase
+ * @param   percent e.g., 50 or 99
+ * @retval  the upper bound of the bucket containing the percentile in us, 0
+ *          if no event was counted
+ */
+uint64_t edhoc_trace_stats_percentile(
+    const struct edhoc_trace_stats *s, uint8_t method, enum edhoc_phase phase,
+    uint8_t percent);
+
+#define TRACE_DECLARE(t, role_, method_, c)                        \
+    struct edhoc_trace t = {.handshake = (c), .role = (role_), \
+                            .method = (method_)}
+#define TRACE_METHOD(t, method_) ((t).method = (method_))
+#define TRACE_BEGIN(t, phase) edhoc_trace_begin(&(t), (phase))
+#define TRACE_END(t, phase, bytes, r) \
+    edhoc_trace_end(&(t), (phase), (uint32_t)(bytes), (r))
+#else
+#define TRACE_DECLARE(t, role_, method_, c) \
+    do {                                    \
+    } while (0)
+#define TRACE_METHOD(t, method_) \
+    do {                         \
+    } while (0)
+#define TRACE_BEGIN(t, phase) \
+    do {                      \
+    } while (0)
+#define TRACE_END(t, phase, bytes, r) \
+    do {                              \
+    } while (0)
+#endif
+
+#endif
@@ -11,7 +11,7 @@
 #ifndef EDHOC_TXRX_WRAPPER_H
 #define EDHOC_TXRX_WRAPPER_H
 
-#include "../inc/byte_array.h"
+#include "../../common/inc/byte_array.h"
 
 /**
  * @brief   The user should call inside this function its send function. 
@@ -0,0 +1,64 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <stdint.h>
+
+#include "error.h"
+
+/*allocations from a workspace are aligned to this number of bytes*/
+#define WORKSPACE_ALIGN 8
+#define WORKSPACE_ALIGN_UP(x) \
+    (((x) + WORKSPACE_ALIGN - 1) & ~((uint32_t)WORKSPACE_ALIGN - 1))
+
+/**
+ * Caller provided memory from which the buffers of a handshake are carved. 
+ * Allocation is a pointer bump, everything is released at once when the 
+ * handshake ends. The memory is erased at that point since it held 
+ * plaintexts and keystream. A workspace can be used by one handshake at a 
+ * time. Use edhoc_initiator_workspace_size() and 
+ * edhoc_responder_workspace_size() to size buf.
+ */
+struct edhoc_workspace {
+    uint8_t *buf;
+    uint32_t size;
+    uint32_t used;
+    uint32_t peak; /*high-water mark since workspace_init()*/
+};
+
+/**
+ * @brief   Initializes a workspace on top of a buffer
+ * @param   ws the workspace
+ * @param   buf the buffer, should be aligned to WORKSPACE_ALIGN
+ * @param   size size of buf
+ */
+void workspace_init(struct edhoc_workspace *ws, uint8_t *buf, uint32_t size);
+
+/**
+ * @brief   Carves a buffer out of a workspace
+ * @param   ws the workspace
+ * @param   len the requested length
+ * @param   out pointer to the buffer
+ * @retval  an EdhocError code, WorkspaceTooSmall if ws is exhausted
+ */
+EdhocError workspace_alloc(
+    struct edhoc_workspace *ws,
+    uint32_t len,
+    uint8_t **out);
+
+/**
+ * @brief   Erases the used part of a workspace and releases all buffers
+ * @param   ws the workspace
+ */
+void workspace_release(struct edhoc_workspace *ws);
+
+#endif
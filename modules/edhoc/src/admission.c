@@ -0,0 +1,63 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#include "../inc/admission.h"
+
+#include <string.h>
+
+#include "../inc/error.h"
+
+/*one handshake in the units of admission.tokens*/
+#define TOKEN_UNIT 1000
+
+/**
+ * @brief   Adds the tokens earned since the last call to the bucket
+ */
+static void bucket_refill(struct admission *a, uint32_t now_ms) {
+    uint32_t elapsed = now_ms - a->last_ms;
+    uint64_t max = (uint64_t)a->burst * TOKEN_UNIT;
+
+    a->last_ms = now_ms;
+    /*rate handshakes per second are rate tokens per millisecond*/
+    a->tokens += (uint64_t)elapsed * a->rate;
+    if (a->tokens > max) a->tokens = max;
+}
+
+void admission_init(
+    struct admission *a,
+    uint32_t rate, uint32_t burst, uint32_t max_active,
+    uint32_t now_ms) {
+    memset(a, 0, sizeof(*a));
+    a->rate = rate;
+    a->burst = burst;
+    a->max_active = max_active;
+    a->tokens = (uint64_t)burst * TOKEN_UNIT;
+    a->last_ms = now_ms;
+}
+
+EdhocError admission_acquire(struct admission *a, uint32_t now_ms) {
+    if (a->max_active && a->active >= a->max_active) {
+        a->stats.busy++;
+        return TooManyHandshakes;
+    }
+    bucket_refill(a, now_ms);
+    if (a->tokens < TOKEN_UNIT) {
+        a->stats.rate_limited++;
+        return HandshakeRateLimited;
+    }
+    a->tokens -= TOKEN_UNIT;
+    a->active++;
+    a->stats.admitted++;
+    return EdhocNoError;
+}
+
+void admission_release(struct admission *a) {
+    if (a->active) a->active--;
+}
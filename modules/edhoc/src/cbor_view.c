@@ -0,0 +1,156 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#include "../inc/cbor_view.h"
+
+#include <cbor.h>
+#include <stdint.h>
+
+#include "../../common/inc/byte_array.h"
+#include "../inc/error.h"
+
+/**
+ * @brief   Decodes the head of a CBOR data item
+ * @param   in the not yet parsed part of the input buffer
+ * @param   major_type the major type of the item
+ * @param   val the argument of the head
+ */
+static EdhocError head_decode(
+    struct byte_array *in,
+    uint8_t *major_type,
+    uint64_t *val) {
+    uint8_t info, n, i;
+
+    if (in->len == 0) return ErrorDuringCborDecoding;
+    *major_type = in->ptr[0] >> 5;
+    info = in->ptr[0] & 0x1f;
+
+    if (info < 24) {
+        n = 0;
+        *val = info;
+    } else if (info <= 27) {
+        /*1, 2, 4 or 8 bytes follow*/
+        n = 1 << (info - 24);
+        *val = 0;
+    } else {
+        /*indefinite lengths and reserved values are not used in EDHOC*/
+        return UnsupportedCborType;
+    }
+
+    if (in->len < 1 + (uint32_t)n) return ErrorDuringCborDecoding;
+    for (i = 1; i <= n; i++) {
+        *val = (*val << 8) | in->ptr[i];
+    }
+    in->ptr += 1 + n;
+    in->len -= 1 + n;
+    return EdhocNoError;
+}
+
+EdhocError cbor_item_next(struct byte_array *in, struct cbor_item *item) {
+    struct byte_array rest = *in;
+    uint8_t major_type;
+    uint64_t val;
+    EdhocError r;
+
+    r = head_decode(&rest, &major_type, &val);
+    if (r != EdhocNoError) return r;
+
+    item->int_val = 0;
+    item->len = 0;
+    item->view = NULL_ARRAY;
+
+    switch (major_type) {
+        case 0:
+        case 1:
+            if (val > INT64_MAX) return ErrorDuringCborDecoding;
+            item->type = CborIntegerType;
+            item->int_val = (major_type == 0) ? (int64_t)val : -1 - (int64_t)val;
+            break;
+
+        case 2:
+        case 3:
+            /*the only bounds check needed for the content of the string*/
+            if (val > rest.len) return ErrorDuringCborDecoding;
+            item->type = (major_type == 2) ? CborByteStringType
+                                           : CborTextStringType;
+            item->view.ptr = rest.ptr;
+            item->view.len = (uint32_t)val;
+            rest.ptr += val;
+            rest.len -= (uint32_t)val;
+            break;
+
+        case 4:
+        case 5:
+            item->type = (major_type == 4) ? CborArrayType : CborMapType;
+            item->len = val;
+            break;
+
+        default:
+            return UnsupportedCborType;
+    }
+
+    *in = rest;
+    return EdhocNoError;
+}
+
+EdhocError cbor_item_skip(struct byte_array *in) {
+    struct byte_array rest = *in;
+    struct cbor_item item;
+    uint64_t pending = 1;
+    EdhocError r;
+
+    while (pending) {
+        r = cbor_item_next(&rest, &item);
+        if (r != EdhocNoError) return r;
+        pending--;
+        /*every element takes at least one byte, this also bounds pending*/
+        if (item.len > rest.len) return ErrorDuringCborDecoding;
+        if (item.type == CborArrayType) {
+            pending += item.len;
+        } else if (item.type == CborMapType) {
+            pending += 2 * item.len;
+        }
+    }
+
+    *in = rest;
+    return EdhocNoError;
+}
+
+EdhocError cbor_bstr_next(struct byte_array *in, struct byte_array *out) {
+    struct cbor_item item;
+    EdhocError r = cbor_item_next(in, &item);
+    if (r != EdhocNoError) return r;
+    if (item.type != CborByteStringType) return UnsupportedCborType;
+    *out = item.view;
+    return EdhocNoError;
+}
+
+EdhocError cbor_bstr_identifier_next(
+    struct byte_array *in,
+    uint8_t *single,
+    struct byte_array *out) {
+    struct cbor_item item;
+    EdhocError r = cbor_item_next(in, &item);
+    if (r != EdhocNoError) return r;
+
+    if (item.type == CborByteStringType) {
+        *out = item.view;
+    } else if (item.type == CborIntegerType) {
+        if (item.int_val < -24 || item.int_val > 23) {
+            return ErrorDuringCborDecoding;
+        }
+        *single = (uint8_t)(item.int_val + 24);
+        out->ptr = single;
+        out->len = 1;
+    } else {
+        return UnsupportedCborType;
+    }
+    return EdhocNoError;
+}
@@ -0,0 +1,131 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+
+#include "../inc/crypto_async.h"
+
+#include <string.h>
+
+#include "../inc/crypto_wrapper.h"
+#include "../inc/error.h"
+
+/*the fiber of a task, see fiber.h*/
+static void task_body(struct fiber *f) {
+    struct crypto_task *t = (struct crypto_task *)f;
+
+    t->r = t->fn(t->arg);
+}
+
+static void task_ready(struct fiber *f, void *arg) {
+    struct crypto_task *t = (struct crypto_task *)f;
+
+    t->ready(t, t->ready_arg);
+}
+
+EdhocError crypto_task_init(
+    struct crypto_task *t,
+    void *stack, uint32_t stack_size,
+    struct crypto_provider *provider,
+    void (*ready)(struct crypto_task *t, void *arg), void *ready_arg) {
+    if (stack_size < CRYPTO_TASK_MIN_STACK_SIZE) return WorkspaceTooSmall;
+    memset(t, 0, sizeof(*t));
+    fiber_init(&t->f, stack, stack_size, ready != NULL ? task_ready : NULL,
+               NULL);
+    t->provider = provider;
+    t->ready = ready;
+    t->ready_arg = ready_arg;
+    return EdhocNoError;
+}
+
+EdhocError crypto_task_start(
+    struct crypto_task *t, EdhocError (*fn)(void *arg), void *arg) {
+    t->fn = fn;
+    t->arg = arg;
+    return fiber_start(&t->f, task_body) ? t->r : CryptoPending;
+}
+
+EdhocError crypto_task_resume(struct crypto_task *t) {
+    return fiber_resume(&t->f) ? t->r : CryptoPending;
+}
+
+struct crypto_task *crypto_task_current(void) {
+    struct fiber *f = fiber_current();
+
+    /*the fiber may also run an OSCORE task*/
+    if (f == NULL || f->fn != task_body) return NULL;
+    return (struct crypto_task *)f;
+}
+
+EdhocError crypto_offload(struct crypto_op *op) {
+    struct crypto_task *t = (struct crypto_task *)fiber_wait_begin();
+    EdhocError r;
+
+    op->task = t;
+    r = t->provider->submit(t->provider, op);
+    fiber_wait(&t->f, r == EdhocNoError);
+    return r == EdhocNoError ? op->r : r;
+}
+
+void crypto_op_complete(struct crypto_op *op, EdhocError r) {
+    op->r = r;
+    fiber_wake(&op->task->f);
+}
+
+EdhocError crypto_op_run(struct crypto_op *op) {
+    switch (op->type) {
+        case CRYPTO_OP_AEAD:
+            return aead(op->u.aead.op,
+                        op->u.aead.in, op->u.aead.in_len,
+                        op->u.aead.key, op->u.aead.key_len,
+                        op->u.aead.nonce, op->u.aead.nonce_len,
+                        op->u.aead.aad, op->u.aead.aad_len,
+                        op->u.aead.out, op->u.aead.out_len,
+                        op->u.aead.tag, op->u.aead.tag_len);
+        case CRYPTO_OP_SIGN:
+            return sign(op->u.sign.curve,
+                        op->u.sign.sk, op->u.sign.sk_len,
+                        op->u.sign.pk, op->u.sign.pk_len,
+                        op->u.sign.msg, op->u.sign.msg_len,
+                        op->u.sign.out, op->u.sign.out_len);
+        case CRYPTO_OP_VERIFY:
+            return verify(op->u.verify.curve,
+                          op->u.verify.pk, op->u.verify.pk_len,
+                          op->u.verify.msg, op->u.verify.msg_len,
+                          op->u.verify.sgn, op->u.verify.sgn_len,
+                          op->u.verify.result);
+        case CRYPTO_OP_SHARED_SECRET:
+            return shared_secret_derive(
+                op->u.shared_secret.curve,
+                op->u.shared_secret.sk, op->u.shared_secret.sk_len,
+                op->u.shared_secret.pk, op->u.shared_secret.pk_len,
+                op->u.shared_secret.shared_secret);
+        case CRYPTO_OP_HKDF_EXTRACT:
+            return hkdf_extract(
+                op->u.hkdf_extract.alg,
+                op->u.hkdf_extract.salt, op->u.hkdf_extract.salt_len,
+                op->u.hkdf_extract.ikm, op->u.hkdf_extract.ikm_len,
+                op->u.hkdf_extract.out);
+        case CRYPTO_OP_HKDF_EXPAND:
+            return hkdf_expand(
+                op->u.hkdf_expand.alg,
+                op->u.hkdf_expand.prk, op->u.hkdf_expand.prk_len,
+                op->u.hkdf_expand.info, op->u.hkdf_expand.info_len,
+                op->u.hkdf_expand.out, op->u.hkdf_expand.out_len);
+        case CRYPTO_OP_HKDF_EXPAND_PRK:
+            return hkdf_expand_prk(
+                op->u.hkdf_expand_prk.k,
+                op->u.hkdf_expand_prk.info, op->u.hkdf_expand_prk.info_len,
+                op->u.hkdf_expand_prk.out, op->u.hkdf_expand_prk.out_len);
+    }
+    return UnsupportedCipherSuite;
+}
+
+#endif
@@ -10,22 +10,39 @@
 */
 #include "../inc/crypto_wrapper.h"
 
-#include "../inc/byte_array.h"
+#include <string.h>
+
+#include "../edhoc.h"
+#include "../../common/inc/byte_array.h"
+#include "../inc/crypto_async.h"
+#include "../../common/inc/crypto_backend.h"
 #include "../inc/error.h"
 #include "../inc/print_util.h"
 #include "../inc/suites.h"
 
 #ifdef EDHOC_WITH_TINYCRYPT_AND_C25519
 #include <c25519.h>
+#include <ed25519.h>
 #include <edsign.h>
+#include <fprime.h>
+#include <sha512.h>
 #include <string.h>
 #include <compact_x25519.h>
-#include <tinycrypt/aes.h>
-#include <tinycrypt/ccm_mode.h>
 #include <tinycrypt/constants.h>
-#include <tinycrypt/hmac.h>
+#include <tinycrypt/ecc.h>
+#include <tinycrypt/ecc_dh.h>
+#include <tinycrypt/ecc_dsa.h>
+#endif
+
+#if defined(__ZEPHYR__) && defined(CONFIG_CSPRNG_ENABLED)
+#include <random/rand32.h>
+#elif defined(__linux__)
+#include <errno.h>
+#include <sys/random.h>
 #endif
 
+#ifndef EDHOC_WITH_OPENSSL
+/*replaced by crypto_wrapper_openssl.c*/
 EdhocError __attribute__((weak)) aead(
     enum aes_operation op,
     const uint8_t *in, const uint16_t in_len,
@@ -34,53 +51,256 @@ EdhocError __attribute__((weak)) aead(
     const uint8_t *aad, const uint16_t aad_len,
     uint8_t *out, const uint16_t out_len,
     uint8_t *tag, const uint16_t tag_len) {
-#ifdef EDHOC_WITH_TINYCRYPT_AND_C25519
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    /*inside a crypto task the provider computes, see crypto_async.h*/
+    if (crypto_task_current() != NULL) {
+        struct crypto_op o = {
+            .type = CRYPTO_OP_AEAD,
+            .u.aead = {op, in, in_len, key, key_len, nonce, nonce_len,
+                       aad, aad_len, out, out_len, tag, tag_len}};
+        return crypto_offload(&o);
+    }
+#endif
     int result;
-    struct tc_ccm_mode_struct c;
-    struct tc_aes_key_sched_struct sched;
-    tc_aes128_set_encrypt_key(&sched, key);
-    tc_ccm_config(&c, &sched, nonce, nonce_len, 8);
-
-    if (op == DECRYPT) {
-        result = tc_ccm_decryption_verification(
-            out,
-            out_len,
-            aad,
-            aad_len,
-            in,
-            in_len,
-            &c);
-
-        if (result == 0) return AEADAuthenticationFailed;
 
+    /*the backend writes the tag behind the ciphertext and expects it behind
+    the ciphertext when decrypting, in_len includes it then*/
+    if (key_len != 16) return ErrorDuringAEAD;
+    if (op == ENCRYPT) {
+        if (out_len < in_len + tag_len) return DestBufferToSmall;
     } else {
-        result = tc_ccm_generation_encryption(
-            out,
-            (out_len + tag_len),
-            aad,
-            aad_len,
-            in,
-            in_len,
-            &c);
+        if (in_len < tag_len) return ErrorDuringAEAD;
+        if (out_len < in_len - tag_len) return DestBufferToSmall;
+    }
+    result = crypto_backend_get()->aes_ccm(op, key, nonce, (uint8_t)nonce_len,
+                                           aad, aad_len, in, in_len, out,
+                                           (uint8_t)tag_len);
+    if (result == CRYPTO_BACKEND_AUTH_FAILED) return AEADAuthenticationFailed;
+    if (result != CRYPTO_BACKEND_OK) return ErrorDuringAEAD;
+    if (op == ENCRYPT) memcpy(tag, out + in_len, tag_len);
+    return EdhocNoError;
+}
+#endif
 
-        memcpy(tag, out + out_len, tag_len);
+#if defined(EDHOC_WITH_TINYCRYPT_AND_C25519) && \
+    !defined(EDHOC_WITH_C25519_RADIX51) && !defined(EDHOC_WITH_OPENSSL)
+/*
+ * Ed25519 verification with the primitives of compact25519. edsign_verify()
+ * checks the cofactorless equation, which can not be batched without
+ * accepting signatures it rejects. verify() and verify_batch() therefore
+ * both check the cofactored equation of RFC8032 with the same decoding.
+ */
 
-        if (result != 1) return ErrorDuringAEAD;
+/*order of the Ed25519 base point, little endian*/
+static const uint8_t ed25519_order[FPRIME_SIZE] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+    0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10};
+
+/*size of the random coefficients in the batch equation*/
+#define BATCH_COEFFICIENT_SIZE 16
+
+/**
+ * @brief   Calculates k = SHA-512(R || A || M) mod l
+ */
+static void ed25519_challenge(
+    const uint8_t *r, const uint8_t *a,
+    const uint8_t *msg, uint16_t msg_len,
+    uint8_t *k) {
+    struct sha512_state s;
+    uint8_t block[SHA512_BLOCK_SIZE];
+    uint8_t digest[SHA512_HASH_SIZE];
+    const uint8_t prefix_len = 2 * ED25519_PACK_SIZE;
+    uint32_t i;
+
+    memcpy(block, r, ED25519_PACK_SIZE);
+    memcpy(block + ED25519_PACK_SIZE, a, ED25519_PACK_SIZE);
+
+    sha512_init(&s);
+    if (msg_len + prefix_len < SHA512_BLOCK_SIZE) {
+        memcpy(block + prefix_len, msg, msg_len);
+        sha512_final(&s, block, msg_len + prefix_len);
+    } else {
+        memcpy(block + prefix_len, msg, SHA512_BLOCK_SIZE - prefix_len);
+        sha512_block(&s, block);
+        for (i = SHA512_BLOCK_SIZE - prefix_len;
+             i + SHA512_BLOCK_SIZE <= msg_len;
+             i += SHA512_BLOCK_SIZE) {
+            sha512_block(&s, msg + i);
+        }
+        sha512_final(&s, msg + i, msg_len + prefix_len);
     }
-#endif
+    sha512_get(&s, digest, 0, SHA512_HASH_SIZE);
+    fprime_from_bytes(k, digest, SHA512_HASH_SIZE, ed25519_order);
+}
+
+/**
+ * @brief   Returns true if the little endian scalar s is smaller than l
+ */
+static bool ed25519_scalar_is_canonical(const uint8_t *s) {
+    for (int i = FPRIME_SIZE - 1; i >= 0; i--) {
+        if (s[i] < ed25519_order[i]) return true;
+        if (s[i] > ed25519_order[i]) return false;
+    }
+    return false;
+}
+
+/**
+ * @brief   Decodes a point. ed25519_try_unpack() reduces y modulo p, 
+ *          encodings which are not canonical are rejected by packing the 
+ *          point again.
+ */
+static bool ed25519_decode(struct ed25519_pt *p, const uint8_t *c) {
+    uint8_t x[F25519_SIZE], y[F25519_SIZE];
+    uint8_t packed[ED25519_PACK_SIZE];
+
+    if (!ed25519_try_unpack(x, y, c)) return false;
+    ed25519_pack(packed, x, y);
+    if (memcmp(packed, c, ED25519_PACK_SIZE) != 0) return false;
+    ed25519_project(p, x, y);
+    return true;
+}
+
+/**
+ * @brief   Returns true if [8]a = [8]b
+ */
+static bool ed25519_cofactor_equal(struct ed25519_pt *a, struct ed25519_pt *b) {
+    uint8_t x[F25519_SIZE], y[F25519_SIZE];
+    uint8_t a_packed[ED25519_PACK_SIZE], b_packed[ED25519_PACK_SIZE];
+
+    for (uint8_t i = 0; i < 3; i++) {
+        ed25519_double(a, a);
+        ed25519_double(b, b);
+    }
+    ed25519_unproject(x, y, a);
+    ed25519_pack(a_packed, x, y);
+    ed25519_unproject(x, y, b);
+    ed25519_pack(b_packed, x, y);
+    return memcmp(a_packed, b_packed, ED25519_PACK_SIZE) == 0;
+}
+
+/**
+ * @brief   Checks [8][S]B = [8](R + [k]A) for one signature
+ */
+static bool ed25519_verify(
+    const uint8_t *pk, uint8_t pk_len,
+    const uint8_t *msg, uint16_t msg_len,
+    const uint8_t *sgn, uint16_t sgn_len) {
+    struct ed25519_pt a, r, lhs, rhs;
+    uint8_t k[FPRIME_SIZE];
+
+    if (pk_len != EDSIGN_PUBLIC_KEY_SIZE ||
+        sgn_len != EDSIGN_SIGNATURE_SIZE ||
+        !ed25519_scalar_is_canonical(sgn + ED25519_PACK_SIZE) ||
+        !ed25519_decode(&r, sgn) || !ed25519_decode(&a, pk)) {
+        return false;
+    }
+    ed25519_challenge(sgn, pk, msg, msg_len, k);
+    ed25519_smult(&rhs, &a, k);
+    ed25519_add(&rhs, &rhs, &r);
+    ed25519_smult(&lhs, &ed25519_base, sgn + ED25519_PACK_SIZE);
+    return ed25519_cofactor_equal(&lhs, &rhs);
+}
+
+/**
+ * @brief   Checks the equation of ed25519_verify() for up to 
+ *          VERIFY_BATCH_MAX_SIZE signatures at once with random 
+ *          coefficients z_i
+ *
+ *          [8][sum z_i*S_i]B = [8](sum [z_i]R_i + sum [z_i*k_i]A_i)
+ *
+ *          The right hand side is computed with Straus' method, i.e., all
+ *          scalar multiplications share the same doublings.
+ * @param   valid false if a signature can not be decoded or the equation 
+ *          does not hold
+ */
+static EdhocError ed25519_verify_batch(
+    const struct verify_batch_item *items, uint16_t items_num,
+    bool *valid) {
+    struct ed25519_pt points[2 * VERIFY_BATCH_MAX_SIZE];
+    uint8_t scalars[2 * VERIFY_BATCH_MAX_SIZE][FPRIME_SIZE];
+    uint8_t s_sum[FPRIME_SIZE] = {0};
+    uint8_t t[FPRIME_SIZE];
+    struct ed25519_pt lhs, rhs;
+    EdhocError r;
+
+    *valid = false;
+    for (uint16_t i = 0; i < items_num; i++) {
+        const struct verify_batch_item *it = &items[i];
+        const uint8_t *sig_s = it->sgn + ED25519_PACK_SIZE;
+        uint8_t *z = scalars[2 * i];
+
+        /*the same checks as in ed25519_verify()*/
+        if (it->pk_len != EDSIGN_PUBLIC_KEY_SIZE ||
+            it->sgn_len != EDSIGN_SIGNATURE_SIZE ||
+            !ed25519_scalar_is_canonical(sig_s) ||
+            !ed25519_decode(&points[2 * i], it->sgn) ||
+            !ed25519_decode(&points[2 * i + 1], it->pk)) {
+            return EdhocNoError;
+        }
+
+        /*z_i as coefficient of R_i and z_i*k_i as coefficient of A_i*/
+        memset(z, 0, FPRIME_SIZE);
+        r = random_bytes(z, BATCH_COEFFICIENT_SIZE);
+        if (r != EdhocNoError) return r;
+        ed25519_challenge(it->sgn, it->pk, it->msg, it->msg_len, t);
+        fprime_mul(scalars[2 * i + 1], t, z, ed25519_order);
+
+        /*s_sum += z_i*S_i*/
+        fprime_mul(t, sig_s, z, ed25519_order);
+        fprime_add(s_sum, t, ed25519_order);
+    }
+
+    ed25519_copy(&rhs, &ed25519_neutral);
+    for (int16_t bit = 8 * FPRIME_SIZE - 1; bit >= 0; bit--) {
+        ed25519_double(&rhs, &rhs);
+        for (uint16_t j = 0; j < 2 * items_num; j++) {
+            if ((scalars[j][bit >> 3] >> (bit & 7)) & 1) {
+                ed25519_add(&rhs, &rhs, &points[j]);
+            }
+        }
+    }
+    ed25519_smult(&lhs, &ed25519_base, s_sum);
+    *valid = ed25519_cofactor_equal(&lhs, &rhs);
     return EdhocNoError;
 }
+#endif
 
+#ifndef EDHOC_WITH_C25519_RADIX51
+/*replaced by crypto_wrapper_c25519_64.c*/
+#ifndef EDHOC_WITH_OPENSSL
+/*replaced by crypto_wrapper_openssl.c*/
 EdhocError __attribute__((weak)) sign(
     enum sign_alg_curve curve,
     const uint8_t *sk, const uint8_t sk_len,
     const uint8_t *pk, const uint8_t pk_len,
     const uint8_t *msg, const uint16_t msg_len,
     uint8_t *out, uint32_t *out_len) {
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    if (crypto_task_current() != NULL) {
+        struct crypto_op o = {
+            .type = CRYPTO_OP_SIGN,
+            .u.sign = {curve, sk, sk_len, pk, pk_len, msg, msg_len,
+                       out, out_len}};
+        return crypto_offload(&o);
+    }
+#endif
     if (curve == Ed25519_SIGN) {
 #ifdef EDHOC_WITH_TINYCRYPT_AND_C25519
         edsign_sign(out, pk, sk, msg, msg_len);
 #endif
+    } else if (curve == P_256_SIGN) {
+#ifdef EDHOC_WITH_P256
+        if (*out_len < P256_SIGNATURE_SIZE) return DestBufferToSmall;
+        EdhocError r = p256_sign(sk, msg, msg_len, out);
+        if (r != EdhocNoError) return r;
+        *out_len = P256_SIGNATURE_SIZE;
+#else
+        return UnsupportedSignatureCurve;
+#endif
+    } else {
+        return UnsupportedSignatureCurve;
     }
     return EdhocNoError;
 }
@@ -91,24 +311,93 @@ EdhocError __attribute__((weak)) verify(
     const uint8_t *msg, const uint16_t msg_len,
     const uint8_t *sgn, const uint16_t sgn_len,
     bool *result) {
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    if (crypto_task_current() != NULL) {
+        struct crypto_op o = {
+            .type = CRYPTO_OP_VERIFY,
+            .u.verify = {curve, pk, pk_len, msg, msg_len, sgn, sgn_len,
+                         result}};
+        return crypto_offload(&o);
+    }
+#endif
     if (curve == Ed25519_SIGN) {
 #ifdef EDHOC_WITH_TINYCRYPT_AND_C25519
-        int verified = edsign_verify(sgn, pk, msg, msg_len);
-        if (verified) {
-            *result = true;
-        } else {
+        *result = ed25519_verify(pk, pk_len, msg, msg_len, sgn, sgn_len);
+#endif
+    } else if (curve == P_256_SIGN) {
+#ifdef EDHOC_WITH_P256
+        if (sgn_len != P256_SIGNATURE_SIZE) {
             *result = false;
+            return EdhocNoError;
         }
+        return p256_verify(pk, pk_len, msg, msg_len, sgn, result);
+#else
+        return UnsupportedSignatureCurve;
 #endif
+    } else {
+        return UnsupportedSignatureCurve;
     }
     return EdhocNoError;
 }
+#endif
+#endif
+
+#ifndef EDHOC_WITH_C25519_RADIX51
+/*replaced by crypto_wrapper_c25519_64.c*/
+EdhocError __attribute__((weak)) verify_batch(
+    enum sign_alg_curve curve,
+    struct verify_batch_item *items, uint16_t items_num,
+    bool *all_valid) {
+    EdhocError r;
+    uint16_t i, n;
 
+    *all_valid = true;
+    for (; items_num; items += n, items_num -= n) {
+        bool batch_valid = false;
+
+        n = items_num < VERIFY_BATCH_MAX_SIZE ? items_num
+                                              : VERIFY_BATCH_MAX_SIZE;
+#if defined(EDHOC_WITH_TINYCRYPT_AND_C25519) && !defined(EDHOC_WITH_OPENSSL)
+        if (curve == Ed25519_SIGN && n > 1) {
+            r = ed25519_verify_batch(items, n, &batch_valid);
+            if (r != EdhocNoError) return r;
+        }
+#endif
+        /*a failed batch is verified one by one to find the invalid items*/
+        for (i = 0; i < n; i++) {
+            if (batch_valid) {
+                items[i].result = true;
+                continue;
+            }
+            r = verify(
+                curve,
+                items[i].pk, items[i].pk_len,
+                items[i].msg, items[i].msg_len,
+                items[i].sgn, items[i].sgn_len,
+                &items[i].result);
+            if (r != EdhocNoError) return r;
+            if (!items[i].result) *all_valid = false;
+        }
+    }
+    return EdhocNoError;
+}
+#endif
+
+#ifndef EDHOC_WITH_OPENSSL
+/*replaced by crypto_wrapper_openssl.c*/
 EdhocError __attribute__((weak)) hkdf_extract(
     enum hash_alg alg,
     const uint8_t *salt, uint32_t salt_len,
     uint8_t *ikm, uint8_t ikm_len,
     uint8_t *out) {
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    if (crypto_task_current() != NULL) {
+        struct crypto_op o = {
+            .type = CRYPTO_OP_HKDF_EXTRACT,
+            .u.hkdf_extract = {alg, salt, salt_len, ikm, ikm_len, out}};
+        return crypto_offload(&o);
+    }
+#endif
     /*all currently prosed suites use hmac-sha256*/
     if (alg == SHA_256) {
         /*"Note that [RFC5869] specifies that if the salt is not provided, it is
@@ -116,67 +405,91 @@ EdhocError __attribute__((weak)) hkdf_extract(
     the salt is the same as setting the salt to the empty byte string.
     OSCORE sets the salt default value to empty byte string, which is
     converted to a string of zeroes (see Section 2.2 of [RFC5869])".*/
-
-#ifdef EDHOC_WITH_TINYCRYPT_AND_C25519
-        struct tc_hmac_state_struct h;
-        memset(&h, 0x00, sizeof(h));
-        if (salt == NULL || salt_len == 0) {
-            uint8_t zero_salt[32] = {0};
-            tc_hmac_set_key(&h, zero_salt, 32);
-        } else {
-            tc_hmac_set_key(&h, salt, salt_len);
-        }
-        tc_hmac_init(&h);
-        tc_hmac_update(&h, ikm, ikm_len);
-        tc_hmac_final(out, TC_SHA256_DIGEST_SIZE, &h);
-#endif
+        crypto_hkdf_sha256_extract(salt, salt_len, ikm, ikm_len, out);
     }
     return EdhocNoError;
 }
+#endif
 
 EdhocError __attribute__((weak)) hkdf_expand(
     enum hash_alg alg,
     const uint8_t *prk, const uint8_t prk_len,
     const uint8_t *info, const uint8_t info_len,
     uint8_t *out, uint64_t out_len) {
-    if (alg == SHA_256) {
-        /* "N = ceil(L/HashLen)" */
-        uint32_t iterations = (out_len + 31) / 32;
-        /* "L length of output keying material in octets (<= 255*HashLen)"*/
-        if (iterations > 255) {
-            return ErrorDuringHKDFCalculation;
-        }
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    if (crypto_task_current() != NULL) {
+        struct crypto_op o = {
+            .type = CRYPTO_OP_HKDF_EXPAND,
+            .u.hkdf_expand = {alg, prk, prk_len, info, info_len, out,
+                              out_len}};
+        return crypto_offload(&o);
+    }
+#endif
+    EdhocError r;
+    struct hkdf_prk k;
 
-        uint8_t t[32] = {0};
+    r = hkdf_prk_init(alg, prk, prk_len, &k);
+    if (r != EdhocNoError) return r;
+    r = hkdf_expand_prk(&k, info, info_len, out, out_len);
+    memset(&k, 0x00, sizeof(k));
+    return r;
+}
 
-#ifdef EDHOC_WITH_TINYCRYPT_AND_C25519
-        struct tc_hmac_state_struct h;
-        for (uint8_t i = 1; i <= iterations; i++) {
-            memset(&h, 0x00, sizeof(h));
-            tc_hmac_set_key(&h, prk, prk_len);
-            tc_hmac_init(&h);
-            if (i > 1) {
-                tc_hmac_update(&h, t, 32);
-            }
-            tc_hmac_update(&h, info, info_len);
-            tc_hmac_update(&h, &i, 1);
-            tc_hmac_final(t, TC_SHA256_DIGEST_SIZE, &h);
-            if (out_len < i * 32) {
-                memcpy(&out[(i - 1) * 32], t, out_len % 32);
-            } else {
-                memcpy(&out[(i - 1) * 32], t, 32);
-            }
-        }
+/*the keyed HMAC state must fit into struct hkdf_prk*/
+typedef char hkdf_prk_size_check
+    [(sizeof(struct crypto_hmac_sha256) <= HKDF_PRK_STATE_SIZE) ? 1 : -1];
+
+EdhocError __attribute__((weak)) hkdf_prk_init(
+    enum hash_alg alg,
+    const uint8_t *prk, uint8_t prk_len,
+    struct hkdf_prk *k) {
+    memset(k, 0x00, sizeof(*k));
+    k->alg = alg;
+    if (alg == SHA_256) {
+        crypto_hmac_sha256_init(
+            (struct crypto_hmac_sha256 *)k->ctx.bytes, prk, prk_len);
+    }
+    return EdhocNoError;
+}
+
+EdhocError __attribute__((weak)) hkdf_expand_prk(
+    const struct hkdf_prk *k,
+    const uint8_t *info, uint8_t info_len,
+    uint8_t *out, uint64_t out_len) {
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    if (crypto_task_current() != NULL) {
+        struct crypto_op o = {
+            .type = CRYPTO_OP_HKDF_EXPAND_PRK,
+            .u.hkdf_expand_prk = {k, info, info_len, out, out_len}};
+        return crypto_offload(&o);
+    }
 #endif
+    if (k->alg == SHA_256) {
+        if (crypto_hkdf_sha256_expand(
+                (const struct crypto_hmac_sha256 *)k->ctx.bytes, info,
+                info_len, out, out_len) != CRYPTO_BACKEND_OK) {
+            return ErrorDuringHKDFCalculation;
+        }
     }
     return EdhocNoError;
 }
 
+#if !defined(EDHOC_WITH_C25519_RADIX51) && !defined(EDHOC_WITH_OPENSSL)
+/*replaced by crypto_wrapper_c25519_64.c or crypto_wrapper_openssl.c*/
 EdhocError __attribute__((weak)) shared_secret_derive(
     enum ecdh_curve curve,
     const uint8_t *sk, const uint32_t sk_len,
     const uint8_t *pk, const uint32_t pk_len,
     uint8_t *shared_secret) {
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    if (crypto_task_current() != NULL) {
+        struct crypto_op o = {
+            .type = CRYPTO_OP_SHARED_SECRET,
+            .u.shared_secret = {curve, sk, sk_len, pk, pk_len,
+                                shared_secret}};
+        return crypto_offload(&o);
+    }
+#endif
     if (curve == X25519) {
 #ifdef EDHOC_WITH_TINYCRYPT_AND_C25519
         uint8_t e[F25519_SIZE];
@@ -184,6 +497,14 @@ EdhocError __attribute__((weak)) shared_secret_derive(
         c25519_prepare(e);
         c25519_smult(shared_secret, pk, e);
 #endif
+    } else if (curve == P_256_ECDH) {
+#ifdef EDHOC_WITH_P256
+        return p256_shared_secret(sk, pk, pk_len, shared_secret);
+#else
+        return UnsupportedEcdhCurve;
+#endif
+    } else {
+        return UnsupportedEcdhCurve;
     }
 
     return EdhocNoError;
@@ -195,19 +516,78 @@ EdhocError __attribute__((weak)) ephemeral_dh_key_gen(
     uint8_t extended_seed[32];
     if (curve == X25519) {
 #ifdef EDHOC_WITH_TINYCRYPT_AND_C25519
-        struct tc_sha256_state_struct s;
-        tc_sha256_init(&s);
-        tc_sha256_update(&s, (uint8_t *)&seed, sizeof(seed));
-        tc_sha256_final(extended_seed, &s);
+        crypto_sha256((uint8_t *)&seed, sizeof(seed), extended_seed);
 
         compact_x25519_keygen(sk, pk, extended_seed);
+#endif
+    } else if (curve == P_256_ECDH) {
+#ifdef EDHOC_WITH_P256
+        EdhocError r = hash(SHA_256, (uint8_t *)&seed, sizeof(seed), sk);
+        if (r != EdhocNoError) return r;
+        return p256_public_key(sk, pk);
+#else
+        return UnsupportedEcdhCurve;
+#endif
+    } else {
+        return UnsupportedEcdhCurve;
+    }
+    return EdhocNoError;
+}
+#endif
+
+#ifndef EDHOC_WITH_OPENSSL
+/*replaced by crypto_wrapper_openssl.c*/
+EdhocError __attribute__((weak)) random_bytes(uint8_t *out, uint32_t out_len) {
+#if defined(__ZEPHYR__) && defined(CONFIG_CSPRNG_ENABLED)
+    if (sys_csrand_get(out, out_len) != 0) return ErrorDuringRandomGeneration;
+    return EdhocNoError;
+#elif defined(__linux__)
+    while (out_len) {
+        ssize_t n = getrandom(out, out_len, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return ErrorDuringRandomGeneration;
+        }
+        out += n;
+        out_len -= n;
+    }
+    return EdhocNoError;
+#else
+    /*no CSPRNG known for this platform, random_bytes() must be provided*/
+    return ErrorDuringRandomGeneration;
+#endif
+}
+#endif
+
+#if !defined(EDHOC_WITH_C25519_RADIX51) && !defined(EDHOC_WITH_OPENSSL)
+/*replaced by crypto_wrapper_c25519_64.c or crypto_wrapper_openssl.c*/
+EdhocError __attribute__((weak)) ephemeral_dh_key_pair_gen(
+    enum ecdh_curve curve,
+    uint8_t *sk, uint8_t *pk) {
+    EdhocError r;
+    uint8_t seed[32];
+    if (curve == X25519) {
+        r = random_bytes(seed, sizeof(seed));
+        if (r != EdhocNoError) return r;
+#ifdef EDHOC_WITH_TINYCRYPT_AND_C25519
+        compact_x25519_keygen(sk, pk, seed);
+        memset(seed, 0, sizeof(seed));
+#endif
+    } else if (curve == P_256_ECDH) {
+#ifdef EDHOC_WITH_P256
+        return p256_key_pair_gen(sk, pk);
+#else
+        return UnsupportedEcdhCurve;
 #endif
     } else {
         return UnsupportedEcdhCurve;
     }
     return EdhocNoError;
 }
+#endif
 
+#ifndef EDHOC_WITH_OPENSSL
+/*replaced by crypto_wrapper_openssl.c*/
 EdhocError __attribute__((weak)) hash(
     enum hash_alg alg,
     const uint8_t *in,
@@ -215,13 +595,189 @@ EdhocError __attribute__((weak)) hash(
     uint8_t *out) {
     /*all currently prosed suites use sha256*/
     if (alg == SHA_256) {
-#ifdef EDHOC_WITH_TINYCRYPT_AND_C25519
-        struct tc_sha256_state_struct s;
-        tc_sha256_init(&s);
-        tc_sha256_update(&s, in, in_len);
-        tc_sha256_final(out, &s);
+        crypto_sha256(in, (uint32_t)in_len, out);
+    }
+
+    return EdhocNoError;
+}
+#endif
+
+/*the SHA-256 state must fit into struct hash_state*/
+typedef char hash_state_size_check
+    [(sizeof(struct crypto_sha256) <= HASH_STATE_SIZE) ? 1 : -1];
+
+EdhocError __attribute__((weak)) hash_init(
+    enum hash_alg alg,
+    struct hash_state *s) {
+    s->alg = alg;
+    if (alg == SHA_256) {
+        crypto_sha256_init((struct crypto_sha256 *)s->ctx.bytes);
+    }
+    return EdhocNoError;
+}
+
+EdhocError __attribute__((weak)) hash_update(
+    struct hash_state *s,
+    const uint8_t *in, uint32_t in_len) {
+    if (s->alg == SHA_256) {
+        crypto_sha256_update((struct crypto_sha256 *)s->ctx.bytes, in, in_len);
+    }
+    return EdhocNoError;
+}
+
+EdhocError __attribute__((weak)) hash_final(
+    struct hash_state *s,
+    uint8_t *out) {
+    if (s->alg == SHA_256) {
+        crypto_sha256_final((struct crypto_sha256 *)s->ctx.bytes, out);
+    }
+    return EdhocNoError;
+}
+
+#ifdef EDHOC_WITH_P256
+EdhocError p256_key_pair_gen(uint8_t *sk, uint8_t *pk) {
+    EdhocError r;
+    /*a random value is not a valid private key with a probability of about
+    2^-32*/
+    for (uint8_t i = 0; i < 8; i++) {
+        r = random_bytes(sk, P256_SCALAR_SIZE);
+        if (r != EdhocNoError) return r;
+        r = p256_public_key(sk, pk);
+        if (r != InvalidPrivateKey) return r;
+    }
+    return ErrorDuringRandomGeneration;
+}
 #endif
+
+#if defined(EDHOC_WITH_TINYCRYPT_AND_C25519) && !defined(EDHOC_WITH_P256_64) && \
+    !defined(EDHOC_WITH_OPENSSL)
+/*random number generator used by uECC_sign()*/
+static int p256_rng(uint8_t *dest, unsigned int size) {
+    return random_bytes(dest, size) == EdhocNoError;
+}
+
+/*exponent (p+1)/4 for square roots modulo p*/
+static const uECC_word_t p256_sqrt_exp[NUM_ECC_WORDS] = {
+    0x00000000, 0x00000000, 0x40000000, 0x00000000,
+    0x00000000, 0x40000000, 0xc0000000, 0x3fffffff};
+
+/**
+ * @brief   Converts a public key into the x || y format of TinyCrypt
+ * @param   pk public key in one of the formats listed in crypto_wrapper.h
+ * @param   pk_len length of pk
+ * @param   point the point x || y
+ * @retval  true if pk is a valid point
+ */
+static bool p256_point_decode(
+    const uint8_t *pk, uint32_t pk_len,
+    uint8_t *point) {
+    uECC_Curve curve = uECC_secp256r1();
+    int8_t parity = -1;
+
+    switch (pk_len) {
+        case 2 * NUM_ECC_BYTES + 1:
+            if (pk[0] != 0x04) return false;
+            memcpy(point, pk + 1, 2 * NUM_ECC_BYTES);
+            break;
+        case 2 * NUM_ECC_BYTES:
+            memcpy(point, pk, 2 * NUM_ECC_BYTES);
+            break;
+        case NUM_ECC_BYTES + 1:
+            if (pk[0] != 0x02 && pk[0] != 0x03) return false;
+            parity = pk[0] & 1;
+            memcpy(point, pk + 1, NUM_ECC_BYTES);
+            break;
+        case NUM_ECC_BYTES:
+            memcpy(point, pk, NUM_ECC_BYTES);
+            break;
+        default:
+            return false;
+    }
+
+    if (pk_len <= NUM_ECC_BYTES + 1) {
+        /*y = (x^3 - 3x + b)^((p+1)/4), if no square root exists the point
+        is rejected by uECC_valid_public_key()*/
+        uECC_word_t x[NUM_ECC_WORDS], rhs[NUM_ECC_WORDS], y[NUM_ECC_WORDS];
+        uECC_vli_bytesToNative(x, point, NUM_ECC_BYTES);
+        curve->x_side(rhs, x, curve);
+
+        memset(y, 0, sizeof(y));
+        y[0] = 1;
+        for (bitcount_t i = 8 * NUM_ECC_BYTES - 1; i >= 0; i--) {
+            uECC_vli_modMult_fast(y, y, y, curve);
+            if (uECC_vli_testBit(p256_sqrt_exp, i)) {
+                uECC_vli_modMult_fast(y, y, rhs, curve);
+            }
+        }
+        if (parity >= 0 && (int8_t)(y[0] & 1) != parity) {
+            uECC_word_t zero[NUM_ECC_WORDS] = {0};
+            uECC_vli_modSub(y, zero, y, curve->p, NUM_ECC_WORDS);
+        }
+        uECC_vli_nativeToBytes(point + NUM_ECC_BYTES, NUM_ECC_BYTES, y);
+    }
+
+    /*checks that the coordinates are smaller than p and that the point is
+    on the curve*/
+    return uECC_valid_public_key(point, curve) == 0;
+}
+
+EdhocError p256_public_key(const uint8_t *sk, uint8_t *pk) {
+    uint8_t point[2 * NUM_ECC_BYTES];
+    if (!uECC_compute_public_key(sk, point, uECC_secp256r1())) {
+        return InvalidPrivateKey;
     }
+    memcpy(pk, point, NUM_ECC_BYTES);
+    return EdhocNoError;
+}
 
+EdhocError p256_shared_secret(
+    const uint8_t *sk,
+    const uint8_t *pk, uint32_t pk_len,
+    uint8_t *shared_secret) {
+    uint8_t point[2 * NUM_ECC_BYTES];
+    if (!p256_point_decode(pk, pk_len, point)) return InvalidPublicKey;
+    if (uECC_shared_secret(point, sk, shared_secret, uECC_secp256r1()) !=
+        TC_CRYPTO_SUCCESS) {
+        return InvalidPrivateKey;
+    }
     return EdhocNoError;
 }
+
+EdhocError p256_sign(
+    const uint8_t *sk,
+    const uint8_t *msg, uint16_t msg_len,
+    uint8_t *sgn) {
+    uint8_t h[SHA_DEFAULT_SIZE];
+    EdhocError r = hash(SHA_256, msg, msg_len, h);
+    if (r != EdhocNoError) return r;
+
+    uECC_set_rng(p256_rng);
+    if (uECC_sign(sk, h, sizeof(h), sgn, uECC_secp256r1()) !=
+        TC_CRYPTO_SUCCESS) {
+        return ErrorDuringSigning;
+    }
+    return EdhocNoError;
+}
+
+EdhocError p256_verify(
+    const uint8_t *pk, uint32_t pk_len,
+    const uint8_t *msg, uint16_t msg_len,
+    const uint8_t *sgn,
+    bool *result) {
+    uint8_t point[2 * NUM_ECC_BYTES];
+    uint8_t h[SHA_DEFAULT_SIZE];
+    EdhocError r;
+
+    *result = false;
+    /*the y coordinate is needed to verify a signature*/
+    if (pk_len == NUM_ECC_BYTES || !p256_point_decode(pk, pk_len, point)) {
+        return EdhocNoError;
+    }
+    r = hash(SHA_256, msg, msg_len, h);
+    if (r != EdhocNoError) return r;
+
+    *result = (uECC_verify(point, h, sizeof(h), sgn, uECC_secp256r1()) ==
+               TC_CRYPTO_SUCCESS);
+    return EdhocNoError;
+}
+#endif
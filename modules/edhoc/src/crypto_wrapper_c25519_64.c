@@ -0,0 +1,1167 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+/*
+X25519 and Ed25519 for 64 bit hosts. Field elements are represented with
+five 51 bit limbs and multiplied with 64x64->128 bit multiplications.
+Compiling with -mbmi2 -madx allows the compiler to use MULX/ADX.
+
+Define EDHOC_WITH_C25519_RADIX51 together with
+EDHOC_WITH_TINYCRYPT_AND_C25519 to replace the compact25519 implementations
+of shared_secret_derive(), ephemeral_dh_key_gen(),
+ephemeral_dh_key_pair_gen(), sign(), verify() and verify_batch(). Only the
+SHA-512 implementation of compact25519 is used.
+*/
+
+#ifdef EDHOC_WITH_C25519_RADIX51
+
+#ifndef __SIZEOF_INT128__
+#error "EDHOC_WITH_C25519_RADIX51 requires a compiler with 128 bit integers"
+#endif
+
+#include <sha512.h>
+#include <string.h>
+
+#include "../edhoc.h"
+#include "../inc/crypto_async.h"
+#include "../inc/crypto_wrapper.h"
+#include "../inc/error.h"
+#include "../inc/suites.h"
+
+typedef unsigned __int128 uint128_t;
+
+/******************************************************************************/
+/*                    field arithmetic modulo 2^255 - 19                      */
+/******************************************************************************/
+
+#define MASK51 0x7ffffffffffffULL
+
+typedef uint64_t fe[5];
+
+static const fe fe_d = {0x34dca135978a3ULL, 0x1a8283b156ebdULL,
+                        0x5e7a26001c029ULL, 0x739c663a03cbbULL,
+                        0x52036cee2b6ffULL};
+static const fe fe_d2 = {0x69b9426b2f159ULL, 0x35050762add7aULL,
+                         0x3cf44c0038052ULL, 0x6738cc7407977ULL,
+                         0x2406d9dc56dffULL};
+static const fe fe_sqrtm1 = {0x61b274a0ea0b0ULL, 0x0d5a5fc8f189dULL,
+                             0x7ef5e9cbd0c60ULL, 0x78595a6804c9eULL,
+                             0x2b8324804fc1dULL};
+
+static inline void fe_0(fe h) {
+    h[0] = h[1] = h[2] = h[3] = h[4] = 0;
+}
+
+static inline void fe_1(fe h) {
+    h[0] = 1;
+    h[1] = h[2] = h[3] = h[4] = 0;
+}
+
+static inline void fe_copy(fe h, const fe f) {
+    memcpy(h, f, sizeof(fe));
+}
+
+/*propagates the carries, the limbs of the result are smaller than 2^52*/
+static inline void fe_carry(fe h) {
+    uint64_t c;
+    c = h[0] >> 51;
+    h[0] &= MASK51;
+    h[1] += c;
+    c = h[1] >> 51;
+    h[1] &= MASK51;
+    h[2] += c;
+    c = h[2] >> 51;
+    h[2] &= MASK51;
+    h[3] += c;
+    c = h[3] >> 51;
+    h[3] &= MASK51;
+    h[4] += c;
+    c = h[4] >> 51;
+    h[4] &= MASK51;
+    h[0] += 19 * c;
+}
+
+static inline void fe_add(fe h, const fe f, const fe g) {
+    for (uint8_t i = 0; i < 5; i++) {
+        h[i] = f[i] + g[i];
+    }
+    fe_carry(h);
+}
+
+/*h = f - g, 4*p is added to avoid an underflow*/
+static inline void fe_sub(fe h, const fe f, const fe g) {
+    h[0] = (f[0] + 0x1fffffffffffb4ULL) - g[0];
+    h[1] = (f[1] + 0x1ffffffffffffcULL) - g[1];
+    h[2] = (f[2] + 0x1ffffffffffffcULL) - g[2];
+    h[3] = (f[3] + 0x1ffffffffffffcULL) - g[3];
+    h[4] = (f[4] + 0x1ffffffffffffcULL) - g[4];
+    fe_carry(h);
+}
+
+static inline void fe_neg(fe h, const fe f) {
+    fe zero;
+    fe_0(zero);
+    fe_sub(h, zero, f);
+}
+
+static void fe_mul(fe h, const fe f, const fe g) {
+    uint128_t r0, r1, r2, r3, r4;
+    uint64_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    uint64_t g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+    uint64_t g1_19 = 19 * g1, g2_19 = 19 * g2, g3_19 = 19 * g3,
+             g4_19 = 19 * g4;
+    uint64_t c;
+
+    r0 = (uint128_t)f0 * g0 + (uint128_t)f1 * g4_19 + (uint128_t)f2 * g3_19 +
+         (uint128_t)f3 * g2_19 + (uint128_t)f4 * g1_19;
+    r1 = (uint128_t)f0 * g1 + (uint128_t)f1 * g0 + (uint128_t)f2 * g4_19 +
+         (uint128_t)f3 * g3_19 + (uint128_t)f4 * g2_19;
+    r2 = (uint128_t)f0 * g2 + (uint128_t)f1 * g1 + (uint128_t)f2 * g0 +
+         (uint128_t)f3 * g4_19 + (uint128_t)f4 * g3_19;
+    r3 = (uint128_t)f0 * g3 + (uint128_t)f1 * g2 + (uint128_t)f2 * g1 +
+         (uint128_t)f3 * g0 + (uint128_t)f4 * g4_19;
+    r4 = (uint128_t)f0 * g4 + (uint128_t)f1 * g3 + (uint128_t)f2 * g2 +
+         (uint128_t)f3 * g1 + (uint128_t)f4 * g0;
+
+    r1 += (uint64_t)(r0 >> 51);
+    h[0] = (uint64_t)r0 & MASK51;
+    r2 += (uint64_t)(r1 >> 51);
+    h[1] = (uint64_t)r1 & MASK51;
+    r3 += (uint64_t)(r2 >> 51);
+    h[2] = (uint64_t)r2 & MASK51;
+    r4 += (uint64_t)(r3 >> 51);
+    h[3] = (uint64_t)r3 & MASK51;
+    c = (uint64_t)(r4 >> 51);
+    h[4] = (uint64_t)r4 & MASK51;
+    h[0] += 19 * c;
+    c = h[0] >> 51;
+    h[0] &= MASK51;
+    h[1] += c;
+}
+
+static void fe_sq(fe h, const fe f) {
+    uint128_t r0, r1, r2, r3, r4;
+    uint64_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    uint64_t f0_2 = 2 * f0, f1_2 = 2 * f1;
+    uint64_t f1_38 = 38 * f1, f2_38 = 38 * f2, f3_38 = 38 * f3;
+    uint64_t f3_19 = 19 * f3, f4_19 = 19 * f4;
+    uint64_t c;
+
+    r0 = (uint128_t)f0 * f0 + (uint128_t)f1_38 * f4 + (uint128_t)f2_38 * f3;
+    r1 = (uint128_t)f0_2 * f1 + (uint128_t)f2_38 * f4 + (uint128_t)f3_19 * f3;
+    r2 = (uint128_t)f0_2 * f2 + (uint128_t)f1 * f1 + (uint128_t)f3_38 * f4;
+    r3 = (uint128_t)f0_2 * f3 + (uint128_t)f1_2 * f2 + (uint128_t)f4_19 * f4;
+    r4 = (uint128_t)f0_2 * f4 + (uint128_t)f1_2 * f3 + (uint128_t)f2 * f2;
+
+    r1 += (uint64_t)(r0 >> 51);
+    h[0] = (uint64_t)r0 & MASK51;
+    r2 += (uint64_t)(r1 >> 51);
+    h[1] = (uint64_t)r1 & MASK51;
+    r3 += (uint64_t)(r2 >> 51);
+    h[2] = (uint64_t)r2 & MASK51;
+    r4 += (uint64_t)(r3 >> 51);
+    h[3] = (uint64_t)r3 & MASK51;
+    c = (uint64_t)(r4 >> 51);
+    h[4] = (uint64_t)r4 & MASK51;
+    h[0] += 19 * c;
+    c = h[0] >> 51;
+    h[0] &= MASK51;
+    h[1] += c;
+}
+
+/*h = f^(2^n)*/
+static void fe_sq_n(fe h, const fe f, uint16_t n) {
+    fe_sq(h, f);
+    while (--n) {
+        fe_sq(h, h);
+    }
+}
+
+static void fe_mul_small(fe h, const fe f, uint32_t n) {
+    uint128_t a;
+    uint64_t c = 0;
+    for (uint8_t i = 0; i < 5; i++) {
+        a = (uint128_t)f[i] * n + c;
+        h[i] = (uint64_t)a & MASK51;
+        c = (uint64_t)(a >> 51);
+    }
+    h[0] += 19 * c;
+    fe_carry(h);
+}
+
+/*constant time swap of f and g if b == 1*/
+static inline void fe_cswap(fe f, fe g, uint64_t b) {
+    uint64_t mask = 0 - b;
+    for (uint8_t i = 0; i < 5; i++) {
+        uint64_t x = (f[i] ^ g[i]) & mask;
+        f[i] ^= x;
+        g[i] ^= x;
+    }
+}
+
+/*constant time h = g if b == 1*/
+static inline void fe_cmov(fe h, const fe g, uint64_t b) {
+    uint64_t mask = 0 - b;
+    for (uint8_t i = 0; i < 5; i++) {
+        h[i] ^= (h[i] ^ g[i]) & mask;
+    }
+}
+
+static void fe_frombytes(fe h, const uint8_t *s) {
+    uint64_t w[4];
+    for (uint8_t i = 0; i < 4; i++) {
+        w[i] = 0;
+        for (uint8_t j = 0; j < 8; j++) {
+            w[i] |= (uint64_t)s[8 * i + j] << (8 * j);
+        }
+    }
+    h[0] = w[0] & MASK51;
+    h[1] = ((w[0] >> 51) | (w[1] << 13)) & MASK51;
+    h[2] = ((w[1] >> 38) | (w[2] << 26)) & MASK51;
+    h[3] = ((w[2] >> 25) | (w[3] << 39)) & MASK51;
+    h[4] = (w[3] >> 12) & MASK51;
+}
+
+/*writes the fully reduced value of h*/
+static void fe_tobytes(uint8_t *s, const fe f) {
+    fe h;
+    uint64_t q;
+    fe_copy(h, f);
+    fe_carry(h);
+    fe_carry(h);
+
+    /*q = 1 if h >= p*/
+    q = (h[0] + 19) >> 51;
+    q = (h[1] + q) >> 51;
+    q = (h[2] + q) >> 51;
+    q = (h[3] + q) >> 51;
+    q = (h[4] + q) >> 51;
+
+    h[0] += 19 * q;
+    h[1] += h[0] >> 51;
+    h[0] &= MASK51;
+    h[2] += h[1] >> 51;
+    h[1] &= MASK51;
+    h[3] += h[2] >> 51;
+    h[2] &= MASK51;
+    h[4] += h[3] >> 51;
+    h[3] &= MASK51;
+    h[4] &= MASK51;
+
+    uint64_t w[4];
+    w[0] = h[0] | (h[1] << 51);
+    w[1] = (h[1] >> 13) | (h[2] << 38);
+    w[2] = (h[2] >> 26) | (h[3] << 25);
+    w[3] = (h[3] >> 39) | (h[4] << 12);
+    for (uint8_t i = 0; i < 4; i++) {
+        for (uint8_t j = 0; j < 8; j++) {
+            s[8 * i + j] = (uint8_t)(w[i] >> (8 * j));
+        }
+    }
+}
+
+static uint8_t fe_isnegative(const fe f) {
+    uint8_t s[32];
+    fe_tobytes(s, f);
+    return s[0] & 1;
+}
+
+static uint8_t fe_iszero(const fe f) {
+    uint8_t s[32];
+    uint8_t d = 0;
+    fe_tobytes(s, f);
+    for (uint8_t i = 0; i < 32; i++) {
+        d |= s[i];
+    }
+    return d == 0;
+}
+
+/*computes z^(2^250 - 1) and z^11, used by fe_invert and fe_pow22523*/
+static void fe_pow2_250_1(fe out, fe z11, const fe z) {
+    fe t0, t1, t2;
+    fe_sq(t0, z);           /*2*/
+    fe_sq_n(t1, t0, 2);     /*8*/
+    fe_mul(t1, z, t1);      /*9*/
+    fe_mul(z11, t0, t1);    /*11*/
+    fe_sq(t2, z11);         /*22*/
+    fe_mul(t1, t1, t2);     /*2^5 - 1*/
+    fe_sq_n(t2, t1, 5);     /*2^10 - 2^5*/
+    fe_mul(t1, t2, t1);     /*2^10 - 1*/
+    fe_sq_n(t2, t1, 10);    /*2^20 - 2^10*/
+    fe_mul(t2, t2, t1);     /*2^20 - 1*/
+    fe_sq_n(t0, t2, 20);    /*2^40 - 2^20*/
+    fe_mul(t2, t0, t2);     /*2^40 - 1*/
+    fe_sq_n(t2, t2, 10);    /*2^50 - 2^10*/
+    fe_mul(t1, t2, t1);     /*2^50 - 1*/
+    fe_sq_n(t2, t1, 50);    /*2^100 - 2^50*/
+    fe_mul(t2, t2, t1);     /*2^100 - 1*/
+    fe_sq_n(t0, t2, 100);   /*2^200 - 2^100*/
+    fe_mul(t2, t0, t2);     /*2^200 - 1*/
+    fe_sq_n(t2, t2, 50);    /*2^250 - 2^50*/
+    fe_mul(out, t2, t1);    /*2^250 - 1*/
+}
+
+/*out = z^(p-2) = z^(2^255 - 21)*/
+static void fe_invert(fe out, const fe z) {
+    fe t, z11;
+    fe_pow2_250_1(t, z11, z);
+    fe_sq_n(t, t, 5); /*2^255 - 2^5*/
+    fe_mul(out, t, z11);
+}
+
+/*out = z^((p-5)/8) = z^(2^252 - 3)*/
+static void fe_pow22523(fe out, const fe z) {
+    fe t, z11;
+    fe_pow2_250_1(t, z11, z);
+    fe_sq_n(t, t, 2); /*2^252 - 4*/
+    fe_mul(out, t, z);
+}
+
+/******************************************************************************/
+/*                                  X25519                                    */
+/******************************************************************************/
+
+/*RFC7748 Montgomery ladder*/
+static void x25519_scalarmult(uint8_t *out, const uint8_t *scalar,
+                              const uint8_t *point) {
+    uint8_t e[32];
+    fe x1, x2, z2, x3, z3, a, aa, b, bb, ee, c, d, da, cb;
+    uint64_t swap = 0;
+
+    memcpy(e, scalar, 32);
+    e[0] &= 248;
+    e[31] &= 127;
+    e[31] |= 64;
+
+    fe_frombytes(x1, point);
+    fe_1(x2);
+    fe_0(z2);
+    fe_copy(x3, x1);
+    fe_1(z3);
+
+    for (int16_t t = 254; t >= 0; t--) {
+        uint64_t k_t = (e[t >> 3] >> (t & 7)) & 1;
+        swap ^= k_t;
+        fe_cswap(x2, x3, swap);
+        fe_cswap(z2, z3, swap);
+        swap = k_t;
+
+        fe_add(a, x2, z2);
+        fe_sq(aa, a);
+        fe_sub(b, x2, z2);
+        fe_sq(bb, b);
+        fe_sub(ee, aa, bb);
+        fe_add(c, x3, z3);
+        fe_sub(d, x3, z3);
+        fe_mul(da, d, a);
+        fe_mul(cb, c, b);
+        fe_add(x3, da, cb);
+        fe_sq(x3, x3);
+        fe_sub(z3, da, cb);
+        fe_sq(z3, z3);
+        fe_mul(z3, z3, x1);
+        fe_mul(x2, aa, bb);
+        fe_mul_small(z2, ee, 121665);
+        fe_add(z2, z2, aa);
+        fe_mul(z2, z2, ee);
+    }
+    fe_cswap(x2, x3, swap);
+    fe_cswap(z2, z3, swap);
+
+    fe_invert(z2, z2);
+    fe_mul(x2, x2, z2);
+    fe_tobytes(out, x2);
+    memset(e, 0, sizeof(e));
+}
+
+/******************************************************************************/
+/*                           Edwards25519 group                               */
+/******************************************************************************/
+
+/*extended coordinates x = X/Z, y = Y/Z, x*y = T/Z*/
+struct ge_p3 {
+    fe X, Y, Z, T;
+};
+
+/*precomputed affine point (y+x, y-x, 2*d*x*y)*/
+struct ge_precomp {
+    fe yplusx, yminusx, xy2d;
+};
+
+/*precomputed projective point (Y+X, Y-X, Z, 2*d*T)*/
+struct ge_cached {
+    fe YplusX, YminusX, Z, T2d;
+};
+
+static const fe ge_base_x = {0x62d608f25d51aULL, 0x412a4b4f6592aULL,
+                             0x75b7171a4b31dULL, 0x1ff60527118feULL,
+                             0x216936d3cd6e5ULL};
+static const fe ge_base_y = {0x6666666666658ULL, 0x4ccccccccccccULL,
+                             0x1999999999999ULL, 0x3333333333333ULL,
+                             0x6666666666666ULL};
+
+static void ge_p3_0(struct ge_p3 *h) {
+    fe_0(h->X);
+    fe_1(h->Y);
+    fe_1(h->Z);
+    fe_0(h->T);
+}
+
+static void ge_p3_to_cached(struct ge_cached *r, const struct ge_p3 *p) {
+    fe_add(r->YplusX, p->Y, p->X);
+    fe_sub(r->YminusX, p->Y, p->X);
+    fe_copy(r->Z, p->Z);
+    fe_mul(r->T2d, p->T, fe_d2);
+}
+
+/*r = p + q, add-2008-hwcd-3*/
+static void ge_add(struct ge_p3 *r, const struct ge_p3 *p,
+                   const struct ge_cached *q) {
+    fe a, b, c, d, e, f, g, h;
+    fe_sub(a, p->Y, p->X);
+    fe_mul(a, a, q->YminusX);
+    fe_add(b, p->Y, p->X);
+    fe_mul(b, b, q->YplusX);
+    fe_mul(c, p->T, q->T2d);
+    fe_mul(d, p->Z, q->Z);
+    fe_add(d, d, d);
+    fe_sub(e, b, a);
+    fe_sub(f, d, c);
+    fe_add(g, d, c);
+    fe_add(h, b, a);
+    fe_mul(r->X, e, f);
+    fe_mul(r->Y, g, h);
+    fe_mul(r->T, e, h);
+    fe_mul(r->Z, f, g);
+}
+
+/*r = p + q where q is affine*/
+static void ge_madd(struct ge_p3 *r, const struct ge_p3 *p,
+                    const struct ge_precomp *q) {
+    fe a, b, c, d, e, f, g, h;
+    fe_sub(a, p->Y, p->X);
+    fe_mul(a, a, q->yminusx);
+    fe_add(b, p->Y, p->X);
+    fe_mul(b, b, q->yplusx);
+    fe_mul(c, p->T, q->xy2d);
+    fe_add(d, p->Z, p->Z);
+    fe_sub(e, b, a);
+    fe_sub(f, d, c);
+    fe_add(g, d, c);
+    fe_add(h, b, a);
+    fe_mul(r->X, e, f);
+    fe_mul(r->Y, g, h);
+    fe_mul(r->T, e, h);
+    fe_mul(r->Z, f, g);
+}
+
+/*r = 2*p, dbl-2008-hwcd with a = -1*/
+static void ge_double(struct ge_p3 *r, const struct ge_p3 *p) {
+    fe a, b, c, e, f, g, h;
+    fe_sq(a, p->X);
+    fe_sq(b, p->Y);
+    fe_sq(c, p->Z);
+    fe_add(c, c, c);
+    fe_add(h, a, b);
+    fe_add(e, p->X, p->Y);
+    fe_sq(e, e);
+    fe_sub(e, h, e);
+    fe_sub(g, a, b);
+    fe_add(f, c, g);
+    fe_mul(r->X, e, f);
+    fe_mul(r->Y, g, h);
+    fe_mul(r->T, e, h);
+    fe_mul(r->Z, f, g);
+}
+
+static void ge_tobytes(uint8_t *s, const struct ge_p3 *h) {
+    fe recip, x, y;
+    fe_invert(recip, h->Z);
+    fe_mul(x, h->X, recip);
+    fe_mul(y, h->Y, recip);
+    fe_tobytes(s, y);
+    s[31] ^= fe_isnegative(x) << 7;
+}
+
+/*decodes a point, returns 0 if s is not the encoding of a point*/
+static uint8_t ge_frombytes(struct ge_p3 *h, const uint8_t *s) {
+    fe u, v, v3, vxx, check;
+    uint8_t y_bytes[32];
+
+    fe_frombytes(h->Y, s);
+
+    /*reject non-canonical encodings of y*/
+    fe_tobytes(y_bytes, h->Y);
+    y_bytes[31] |= s[31] & 0x80;
+    if (memcmp(y_bytes, s, 32) != 0) return 0;
+
+    fe_1(h->Z);
+    fe_sq(u, h->Y);
+    fe_mul(v, u, fe_d);
+    fe_sub(u, u, h->Z); /*u = y^2 - 1*/
+    fe_add(v, v, h->Z); /*v = d*y^2 + 1*/
+
+    /*x = u*v^3*(u*v^7)^((p-5)/8)*/
+    fe_sq(v3, v);
+    fe_mul(v3, v3, v);
+    fe_sq(h->X, v3);
+    fe_mul(h->X, h->X, v);
+    fe_mul(h->X, h->X, u);
+    fe_pow22523(h->X, h->X);
+    fe_mul(h->X, h->X, v3);
+    fe_mul(h->X, h->X, u);
+
+    fe_sq(vxx, h->X);
+    fe_mul(vxx, vxx, v);
+    fe_sub(check, vxx, u);
+    if (!fe_iszero(check)) {
+        fe_add(check, vxx, u);
+        if (!fe_iszero(check)) return 0;
+        fe_mul(h->X, h->X, fe_sqrtm1);
+    }
+
+    if (fe_iszero(h->X) && (s[31] >> 7)) return 0;
+    if (fe_isnegative(h->X) != (s[31] >> 7)) {
+        fe_neg(h->X, h->X);
+    }
+
+    fe_mul(h->T, h->X, h->Y);
+    return 1;
+}
+
+static void ge_neg(struct ge_p3 *r, const struct ge_p3 *p) {
+    fe_neg(r->X, p->X);
+    fe_copy(r->Y, p->Y);
+    fe_copy(r->Z, p->Z);
+    fe_neg(r->T, p->T);
+}
+
+/*converts a scalar into 64 signed radix 16 digits in [-8, 8]*/
+static void scalar_radix16(int8_t *e, const uint8_t *a) {
+    int8_t carry = 0;
+    for (uint8_t i = 0; i < 32; i++) {
+        e[2 * i] = a[i] & 15;
+        e[2 * i + 1] = (a[i] >> 4) & 15;
+    }
+    for (uint8_t i = 0; i < 63; i++) {
+        e[i] += carry;
+        carry = (e[i] + 8) >> 4;
+        e[i] -= carry * 16;
+    }
+    e[63] += carry;
+}
+
+static inline uint64_t ct_equal(int8_t a, int8_t b) {
+    uint8_t x = (uint8_t)a ^ (uint8_t)b;
+    return ((uint64_t)x - 1) >> 63;
+}
+
+static inline uint64_t ct_negative(int8_t a) {
+    return ((uint64_t)(int64_t)a) >> 63;
+}
+
+/*Table with the multiples j*256^i*B, j = 1..8, i = 0..31 for the base point
+multiplication. Computed when first needed.*/
+static struct ge_precomp base_table[32][8];
+static uint8_t base_table_ready;
+static uint8_t base_table_lock;
+
+static void ge_to_precomp(struct ge_precomp *r, const struct ge_p3 *p) {
+    fe recip, x, y;
+    fe_invert(recip, p->Z);
+    fe_mul(x, p->X, recip);
+    fe_mul(y, p->Y, recip);
+    fe_add(r->yplusx, y, x);
+    fe_sub(r->yminusx, y, x);
+    fe_mul(r->xy2d, x, y);
+    fe_mul(r->xy2d, r->xy2d, fe_d2);
+}
+
+static void base_table_init(void) {
+    if (__atomic_load_n(&base_table_ready, __ATOMIC_ACQUIRE)) return;
+
+    while (__atomic_test_and_set(&base_table_lock, __ATOMIC_ACQUIRE)) {
+    }
+    if (!base_table_ready) {
+        struct ge_p3 row_base, p;
+        struct ge_cached c;
+
+        fe_copy(row_base.X, ge_base_x);
+        fe_copy(row_base.Y, ge_base_y);
+        fe_1(row_base.Z);
+        fe_mul(row_base.T, ge_base_x, ge_base_y);
+
+        for (uint8_t i = 0; i < 32; i++) {
+            ge_p3_to_cached(&c, &row_base);
+            p = row_base;
+            for (uint8_t j = 0; j < 8; j++) {
+                ge_to_precomp(&base_table[i][j], &p);
+                ge_add(&p, &p, &c);
+            }
+            /*next row base 256*row_base*/
+            for (uint8_t j = 0; j < 8; j++) {
+                ge_double(&row_base, &row_base);
+            }
+        }
+        __atomic_store_n(&base_table_ready, 1, __ATOMIC_RELEASE);
+    }
+    __atomic_clear(&base_table_lock, __ATOMIC_RELEASE);
+}
+
+/*constant time selection of b*256^pos*B*/
+static void base_table_select(struct ge_precomp *t, uint8_t pos, int8_t b) {
+    uint64_t b_negative = ct_negative(b);
+    int8_t b_abs = b - (int8_t)((0 - b_negative) & ((uint64_t)b << 1));
+
+    fe_1(t->yplusx);
+    fe_1(t->yminusx);
+    fe_0(t->xy2d);
+    for (uint8_t j = 0; j < 8; j++) {
+        uint64_t eq = ct_equal(b_abs, j + 1);
+        fe_cmov(t->yplusx, base_table[pos][j].yplusx, eq);
+        fe_cmov(t->yminusx, base_table[pos][j].yminusx, eq);
+        fe_cmov(t->xy2d, base_table[pos][j].xy2d, eq);
+    }
+
+    /*negation swaps y+x and y-x and negates 2*d*x*y*/
+    fe minus_xy2d;
+    fe_cswap(t->yplusx, t->yminusx, b_negative);
+    fe_neg(minus_xy2d, t->xy2d);
+    fe_cmov(t->xy2d, minus_xy2d, b_negative);
+}
+
+/*h = a*B, constant time*/
+static void ge_scalarmult_base(struct ge_p3 *h, const uint8_t *a) {
+    int8_t e[64];
+    struct ge_precomp t;
+
+    base_table_init();
+    scalar_radix16(e, a);
+
+    ge_p3_0(h);
+    for (uint8_t i = 1; i < 64; i += 2) {
+        base_table_select(&t, i / 2, e[i]);
+        ge_madd(h, h, &t);
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+        ge_double(h, h);
+    }
+    for (uint8_t i = 0; i < 64; i += 2) {
+        base_table_select(&t, i / 2, e[i]);
+        ge_madd(h, h, &t);
+    }
+    memset(e, 0, sizeof(e));
+}
+
+/*h = a*p, variable time, used with public inputs only*/
+static void ge_scalarmult_vartime(struct ge_p3 *h, const uint8_t *a,
+                                  const struct ge_p3 *p) {
+    int8_t e[64];
+    struct ge_cached table[8];
+    struct ge_p3 t = *p;
+
+    /*table[j] = (j+1)*p*/
+    ge_p3_to_cached(&table[0], p);
+    for (uint8_t j = 1; j < 8; j++) {
+        ge_add(&t, &t, &table[0]);
+        ge_p3_to_cached(&table[j], &t);
+    }
+
+    scalar_radix16(e, a);
+    ge_p3_0(h);
+    for (int8_t i = 63; i >= 0; i--) {
+        for (uint8_t k = 0; k < 4; k++) {
+            ge_double(h, h);
+        }
+        if (e[i] > 0) {
+            ge_add(h, h, &table[e[i] - 1]);
+        } else if (e[i] < 0) {
+            struct ge_cached neg = table[-e[i] - 1];
+            fe tmp;
+            fe_copy(tmp, neg.YplusX);
+            fe_copy(neg.YplusX, neg.YminusX);
+            fe_copy(neg.YminusX, tmp);
+            fe_neg(neg.T2d, neg.T2d);
+            ge_add(h, h, &neg);
+        }
+    }
+}
+
+/******************************************************************************/
+/*                         arithmetic modulo the group order l                */
+/******************************************************************************/
+
+static const uint64_t sc_l[4] = {0x5812631a5cf5d3edULL, 0x14def9dea2f79cd6ULL,
+                                 0x0000000000000000ULL, 0x1000000000000000ULL};
+
+/*floor(2^512 / l)*/
+static const uint64_t sc_mu[5] = {0xed9ce5a30a2c131bULL, 0x2106215d086329a7ULL,
+                                  0xffffffffffffffebULL, 0xffffffffffffffffULL,
+                                  0x000000000000000fULL};
+
+/*r = x mod l for a 512 bit x, Barrett reduction in constant time*/
+static void sc_reduce512(uint64_t *r, const uint64_t *x) {
+    uint64_t q2[10] = {0};
+    uint64_t r2[5] = {0};
+    uint64_t t[5];
+    uint128_t acc;
+    uint64_t c;
+
+    /*q2 = floor(x / 2^192) * mu*/
+    for (uint8_t i = 0; i < 5; i++) {
+        c = 0;
+        for (uint8_t j = 0; j < 5; j++) {
+            acc = (uint128_t)x[i + 3] * sc_mu[j] + q2[i + j] + c;
+            q2[i + j] = (uint64_t)acc;
+            c = (uint64_t)(acc >> 64);
+        }
+        q2[i + 5] = c;
+    }
+
+    /*r2 = (floor(q2 / 2^320) * l) mod 2^320*/
+    for (uint8_t i = 0; i < 5; i++) {
+        c = 0;
+        for (uint8_t j = 0; i + j < 5 && j < 4; j++) {
+            acc = (uint128_t)q2[i + 5] * sc_l[j] + r2[i + j] + c;
+            r2[i + j] = (uint64_t)acc;
+            c = (uint64_t)(acc >> 64);
+        }
+        if (i + 4 < 5) r2[i + 4] += c;
+    }
+
+    /*t = (x mod 2^320) - r2 mod 2^320, smaller than 3*l*/
+    c = 0;
+    for (uint8_t i = 0; i < 5; i++) {
+        acc = (uint128_t)x[i] - r2[i] - c;
+        t[i] = (uint64_t)acc;
+        c = (uint64_t)(acc >> 64) & 1;
+    }
+
+    /*two conditional subtractions of l*/
+    for (uint8_t k = 0; k < 2; k++) {
+        uint64_t s[5];
+        c = 0;
+        for (uint8_t i = 0; i < 5; i++) {
+            acc = (uint128_t)t[i] - (i < 4 ? sc_l[i] : 0) - c;
+            s[i] = (uint64_t)acc;
+            c = (uint64_t)(acc >> 64) & 1;
+        }
+        /*keep t if the subtraction underflowed*/
+        uint64_t mask = 0 - c;
+        for (uint8_t i = 0; i < 5; i++) {
+            t[i] = (t[i] & mask) | (s[i] & ~mask);
+        }
+    }
+    memcpy(r, t, 4 * sizeof(uint64_t));
+}
+
+static void sc_load(uint64_t *x, const uint8_t *s, uint8_t words) {
+    for (uint8_t i = 0; i < words; i++) {
+        x[i] = 0;
+        for (uint8_t j = 0; j < 8; j++) {
+            x[i] |= (uint64_t)s[8 * i + j] << (8 * j);
+        }
+    }
+}
+
+static void sc_store(uint8_t *s, const uint64_t *x) {
+    for (uint8_t i = 0; i < 4; i++) {
+        for (uint8_t j = 0; j < 8; j++) {
+            s[8 * i + j] = (uint8_t)(x[i] >> (8 * j));
+        }
+    }
+}
+
+/*s = in mod l, in is 64 byte long*/
+static void sc_reduce(uint8_t *s, const uint8_t *in) {
+    uint64_t x[8], r[4];
+    sc_load(x, in, 8);
+    sc_reduce512(r, x);
+    sc_store(s, r);
+}
+
+/*s = (a*b + c) mod l*/
+static void sc_muladd(uint8_t *s, const uint8_t *a, const uint8_t *b,
+                      const uint8_t *c) {
+    uint64_t x[8] = {0}, aw[4], bw[4], cw[4], r[4];
+    uint128_t acc;
+    uint64_t carry;
+
+    sc_load(aw, a, 4);
+    sc_load(bw, b, 4);
+    sc_load(cw, c, 4);
+    for (uint8_t i = 0; i < 4; i++) {
+        carry = 0;
+        for (uint8_t j = 0; j < 4; j++) {
+            acc = (uint128_t)aw[i] * bw[j] + x[i + j] + carry;
+            x[i + j] = (uint64_t)acc;
+            carry = (uint64_t)(acc >> 64);
+        }
+        x[i + 4] = carry;
+    }
+    carry = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        acc = (uint128_t)x[i] + (i < 4 ? cw[i] : 0) + carry;
+        x[i] = (uint64_t)acc;
+        carry = (uint64_t)(acc >> 64);
+    }
+    sc_reduce512(r, x);
+    sc_store(s, r);
+}
+
+/*returns 1 if the little endian scalar s is smaller than l*/
+static uint8_t sc_is_canonical(const uint8_t *s) {
+    uint64_t x[4];
+    sc_load(x, s, 4);
+    for (int8_t i = 3; i >= 0; i--) {
+        if (x[i] < sc_l[i]) return 1;
+        if (x[i] > sc_l[i]) return 0;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/*                                  Ed25519                                   */
+/******************************************************************************/
+
+/*out = SHA-512(prefix || msg) mod l*/
+static void sha512_modl(uint8_t *out,
+                        const uint8_t *prefix, uint8_t prefix_len,
+                        const uint8_t *msg, uint32_t msg_len) {
+    struct sha512_state s;
+    uint8_t block[SHA512_BLOCK_SIZE];
+    uint8_t digest[SHA512_HASH_SIZE];
+    uint32_t i;
+
+    memcpy(block, prefix, prefix_len);
+    sha512_init(&s);
+    if (msg_len + prefix_len < SHA512_BLOCK_SIZE) {
+        memcpy(block + prefix_len, msg, msg_len);
+        sha512_final(&s, block, msg_len + prefix_len);
+    } else {
+        memcpy(block + prefix_len, msg, SHA512_BLOCK_SIZE - prefix_len);
+        sha512_block(&s, block);
+        for (i = SHA512_BLOCK_SIZE - prefix_len;
+             i + SHA512_BLOCK_SIZE <= msg_len;
+             i += SHA512_BLOCK_SIZE) {
+            sha512_block(&s, msg + i);
+        }
+        sha512_final(&s, msg + i, msg_len + prefix_len);
+    }
+    sha512_get(&s, digest, 0, SHA512_HASH_SIZE);
+    sc_reduce(out, digest);
+    memset(block, 0, sizeof(block));
+}
+
+static void ed25519_sign(uint8_t *sig, const uint8_t *sk, const uint8_t *pk,
+                         const uint8_t *msg, uint32_t msg_len) {
+    struct sha512_state s;
+    uint8_t az[SHA512_HASH_SIZE];
+    uint8_t nonce[32], hram[32];
+    uint8_t prefix[64];
+    struct ge_p3 R;
+
+    /*expand the secret key*/
+    sha512_init(&s);
+    sha512_final(&s, sk, 32);
+    sha512_get(&s, az, 0, SHA512_HASH_SIZE);
+    az[0] &= 248;
+    az[31] &= 63;
+    az[31] |= 64;
+
+    /*r = H(prefix || M), R = r*B*/
+    sha512_modl(nonce, az + 32, 32, msg, msg_len);
+    ge_scalarmult_base(&R, nonce);
+    ge_tobytes(sig, &R);
+
+    /*S = r + H(R || A || M)*a*/
+    memcpy(prefix, sig, 32);
+    memcpy(prefix + 32, pk, 32);
+    sha512_modl(hram, prefix, 64, msg, msg_len);
+    sc_muladd(sig + 32, hram, az, nonce);
+
+    memset(az, 0, sizeof(az));
+    memset(nonce, 0, sizeof(nonce));
+}
+
+/*returns 1 if [8]a = [8]b, see verify() in crypto_wrapper.h*/
+static uint8_t ge_cofactor_equal(struct ge_p3 *a, struct ge_p3 *b) {
+    uint8_t a_packed[32], b_packed[32];
+
+    for (uint8_t i = 0; i < 3; i++) {
+        ge_double(a, a);
+        ge_double(b, b);
+    }
+    ge_tobytes(a_packed, a);
+    ge_tobytes(b_packed, b);
+    return memcmp(a_packed, b_packed, 32) == 0;
+}
+
+/*checks [8]S*B = [8](R + k*A), ge_frombytes() rejects encodings which are
+not canonical*/
+static uint8_t ed25519_verify(const uint8_t *sig, const uint8_t *pk,
+                              const uint8_t *msg, uint32_t msg_len) {
+    struct ge_p3 A, R, lhs, rhs;
+    struct ge_cached c;
+    uint8_t k[32], prefix[64];
+
+    if (!sc_is_canonical(sig + 32)) return 0;
+    if (!ge_frombytes(&R, sig) || !ge_frombytes(&A, pk)) return 0;
+
+    memcpy(prefix, sig, 32);
+    memcpy(prefix + 32, pk, 32);
+    sha512_modl(k, prefix, 64, msg, msg_len);
+
+    ge_scalarmult_vartime(&rhs, k, &A);
+    ge_p3_to_cached(&c, &R);
+    ge_add(&rhs, &rhs, &c);
+    ge_scalarmult_base(&lhs, sig + 32);
+    return ge_cofactor_equal(&lhs, &rhs);
+}
+
+/*size of the random coefficients in the batch equation*/
+#define BATCH_COEFFICIENT_SIZE 16
+
+/**
+ * @brief   Checks [8][sum z_i*S_i]B = [8](sum [z_i]R_i + sum [z_i*k_i]A_i)
+ *          with Straus' method and the checks of ed25519_verify(), see 
+ *          crypto_wrapper.c
+ */
+static EdhocError ed25519_verify_batch(
+    const struct verify_batch_item *items, uint16_t items_num,
+    bool *valid) {
+    struct ge_cached points[2 * VERIFY_BATCH_MAX_SIZE];
+    uint8_t scalars[2 * VERIFY_BATCH_MAX_SIZE][32];
+    uint8_t s_sum[32] = {0};
+    const uint8_t zero[32] = {0};
+    uint8_t k[32], prefix[64];
+    struct ge_p3 p, lhs, rhs;
+    EdhocError r;
+
+    *valid = false;
+    for (uint16_t i = 0; i < items_num; i++) {
+        const struct verify_batch_item *it = &items[i];
+        uint8_t *z = scalars[2 * i];
+
+        if (it->pk_len != 32 || it->sgn_len != 64 ||
+            !sc_is_canonical(it->sgn + 32)) {
+            return EdhocNoError;
+        }
+        if (!ge_frombytes(&p, it->sgn)) return EdhocNoError;
+        ge_p3_to_cached(&points[2 * i], &p);
+        if (!ge_frombytes(&p, it->pk)) return EdhocNoError;
+        ge_p3_to_cached(&points[2 * i + 1], &p);
+
+        memset(z, 0, 32);
+        r = random_bytes(z, BATCH_COEFFICIENT_SIZE);
+        if (r != EdhocNoError) return r;
+
+        memcpy(prefix, it->sgn, 32);
+        memcpy(prefix + 32, it->pk, 32);
+        sha512_modl(k, prefix, 64, it->msg, it->msg_len);
+        sc_muladd(scalars[2 * i + 1], k, z, zero);
+        sc_muladd(s_sum, it->sgn + 32, z, s_sum);
+    }
+
+    ge_p3_0(&rhs);
+    for (int16_t bit = 252; bit >= 0; bit--) {
+        ge_double(&rhs, &rhs);
+        for (uint16_t j = 0; j < 2 * items_num; j++) {
+            if ((scalars[j][bit >> 3] >> (bit & 7)) & 1) {
+                ge_add(&rhs, &rhs, &points[j]);
+            }
+        }
+    }
+    ge_scalarmult_base(&lhs, s_sum);
+    *valid = ge_cofactor_equal(&lhs, &rhs);
+    return EdhocNoError;
+}
+
+/******************************************************************************/
+/*                             crypto_wrapper API                             */
+/******************************************************************************/
+
+EdhocError shared_secret_derive(
+    enum ecdh_curve curve,
+    const uint8_t *sk, const uint32_t sk_len,
+    const uint8_t *pk, const uint32_t pk_len,
+    uint8_t *shared_secret) {
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    /*inside a crypto task the provider computes, see crypto_async.h*/
+    if (crypto_task_current() != NULL) {
+        struct crypto_op o = {
+            .type = CRYPTO_OP_SHARED_SECRET,
+            .u.shared_secret = {curve, sk, sk_len, pk, pk_len,
+                                shared_secret}};
+        return crypto_offload(&o);
+    }
+#endif
+#ifdef EDHOC_WITH_P256
+    if (curve == P_256_ECDH) {
+        return p256_shared_secret(sk, pk, pk_len, shared_secret);
+    }
+#endif
+    if (curve != X25519) return UnsupportedEcdhCurve;
+    if (sk_len != 32) return InvalidPrivateKey;
+    if (pk_len != 32) return InvalidPublicKey;
+    x25519_scalarmult(shared_secret, sk, pk);
+    return EdhocNoError;
+}
+
+/*clamps sk and computes pk = X25519(sk, 9) on the Edwards curve with the
+base table: u = (1 + y)/(1 - y) = (Z + Y)/(Z - Y)*/
+static void x25519_keygen(uint8_t *sk, uint8_t *pk) {
+    struct ge_p3 A;
+    fe n, d;
+
+    sk[0] &= 248;
+    sk[31] &= 127;
+    sk[31] |= 64;
+    ge_scalarmult_base(&A, sk);
+    fe_add(n, A.Z, A.Y);
+    fe_sub(d, A.Z, A.Y);
+    fe_invert(d, d);
+    fe_mul(n, n, d);
+    fe_tobytes(pk, n);
+}
+
+EdhocError ephemeral_dh_key_pair_gen(
+    enum ecdh_curve curve,
+    uint8_t *sk, uint8_t *pk) {
+    EdhocError r;
+#ifdef EDHOC_WITH_P256
+    if (curve == P_256_ECDH) return p256_key_pair_gen(sk, pk);
+#endif
+    if (curve != X25519) return UnsupportedEcdhCurve;
+    r = random_bytes(sk, 32);
+    if (r != EdhocNoError) return r;
+    x25519_keygen(sk, pk);
+    return EdhocNoError;
+}
+
+EdhocError ephemeral_dh_key_gen(
+    enum ecdh_curve curve, uint32_t seed,
+    uint8_t *sk, uint8_t *pk) {
+    EdhocError r;
+#ifdef EDHOC_WITH_P256
+    if (curve == P_256_ECDH) {
+        r = hash(SHA_256, (uint8_t *)&seed, sizeof(seed), sk);
+        if (r != EdhocNoError) return r;
+        return p256_public_key(sk, pk);
+    }
+#endif
+    if (curve != X25519) return UnsupportedEcdhCurve;
+    r = hash(SHA_256, (uint8_t *)&seed, sizeof(seed), sk);
+    if (r != EdhocNoError) return r;
+    x25519_keygen(sk, pk);
+    return EdhocNoError;
+}
+
+EdhocError sign(
+    enum sign_alg_curve curve,
+    const uint8_t *sk, const uint8_t sk_len,
+    const uint8_t *pk, const uint8_t pk_len,
+    const uint8_t *msg, const uint16_t msg_len,
+    uint8_t *out, uint32_t *out_len) {
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    if (crypto_task_current() != NULL) {
+        struct crypto_op o = {
+            .type = CRYPTO_OP_SIGN,
+            .u.sign = {curve, sk, sk_len, pk, pk_len, msg, msg_len,
+                       out, out_len}};
+        return crypto_offload(&o);
+    }
+#endif
+    if (curve == P_256_SIGN) {
+#ifdef EDHOC_WITH_P256
+        if (*out_len < P256_SIGNATURE_SIZE) return DestBufferToSmall;
+        EdhocError r = p256_sign(sk, msg, msg_len, out);
+        if (r != EdhocNoError) return r;
+        *out_len = P256_SIGNATURE_SIZE;
+        return EdhocNoError;
+#endif
+    }
+    if (curve != Ed25519_SIGN) return UnsupportedSignatureCurve;
+    if (sk_len != 32) return InvalidPrivateKey;
+    if (pk_len != 32) return InvalidPublicKey;
+    if (*out_len < 64) return DestBufferToSmall;
+    ed25519_sign(out, sk, pk, msg, msg_len);
+    *out_len = 64;
+    return EdhocNoError;
+}
+
+EdhocError verify(
+    enum sign_alg_curve curve,
+    const uint8_t *pk, const uint8_t pk_len,
+    const uint8_t *msg, const uint16_t msg_len,
+    const uint8_t *sgn, const uint16_t sgn_len,
+    bool *result) {
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    if (crypto_task_current() != NULL) {
+        struct crypto_op o = {
+            .type = CRYPTO_OP_VERIFY,
+            .u.verify = {curve, pk, pk_len, msg, msg_len, sgn, sgn_len,
+                         result}};
+        return crypto_offload(&o);
+    }
+#endif
+    if (curve == P_256_SIGN) {
+#ifdef EDHOC_WITH_P256
+        if (sgn_len != P256_SIGNATURE_SIZE) {
+            *result = false;
+            return EdhocNoError;
+        }
+        return p256_verify(pk, pk_len, msg, msg_len, sgn, result);
+#endif
+    }
+    if (curve != Ed25519_SIGN) return UnsupportedSignatureCurve;
+    *result = (pk_len == 32 && sgn_len == 64 &&
+               ed25519_verify(sgn, pk, msg, msg_len));
+    return EdhocNoError;
+}
+
+EdhocError verify_batch(
+    enum sign_alg_curve curve,
+    struct verify_batch_item *items, uint16_t items_num,
+    bool *all_valid) {
+    EdhocError r;
+    uint16_t i, n;
+
+    *all_valid = true;
+    for (; items_num; items += n, items_num -= n) {
+        bool batch_valid = false;
+
+        n = items_num < VERIFY_BATCH_MAX_SIZE ? items_num
+                                              : VERIFY_BATCH_MAX_SIZE;
+        if (curve == Ed25519_SIGN && n > 1) {
+            r = ed25519_verify_batch(items, n, &batch_valid);
+            if (r != EdhocNoError) return r;
+        }
+        /*a failed batch is verified one by one to find the invalid items*/
+        for (i = 0; i < n; i++) {
+            if (batch_valid) {
+                items[i].result = true;
+                continue;
+            }
+            r = verify(
+                curve,
+                items[i].pk, items[i].pk_len,
+                items[i].msg, items[i].msg_len,
+                items[i].sgn, items[i].sgn_len,
+                &items[i].result);
+            if (r != EdhocNoError) return r;
+            if (!items[i].result) *all_valid = false;
+        }
+    }
+    return EdhocNoError;
+}
+
+#endif
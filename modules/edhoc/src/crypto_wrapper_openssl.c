@@ -0,0 +1,696 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+/*
+Crypto for hosts with OpenSSL 3, built on the EVP API of libcrypto.
+
+Define EDHOC_WITH_OPENSSL and link with -lcrypto to replace aead(), sign(),
+verify(), shared_secret_derive(), ephemeral_dh_key_gen(),
+ephemeral_dh_key_pair_gen(), random_bytes(), hash(), hkdf_extract() and the
+P-256 primitives. verify_batch() of crypto_wrapper.c then verifies the
+signatures one by one with verify().
+
+The incremental hash and the prepared HKDF PRK are kept on crypto_backend.h,
+struct hash_state and struct hkdf_prk must be plain memory which can be
+copied and dropped without a free, which an EVP_MD_CTX or EVP_MAC_CTX is
+not.
+
+Every thread keeps its EVP contexts, the fetched algorithms and the last
+signing key, so that an operation does not allocate them again. The
+signing key is in most cases the static key of the party, setting up an
+Ed25519 or a P-256 key includes a scalar multiplication.
+*/
+
+#ifdef EDHOC_WITH_OPENSSL
+
+#if defined(EDHOC_WITH_C25519_RADIX51) || defined(EDHOC_WITH_P256_64)
+#error "EDHOC_WITH_OPENSSL can not be combined with EDHOC_WITH_C25519_RADIX51 or EDHOC_WITH_P256_64"
+#endif
+
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/opensslv.h>
+#include <openssl/param_build.h>
+#include <openssl/rand.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../edhoc.h"
+#include "../inc/crypto_async.h"
+#include "../../common/inc/crypto_backend.h"
+#include "../inc/crypto_wrapper.h"
+#include "../inc/error.h"
+#include "../inc/suites.h"
+
+#if OPENSSL_VERSION_NUMBER < 0x30000000L
+#error "EDHOC_WITH_OPENSSL requires OpenSSL 3.0 or later"
+#endif
+
+#define X25519_KEY_SIZE 32
+#define ED25519_KEY_SIZE 32
+#define P256_POINT_SIZE (2 * P256_SCALAR_SIZE + 1)
+
+/*objects reused by all operations of a thread*/
+struct ossl_thread {
+    EVP_CIPHER *ccm;
+    EVP_CIPHER_CTX *cipher_ctx;
+    EVP_MD *sha256;
+    EVP_MD_CTX *md_ctx;
+    EVP_MAC *hmac;
+    EVP_MAC_CTX *mac_ctx;
+    EC_GROUP *p256;
+    BN_CTX *bn_ctx;
+    /*the last signing key*/
+    int sign_type;
+    uint8_t sign_sk[P256_SCALAR_SIZE];
+    EVP_PKEY *sign_key;
+};
+
+static pthread_once_t ossl_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ossl_key;
+
+static void ossl_thread_free(void *arg) {
+    struct ossl_thread *s = arg;
+
+    EVP_CIPHER_free(s->ccm);
+    EVP_CIPHER_CTX_free(s->cipher_ctx);
+    EVP_MD_free(s->sha256);
+    EVP_MD_CTX_free(s->md_ctx);
+    EVP_MAC_free(s->hmac);
+    EVP_MAC_CTX_free(s->mac_ctx);
+    EC_GROUP_free(s->p256);
+    BN_CTX_free(s->bn_ctx);
+    EVP_PKEY_free(s->sign_key);
+    OPENSSL_cleanse(s, sizeof(*s));
+    free(s);
+}
+
+static void ossl_key_create(void) {
+    pthread_key_create(&ossl_key, ossl_thread_free);
+}
+
+/**
+ * @brief   Returns the objects of the calling thread, creates them on the
+ *          first call
+ * @retval  NULL if libcrypto could not allocate them
+ */
+static struct ossl_thread *ossl_thread(void) {
+    struct ossl_thread *s;
+    OSSL_PARAM params[2];
+
+    pthread_once(&ossl_once, ossl_key_create);
+    s = pthread_getspecific(ossl_key);
+    if (s != NULL) return s;
+
+    s = calloc(1, sizeof(*s));
+    if (s == NULL) return NULL;
+    s->ccm = EVP_CIPHER_fetch(NULL, "AES-128-CCM", NULL);
+    s->cipher_ctx = EVP_CIPHER_CTX_new();
+    s->sha256 = EVP_MD_fetch(NULL, "SHA256", NULL);
+    s->md_ctx = EVP_MD_CTX_new();
+    s->hmac = EVP_MAC_fetch(NULL, "HMAC", NULL);
+    if (s->hmac != NULL) s->mac_ctx = EVP_MAC_CTX_new(s->hmac);
+    s->p256 = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+    s->bn_ctx = BN_CTX_new();
+    /*the algorithms are set once, later calls only set the key*/
+    params[0] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST,
+                                                 "SHA256", 0);
+    params[1] = OSSL_PARAM_construct_end();
+    if (s->ccm == NULL || s->cipher_ctx == NULL || s->sha256 == NULL ||
+        s->md_ctx == NULL || s->mac_ctx == NULL || s->p256 == NULL ||
+        s->bn_ctx == NULL ||
+        EVP_CipherInit_ex2(s->cipher_ctx, s->ccm, NULL, NULL, 1, NULL) != 1 ||
+        EVP_MAC_CTX_set_params(s->mac_ctx, params) != 1 ||
+        pthread_setspecific(ossl_key, s) != 0) {
+        ossl_thread_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+/******************************************************************************/
+/*                                   keys                                     */
+/******************************************************************************/
+
+/**
+ * @brief   Converts a P-256 public key in one of the formats listed in
+ *          crypto_wrapper.h into an uncompressed point. Of an x coordinate
+ *          only the point with even y is taken, which has the same ECDH
+ *          result as the one with odd y.
+ * @retval  false if pk is not a point on the curve
+ */
+static bool p256_point_decode(
+    struct ossl_thread *s,
+    const uint8_t *pk, uint32_t pk_len,
+    uint8_t *point) {
+    uint8_t buf[P256_POINT_SIZE];
+    const uint8_t *p = pk;
+    EC_POINT *q;
+    bool ok;
+
+    switch (pk_len) {
+        case P256_POINT_SIZE:
+        case P256_SCALAR_SIZE + 1:
+            break;
+        case 2 * P256_SCALAR_SIZE:
+            buf[0] = 0x04;
+            memcpy(buf + 1, pk, pk_len);
+            p = buf;
+            pk_len++;
+            break;
+        case P256_SCALAR_SIZE:
+            buf[0] = 0x02;
+            memcpy(buf + 1, pk, pk_len);
+            p = buf;
+            pk_len++;
+            break;
+        default:
+            return false;
+    }
+
+    q = EC_POINT_new(s->p256);
+    if (q == NULL) return false;
+    /*checks that the point is on the curve*/
+    ok = EC_POINT_oct2point(s->p256, q, p, pk_len, s->bn_ctx) == 1 &&
+         EC_POINT_point2oct(s->p256, q, POINT_CONVERSION_UNCOMPRESSED, point,
+                            P256_POINT_SIZE, s->bn_ctx) == P256_POINT_SIZE;
+    EC_POINT_free(q);
+    return ok;
+}
+
+/**
+ * @brief   Creates a P-256 EVP_PKEY
+ * @param   sk private key or NULL for a public key
+ * @param   point uncompressed public key or NULL for a private key
+ */
+static EVP_PKEY *p256_pkey(const uint8_t *sk, const uint8_t *point) {
+    OSSL_PARAM_BLD *bld = OSSL_PARAM_BLD_new();
+    OSSL_PARAM *params = NULL;
+    EVP_PKEY_CTX *ctx = NULL;
+    EVP_PKEY *pkey = NULL;
+    BIGNUM *d = NULL;
+
+    if (bld == NULL) return NULL;
+    if (!OSSL_PARAM_BLD_push_utf8_string(bld, OSSL_PKEY_PARAM_GROUP_NAME,
+                                         SN_X9_62_prime256v1, 0)) {
+        goto out;
+    }
+    if (sk != NULL) {
+        d = BN_secure_new();
+        if (d == NULL || BN_bin2bn(sk, P256_SCALAR_SIZE, d) == NULL ||
+            !OSSL_PARAM_BLD_push_BN(bld, OSSL_PKEY_PARAM_PRIV_KEY, d)) {
+            goto out;
+        }
+    }
+    if (point != NULL &&
+        !OSSL_PARAM_BLD_push_octet_string(bld, OSSL_PKEY_PARAM_PUB_KEY, point,
+                                          P256_POINT_SIZE)) {
+        goto out;
+    }
+    params = OSSL_PARAM_BLD_to_param(bld);
+    ctx = EVP_PKEY_CTX_new_from_name(NULL, "EC", NULL);
+    if (params == NULL || ctx == NULL || EVP_PKEY_fromdata_init(ctx) != 1 ||
+        EVP_PKEY_fromdata(ctx, &pkey,
+                          sk != NULL ? EVP_PKEY_KEYPAIR : EVP_PKEY_PUBLIC_KEY,
+                          params) != 1) {
+        pkey = NULL;
+    }
+out:
+    EVP_PKEY_CTX_free(ctx);
+    OSSL_PARAM_free(params);
+    OSSL_PARAM_BLD_free(bld);
+    BN_clear_free(d);
+    return pkey;
+}
+
+/**
+ * @brief   Returns the signing key of sk, reuses the one of the last call if
+ *          sk did not change
+ * @param   type EVP_PKEY_ED25519 or EVP_PKEY_EC
+ */
+static EVP_PKEY *sign_key(struct ossl_thread *s, int type, const uint8_t *sk) {
+    if (s->sign_key != NULL && s->sign_type == type &&
+        CRYPTO_memcmp(s->sign_sk, sk, sizeof(s->sign_sk)) == 0) {
+        return s->sign_key;
+    }
+    EVP_PKEY_free(s->sign_key);
+    if (type == EVP_PKEY_ED25519) {
+        s->sign_key = EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, NULL, sk,
+                                                   ED25519_KEY_SIZE);
+    } else {
+        s->sign_key = p256_pkey(sk, NULL);
+    }
+    s->sign_type = type;
+    memcpy(s->sign_sk, sk, sizeof(s->sign_sk));
+    return s->sign_key;
+}
+
+/**
+ * @brief   Computes the ECDH shared secret of two keys
+ */
+static bool pkey_derive(
+    EVP_PKEY *own, EVP_PKEY *peer,
+    uint8_t *shared_secret, size_t len) {
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(own, NULL);
+    bool ok = ctx != NULL && EVP_PKEY_derive_init(ctx) == 1 &&
+              EVP_PKEY_derive_set_peer_ex(ctx, peer, 0) == 1 &&
+              EVP_PKEY_derive(ctx, shared_secret, &len) == 1;
+    EVP_PKEY_CTX_free(ctx);
+    return ok;
+}
+
+/**
+ * @brief   Generates the X25519 key pair of a 32 byte seed, the private key
+ *          is the clamped seed as with compact_x25519_keygen()
+ */
+static EdhocError x25519_keygen(
+    const uint8_t *seed,
+    uint8_t *sk, uint8_t *pk) {
+    EVP_PKEY *pkey;
+    size_t len = X25519_KEY_SIZE;
+    bool ok;
+
+    memcpy(sk, seed, X25519_KEY_SIZE);
+    sk[0] &= 248;
+    sk[31] &= 127;
+    sk[31] |= 64;
+    pkey = EVP_PKEY_new_raw_private_key(EVP_PKEY_X25519, NULL, sk,
+                                        X25519_KEY_SIZE);
+    ok = pkey != NULL && EVP_PKEY_get_raw_public_key(pkey, pk, &len) == 1;
+    EVP_PKEY_free(pkey);
+    return ok ? EdhocNoError : CryptoLibraryError;
+}
+
+/******************************************************************************/
+/*                                crypto API                                  */
+/******************************************************************************/
+
+EdhocError aead(
+    enum aes_operation op,
+    const uint8_t *in, const uint16_t in_len,
+    const uint8_t *key, const uint16_t key_len,
+    uint8_t *nonce, const uint16_t nonce_len,
+    const uint8_t *aad, const uint16_t aad_len,
+    uint8_t *out, const uint16_t out_len,
+    uint8_t *tag, const uint16_t tag_len) {
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    /*inside a crypto task the provider computes, see crypto_async.h*/
+    if (crypto_task_current() != NULL) {
+        struct crypto_op o = {
+            .type = CRYPTO_OP_AEAD,
+            .u.aead = {op, in, in_len, key, key_len, nonce, nonce_len,
+                       aad, aad_len, out, out_len, tag, tag_len}};
+        return crypto_offload(&o);
+    }
+#endif
+    struct ossl_thread *s = ossl_thread();
+    int enc = (op == ENCRYPT), len;
+    /*the tag follows the ciphertext, see crypto_backend.h*/
+    uint16_t n = enc ? in_len : in_len - tag_len;
+
+    if (s == NULL) return ErrorDuringAEAD;
+    if (key_len != 16 || (!enc && in_len < tag_len)) return ErrorDuringAEAD;
+    if (out_len < n + (enc ? tag_len : 0)) return DestBufferToSmall;
+
+    /*without a cipher the context keeps its provider context, it is reset
+    and keyed again instead of allocated*/
+    if (EVP_CipherInit_ex2(s->cipher_ctx, NULL, NULL, NULL, enc, NULL) != 1 ||
+        EVP_CIPHER_CTX_ctrl(s->cipher_ctx, EVP_CTRL_AEAD_SET_IVLEN,
+                            nonce_len, NULL) != 1 ||
+        EVP_CIPHER_CTX_ctrl(s->cipher_ctx, EVP_CTRL_AEAD_SET_TAG, tag_len,
+                            enc ? NULL : (void *)(in + n)) != 1 ||
+        EVP_CipherInit_ex2(s->cipher_ctx, NULL, key, nonce, enc, NULL) != 1 ||
+        EVP_CipherUpdate(s->cipher_ctx, NULL, &len, NULL, n) != 1 ||
+        (aad_len != 0 &&
+         EVP_CipherUpdate(s->cipher_ctx, NULL, &len, aad, aad_len) != 1)) {
+        return ErrorDuringAEAD;
+    }
+    if (EVP_CipherUpdate(s->cipher_ctx, out, &len, in, n) != 1) {
+        if (enc) return ErrorDuringAEAD;
+        OPENSSL_cleanse(out, n);
+        return AEADAuthenticationFailed;
+    }
+    if (enc) {
+        if (EVP_CIPHER_CTX_ctrl(s->cipher_ctx, EVP_CTRL_AEAD_GET_TAG, tag_len,
+                                tag) != 1) {
+            return ErrorDuringAEAD;
+        }
+        memcpy(out + n, tag, tag_len);
+    }
+    return EdhocNoError;
+}
+
+EdhocError sign(
+    enum sign_alg_curve curve,
+    const uint8_t *sk, const uint8_t sk_len,
+    const uint8_t *pk, const uint8_t pk_len,
+    const uint8_t *msg, const uint16_t msg_len,
+    uint8_t *out, uint32_t *out_len) {
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    if (crypto_task_current() != NULL) {
+        struct crypto_op o = {
+            .type = CRYPTO_OP_SIGN,
+            .u.sign = {curve, sk, sk_len, pk, pk_len, msg, msg_len,
+                       out, out_len}};
+        return crypto_offload(&o);
+    }
+#endif
+    struct ossl_thread *s;
+    EVP_PKEY *key;
+    size_t len = *out_len;
+    int ok;
+
+    if (curve == P_256_SIGN) {
+        if (*out_len < P256_SIGNATURE_SIZE) return DestBufferToSmall;
+        EdhocError r = p256_sign(sk, msg, msg_len, out);
+        if (r != EdhocNoError) return r;
+        *out_len = P256_SIGNATURE_SIZE;
+        return EdhocNoError;
+    }
+    if (curve != Ed25519_SIGN) return UnsupportedSignatureCurve;
+
+    s = ossl_thread();
+    if (s == NULL) return ErrorDuringSigning;
+    key = sign_key(s, EVP_PKEY_ED25519, sk);
+    ok = key != NULL &&
+         EVP_DigestSignInit_ex(s->md_ctx, NULL, NULL, NULL, NULL, key,
+                               NULL) == 1 &&
+         EVP_DigestSign(s->md_ctx, out, &len, msg, msg_len) == 1;
+    EVP_MD_CTX_reset(s->md_ctx);
+    if (!ok) return ErrorDuringSigning;
+    *out_len = (uint32_t)len;
+    return EdhocNoError;
+}
+
+EdhocError verify(
+    enum sign_alg_curve curve,
+    const uint8_t *pk, const uint8_t pk_len,
+    const uint8_t *msg, const uint16_t msg_len,
+    const uint8_t *sgn, const uint16_t sgn_len,
+    bool *result) {
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    if (crypto_task_current() != NULL) {
+        struct crypto_op o = {
+            .type = CRYPTO_OP_VERIFY,
+            .u.verify = {curve, pk, pk_len, msg, msg_len, sgn, sgn_len,
+                         result}};
+        return crypto_offload(&o);
+    }
+#endif
+    struct ossl_thread *s;
+    EVP_PKEY *key;
+
+    *result = false;
+    if (curve == P_256_SIGN) {
+        if (sgn_len != P256_SIGNATURE_SIZE) return EdhocNoError;
+        return p256_verify(pk, pk_len, msg, msg_len, sgn, result);
+    }
+    if (curve != Ed25519_SIGN) return UnsupportedSignatureCurve;
+    if (pk_len != ED25519_KEY_SIZE) return EdhocNoError;
+
+    s = ossl_thread();
+    if (s == NULL) return CryptoLibraryError;
+    key = EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, NULL, pk, pk_len);
+    if (key == NULL) return EdhocNoError;
+    *result = EVP_DigestVerifyInit_ex(s->md_ctx, NULL, NULL, NULL, NULL, key,
+                                      NULL) == 1 &&
+              EVP_DigestVerify(s->md_ctx, sgn, sgn_len, msg, msg_len) == 1;
+    EVP_MD_CTX_reset(s->md_ctx);
+    EVP_PKEY_free(key);
+    return EdhocNoError;
+}
+
+EdhocError shared_secret_derive(
+    enum ecdh_curve curve,
+    const uint8_t *sk, const uint32_t sk_len,
+    const uint8_t *pk, const uint32_t pk_len,
+    uint8_t *shared_secret) {
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    if (crypto_task_current() != NULL) {
+        struct crypto_op o = {
+            .type = CRYPTO_OP_SHARED_SECRET,
+            .u.shared_secret = {curve, sk, sk_len, pk, pk_len,
+                                shared_secret}};
+        return crypto_offload(&o);
+    }
+#endif
+    EVP_PKEY *own, *peer;
+    bool ok;
+
+    if (curve == P_256_ECDH) {
+        return p256_shared_secret(sk, pk, pk_len, shared_secret);
+    }
+    if (curve != X25519) return UnsupportedEcdhCurve;
+    if (sk_len != X25519_KEY_SIZE || pk_len != X25519_KEY_SIZE) {
+        return InvalidPublicKey;
+    }
+
+    own = EVP_PKEY_new_raw_private_key(EVP_PKEY_X25519, NULL, sk, sk_len);
+    peer = EVP_PKEY_new_raw_public_key(EVP_PKEY_X25519, NULL, pk, pk_len);
+    ok = own != NULL && peer != NULL &&
+         pkey_derive(own, peer, shared_secret, X25519_KEY_SIZE);
+    EVP_PKEY_free(own);
+    EVP_PKEY_free(peer);
+    return ok ? EdhocNoError : CryptoLibraryError;
+}
+
+EdhocError ephemeral_dh_key_gen(
+    enum ecdh_curve curve, uint32_t seed,
+    uint8_t *sk, uint8_t *pk) {
+    uint8_t extended_seed[32];
+    EdhocError r;
+
+    r = hash(SHA_256, (uint8_t *)&seed, sizeof(seed), extended_seed);
+    if (r != EdhocNoError) return r;
+    if (curve == X25519) {
+        return x25519_keygen(extended_seed, sk, pk);
+    } else if (curve == P_256_ECDH) {
+        memcpy(sk, extended_seed, P256_SCALAR_SIZE);
+        return p256_public_key(sk, pk);
+    }
+    return UnsupportedEcdhCurve;
+}
+
+EdhocError ephemeral_dh_key_pair_gen(
+    enum ecdh_curve curve,
+    uint8_t *sk, uint8_t *pk) {
+    uint8_t seed[X25519_KEY_SIZE];
+    EdhocError r;
+
+    if (curve == X25519) {
+        r = random_bytes(seed, sizeof(seed));
+        if (r != EdhocNoError) return r;
+        r = x25519_keygen(seed, sk, pk);
+        OPENSSL_cleanse(seed, sizeof(seed));
+        return r;
+    } else if (curve == P_256_ECDH) {
+        return p256_key_pair_gen(sk, pk);
+    }
+    return UnsupportedEcdhCurve;
+}
+
+EdhocError random_bytes(uint8_t *out, uint32_t out_len) {
+    if (RAND_bytes(out, (int)out_len) != 1) {
+        return ErrorDuringRandomGeneration;
+    }
+    return EdhocNoError;
+}
+
+EdhocError hash(
+    enum hash_alg alg,
+    const uint8_t *in,
+    const uint64_t in_len,
+    uint8_t *out) {
+    struct ossl_thread *s;
+
+    if (alg != SHA_256) return EdhocNoError;
+    s = ossl_thread();
+    if (s == NULL ||
+        EVP_DigestInit_ex2(s->md_ctx, s->sha256, NULL) != 1 ||
+        EVP_DigestUpdate(s->md_ctx, in, in_len) != 1 ||
+        EVP_DigestFinal_ex(s->md_ctx, out, NULL) != 1) {
+        return CryptoLibraryError;
+    }
+    return EdhocNoError;
+}
+
+EdhocError hkdf_extract(
+    enum hash_alg alg,
+    const uint8_t *salt, uint32_t salt_len,
+    uint8_t *ikm, uint8_t ikm_len,
+    uint8_t *out) {
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    if (crypto_task_current() != NULL) {
+        struct crypto_op o = {
+            .type = CRYPTO_OP_HKDF_EXTRACT,
+            .u.hkdf_extract = {alg, salt, salt_len, ikm, ikm_len, out}};
+        return crypto_offload(&o);
+    }
+#endif
+    static const uint8_t zero_salt[SHA_DEFAULT_SIZE] = {0};
+    struct ossl_thread *s;
+    size_t len;
+
+    if (alg != SHA_256) return EdhocNoError;
+    s = ossl_thread();
+    if (s == NULL) return ErrorDuringHKDFCalculation;
+    /*an empty salt is a string of zeros, see hkdf_extract() in
+    crypto_wrapper.c*/
+    if (salt == NULL || salt_len == 0) {
+        salt = zero_salt;
+        salt_len = sizeof(zero_salt);
+    }
+    /*HKDF-Extract is HMAC(salt, IKM), the MAC context is keyed again
+    instead of allocated*/
+    if (EVP_MAC_init(s->mac_ctx, salt, salt_len, NULL) != 1 ||
+        EVP_MAC_update(s->mac_ctx, ikm, ikm_len) != 1 ||
+        EVP_MAC_final(s->mac_ctx, out, &len, SHA_DEFAULT_SIZE) != 1) {
+        return ErrorDuringHKDFCalculation;
+    }
+    return EdhocNoError;
+}
+
+/******************************************************************************/
+/*                                  P-256                                     */
+/******************************************************************************/
+
+EdhocError p256_public_key(const uint8_t *sk, uint8_t *pk) {
+    struct ossl_thread *s = ossl_thread();
+    uint8_t point[P256_POINT_SIZE];
+    EdhocError r = CryptoLibraryError;
+    BIGNUM *d;
+    EC_POINT *q;
+
+    if (s == NULL) return CryptoLibraryError;
+    d = BN_secure_new();
+    q = EC_POINT_new(s->p256);
+    if (d == NULL || q == NULL || BN_bin2bn(sk, P256_SCALAR_SIZE, d) == NULL) {
+        goto out;
+    }
+    if (BN_is_zero(d) || BN_cmp(d, EC_GROUP_get0_order(s->p256)) >= 0) {
+        r = InvalidPrivateKey;
+        goto out;
+    }
+    if (EC_POINT_mul(s->p256, q, d, NULL, NULL, s->bn_ctx) != 1 ||
+        EC_POINT_point2oct(s->p256, q, POINT_CONVERSION_UNCOMPRESSED, point,
+                           sizeof(point), s->bn_ctx) != sizeof(point)) {
+        goto out;
+    }
+    memcpy(pk, point + 1, P256_SCALAR_SIZE);
+    r = EdhocNoError;
+out:
+    BN_clear_free(d);
+    EC_POINT_free(q);
+    return r;
+}
+
+EdhocError p256_shared_secret(
+    const uint8_t *sk,
+    const uint8_t *pk, uint32_t pk_len,
+    uint8_t *shared_secret) {
+    struct ossl_thread *s = ossl_thread();
+    uint8_t point[P256_POINT_SIZE];
+    EVP_PKEY *own, *peer;
+    bool ok;
+
+    if (s == NULL) return CryptoLibraryError;
+    if (!p256_point_decode(s, pk, pk_len, point)) return InvalidPublicKey;
+    own = p256_pkey(sk, NULL);
+    if (own == NULL) return InvalidPrivateKey;
+    peer = p256_pkey(NULL, point);
+    ok = peer != NULL &&
+         pkey_derive(own, peer, shared_secret, P256_SCALAR_SIZE);
+    EVP_PKEY_free(own);
+    EVP_PKEY_free(peer);
+    return ok ? EdhocNoError : InvalidPublicKey;
+}
+
+EdhocError p256_sign(
+    const uint8_t *sk,
+    const uint8_t *msg, uint16_t msg_len,
+    uint8_t *sgn) {
+    struct ossl_thread *s = ossl_thread();
+    uint8_t der[P256_SIGNATURE_SIZE + 8];
+    const uint8_t *p = der;
+    size_t der_len = sizeof(der);
+    const BIGNUM *r, *t;
+    ECDSA_SIG *sig = NULL;
+    EVP_PKEY *key;
+    bool ok;
+
+    if (s == NULL) return ErrorDuringSigning;
+    key = sign_key(s, EVP_PKEY_EC, sk);
+    ok = key != NULL &&
+         EVP_DigestSignInit_ex(s->md_ctx, NULL, "SHA256", NULL, NULL, key,
+                               NULL) == 1 &&
+         EVP_DigestSign(s->md_ctx, der, &der_len, msg, msg_len) == 1;
+    EVP_MD_CTX_reset(s->md_ctx);
+
+    /*DER to r || s*/
+    if (ok) sig = d2i_ECDSA_SIG(NULL, &p, (long)der_len);
+    if (sig == NULL) return ErrorDuringSigning;
+    ECDSA_SIG_get0(sig, &r, &t);
+    ok = BN_bn2binpad(r, sgn, P256_SCALAR_SIZE) == P256_SCALAR_SIZE &&
+         BN_bn2binpad(t, sgn + P256_SCALAR_SIZE, P256_SCALAR_SIZE) ==
+             P256_SCALAR_SIZE;
+    ECDSA_SIG_free(sig);
+    return ok ? EdhocNoError : ErrorDuringSigning;
+}
+
+EdhocError p256_verify(
+    const uint8_t *pk, uint32_t pk_len,
+    const uint8_t *msg, uint16_t msg_len,
+    const uint8_t *sgn,
+    bool *result) {
+    struct ossl_thread *s = ossl_thread();
+    uint8_t point[P256_POINT_SIZE];
+    uint8_t *der = NULL;
+    ECDSA_SIG *sig;
+    BIGNUM *r, *t;
+    EVP_PKEY *key;
+    int der_len;
+
+    *result = false;
+    if (s == NULL) return CryptoLibraryError;
+    /*the y coordinate is needed to verify a signature*/
+    if (pk_len == P256_SCALAR_SIZE || !p256_point_decode(s, pk, pk_len, point)) {
+        return EdhocNoError;
+    }
+
+    /*r || s to DER*/
+    sig = ECDSA_SIG_new();
+    r = BN_bin2bn(sgn, P256_SCALAR_SIZE, NULL);
+    t = BN_bin2bn(sgn + P256_SCALAR_SIZE, P256_SCALAR_SIZE, NULL);
+    if (sig == NULL || r == NULL || t == NULL || !ECDSA_SIG_set0(sig, r, t)) {
+        ECDSA_SIG_free(sig);
+        BN_free(r);
+        BN_free(t);
+        return CryptoLibraryError;
+    }
+    der_len = i2d_ECDSA_SIG(sig, &der);
+    ECDSA_SIG_free(sig);
+    if (der_len <= 0) return CryptoLibraryError;
+
+    key = p256_pkey(NULL, point);
+    *result = key != NULL &&
+              EVP_DigestVerifyInit_ex(s->md_ctx, NULL, "SHA256", NULL, NULL,
+                                      key, NULL) == 1 &&
+              EVP_DigestVerify(s->md_ctx, der, der_len, msg, msg_len) == 1;
+    EVP_MD_CTX_reset(s->md_ctx);
+    EVP_PKEY_free(key);
+    OPENSSL_free(der);
+    return EdhocNoError;
+}
+
+#endif
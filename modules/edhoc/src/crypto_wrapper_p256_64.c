@@ -0,0 +1,710 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+/*
+P-256 ECDH and ECDSA for 64 bit hosts. Field elements and scalars are kept
+in Montgomery representation with four 64 bit limbs. Points use projective
+coordinates and the complete addition formulas of Renes, Costello and
+Batina, so that there are no exceptional cases and all operations on secret
+data run in constant time. Fixed base multiplications use a table of
+64 x 15 precomputed multiples of the generator which is built when it is
+first needed.
+
+Define EDHOC_WITH_P256_64 to use this file instead of the TinyCrypt based
+P-256 implementation in crypto_wrapper.c.
+*/
+
+#ifdef EDHOC_WITH_P256_64
+
+#ifndef __SIZEOF_INT128__
+#error "EDHOC_WITH_P256_64 requires a compiler with 128 bit integers"
+#endif
+
+#include <string.h>
+
+#include "../edhoc.h"
+#include "../inc/crypto_wrapper.h"
+#include "../inc/error.h"
+#include "../inc/suites.h"
+
+typedef unsigned __int128 uint128_t;
+
+/******************************************************************************/
+/*                    Montgomery arithmetic modulo p and n                    */
+/******************************************************************************/
+
+typedef uint64_t u256[4];
+
+struct mont_modulus {
+    u256 m;
+    uint64_t m0inv; /*-m^-1 mod 2^64*/
+    u256 rr;        /*2^512 mod m*/
+    u256 one;       /*2^256 mod m*/
+};
+
+static const struct mont_modulus mod_p = {
+    {0xffffffffffffffffULL, 0x00000000ffffffffULL,
+     0x0000000000000000ULL, 0xffffffff00000001ULL},
+    0x0000000000000001ULL,
+    {0x0000000000000003ULL, 0xfffffffbffffffffULL,
+     0xfffffffffffffffeULL, 0x00000004fffffffdULL},
+    {0x0000000000000001ULL, 0xffffffff00000000ULL,
+     0xffffffffffffffffULL, 0x00000000fffffffeULL},
+};
+
+static const struct mont_modulus mod_n = {
+    {0xf3b9cac2fc632551ULL, 0xbce6faada7179e84ULL,
+     0xffffffffffffffffULL, 0xffffffff00000000ULL},
+    0xccd1c8aaee00bc4fULL,
+    {0x83244c95be79eea2ULL, 0x4699799c49bd6fa6ULL,
+     0x2845b2392b6bec59ULL, 0x66e12d94f3d95620ULL},
+    {0x0c46353d039cdaafULL, 0x4319055258e8617bULL,
+     0x0000000000000000ULL, 0x00000000ffffffffULL},
+};
+
+/*exponents for inversion and square root*/
+static const u256 p_minus_2 = {0xfffffffffffffffdULL, 0x00000000ffffffffULL,
+                               0x0000000000000000ULL, 0xffffffff00000001ULL};
+static const u256 n_minus_2 = {0xf3b9cac2fc63254fULL, 0xbce6faada7179e84ULL,
+                               0xffffffffffffffffULL, 0xffffffff00000000ULL};
+static const u256 p_plus_1_div_4 = {
+    0x0000000000000000ULL, 0x0000000040000000ULL,
+    0x4000000000000000ULL, 0x3fffffffc0000000ULL};
+
+/*curve parameter b and generator in Montgomery representation*/
+static const u256 b_mont = {0xd89cdf6229c4bddfULL, 0xacf005cd78843090ULL,
+                            0xe5a220abf7212ed6ULL, 0xdc30061d04874834ULL};
+static const u256 gx_mont = {0x79e730d418a9143cULL, 0x75ba95fc5fedb601ULL,
+                             0x79fb732b77622510ULL, 0x18905f76a53755c6ULL};
+static const u256 gy_mont = {0xddf25357ce95560aULL, 0x8b4ab8e4ba19e45cULL,
+                             0xd2e88688dd21f325ULL, 0x8571ff1825885d85ULL};
+
+static inline void u256_copy(u256 r, const u256 a) {
+    memcpy(r, a, sizeof(u256));
+}
+
+/*constant time r = a if b == 1*/
+static inline void u256_cmov(u256 r, const u256 a, uint64_t b) {
+    uint64_t mask = 0 - b;
+    for (uint8_t i = 0; i < 4; i++) {
+        r[i] ^= (r[i] ^ a[i]) & mask;
+    }
+}
+
+static inline uint64_t u256_is_zero(const u256 a) {
+    uint64_t d = a[0] | a[1] | a[2] | a[3];
+    return ((d | (0 - d)) >> 63) ^ 1;
+}
+
+static inline uint64_t u256_equal(const u256 a, const u256 b) {
+    uint64_t d = (a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2]) | (a[3] ^ b[3]);
+    return ((d | (0 - d)) >> 63) ^ 1;
+}
+
+/*r = a - b, returns the borrow*/
+static inline uint64_t u256_sub(u256 r, const u256 a, const u256 b) {
+    uint128_t acc;
+    uint64_t borrow = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        acc = (uint128_t)a[i] - b[i] - borrow;
+        r[i] = (uint64_t)acc;
+        borrow = (uint64_t)(acc >> 64) & 1;
+    }
+    return borrow;
+}
+
+/*returns 1 if a < b, constant time*/
+static inline uint64_t u256_lt(const u256 a, const u256 b) {
+    u256 t;
+    return u256_sub(t, a, b);
+}
+
+static void u256_from_bytes(u256 r, const uint8_t *be) {
+    for (uint8_t i = 0; i < 4; i++) {
+        r[3 - i] = 0;
+        for (uint8_t j = 0; j < 8; j++) {
+            r[3 - i] = (r[3 - i] << 8) | be[8 * i + j];
+        }
+    }
+}
+
+static void u256_to_bytes(uint8_t *be, const u256 a) {
+    for (uint8_t i = 0; i < 4; i++) {
+        for (uint8_t j = 0; j < 8; j++) {
+            be[8 * i + j] = (uint8_t)(a[3 - i] >> (56 - 8 * j));
+        }
+    }
+}
+
+/*r = a*b/2^256 mod m, the inputs must be smaller than m*/
+static void mont_mul(u256 r, const u256 a, const u256 b,
+                     const struct mont_modulus *mod) {
+    uint64_t t[6] = {0};
+    uint128_t acc;
+    uint64_t c, u;
+
+    for (uint8_t i = 0; i < 4; i++) {
+        c = 0;
+        for (uint8_t j = 0; j < 4; j++) {
+            acc = (uint128_t)a[i] * b[j] + t[j] + c;
+            t[j] = (uint64_t)acc;
+            c = (uint64_t)(acc >> 64);
+        }
+        acc = (uint128_t)t[4] + c;
+        t[4] = (uint64_t)acc;
+        t[5] = (uint64_t)(acc >> 64);
+
+        u = t[0] * mod->m0inv;
+        acc = (uint128_t)u * mod->m[0] + t[0];
+        c = (uint64_t)(acc >> 64);
+        for (uint8_t j = 1; j < 4; j++) {
+            acc = (uint128_t)u * mod->m[j] + t[j] + c;
+            t[j - 1] = (uint64_t)acc;
+            c = (uint64_t)(acc >> 64);
+        }
+        acc = (uint128_t)t[4] + c;
+        t[3] = (uint64_t)acc;
+        t[4] = t[5] + (uint64_t)(acc >> 64);
+    }
+
+    /*t < 2m, subtract m if t >= m*/
+    u256 s;
+    uint64_t borrow = u256_sub(s, t, mod->m);
+    u256_copy(r, t);
+    u256_cmov(r, s, (t[4] | (borrow ^ 1)) & 1);
+}
+
+static inline void mont_sq(u256 r, const u256 a,
+                           const struct mont_modulus *mod) {
+    mont_mul(r, a, a, mod);
+}
+
+static void mod_add(u256 r, const u256 a, const u256 b,
+                    const struct mont_modulus *mod) {
+    uint128_t acc;
+    uint64_t carry = 0;
+    u256 t, s;
+    for (uint8_t i = 0; i < 4; i++) {
+        acc = (uint128_t)a[i] + b[i] + carry;
+        t[i] = (uint64_t)acc;
+        carry = (uint64_t)(acc >> 64);
+    }
+    uint64_t borrow = u256_sub(s, t, mod->m);
+    u256_copy(r, t);
+    u256_cmov(r, s, carry | (borrow ^ 1));
+}
+
+static void mod_sub(u256 r, const u256 a, const u256 b,
+                    const struct mont_modulus *mod) {
+    uint128_t acc;
+    uint64_t carry = 0;
+    u256 t;
+    uint64_t borrow = u256_sub(t, a, b);
+    uint64_t mask = 0 - borrow;
+    for (uint8_t i = 0; i < 4; i++) {
+        acc = (uint128_t)t[i] + (mod->m[i] & mask) + carry;
+        r[i] = (uint64_t)acc;
+        carry = (uint64_t)(acc >> 64);
+    }
+}
+
+static inline void mont_to(u256 r, const u256 a,
+                           const struct mont_modulus *mod) {
+    mont_mul(r, a, mod->rr, mod);
+}
+
+static inline void mont_from(u256 r, const u256 a,
+                             const struct mont_modulus *mod) {
+    static const u256 one = {1, 0, 0, 0};
+    mont_mul(r, a, one, mod);
+}
+
+/*r = a^e, the exponent is public*/
+static void mont_pow(u256 r, const u256 a, const u256 e,
+                     const struct mont_modulus *mod) {
+    u256 t;
+    u256_copy(t, mod->one);
+    for (int16_t i = 255; i >= 0; i--) {
+        mont_sq(t, t, mod);
+        if ((e[i >> 6] >> (i & 63)) & 1) {
+            mont_mul(t, t, a, mod);
+        }
+    }
+    u256_copy(r, t);
+}
+
+/*reduces a value smaller than 2^256 modulo n*/
+static void reduce_n(u256 r, const u256 a) {
+    u256 s;
+    uint64_t borrow = u256_sub(s, a, mod_n.m);
+    u256_copy(r, a);
+    u256_cmov(r, s, borrow ^ 1);
+}
+
+/******************************************************************************/
+/*                               P-256 group                                  */
+/******************************************************************************/
+
+/*projective point (X:Y:Z), coordinates in Montgomery representation*/
+struct p256_point {
+    u256 x, y, z;
+};
+
+/*affine point in Montgomery representation*/
+struct p256_affine {
+    u256 x, y;
+};
+
+static void point_set_infinity(struct p256_point *r) {
+    memset(r->x, 0, sizeof(u256));
+    u256_copy(r->y, mod_p.one);
+    memset(r->z, 0, sizeof(u256));
+}
+
+static inline void fp_mul(u256 r, const u256 a, const u256 b) {
+    mont_mul(r, a, b, &mod_p);
+}
+
+static inline void fp_sq(u256 r, const u256 a) {
+    mont_mul(r, a, a, &mod_p);
+}
+
+static inline void fp_add(u256 r, const u256 a, const u256 b) {
+    mod_add(r, a, b, &mod_p);
+}
+
+static inline void fp_sub(u256 r, const u256 a, const u256 b) {
+    mod_sub(r, a, b, &mod_p);
+}
+
+/*r = p + q, algorithm 4 of Renes-Costello-Batina (a = -3)*/
+static void point_add(struct p256_point *r, const struct p256_point *p,
+                      const struct p256_point *q) {
+    u256 t0, t1, t2, t3, t4, x3, y3, z3;
+
+    fp_mul(t0, p->x, q->x);
+    fp_mul(t1, p->y, q->y);
+    fp_mul(t2, p->z, q->z);
+    fp_add(t3, p->x, p->y);
+    fp_add(t4, q->x, q->y);
+    fp_mul(t3, t3, t4);
+    fp_add(t4, t0, t1);
+    fp_sub(t3, t3, t4);
+    fp_add(t4, p->y, p->z);
+    fp_add(x3, q->y, q->z);
+    fp_mul(t4, t4, x3);
+    fp_add(x3, t1, t2);
+    fp_sub(t4, t4, x3);
+    fp_add(x3, p->x, p->z);
+    fp_add(y3, q->x, q->z);
+    fp_mul(x3, x3, y3);
+    fp_add(y3, t0, t2);
+    fp_sub(y3, x3, y3);
+    fp_mul(z3, b_mont, t2);
+    fp_sub(x3, y3, z3);
+    fp_add(z3, x3, x3);
+    fp_add(x3, x3, z3);
+    fp_sub(z3, t1, x3);
+    fp_add(x3, t1, x3);
+    fp_mul(y3, b_mont, y3);
+    fp_add(t1, t2, t2);
+    fp_add(t2, t1, t2);
+    fp_sub(y3, y3, t2);
+    fp_sub(y3, y3, t0);
+    fp_add(t1, y3, y3);
+    fp_add(y3, t1, y3);
+    fp_add(t1, t0, t0);
+    fp_add(t0, t1, t0);
+    fp_sub(t0, t0, t2);
+    fp_mul(t1, t4, y3);
+    fp_mul(t2, t0, y3);
+    fp_mul(y3, x3, z3);
+    fp_add(y3, y3, t2);
+    fp_mul(x3, t3, x3);
+    fp_sub(x3, x3, t1);
+    fp_mul(z3, t4, z3);
+    fp_mul(t1, t3, t0);
+    fp_add(z3, z3, t1);
+
+    u256_copy(r->x, x3);
+    u256_copy(r->y, y3);
+    u256_copy(r->z, z3);
+}
+
+/*r = 2p, algorithm 6 of Renes-Costello-Batina (a = -3)*/
+static void point_double(struct p256_point *r, const struct p256_point *p) {
+    u256 t0, t1, t2, t3, x3, y3, z3;
+
+    fp_sq(t0, p->x);
+    fp_sq(t1, p->y);
+    fp_sq(t2, p->z);
+    fp_mul(t3, p->x, p->y);
+    fp_add(t3, t3, t3);
+    fp_mul(z3, p->x, p->z);
+    fp_add(z3, z3, z3);
+    fp_mul(y3, b_mont, t2);
+    fp_sub(y3, y3, z3);
+    fp_add(x3, y3, y3);
+    fp_add(y3, x3, y3);
+    fp_sub(x3, t1, y3);
+    fp_add(y3, t1, y3);
+    fp_mul(y3, x3, y3);
+    fp_mul(x3, x3, t3);
+    fp_add(t3, t2, t2);
+    fp_add(t2, t2, t3);
+    fp_mul(z3, b_mont, z3);
+    fp_sub(z3, z3, t2);
+    fp_sub(z3, z3, t0);
+    fp_add(t3, z3, z3);
+    fp_add(z3, z3, t3);
+    fp_add(t3, t0, t0);
+    fp_add(t0, t3, t0);
+    fp_sub(t0, t0, t2);
+    fp_mul(t0, t0, z3);
+    fp_add(y3, y3, t0);
+    fp_mul(t0, p->y, p->z);
+    fp_add(t0, t0, t0);
+    fp_mul(z3, t0, z3);
+    fp_sub(x3, x3, z3);
+    fp_mul(z3, t0, t1);
+    fp_add(z3, z3, z3);
+    fp_add(z3, z3, z3);
+
+    u256_copy(r->x, x3);
+    u256_copy(r->y, y3);
+    u256_copy(r->z, z3);
+}
+
+/*converts p to affine coordinates, returns 0 for the point at infinity*/
+static uint64_t point_to_affine(struct p256_affine *r,
+                                const struct p256_point *p) {
+    u256 zinv;
+    mont_pow(zinv, p->z, p_minus_2, &mod_p);
+    fp_mul(r->x, p->x, zinv);
+    fp_mul(r->y, p->y, zinv);
+    return u256_is_zero(p->z) ^ 1;
+}
+
+/*returns 1 if (x, y) is on the curve, y^2 = x^3 - 3x + b*/
+static uint64_t point_is_on_curve(const u256 x, const u256 y) {
+    u256 lhs, rhs, t;
+    fp_sq(lhs, y);
+    fp_sq(rhs, x);
+    fp_mul(rhs, rhs, x);
+    fp_add(t, x, x);
+    fp_add(t, t, x);
+    fp_sub(rhs, rhs, t);
+    fp_add(rhs, rhs, b_mont);
+    return u256_equal(lhs, rhs);
+}
+
+/**
+ * @brief   Decodes a public key given as x coordinate only (32 bytes),
+ *          compressed (33 bytes), x || y (64 bytes) or uncompressed
+ *          (65 bytes) point. When only x is given either of the two points
+ *          is returned, which is sufficient for ECDH.
+ * @retval  1 if pk is a valid point
+ */
+static uint64_t point_decode(struct p256_point *r, const uint8_t *pk,
+                             uint32_t pk_len) {
+    u256 x, y, t;
+    const uint8_t *x_bytes;
+    const uint8_t *y_bytes = NULL;
+    int8_t parity = -1;
+
+    switch (pk_len) {
+        case 32:
+            x_bytes = pk;
+            break;
+        case 33:
+            if (pk[0] != 0x02 && pk[0] != 0x03) return 0;
+            x_bytes = pk + 1;
+            parity = pk[0] & 1;
+            break;
+        case 64:
+            x_bytes = pk;
+            y_bytes = pk + 32;
+            break;
+        case 65:
+            if (pk[0] != 0x04) return 0;
+            x_bytes = pk + 1;
+            y_bytes = pk + 33;
+            break;
+        default:
+            return 0;
+    }
+
+    u256_from_bytes(x, x_bytes);
+    if (!u256_lt(x, mod_p.m)) return 0;
+    mont_to(x, x, &mod_p);
+
+    if (y_bytes) {
+        u256_from_bytes(y, y_bytes);
+        if (!u256_lt(y, mod_p.m)) return 0;
+        mont_to(y, y, &mod_p);
+    } else {
+        /*y = (x^3 - 3x + b)^((p+1)/4)*/
+        u256 rhs;
+        fp_sq(rhs, x);
+        fp_mul(rhs, rhs, x);
+        fp_add(t, x, x);
+        fp_add(t, t, x);
+        fp_sub(rhs, rhs, t);
+        fp_add(rhs, rhs, b_mont);
+        mont_pow(y, rhs, p_plus_1_div_4, &mod_p);
+        if (parity >= 0) {
+            mont_from(t, y, &mod_p);
+            if ((int8_t)(t[0] & 1) != parity) {
+                u256 zero = {0};
+                fp_sub(y, zero, y);
+            }
+        }
+    }
+
+    if (!point_is_on_curve(x, y)) return 0;
+
+    u256_copy(r->x, x);
+    u256_copy(r->y, y);
+    u256_copy(r->z, mod_p.one);
+    return 1;
+}
+
+/*r = k*p with 4 bit fixed windows, constant time*/
+static void point_mul(struct p256_point *r, const u256 k,
+                      const struct p256_point *p) {
+    struct p256_point table[16];
+    struct p256_point t;
+
+    point_set_infinity(&table[0]);
+    table[1] = *p;
+    for (uint8_t i = 2; i < 16; i++) {
+        if (i & 1) {
+            point_add(&table[i], &table[i - 1], p);
+        } else {
+            point_double(&table[i], &table[i / 2]);
+        }
+    }
+
+    point_set_infinity(r);
+    for (int8_t w = 63; w >= 0; w--) {
+        for (uint8_t i = 0; i < 4; i++) {
+            point_double(r, r);
+        }
+        uint64_t d = (k[w >> 4] >> (4 * (w & 15))) & 15;
+        point_set_infinity(&t);
+        for (uint8_t j = 1; j < 16; j++) {
+            uint64_t eq = ((d ^ j) - 1) >> 63;
+            u256_cmov(t.x, table[j].x, eq);
+            u256_cmov(t.y, table[j].y, eq);
+            u256_cmov(t.z, table[j].z, eq);
+        }
+        point_add(r, r, &t);
+    }
+}
+
+/*Table with the multiples j*16^i*G, j = 1..15, i = 0..63. Computed when
+first needed.*/
+static struct p256_affine base_table[64][15];
+static uint8_t base_table_ready;
+static uint8_t base_table_lock;
+
+static void base_table_init(void) {
+    if (__atomic_load_n(&base_table_ready, __ATOMIC_ACQUIRE)) return;
+
+    while (__atomic_test_and_set(&base_table_lock, __ATOMIC_ACQUIRE)) {
+    }
+    if (!base_table_ready) {
+        struct p256_point row_base, p;
+
+        u256_copy(row_base.x, gx_mont);
+        u256_copy(row_base.y, gy_mont);
+        u256_copy(row_base.z, mod_p.one);
+
+        for (uint8_t i = 0; i < 64; i++) {
+            p = row_base;
+            for (uint8_t j = 0; j < 15; j++) {
+                point_to_affine(&base_table[i][j], &p);
+                point_add(&p, &p, &row_base);
+            }
+            /*p = 16*row_base*/
+            row_base = p;
+        }
+        __atomic_store_n(&base_table_ready, 1, __ATOMIC_RELEASE);
+    }
+    __atomic_clear(&base_table_lock, __ATOMIC_RELEASE);
+}
+
+/*r = k*G, constant time*/
+static void point_mul_base(struct p256_point *r, const u256 k) {
+    struct p256_point t;
+
+    base_table_init();
+    point_set_infinity(r);
+    for (uint8_t w = 0; w < 64; w++) {
+        uint64_t d = (k[w >> 4] >> (4 * (w & 15))) & 15;
+        point_set_infinity(&t);
+        for (uint8_t j = 1; j < 16; j++) {
+            uint64_t eq = ((d ^ j) - 1) >> 63;
+            u256_cmov(t.x, base_table[w][j - 1].x, eq);
+            u256_cmov(t.y, base_table[w][j - 1].y, eq);
+            u256_cmov(t.z, mod_p.one, eq);
+        }
+        point_add(r, r, &t);
+    }
+}
+
+/*reads a scalar and checks that 0 < k < n*/
+static uint64_t scalar_decode(u256 k, const uint8_t *be) {
+    u256_from_bytes(k, be);
+    return (u256_is_zero(k) ^ 1) & u256_lt(k, mod_n.m);
+}
+
+/******************************************************************************/
+/*                                P-256 API                                   */
+/******************************************************************************/
+
+EdhocError p256_public_key(const uint8_t *sk, uint8_t *pk) {
+    u256 k;
+    struct p256_point r;
+    struct p256_affine a;
+
+    if (!scalar_decode(k, sk)) return InvalidPrivateKey;
+    point_mul_base(&r, k);
+    point_to_affine(&a, &r);
+    mont_from(a.x, a.x, &mod_p);
+    u256_to_bytes(pk, a.x);
+    memset(k, 0, sizeof(k));
+    return EdhocNoError;
+}
+
+EdhocError p256_shared_secret(
+    const uint8_t *sk,
+    const uint8_t *pk, uint32_t pk_len,
+    uint8_t *shared_secret) {
+    u256 k;
+    struct p256_point p, r;
+    struct p256_affine a;
+
+    if (!point_decode(&p, pk, pk_len)) return InvalidPublicKey;
+    if (!scalar_decode(k, sk)) return InvalidPrivateKey;
+
+    point_mul(&r, k, &p);
+    memset(k, 0, sizeof(k));
+    /*the group has prime order, so r is never the point at infinity*/
+    point_to_affine(&a, &r);
+    mont_from(a.x, a.x, &mod_p);
+    u256_to_bytes(shared_secret, a.x);
+    return EdhocNoError;
+}
+
+/*e = SHA-256(msg) mod n*/
+static EdhocError message_digest(u256 e, const uint8_t *msg,
+                                 uint16_t msg_len) {
+    uint8_t h[SHA_DEFAULT_SIZE];
+    EdhocError r = hash(SHA_256, msg, msg_len, h);
+    if (r != EdhocNoError) return r;
+    u256_from_bytes(e, h);
+    reduce_n(e, e);
+    return EdhocNoError;
+}
+
+EdhocError p256_sign(
+    const uint8_t *sk,
+    const uint8_t *msg, uint16_t msg_len,
+    uint8_t *sgn) {
+    EdhocError err;
+    u256 d, e, k, r = {0}, s = {0};
+    u256 dm, em, km, rm;
+    struct p256_point R;
+    struct p256_affine a;
+    uint8_t seed[3 * 32];
+
+    if (!scalar_decode(d, sk)) return InvalidPrivateKey;
+    err = message_digest(e, msg, msg_len);
+    if (err != EdhocNoError) return err;
+    mont_to(dm, d, &mod_n);
+    mont_to(em, e, &mod_n);
+
+    /*the nonce is derived from fresh randomness, the key and the message,
+    so that a weak random number generator does not leak the key*/
+    memcpy(seed + 32, sk, 32);
+    u256_to_bytes(seed + 64, e);
+    do {
+        err = random_bytes(seed, 32);
+        if (err != EdhocNoError) break;
+        err = hash(SHA_256, seed, sizeof(seed), seed);
+        if (err != EdhocNoError) break;
+        if (!scalar_decode(k, seed)) continue;
+
+        point_mul_base(&R, k);
+        point_to_affine(&a, &R);
+        mont_from(r, a.x, &mod_p);
+        reduce_n(r, r);
+
+        /*s = k^-1 * (e + r*d) mod n*/
+        mont_to(rm, r, &mod_n);
+        mont_to(km, k, &mod_n);
+        mont_pow(km, km, n_minus_2, &mod_n);
+        mont_mul(s, rm, dm, &mod_n);
+        mod_add(s, s, em, &mod_n);
+        mont_mul(s, s, km, &mod_n);
+        mont_from(s, s, &mod_n);
+    } while (u256_is_zero(r) || u256_is_zero(s));
+
+    memset(seed, 0, sizeof(seed));
+    memset(d, 0, sizeof(d));
+    memset(dm, 0, sizeof(dm));
+    memset(k, 0, sizeof(k));
+    memset(km, 0, sizeof(km));
+    if (err != EdhocNoError) return err;
+
+    u256_to_bytes(sgn, r);
+    u256_to_bytes(sgn + 32, s);
+    return EdhocNoError;
+}
+
+EdhocError p256_verify(
+    const uint8_t *pk, uint32_t pk_len,
+    const uint8_t *msg, uint16_t msg_len,
+    const uint8_t *sgn,
+    bool *result) {
+    EdhocError err;
+    u256 r, s, e, w, u1, u2, x;
+    struct p256_point q, p1, p2;
+    struct p256_affine a;
+
+    *result = false;
+    /*the y coordinate is needed to verify a signature*/
+    if (pk_len == 32 || !point_decode(&q, pk, pk_len)) return EdhocNoError;
+    if (!scalar_decode(r, sgn) || !scalar_decode(s, sgn + 32)) {
+        return EdhocNoError;
+    }
+    err = message_digest(e, msg, msg_len);
+    if (err != EdhocNoError) return err;
+
+    /*u1 = e/s, u2 = r/s*/
+    mont_to(w, s, &mod_n);
+    mont_pow(w, w, n_minus_2, &mod_n);
+    mont_mul(u1, e, w, &mod_n);
+    mont_mul(u2, r, w, &mod_n);
+
+    point_mul_base(&p1, u1);
+    point_mul(&p2, u2, &q);
+    point_add(&p1, &p1, &p2);
+    if (!point_to_affine(&a, &p1)) return EdhocNoError;
+
+    mont_from(x, a.x, &mod_p);
+    reduce_n(x, x);
+    *result = u256_equal(x, r);
+    return EdhocNoError;
+}
+
+#endif
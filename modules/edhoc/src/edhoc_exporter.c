@@ -9,12 +9,14 @@
    except according to those terms.
 */
 #include <stdint.h>
+#include <string.h>
 
 #include "../edhoc.h"
 #include "../inc/crypto_wrapper.h"
 #include "../inc/error.h"
 #include "../inc/hkdf_info.h"
 #include "../inc/okm.h"
+#include "../inc/print_util.h"
 #include "../inc/suites.h"
 
 EdhocError edhoc_exporter(
@@ -29,4 +31,73 @@ EdhocError edhoc_exporter(
     uint16_t out_len) {
 
     return okm_calc(app_aead_alg, app_hash_alg, label, prk_4x3m, prk_4x3m_len, th4, th4_len, out, out_len);
-}
\ No newline at end of file
+}
+
+EdhocError edhoc_exporter_oscore(
+    enum hash_alg app_hash_alg,
+    enum aead_alg app_aead_alg,
+    const uint8_t* prk_4x3m, uint16_t prk_4x3m_len,
+    const uint8_t* th4, uint16_t th4_len,
+    uint8_t* master_secret, uint16_t master_secret_len,
+    uint8_t* master_salt, uint16_t master_salt_len) {
+    EdhocError r;
+    struct hkdf_prk k;
+    volatile uint8_t* p = (volatile uint8_t*)&k;
+    uint8_t info[INFO_DEFAULT_SIZE];
+    uint8_t prefix_len = sizeof(info);
+    uint8_t label_len;
+
+    /*both infos are [app_aead_alg, th4, label, length], the first two 
+    elements are encoded only once*/
+    r = hkdf_info_prefix_encode(app_aead_alg, th4, th4_len, info, &prefix_len);
+    if (r != EdhocNoError) return r;
+
+    r = hkdf_prk_init(app_hash_alg, prk_4x3m, prk_4x3m_len, &k);
+    if (r != EdhocNoError) return r;
+
+    label_len = sizeof(info) - prefix_len;
+    r = hkdf_info_label_encode(
+        "OSCORE Master Secret", master_secret_len,
+        info + prefix_len, &label_len);
+    if (r != EdhocNoError) goto out;
+    PRINT_ARRAY("info", info, prefix_len + label_len);
+    r = hkdf_expand_prk(
+        &k, info, prefix_len + label_len, master_secret, master_secret_len);
+    if (r != EdhocNoError) goto out;
+
+    label_len = sizeof(info) - prefix_len;
+    r = hkdf_info_label_encode(
+        "OSCORE Master Salt", master_salt_len,
+        info + prefix_len, &label_len);
+    if (r != EdhocNoError) goto out;
+    PRINT_ARRAY("info", info, prefix_len + label_len);
+    r = hkdf_expand_prk(
+        &k, info, prefix_len + label_len, master_salt, master_salt_len);
+
+out:
+    for (uint16_t i = 0; i < sizeof(k); i++) p[i] = 0;
+    return r;
+}
+
+EdhocError edhoc_key_update(
+    enum hash_alg app_hash_alg,
+    const uint8_t* nonce, uint32_t nonce_len,
+    uint8_t* prk_4x3m, uint16_t prk_4x3m_len) {
+    EdhocError r;
+    uint8_t new_prk_4x3m[PRK_DEFAULT_SIZE];
+    volatile uint8_t* p = new_prk_4x3m;
+
+    /*all currently proposed suites use SHA-256, i.e., 32 byte PRKs*/
+    if (prk_4x3m_len != sizeof(new_prk_4x3m)) return DestBufferToSmall;
+
+    r = hkdf_extract(
+        app_hash_alg, nonce, nonce_len,
+        prk_4x3m, (uint8_t)prk_4x3m_len,
+        new_prk_4x3m);
+    if (r != EdhocNoError) return r;
+
+    memcpy(prk_4x3m, new_prk_4x3m, prk_4x3m_len);
+    for (uint16_t i = 0; i < sizeof(new_prk_4x3m); i++) p[i] = 0;
+    PRINT_ARRAY("updated PRK_4x3m", prk_4x3m, prk_4x3m_len);
+    return EdhocNoError;
+}
@@ -0,0 +1,95 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#include <string.h>
+
+#include "../edhoc.h"
+#include "../inc/ephemeral_key_pool.h"
+#include "../inc/error.h"
+#include "../inc/suites.h"
+
+#if (EPHEMERAL_KEY_POOL_SIZE & (EPHEMERAL_KEY_POOL_SIZE - 1)) != 0
+#error "EPHEMERAL_KEY_POOL_SIZE must be a power of two"
+#endif
+
+/*head and tail are shared between the producer and the consumer. The
+acquire/release pairs make sure that a slot is completely written before it
+becomes visible to the other side.*/
+static inline uint32_t index_load(uint32_t *i) {
+    return __atomic_load_n(i, __ATOMIC_ACQUIRE);
+}
+
+static inline void index_store(uint32_t *i, uint32_t v) {
+    __atomic_store_n(i, v, __ATOMIC_RELEASE);
+}
+
+EdhocError ephemeral_key_pool_init(
+    struct ephemeral_key_pool *pool,
+    enum ecdh_curve curve) {
+    memset(pool, 0, sizeof(*pool));
+    pool->curve = curve;
+    return EdhocNoError;
+}
+
+EdhocError ephemeral_key_pool_refill(
+    struct ephemeral_key_pool *pool,
+    uint32_t max_keys) {
+    EdhocError r;
+    uint32_t head = pool->head;
+
+    while (max_keys--) {
+        if (head - index_load(&pool->tail) == EPHEMERAL_KEY_POOL_SIZE) {
+            /*the pool is full*/
+            break;
+        }
+
+        struct ephemeral_key_pair *slot =
+            &pool->slots[head & (EPHEMERAL_KEY_POOL_SIZE - 1)];
+        r = ephemeral_dh_key_pair_gen(pool->curve, slot->sk, slot->pk);
+        if (r != EdhocNoError) return r;
+
+        index_store(&pool->head, ++head);
+    }
+    return EdhocNoError;
+}
+
+uint32_t ephemeral_key_pool_available(struct ephemeral_key_pool *pool) {
+    return index_load(&pool->head) - index_load(&pool->tail);
+}
+
+EdhocError ephemeral_key_pool_take(
+    struct ephemeral_key_pool *pool,
+    enum ecdh_curve curve,
+    uint8_t *sk, uint32_t sk_len,
+    uint8_t *pk, uint32_t pk_len) {
+    if (sk_len < EPHEMERAL_KEY_DEFAULT_SIZE ||
+        pk_len < EPHEMERAL_KEY_DEFAULT_SIZE) {
+        return DestBufferToSmall;
+    }
+
+    uint32_t tail = pool->tail;
+    if (curve != pool->curve || index_load(&pool->head) == tail) {
+        /*the peer selected a suite with another curve or the producer did
+        not keep up, do not fail or stall the handshake*/
+        pool->misses++;
+        return ephemeral_dh_key_pair_gen(curve, sk, pk);
+    }
+
+    struct ephemeral_key_pair *slot =
+        &pool->slots[tail & (EPHEMERAL_KEY_POOL_SIZE - 1)];
+    memcpy(sk, slot->sk, EPHEMERAL_KEY_DEFAULT_SIZE);
+    memcpy(pk, slot->pk, EPHEMERAL_KEY_DEFAULT_SIZE);
+
+    /*erase the slot before handing it back to the producer so that the key
+    pair can not be taken a second time*/
+    memset(slot, 0, sizeof(*slot));
+    index_store(&pool->tail, tail + 1);
+    return EdhocNoError;
+}
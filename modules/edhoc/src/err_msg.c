@@ -54,16 +54,16 @@ static inline EdhocError err_msg_crate(
     return EdhocNoError;
 }
 
-EdhocError tx_err_msg(
+EdhocError err_msg_encode(
     enum role role, uint8_t corr,
     uint8_t* c_x, uint8_t c_x_len,
     uint8_t* err_msg_str, uint8_t err_msg_str_len,
-    uint8_t* suites, uint8_t suites_len) {
+    uint8_t* suites, uint8_t suites_len,
+    uint8_t* out, uint32_t* out_len) {
     EdhocError r;
-    uint8_t err_msg_buf[ERR_MSG_DEFAULT_SIZE];
     struct byte_array err_msg = {
-        .len = sizeof(err_msg_buf),
-        .ptr = err_msg_buf,
+        .len = *out_len,
+        .ptr = out,
     };
 
     struct error_msg err_struct = {
@@ -84,5 +84,23 @@ EdhocError tx_err_msg(
 
     r = err_msg_crate(&err_struct, &err_msg);
     if (r != EdhocNoError) return r;
-    return tx(err_msg.ptr, err_msg.len);
+    *out_len = err_msg.len;
+    return EdhocNoError;
+}
+
+EdhocError tx_err_msg(
+    enum role role, uint8_t corr,
+    uint8_t* c_x, uint8_t c_x_len,
+    uint8_t* err_msg_str, uint8_t err_msg_str_len,
+    uint8_t* suites, uint8_t suites_len) {
+    EdhocError r;
+    uint8_t err_msg_buf[ERR_MSG_DEFAULT_SIZE];
+    uint32_t err_msg_len = sizeof(err_msg_buf);
+
+    r = err_msg_encode(role, corr, c_x, c_x_len,
+                       err_msg_str, err_msg_str_len,
+                       suites, suites_len,
+                       err_msg_buf, &err_msg_len);
+    if (r != EdhocNoError) return r;
+    return tx(err_msg_buf, err_msg_len);
 }
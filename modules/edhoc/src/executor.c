@@ -0,0 +1,485 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifdef EDHOC_WITH_EXECUTOR
+
+#include "../inc/executor.h"
+
+#include <string.h>
+
+#include "../edhoc.h"
+#include "../inc/crypto_wrapper.h"
+#include "../inc/ephemeral_key_pool.h"
+#include "../inc/error.h"
+#include "../inc/workspace.h"
+
+#if (EDHOC_EXECUTOR_QUEUE_SIZE & (EDHOC_EXECUTOR_QUEUE_SIZE - 1)) != 0
+#error "EDHOC_EXECUTOR_QUEUE_SIZE must be a power of two"
+#endif
+
+/*key pairs an idle worker generates before it checks for jobs again*/
+#define IDLE_REFILL_KEYS 1
+
+/**
+ * @brief   Appends a job to a queue
+ * @retval  false if the queue is full
+ */
+static bool queue_push(struct edhoc_job_queue *d, struct edhoc_job *job) {
+    bool ok = false;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->tail - d->head < EDHOC_EXECUTOR_QUEUE_SIZE) {
+        d->jobs[d->tail & (EDHOC_EXECUTOR_QUEUE_SIZE - 1)] = job;
+        d->tail++;
+        ok = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+/**
+ * @brief   Takes the oldest job of a queue. The owner and thieves take from
+ *          the same end, so that handshakes are served in order.
+ * @retval  the job or NULL if the queue is empty
+ */
+static struct edhoc_job *queue_take(struct edhoc_job_queue *d) {
+    struct edhoc_job *job = NULL;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->head != d->tail) {
+        job = d->jobs[d->head & (EDHOC_EXECUTOR_QUEUE_SIZE - 1)];
+        d->head++;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return job;
+}
+
+/**
+ * @brief   Appends a finished job to the completion queue. Lock-free, any
+ *          number of workers push concurrently (intrusive MPSC queue after
+ *          D. Vyukov).
+ */
+static void cq_push(struct edhoc_executor *ex, struct edhoc_job *job) {
+    struct edhoc_job *prev;
+
+    __atomic_store_n(&job->next, NULL, __ATOMIC_RELAXED);
+    prev = __atomic_exchange_n(&ex->cq_head, job, __ATOMIC_ACQ_REL);
+    /*between the exchange and this store the queue is split, the consumer
+    sees it as empty up to prev*/
+    __atomic_store_n(&prev->next, job, __ATOMIC_RELEASE);
+}
+
+struct edhoc_job *edhoc_executor_poll(struct edhoc_executor *ex) {
+    struct edhoc_job *tail = ex->cq_tail;
+    struct edhoc_job *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+    if (tail == &ex->cq_stub) {
+        if (next == NULL) return NULL;
+        ex->cq_tail = next;
+        tail = next;
+        next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+    }
+    if (next != NULL) {
+        ex->cq_tail = next;
+        return tail;
+    }
+    if (tail != __atomic_load_n(&ex->cq_head, __ATOMIC_ACQUIRE)) {
+        /*a worker is in the middle of cq_push()*/
+        return NULL;
+    }
+    /*tail is the last job, the stub takes its place so that tail can be
+    returned*/
+    cq_push(ex, &ex->cq_stub);
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next != NULL) {
+        ex->cq_tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+/**
+ * @brief   Returns the next job for a worker, first from its own queue then
+ *          from the queues of the others
+ */
+static struct edhoc_job *job_next(struct edhoc_worker *w) {
+    struct edhoc_executor *ex = w->ex;
+    uint32_t self = (uint32_t)(w - ex->workers);
+    struct edhoc_job *job;
+
+    job = queue_take(&w->queue);
+    for (uint32_t i = 1; job == NULL && i < ex->num_workers; i++) {
+        job = queue_take(&ex->workers[(self + i) % ex->num_workers].queue);
+        if (job != NULL) w->stolen++;
+    }
+    if (job != NULL) __atomic_sub_fetch(&ex->pending, 1, __ATOMIC_ACQ_REL);
+    return job;
+}
+
+/**
+ * @brief   Runs a job with the key pool of a worker
+ * @param   w the worker
+ * @param   job the job
+ * @param   ws the workspace, NULL to keep the buffers on the stack
+ */
+/*rotates the state keys once EDHOC_EXECUTOR_ROTATE_FILL percent of the
+slots of the current epoch are used*/
+static void keys_rotate_check(struct edhoc_executor *ex) {
+    uint32_t fill =
+        (uint32_t)((uint64_t)ex->keys->used_num * EDHOC_EXECUTOR_ROTATE_FILL /
+                   100);
+
+    if (fill == 0) fill = 1;
+    /*a failed rotation is retried after the next handshake*/
+    edhoc_state_keys_rotate_used(ex->keys, fill);
+}
+
+static void job_run(
+    struct edhoc_worker *w, struct edhoc_job *job, struct edhoc_workspace *ws) {
+    struct edhoc_executor *ex = w->ex;
+    struct edhoc_responder_context c = ex->c;
+
+    c.workspace = ws;
+    c.key_pool = &w->pool;
+    job->out_len = sizeof(job->out);
+    job->ad_len = sizeof(job->ad);
+    if (job->type == EDHOC_JOB_MSG2) {
+        job->state_len = sizeof(job->state);
+        job->r = edhoc_responder_stateless_msg2(
+            &c, ex->keys,
+            job->in, job->in_len,
+            job->ad, &job->ad_len,
+            job->out, &job->out_len,
+            job->state, &job->state_len);
+    } else {
+        job->r = edhoc_responder_stateless_msg3(
+            &c, ex->keys,
+            ex->cred_i_array, ex->num_cred_i,
+            job->state, job->state_len,
+            job->in, job->in_len,
+            job->out, &job->out_len,
+            job->ad, &job->ad_len,
+            job->prk_4x3m, sizeof(job->prk_4x3m),
+            job->th4, sizeof(job->th4));
+        if (job->r == EdhocNoError) keys_rotate_check(ex);
+    }
+    w->done++;
+}
+
+static void job_finish(struct edhoc_executor *ex, struct edhoc_job *job) {
+    cq_push(ex, job);
+    if (ex->notify != NULL) ex->notify(ex->notify_arg);
+}
+
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+/*
+ * With a crypto provider every job runs as a crypto task. While the provider
+ * computes, the task is suspended and the worker starts other jobs, up to
+ * EDHOC_EXECUTOR_TASKS. A suspended task keeps its buffers on its own stack,
+ * so that it does not share the workspace of the worker with other tasks.
+ */
+
+static EdhocError task_main(void *arg) {
+    struct edhoc_executor_task *t = (struct edhoc_executor_task *)arg;
+
+    job_run(t->w, t->job, NULL);
+    return EdhocNoError;
+}
+
+/*called by the provider*/
+static void task_ready(struct crypto_task *ct, void *arg) {
+    struct edhoc_executor_task *t = (struct edhoc_executor_task *)arg;
+    struct edhoc_executor *ex = t->w->ex;
+
+    pthread_mutex_lock(&ex->idle_lock);
+    t->next_ready = t->w->ready;
+    t->w->ready = t;
+    /*the worker of the task may wait with the others*/
+    pthread_cond_broadcast(&ex->idle_cond);
+    pthread_mutex_unlock(&ex->idle_lock);
+}
+
+static struct edhoc_executor_task *ready_take(struct edhoc_worker *w) {
+    struct edhoc_executor_task *t;
+
+    pthread_mutex_lock(&w->ex->idle_lock);
+    t = w->ready;
+    if (t != NULL) w->ready = t->next_ready;
+    pthread_mutex_unlock(&w->ex->idle_lock);
+    return t;
+}
+
+static void task_result(
+    struct edhoc_worker *w, struct edhoc_executor_task *t, EdhocError r) {
+    struct edhoc_job *job = t->job;
+
+    if (r == CryptoPending) {
+        w->suspended++;
+        return;
+    }
+    t->job = NULL;
+    w->busy--;
+    job_finish(w->ex, job);
+}
+
+static void task_start(struct edhoc_worker *w, struct edhoc_job *job) {
+    struct edhoc_executor_task *t = w->tasks;
+
+    while (t->job != NULL) t++;
+    t->job = job;
+    w->busy++;
+    task_result(w, t, crypto_task_start(&t->t, task_main, t));
+}
+
+/*the provider of the tasks of a worker, called on the thread of the worker*/
+static EdhocError worker_submit(struct crypto_provider *p,
+                                struct crypto_op *op) {
+    struct edhoc_worker *w = (struct edhoc_worker *)p->ctx;
+    struct crypto_provider *provider = w->ex->provider;
+
+    if (op->type == CRYPTO_OP_VERIFY && op->u.verify.curve == Ed25519_SIGN) {
+        /*a task waits for one operation at a time*/
+        w->verify_ops[w->verify_cnt++] = op;
+        return EdhocNoError;
+    }
+    return provider->submit(provider, op);
+}
+
+/**
+ * @brief   Verifies the queued signatures of the tasks of a worker with
+ *          verify_batch() and completes their operations
+ * @retval  false if no signature was queued
+ */
+static bool verify_flush(struct edhoc_worker *w) {
+    struct verify_batch_item items[EDHOC_EXECUTOR_TASKS];
+    uint32_t n = w->verify_cnt;
+    bool all_valid;
+    EdhocError r;
+
+    if (n == 0) return false;
+    for (uint32_t i = 0; i < n; i++) {
+        struct crypto_op *op = w->verify_ops[i];
+        items[i].pk = op->u.verify.pk;
+        items[i].pk_len = op->u.verify.pk_len;
+        items[i].msg = op->u.verify.msg;
+        items[i].msg_len = op->u.verify.msg_len;
+        items[i].sgn = op->u.verify.sgn;
+        items[i].sgn_len = op->u.verify.sgn_len;
+        items[i].result = false;
+    }
+    r = verify_batch(Ed25519_SIGN, items, (uint16_t)n, &all_valid);
+    w->verify_cnt = 0;
+    w->batched += n;
+    w->batches++;
+    for (uint32_t i = 0; i < n; i++) {
+        *w->verify_ops[i]->u.verify.result = items[i].result;
+        /*the task is resumed through task_ready()*/
+        crypto_op_complete(w->verify_ops[i], r);
+    }
+    return true;
+}
+
+static inline bool worker_full(struct edhoc_worker *w) {
+    return w->ex->provider != NULL && w->busy == EDHOC_EXECUTOR_TASKS;
+}
+
+static inline bool worker_ready(struct edhoc_worker *w) {
+    return w->ready != NULL;
+}
+
+static inline uint32_t worker_busy(struct edhoc_worker *w) {
+    return w->busy;
+}
+#else
+static inline bool worker_full(struct edhoc_worker *w) {
+    return false;
+}
+
+static inline bool worker_ready(struct edhoc_worker *w) {
+    return false;
+}
+
+static inline uint32_t worker_busy(struct edhoc_worker *w) {
+    return 0;
+}
+#endif
+
+static void *worker_main(void *arg) {
+    struct edhoc_worker *w = (struct edhoc_worker *)arg;
+    struct edhoc_executor *ex = w->ex;
+    struct edhoc_job *job;
+
+    while (1) {
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+        struct edhoc_executor_task *t = ready_take(w);
+        if (t != NULL) {
+            task_result(w, t, crypto_task_resume(&t->t));
+            continue;
+        }
+#endif
+        job = worker_full(w) ? NULL : job_next(w);
+        if (job != NULL) {
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+            if (ex->provider != NULL) {
+                task_start(w, job);
+                continue;
+            }
+#endif
+            job_run(w, job, &w->ws);
+            job_finish(ex, job);
+            continue;
+        }
+
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+        /*no other job can be started, the queued signatures are verified*/
+        if (verify_flush(w)) continue;
+#endif
+
+        /*idle, generate ephemeral keys for the next handshakes*/
+        if (!__atomic_load_n(&ex->stop, __ATOMIC_ACQUIRE) &&
+            ephemeral_key_pool_available(&w->pool) < EPHEMERAL_KEY_POOL_SIZE &&
+            ephemeral_key_pool_refill(&w->pool, IDLE_REFILL_KEYS) == EdhocNoError) {
+            continue;
+        }
+
+        /*wait for a job this worker can take, a task to resume or the stop
+        of the executor once its own tasks finished*/
+        pthread_mutex_lock(&ex->idle_lock);
+        while (!worker_ready(w) &&
+               (worker_full(w) ||
+                __atomic_load_n(&ex->pending, __ATOMIC_ACQUIRE) == 0) &&
+               !(ex->stop && worker_busy(w) == 0)) {
+            pthread_cond_wait(&ex->idle_cond, &ex->idle_lock);
+        }
+        bool done = ex->stop && worker_busy(w) == 0 &&
+                    __atomic_load_n(&ex->pending, __ATOMIC_ACQUIRE) == 0;
+        pthread_mutex_unlock(&ex->idle_lock);
+        if (done) break;
+    }
+    return NULL;
+}
+
+/**
+ * @brief   Stops the workers and waits for the first started of them
+ */
+static void workers_stop(struct edhoc_executor *ex, uint32_t started) {
+    pthread_mutex_lock(&ex->idle_lock);
+    __atomic_store_n(&ex->stop, true, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&ex->idle_cond);
+    pthread_mutex_unlock(&ex->idle_lock);
+
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(ex->workers[i].thread, NULL);
+    }
+    for (uint32_t i = 0; i < ex->num_workers; i++) {
+        pthread_mutex_destroy(&ex->workers[i].queue.lock);
+        workspace_release(&ex->workers[i].ws);
+    }
+    pthread_mutex_destroy(&ex->idle_lock);
+    pthread_cond_destroy(&ex->idle_cond);
+}
+
+EdhocError edhoc_executor_start(
+    struct edhoc_executor *ex,
+    struct edhoc_worker *workers, uint32_t num_workers,
+    const struct edhoc_responder_context *c,
+    struct other_party_cred *cred_i_array, uint16_t num_cred_i,
+    struct edhoc_state_keys *keys,
+    enum ecdh_curve curve,
+    struct crypto_provider *provider,
+    void (*notify)(void *arg), void *notify_arg) {
+    uint32_t started = 0;
+    EdhocError r;
+
+    if (num_workers == 0) return InvalidArgument;
+#ifndef EDHOC_WITH_ASYNC_CRYPTO
+    if (provider != NULL) return InvalidArgument;
+#endif
+    memset(ex, 0, sizeof(*ex));
+    ex->workers = workers;
+    ex->c = *c;
+    ex->cred_i_array = cred_i_array;
+    ex->num_cred_i = num_cred_i;
+    ex->keys = keys;
+    ex->provider = provider;
+    ex->notify = notify;
+    ex->notify_arg = notify_arg;
+    ex->cq_head = &ex->cq_stub;
+    ex->cq_tail = &ex->cq_stub;
+    pthread_mutex_init(&ex->idle_lock, NULL);
+    pthread_cond_init(&ex->idle_cond, NULL);
+
+    /*num_workers counts the initialized workers, workers_stop() releases
+    them if the start fails. The threads run after all are initialized.*/
+    for (uint32_t i = 0; i < num_workers; i++) {
+        struct edhoc_worker *w = &workers[i];
+        memset(w, 0, sizeof(*w));
+        w->ex = ex;
+        pthread_mutex_init(&w->queue.lock, NULL);
+        workspace_init(&w->ws, (uint8_t *)w->ws_buf, sizeof(w->ws_buf));
+        ex->num_workers = i + 1;
+        r = ephemeral_key_pool_init(&w->pool, curve);
+        if (r != EdhocNoError) goto err;
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+        w->verifier.submit = worker_submit;
+        w->verifier.ctx = w;
+        for (uint32_t j = 0; provider != NULL && j < EDHOC_EXECUTOR_TASKS; j++) {
+            struct edhoc_executor_task *t = &w->tasks[j];
+            t->w = w;
+            r = crypto_task_init(&t->t, t->stack, sizeof(t->stack),
+                                 &w->verifier, task_ready, t);
+            if (r != EdhocNoError) goto err;
+        }
+#endif
+    }
+    for (started = 0; started < num_workers; started++) {
+        if (pthread_create(&workers[started].thread, NULL, worker_main,
+                           &workers[started])) {
+            r = ThreadCreationFailed;
+            goto err;
+        }
+    }
+    return EdhocNoError;
+err:
+    workers_stop(ex, started);
+    return r;
+}
+
+EdhocError edhoc_executor_submit(struct edhoc_executor *ex, struct edhoc_job *job) {
+    uint32_t first = __atomic_fetch_add(&ex->next, 1, __ATOMIC_RELAXED);
+
+    /*counted before the push, a worker may take the job and decrement
+    pending before queue_push() returns*/
+    __atomic_add_fetch(&ex->pending, 1, __ATOMIC_ACQ_REL);
+    for (uint32_t i = 0; i < ex->num_workers; i++) {
+        struct edhoc_worker *w = &ex->workers[(first + i) % ex->num_workers];
+        if (queue_push(&w->queue, job)) {
+            /*taking the lock orders the signal after the check of a worker
+            which is about to wait*/
+            pthread_mutex_lock(&ex->idle_lock);
+            if (ex->provider != NULL) {
+                /*a worker with all tasks suspended can not take the job*/
+                pthread_cond_broadcast(&ex->idle_cond);
+            } else {
+                pthread_cond_signal(&ex->idle_cond);
+            }
+            pthread_mutex_unlock(&ex->idle_lock);
+            return EdhocNoError;
+        }
+    }
+    __atomic_sub_fetch(&ex->pending, 1, __ATOMIC_ACQ_REL);
+    return TooManyHandshakes;
+}
+
+void edhoc_executor_stop(struct edhoc_executor *ex) {
+    workers_stop(ex, ex->num_workers);
+}
+
+#endif
@@ -13,22 +13,21 @@
 #include <cbor.h>
 #include <string.h>
 
-#include "../inc/byte_array.h"
+#include "../../common/inc/byte_array.h"
 #include "../inc/error.h"
 #include "../inc/suites.h"
 
-EdhocError create_hkdf_info(
+EdhocError hkdf_info_prefix_encode(
     enum aead_alg aead_alg,
     const uint8_t *th, uint8_t th_len,
-    const char *label,
-    uint64_t okm_len,
     uint8_t *out, uint8_t *out_len) {
     CborEncoder enc;
     cbor_encoder_init(&enc, out, *out_len, 0);
     CborEncoder array_enc;
     CborError r;
 
-    cbor_encoder_create_array(&enc, &array_enc, 4);
+    r = cbor_encoder_create_array(&enc, &array_enc, 4);
+    if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
 
     r = cbor_encode_int(&array_enc, aead_alg);
     if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
@@ -36,16 +35,48 @@ EdhocError create_hkdf_info(
     r = cbor_encode_byte_string(&array_enc, th, th_len);
     if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
 
-    r = cbor_encode_text_stringz(&array_enc, label);
-    if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
+    /*the array is completed by hkdf_info_label_encode()*/
+    *out_len = cbor_encoder_get_buffer_size(&array_enc, out);
+
+    return EdhocNoError;
+}
+
+EdhocError hkdf_info_label_encode(
+    const char *label,
+    uint64_t okm_len,
+    uint8_t *out, uint8_t *out_len) {
+    CborEncoder enc;
+    cbor_encoder_init(&enc, out, *out_len, 0);
+    CborError r;
 
-    r = cbor_encode_uint(&array_enc, okm_len);
+    r = cbor_encode_text_stringz(&enc, label);
     if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
 
-    cbor_encoder_close_container(&enc, &array_enc);
+    r = cbor_encode_uint(&enc, okm_len);
+    if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
 
-    /* Get the CBOR length */
     *out_len = cbor_encoder_get_buffer_size(&enc, out);
 
     return EdhocNoError;
 }
+
+EdhocError hkdf_info_encode(
+    enum aead_alg aead_alg,
+    const uint8_t *th, uint8_t th_len,
+    const char *label,
+    uint64_t okm_len,
+    uint8_t *out, uint8_t *out_len) {
+    EdhocError r;
+    uint8_t prefix_len = *out_len;
+    uint8_t label_len;
+
+    r = hkdf_info_prefix_encode(aead_alg, th, th_len, out, &prefix_len);
+    if (r != EdhocNoError) return r;
+
+    label_len = *out_len - prefix_len;
+    r = hkdf_info_label_encode(label, okm_len, out + prefix_len, &label_len);
+    if (r != EdhocNoError) return r;
+
+    *out_len = prefix_len + label_len;
+    return EdhocNoError;
+}
@@ -13,7 +13,7 @@
 
 #include "../edhoc.h"
 #include "../inc/a_Xae_encode.h"
-#include "../inc/cbor_decoder.h"
+#include "../inc/cbor_view.h"
 #include "../inc/crypto_wrapper.h"
 #include "../inc/err_msg.h"
 #include "../inc/error.h"
@@ -28,7 +28,9 @@
 #include "../inc/signature_or_mac_msg.h"
 #include "../inc/suites.h"
 #include "../inc/th.h"
+#include "../inc/trace.h"
 #include "../inc/txrx_wrapper.h"
+#include "../inc/workspace.h"
 
 /**
  * @brief   Encodes a connection identifier C_x of length one byte to 
@@ -46,94 +48,64 @@ static inline EdhocError c_x_bstr_identifier_encode(uint8_t c_x, uint8_t* out) {
 }
 
 /**
- * @brief   Parses message 2
+ * @brief   Parses message 2 in a single pass. The fields of m point into msg2.
  * @param   c initiator context
  * @param   msg2 pointer to a buffer containign message 2 
  * @param   msg2_len the length of the raw message
- * @param   msg2_struct pointer to a structure for the parsed message
- * @param   err_msg pointer to an error message structure
+ * @param   m the parsed message
  */
 static inline EdhocError msg2_parse(
     const struct edhoc_initiator_context* c,
     uint8_t* msg2, uint32_t msg2_len,
-    uint8_t* c_i, uint64_t* c_i_len,
-    uint8_t* g_y, uint64_t* g_y_len,
-    uint8_t* c_r, uint64_t* c_r_len,
-    uint8_t* ciphertext2, uint64_t* ciphertext2_len) {
-    uint8_t* temp_ptr = msg2;
-    uint8_t* next_temp_ptr;
-    uint32_t temp_len = msg2_len;
+    struct msg_2* m) {
+    struct byte_array rest = {.ptr = msg2, .len = msg2_len};
+    struct cbor_item item;
     EdhocError r;
-    CborType cbor_type;
 
     if (!(c->corr == 1 || c->corr == 3)) {
         /*C_I (the connection identifier of the initiator) is present*/
-        r = cbor_decoder(
-            &next_temp_ptr, temp_ptr, temp_len, c_i, c_i_len, &cbor_type);
+        r = cbor_bstr_identifier_next(&rest, &m->c_i_single, &m->c_i);
         if (r != EdhocNoError) return r;
-        temp_len -= (next_temp_ptr - temp_ptr);
-        temp_ptr = next_temp_ptr;
-        PRINT_ARRAY("msg2 C_I", c_i, *c_i_len);
+        PRINT_ARRAY("msg2 C_I", m->c_i.ptr, m->c_i.len);
     } else {
-        *c_i_len = 0;
+        m->c_i = NULL_ARRAY;
     }
 
     /*get the ephemeral public key of the responder (G_Y) or ERR_MSG*/
-    r = cbor_decoder(
-        &next_temp_ptr, temp_ptr, temp_len, g_y, g_y_len, &cbor_type);
+    r = cbor_item_next(&rest, &item);
     if (r != EdhocNoError) return r;
-    temp_len -= (next_temp_ptr - temp_ptr);
-    temp_ptr = next_temp_ptr;
-    PRINT_ARRAY("msg2 G_Y", g_y, *g_y_len);
-
-    if (cbor_type == CborTextStringType) {
+    if (item.type == CborTextStringType) {
         /*the error message and message 2 differ in the type of the second 
         element. In the error message the second element is DIAG_MSG : tstr and 
         in message 2 it is G_Y : bstr*/
         return ErrorMessageReceived;
-    } else {
-        /*get the connection identifier of the responder C_R */
-        /*c_r is encoded as bstr_identifier, i.e., byte string of length 1 is
-		 * encoded as integer -24, else c_r is a byte string.
-		 * On different platforms int has different size so we dump c_r first
-		 * in a int buffer and then we check if it is string or int*/
-
-        if (*c_r_len > 1) {
-            r = cbor_decoder(
-                &next_temp_ptr, temp_ptr, temp_len,
-                c_r, c_r_len, &cbor_type);
-            if (r != EdhocNoError) return r;
-        } else {
-            int buf;
-            r = cbor_decoder(
-                &next_temp_ptr, temp_ptr, temp_len,
-                &buf, c_r_len, &cbor_type);
-            if (r != EdhocNoError) return r;
-            if (*c_r_len > 1) return C_R_lengthtosmall;
-            *c_r = buf + 24;
-        }
+    }
+    if (item.type != CborByteStringType) return UnsupportedCborType;
+    m->g_y = item.view;
+    PRINT_ARRAY("msg2 G_Y", m->g_y.ptr, m->g_y.len);
 
-        PRINT_ARRAY("msg2 C_R", c_r, *c_r_len);
-        temp_len -= (next_temp_ptr - temp_ptr);
-        temp_ptr = next_temp_ptr;
+    /*get the connection identifier of the responder C_R, encoded as 
+    bstr_identifier*/
+    r = cbor_bstr_identifier_next(&rest, &m->c_r_single, &m->c_r);
+    if (r != EdhocNoError) return r;
+    PRINT_ARRAY("msg2 C_R", m->c_r.ptr, m->c_r.len);
 
-        /*get ciphertext_2*/
-        r = cbor_decoder(
-            &next_temp_ptr, temp_ptr, temp_len,
-            ciphertext2, ciphertext2_len, &cbor_type);
-        if (r != EdhocNoError) return r;
-        PRINT_ARRAY("msg2 CIPHERTEXT_2", ciphertext2, *ciphertext2_len);
-        return EdhocNoError;
-    }
+    /*get ciphertext_2*/
+    r = cbor_bstr_next(&rest, &m->ciphertext);
+    if (r != EdhocNoError) return r;
+    PRINT_ARRAY("msg2 CIPHERTEXT_2", m->ciphertext.ptr, m->ciphertext.len);
+    return EdhocNoError;
 }
 /**
  * @brief   Encodes message 1
  * @param   c initiator context
+ * @param   g_x the ephemeral public key of the initiator
  * @param   msg1 pointer to a buffer for holding the encoded message
  * @param   msg1_len length of the encoded message
  */
 static inline EdhocError msg1_encode(
     const struct edhoc_initiator_context* c,
+    const struct byte_array* g_x,
     uint8_t* msg1, uint32_t* msg1_len) {
     CborEncoder msg1_enc, enc;
     CborError r;
@@ -165,7 +137,7 @@ static inline EdhocError msg1_encode(
     }
 
     /* G_X ephemeral public key, bstr */
-    r = cbor_encode_byte_string(&msg1_enc, c->g_x.ptr, c->g_x.len);
+    r = cbor_encode_byte_string(&msg1_enc, g_x->ptr, g_x->len);
     if (r != CborNoError) return CborEncodingError;
 
     /* C_I connection id, encoded as  bstr_identifier */
@@ -194,14 +166,23 @@ static inline EdhocError msg1_encode(
     return EdhocNoError;
 }
 
-EdhocError edhoc_initiator_run(
+/**
+ * @brief   Executes the initiator side of the protocol, see 
+ *          edhoc_initiator_run(). All buffers which depend on the 
+ *          message sizes are carved from ws. If msg3_out is not NULL 
+ *          msg3 is returned through it instead of being sent.
+ */
+static EdhocError initiator_run(
+    struct edhoc_workspace* ws,
     const struct edhoc_initiator_context* c,
     struct other_party_cred* cred_r_array, uint16_t num_cred_r,
     uint8_t* err_msg, uint32_t* err_msg_len,
     uint8_t* ad_2, uint64_t* ad_2_len,
     uint8_t* prk_4x3m, uint8_t prk_4x3m_len,
-    uint8_t* th4, uint8_t th4_len) {
+    uint8_t* th4, uint8_t th4_len,
+    uint8_t* msg3_out, uint32_t* msg3_out_len) {
     EdhocError r;
+    TRACE_DECLARE(tr, INITIATOR, c->method_type, c);
 
     struct suite suite;
     bool auth_method_static_dh_i = false, auth_method_static_dh_r = false;
@@ -213,33 +194,54 @@ EdhocError edhoc_initiator_run(
         &auth_method_static_dh_i,
         &auth_method_static_dh_r);
 
-    uint8_t msg1[MSG_1_DEFAULT_SIZE];
-    uint32_t msg1_len = sizeof(msg1);
-    uint8_t msg2[MSG_2_DEFAULT_SIZE];
-    uint32_t msg2_len = sizeof(msg2);
-
-    uint8_t c_i[c->c_i.len];
-    uint64_t c_i_len = sizeof(c_i);
-
-    /*in a given selected cipher suite the length of G_X and G_Y is equal*/
-    uint8_t g_y[c->g_x.len];
-    uint64_t g_y_len = sizeof(g_y);
-
-    uint8_t c_r[C_R_DEFAULT_SIZE];
-    uint64_t c_r_len = sizeof(c_r);
+    /*ephemeral DH key pair, taken from the key pool if the caller set one*/
+    struct byte_array x = c->x;
+    struct byte_array g_x = c->g_x;
+    uint8_t x_buf[EPHEMERAL_KEY_DEFAULT_SIZE];
+    uint8_t g_x_buf[EPHEMERAL_KEY_DEFAULT_SIZE];
+    if (c->key_pool != NULL) {
+        r = ephemeral_key_pool_take(
+            c->key_pool, suite.edhoc_ecdh_curve,
+            x_buf, sizeof(x_buf),
+            g_x_buf, sizeof(g_x_buf));
+        if (r != EdhocNoError) return r;
+        x.ptr = x_buf;
+        x.len = sizeof(x_buf);
+        g_x.ptr = g_x_buf;
+        g_x.len = sizeof(g_x_buf);
+    }
 
-    uint8_t ciphertext2[CIPHERTEXT2_DEFAULT_SIZE];
-    uint64_t ciphertext2_len = sizeof(ciphertext2);
+    uint8_t* msg1;
+    r = workspace_alloc(ws, MSG_1_DEFAULT_SIZE, &msg1);
+    if (r != EdhocNoError) return r;
+    uint32_t msg1_len = MSG_1_DEFAULT_SIZE;
+    uint8_t* msg2;
+    r = workspace_alloc(ws, MSG_2_DEFAULT_SIZE, &msg2);
+    if (r != EdhocNoError) return r;
+    uint32_t msg2_len = MSG_2_DEFAULT_SIZE;
 
-    r = msg1_encode(c, (uint8_t*)&msg1, &msg1_len);
+    TRACE_BEGIN(tr, EDHOC_PHASE_ENCODE);
+    r = msg1_encode(c, &g_x, msg1, &msg1_len);
+    TRACE_END(tr, EDHOC_PHASE_ENCODE, msg1_len, r);
     if (r != EdhocNoError) return r;
 
+    TRACE_BEGIN(tr, EDHOC_PHASE_TX);
     r = tx(msg1, msg1_len);
+    TRACE_END(tr, EDHOC_PHASE_TX, msg1_len, r);
+    if (r != EdhocNoError) return r;
+
+    /*absorb msg1 into the transcript hash before waiting for msg2*/
+    struct hash_state th2_state;
+    TRACE_BEGIN(tr, EDHOC_PHASE_TH);
+    r = th2_init(suite.edhoc_hash, msg1, msg1_len, &th2_state);
+    TRACE_END(tr, EDHOC_PHASE_TH, msg1_len, r);
     if (r != EdhocNoError) return r;
 
     /**********************receive and process msg2 ***************************/
 
+    TRACE_BEGIN(tr, EDHOC_PHASE_RX);
     r = rx(msg2, &msg2_len);
+    TRACE_END(tr, EDHOC_PHASE_RX, r == EdhocNoError ? msg2_len : 0, r);
     if (r != EdhocNoError) return r;
     PRINT_ARRAY("message_2 (CBOR Sequence)", msg2, msg2_len);
 
@@ -247,13 +249,10 @@ EdhocError edhoc_initiator_run(
     ErrorMessageReceived. If this hapens edhoc_initiator_run will return. Then
     the caller needs to examine SUITES_R in err_msg re-initialize the initiator 
     and call edhoc_initiator_run again*/
-    r = msg2_parse(
-        c,
-        msg2, msg2_len,
-        c_i, &c_i_len,
-        g_y, &g_y_len,
-        c_r, &c_r_len,
-        ciphertext2, &ciphertext2_len);
+    struct msg_2 m2;
+    TRACE_BEGIN(tr, EDHOC_PHASE_DECODE);
+    r = msg2_parse(c, msg2, msg2_len, &m2);
+    TRACE_END(tr, EDHOC_PHASE_DECODE, msg2_len, r);
     if (r == ErrorMessageReceived) {
         /*provide the error message to the caller*/;
         r = _memcpy_s(err_msg, *err_msg_len, msg2, msg2_len);
@@ -263,31 +262,51 @@ EdhocError edhoc_initiator_run(
     }
     if (r != EdhocNoError) return r;
 
+    uint8_t* c_i = m2.c_i.ptr;
+    uint32_t c_i_len = m2.c_i.len;
+    uint8_t* g_y = m2.g_y.ptr;
+    uint32_t g_y_len = m2.g_y.len;
+    uint8_t* c_r = m2.c_r.ptr;
+    uint32_t c_r_len = m2.c_r.len;
+    uint8_t* ciphertext2 = m2.ciphertext.ptr;
+    uint32_t ciphertext2_len = m2.ciphertext.len;
+
+    /*in a given selected cipher suite the length of G_X and G_Y is equal*/
+    if (g_y_len != g_x.len) return InvalidPublicKey;
+
     /*calculate the DH shared secret*/
     uint8_t g_xy[ECDH_SECRET_DEFAULT_SIZE];
-    r = shared_secret_derive(suite.edhoc_ecdh_curve, c->x.ptr, c->x.len, g_y, g_y_len, g_xy);
+    TRACE_BEGIN(tr, EDHOC_PHASE_DH);
+    r = shared_secret_derive(suite.edhoc_ecdh_curve, x.ptr, x.len, g_y, g_y_len, g_xy);
+    TRACE_END(tr, EDHOC_PHASE_DH, sizeof(g_xy), r);
     if (r != EdhocNoError) return r;
     PRINT_ARRAY("G_XY (ECDH shared secret) ", g_xy, sizeof(g_xy));
 
     /*calculate th2*/
     uint8_t th2[SHA_DEFAULT_SIZE];
-    r = th2_calculate(
-        suite.edhoc_hash,
-        msg1, msg1_len,
+    TRACE_BEGIN(tr, EDHOC_PHASE_TH);
+    r = th2_final(
+        &th2_state,
         c_i, c_i_len,
-        g_y, sizeof(g_y),
+        g_y, g_y_len,
         c_r, c_r_len, th2);
+    TRACE_END(tr, EDHOC_PHASE_TH, sizeof(th2), r);
     if (r != 0) return r;
 
     /*calculate PRK_2e*/
     uint8_t PRK_2e[PRK_DEFAULT_SIZE];
+    TRACE_BEGIN(tr, EDHOC_PHASE_KDF);
     r = hkdf_extract(suite.edhoc_hash, NULL, 0, g_xy, sizeof(g_xy), PRK_2e);
+    TRACE_END(tr, EDHOC_PHASE_KDF, sizeof(PRK_2e), r);
     if (r != EdhocNoError) return r;
     PRINT_ARRAY("PRK_2e", PRK_2e, sizeof(PRK_2e));
 
     /*Calculate K_2e*/
     uint64_t K_2e_len = ciphertext2_len;
-    uint8_t K_2e[K_2e_len];
+    uint8_t* K_2e;
+    r = workspace_alloc(ws, K_2e_len, &K_2e);
+    if (r != EdhocNoError) return r;
+    TRACE_BEGIN(tr, EDHOC_PHASE_KDF);
     r = okm_calc(
         suite.edhoc_aead,
         suite.edhoc_hash,
@@ -295,29 +314,39 @@ EdhocError edhoc_initiator_run(
         (uint8_t*)&PRK_2e, sizeof(PRK_2e),
         (uint8_t*)&th2, sizeof(th2),
         K_2e, K_2e_len);
+    TRACE_END(tr, EDHOC_PHASE_KDF, K_2e_len, r);
     if (r != EdhocNoError) return r;
-    PRINT_ARRAY("K_2e", K_2e, sizeof(K_2e));
+    PRINT_ARRAY("K_2e", K_2e, K_2e_len);
 
-    uint8_t P_2e[ciphertext2_len];
+    uint8_t* P_2e;
+    r = workspace_alloc(ws, ciphertext2_len, &P_2e);
+    if (r != EdhocNoError) return r;
     for (uint16_t i = 0; i < K_2e_len; i++) {
         P_2e[i] = ciphertext2[i] ^ K_2e[i];
     }
 
-    PRINT_ARRAY("P_2e", P_2e, sizeof(P_2e));
+    PRINT_ARRAY("P_2e", P_2e, ciphertext2_len);
 
-    uint8_t sign_or_mac[SGN_OR_MAC_DEFAULT_SIZE];
-    uint64_t sign_or_mac_len = sizeof(sign_or_mac);
-    uint8_t id_cred_r[ID_CRED_DEFAULT_SIZE];
-    uint64_t id_cred_r_len = sizeof(id_cred_r);
+    struct byte_array sign_or_mac, ad_2_view;
+    uint8_t* id_cred_r;
+    r = workspace_alloc(ws, ID_CRED_DEFAULT_SIZE, &id_cred_r);
+    if (r != EdhocNoError) return r;
+    uint64_t id_cred_r_len = ID_CRED_DEFAULT_SIZE;
 
+    TRACE_BEGIN(tr, EDHOC_PHASE_DECODE);
     r = plaintext_split(
-        P_2e, sizeof(P_2e),
+        P_2e, ciphertext2_len,
         id_cred_r, &id_cred_r_len,
-        sign_or_mac, &sign_or_mac_len,
-        ad_2, ad_2_len);
+        &sign_or_mac, &ad_2_view);
+    TRACE_END(tr, EDHOC_PHASE_DECODE, ciphertext2_len, r);
     if (r != EdhocNoError) return r;
     PRINT_ARRAY("ID_CRED_R", id_cred_r, id_cred_r_len);
-    PRINT_ARRAY("sign_or_mac", sign_or_mac, sign_or_mac_len);
+    PRINT_ARRAY("sign_or_mac", sign_or_mac.ptr, sign_or_mac.len);
+
+    /*AD_2 is handed to the caller*/
+    r = _memcpy_s(ad_2, *ad_2_len, ad_2_view.ptr, ad_2_view.len);
+    if (r != EdhocNoError) return r;
+    *ad_2_len = ad_2_view.len;
     if (*ad_2_len) {
         PRINT_ARRAY("AD_2", ad_2, *ad_2_len);
     }
@@ -330,13 +359,16 @@ EdhocError edhoc_initiator_run(
     uint8_t* g_r;
     uint16_t g_r_len = 0;
 
+    TRACE_BEGIN(tr, EDHOC_PHASE_CRED);
     r = retrieve_cred(
-        auth_method_static_dh_r, cred_r_array, num_cred_r,
+        auth_method_static_dh_r, c->trust_anchors, c->revoked,
+        cred_r_array, num_cred_r,
         id_cred_r, id_cred_r_len,
         &cred_r,
         &cred_r_len,
         &pk, &pk_len,
         &g_r, &g_r_len);
+    TRACE_END(tr, EDHOC_PHASE_CRED, cred_r_len, r);
     if (r != EdhocNoError)
         return r;
 
@@ -346,18 +378,26 @@ EdhocError edhoc_initiator_run(
 
     uint8_t PRK_3e2m[PRK_DEFAULT_SIZE];
     /*derive prk_3e2m*/
+    TRACE_BEGIN(tr, auth_method_static_dh_r ? EDHOC_PHASE_DH : EDHOC_PHASE_KDF);
     r = prk_derive(
         auth_method_static_dh_r, suite,
         PRK_2e, sizeof(PRK_2e),
         g_r, g_r_len,
-        c->x.ptr, c->x.len, PRK_3e2m);
+        x.ptr, x.len, PRK_3e2m);
+    TRACE_END(tr, auth_method_static_dh_r ? EDHOC_PHASE_DH : EDHOC_PHASE_KDF,
+              sizeof(PRK_3e2m), r);
+    /*the ephemeral secret key is not needed anymore*/
+    memset(x_buf, 0, sizeof(x_buf));
     if (r != EdhocNoError) return r;
     PRINT_ARRAY("prk_3e2m", PRK_3e2m, sizeof(PRK_3e2m));
 
-    uint8_t m_2[A_2M_DEFAULT_SIZE];
-    uint16_t m_2_len = sizeof(m_2);
+    uint8_t* m_2;
+    r = workspace_alloc(ws, A_2M_DEFAULT_SIZE, &m_2);
+    if (r != EdhocNoError) return r;
+    uint16_t m_2_len = A_2M_DEFAULT_SIZE;
     uint8_t mac_2[16];
     uint8_t mac_2_len = sizeof(mac_2);
+    TRACE_BEGIN(tr, EDHOC_PHASE_MAC);
     r = signature_or_mac_msg_create(
         auth_method_static_dh_r, suite, "K_2m", "IV_2m",
         (uint8_t*)&PRK_3e2m, sizeof(PRK_3e2m),
@@ -367,10 +407,12 @@ EdhocError edhoc_initiator_run(
         ad_2, *ad_2_len,
         m_2, &m_2_len,
         mac_2, &mac_2_len);
+    TRACE_END(tr, EDHOC_PHASE_MAC, m_2_len, r);
     if (r != EdhocNoError) return r;
 
     if (auth_method_static_dh_r) {
-        if (!memcmp(mac_2, sign_or_mac, mac_2_len)) {
+        if (sign_or_mac.len == mac_2_len &&
+            !memcmp(mac_2, sign_or_mac.ptr, mac_2_len)) {
             PRINT_MSG("Responder authentication successful!\n");
         } else {
             r = tx_err_msg(INITIATOR, c->corr, c_r, c_r_len, NULL, 0, NULL, 0);
@@ -380,12 +422,14 @@ EdhocError edhoc_initiator_run(
     } else {
         /*the responder authenticates with a signature*/
         bool verified = false;
+        TRACE_BEGIN(tr, EDHOC_PHASE_VERIFY);
         r = verify(
             suite.edhoc_sign_curve,
             pk, pk_len,
-            (uint8_t*)&m_2, m_2_len,
-            (uint8_t*)&sign_or_mac, sign_or_mac_len,
+            m_2, m_2_len,
+            sign_or_mac.ptr, sign_or_mac.len,
             &verified);
+        TRACE_END(tr, EDHOC_PHASE_VERIFY, m_2_len, r);
         if (verified) {
             PRINT_MSG("Responder authentication successful!\n");
         } else {
@@ -407,27 +451,35 @@ EdhocError edhoc_initiator_run(
         data_3_len = c_r_len;
     }
     uint8_t th3[32];
+    TRACE_BEGIN(tr, EDHOC_PHASE_TH);
     r = th3_calculate(
         suite.edhoc_hash,
         (uint8_t*)&th2, sizeof(th2),
         ciphertext2, ciphertext2_len,
         data_3, data_3_len, th3);
+    TRACE_END(tr, EDHOC_PHASE_TH, sizeof(th3), r);
     if (r != EdhocNoError) return r;
 
     /*derive prk_4x3m*/
+    TRACE_BEGIN(tr, auth_method_static_dh_i ? EDHOC_PHASE_DH : EDHOC_PHASE_KDF);
     r = prk_derive(
         auth_method_static_dh_i, suite,
         (uint8_t*)&PRK_3e2m, sizeof(PRK_3e2m),
-        g_y, sizeof(g_y),
+        g_y, g_y_len,
         c->i.ptr, c->i.len,
         prk_4x3m);
+    TRACE_END(tr, auth_method_static_dh_i ? EDHOC_PHASE_DH : EDHOC_PHASE_KDF,
+              prk_4x3m_len, r);
     if (r != EdhocNoError) return r;
     PRINT_ARRAY("prk_4x3m", prk_4x3m, prk_4x3m_len);
 
-    uint8_t m_3[M_3_DEFAULT_SIZE];
-    uint16_t m_3_len = sizeof(m_3);
+    uint8_t* m_3;
+    r = workspace_alloc(ws, M_3_DEFAULT_SIZE, &m_3);
+    if (r != EdhocNoError) return r;
+    uint16_t m_3_len = M_3_DEFAULT_SIZE;
     uint8_t sign_or_mac_3[64];
     uint32_t sign_or_mac_3_len = sizeof(sign_or_mac_3);
+    TRACE_BEGIN(tr, EDHOC_PHASE_MAC);
     r = signature_or_mac_msg_create(
         auth_method_static_dh_i, suite, "K_3m", "IV_3m",
         prk_4x3m, prk_4x3m_len,
@@ -436,24 +488,27 @@ EdhocError edhoc_initiator_run(
         c->cred_i.ptr, c->cred_i.len,
         c->ad_3.ptr, c->ad_3.len, m_3, &m_3_len,
         sign_or_mac_3, (uint8_t*)&sign_or_mac_3_len);
+    TRACE_END(tr, EDHOC_PHASE_MAC, m_3_len, r);
     if (r != EdhocNoError) return r;
 
     /*Calculate signature if the initiator authenticates with signature*/
     if (!auth_method_static_dh_i) {
         /*Calculate a signature*/
         sign_or_mac_3_len = sizeof(sign_or_mac_3);
+        TRACE_BEGIN(tr, EDHOC_PHASE_SIGN);
         r = sign(
             suite.edhoc_sign_curve,
             c->sk_i.ptr, c->sk_i.len,
             c->pk_i.ptr, c->pk_i.len,
             m_3, m_3_len, sign_or_mac_3,
             &sign_or_mac_3_len);
+        TRACE_END(tr, EDHOC_PHASE_SIGN, m_3_len, r);
         if (r != EdhocNoError) return r;
         PRINT_ARRAY("Signature_or_MAC_3", sign_or_mac_3, sign_or_mac_3_len);
     }
 
     /*Calculate P_3ae*/
-    uint8_t sign_or_mac_3_enc[sign_or_mac_3_len + 2];
+    uint8_t sign_or_mac_3_enc[sizeof(sign_or_mac_3) + 2];
     uint16_t sign_or_mac_3_enc_len = sizeof(sign_or_mac_3_enc);
     r = encode_byte_string(
         sign_or_mac_3, sign_or_mac_3_len,
@@ -464,8 +519,10 @@ EdhocError edhoc_initiator_run(
     uint32_t kid_len = sizeof(kid_buf);
     id_cred2kid(c->id_cred_i.ptr, c->id_cred_i.len, kid_buf, &kid_len);
 
-    uint8_t P_3ae[PRK_3AE_DEFAULT_SIZE];
-    uint32_t P_3ae_len = sizeof(P_3ae);
+    uint8_t* P_3ae;
+    r = workspace_alloc(ws, PRK_3AE_DEFAULT_SIZE, &P_3ae);
+    if (r != EdhocNoError) return r;
+    uint32_t P_3ae_len = PRK_3AE_DEFAULT_SIZE;
 
     if (kid_len != 0) {
         r = _memcpy_s(P_3ae, P_3ae_len, kid_buf, kid_len);
@@ -482,30 +539,27 @@ EdhocError edhoc_initiator_run(
     }
     PRINT_ARRAY("P_3ae", P_3ae, P_3ae_len);
 
-    /*Calculate K_3ae*/
+    /*Calculate K_3ae and IV_3ae*/
     uint8_t K_3ae[16];
-    r = okm_calc(
-        suite.edhoc_aead, suite.edhoc_hash, "K_3ae",
-        PRK_3e2m, sizeof(PRK_3e2m),
-        (uint8_t*)&th3, sizeof(th3),
-        K_3ae, sizeof(K_3ae));
-    if (r != EdhocNoError) return r;
-    PRINT_ARRAY("K_3ae", K_3ae, sizeof(K_3ae));
-
-    /*Calculate IV_3ae*/
     uint8_t IV_3ae[13];
-    r = okm_calc(
-        suite.edhoc_aead, suite.edhoc_hash, "IV_3ae",
+    TRACE_BEGIN(tr, EDHOC_PHASE_KDF);
+    r = okm_key_iv_calc(
+        suite.edhoc_aead, suite.edhoc_hash, "K_3ae", "IV_3ae",
         PRK_3e2m, sizeof(PRK_3e2m),
         (uint8_t*)&th3, sizeof(th3),
+        K_3ae, sizeof(K_3ae),
         IV_3ae, sizeof(IV_3ae));
+    TRACE_END(tr, EDHOC_PHASE_KDF, sizeof(K_3ae) + sizeof(IV_3ae), r);
     if (r != EdhocNoError) return r;
+    PRINT_ARRAY("K_3ae", K_3ae, sizeof(K_3ae));
     PRINT_ARRAY("IV_3ae", IV_3ae, sizeof(IV_3ae));
 
     /*Associated data A_3ae*/
-    uint8_t A_3ae[A_3AE_DEFAULT_SIZE];
-    uint32_t A_3ae_len = sizeof(A_3ae);
-    r = a_Xae_encode(th3, sizeof(th3), (uint8_t*)&A_3ae, &A_3ae_len);
+    uint8_t* A_3ae;
+    r = workspace_alloc(ws, A_3AE_DEFAULT_SIZE, &A_3ae);
+    if (r != EdhocNoError) return r;
+    uint32_t A_3ae_len = A_3AE_DEFAULT_SIZE;
+    r = a_Xae_encode(th3, sizeof(th3), A_3ae, &A_3ae_len);
     if (r != EdhocNoError) return r;
     PRINT_ARRAY("A_3ae", A_3ae, A_3ae_len);
 
@@ -514,29 +568,42 @@ EdhocError edhoc_initiator_run(
     if (suite.edhoc_aead == AES_CCM_16_128_128) {
         mac_len = 16;
     }
-    uint8_t tag[mac_len];
-    uint8_t ciphertext_3[P_3ae_len + mac_len];
+    uint8_t tag[16];
+    uint32_t ciphertext_3_len = P_3ae_len + mac_len;
+    uint8_t* ciphertext_3;
+    r = workspace_alloc(ws, ciphertext_3_len, &ciphertext_3);
+    if (r != EdhocNoError) return r;
+    TRACE_BEGIN(tr, EDHOC_PHASE_AEAD);
     r = aead(ENCRYPT,
              P_3ae, P_3ae_len,
              K_3ae, sizeof(K_3ae),
              IV_3ae, sizeof(IV_3ae),
              A_3ae, A_3ae_len,
-             ciphertext_3, sizeof(ciphertext_3),
+             ciphertext_3, ciphertext_3_len,
              tag, mac_len);
+    TRACE_END(tr, EDHOC_PHASE_AEAD, ciphertext_3_len, r);
     if (r != EdhocNoError) return r;
 
-    PRINT_ARRAY("ciphertext_3", ciphertext_3, sizeof(ciphertext_3));
+    PRINT_ARRAY("ciphertext_3", ciphertext_3, ciphertext_3_len);
 
     /*massage 3 create and send*/
-    uint8_t ciphertext_3_enc[sizeof(ciphertext_3) + 2];
-    uint16_t ciphertext_3_enc_len = sizeof(ciphertext_3_enc);
+    uint8_t* ciphertext_3_enc;
+    r = workspace_alloc(ws, ciphertext_3_len + 3, &ciphertext_3_enc);
+    if (r != EdhocNoError) return r;
+    uint16_t ciphertext_3_enc_len = ciphertext_3_len + 3;
+    TRACE_BEGIN(tr, EDHOC_PHASE_ENCODE);
     r = encode_byte_string(
-        ciphertext_3, sizeof(ciphertext_3),
+        ciphertext_3, ciphertext_3_len,
         ciphertext_3_enc, &ciphertext_3_enc_len);
+    TRACE_END(tr, EDHOC_PHASE_ENCODE, ciphertext_3_enc_len, r);
     if (r != EdhocNoError) return r;
 
     uint16_t msg3_len = ciphertext_3_enc_len + c_r_len;
-    uint8_t msg3[msg3_len];
+    /*the responder does not accept longer messages*/
+    if (msg3_len > MSG_3_DEFAULT_SIZE) return DestBufferToSmall;
+    uint8_t* msg3;
+    r = workspace_alloc(ws, msg3_len, &msg3);
+    if (r != EdhocNoError) return r;
     if (c_r_len == 1) {
         uint8_t c_r_bstr_ident;
         r = c_x_bstr_identifier_encode(c_r[0], &c_r_bstr_ident);
@@ -551,16 +618,113 @@ EdhocError edhoc_initiator_run(
 
     PRINT_ARRAY("msg3", msg3, msg3_len);
 
-    r = tx(msg3, msg3_len);
-    if (r != EdhocNoError) return r;
+    if (msg3_out != NULL) {
+        /*the caller sends msg3 together with its first OSCORE request*/
+        r = _memcpy_s(msg3_out, *msg3_out_len, msg3, msg3_len);
+        if (r != EdhocNoError) return r;
+        *msg3_out_len = msg3_len;
+    } else {
+        TRACE_BEGIN(tr, EDHOC_PHASE_TX);
+        r = tx(msg3, msg3_len);
+        TRACE_END(tr, EDHOC_PHASE_TX, msg3_len, r);
+        if (r != EdhocNoError) return r;
+    }
 
     /*TH4*/
+    TRACE_BEGIN(tr, EDHOC_PHASE_TH);
     r = th4_calculate(
         suite.edhoc_hash,
         th3, sizeof(th3),
-        ciphertext_3, sizeof(ciphertext_3),
+        ciphertext_3, ciphertext_3_len,
         th4);
+    TRACE_END(tr, EDHOC_PHASE_TH, th4_len, r);
     if (r != EdhocNoError) return r;
 
     return EdhocNoError;
 }
+
+/**
+ * @brief   Executes initiator_run() with a workspace on the stack. Kept out of 
+ *          line so that the stack is only used if the caller did not provide 
+ *          a workspace.
+ */
+static EdhocError __attribute__((noinline)) initiator_run_on_stack(
+    const struct edhoc_initiator_context* c,
+    struct other_party_cred* cred_r_array, uint16_t num_cred_r,
+    uint8_t* err_msg, uint32_t* err_msg_len,
+    uint8_t* ad_2, uint64_t* ad_2_len,
+    uint8_t* prk_4x3m, uint8_t prk_4x3m_len,
+    uint8_t* th4, uint8_t th4_len,
+    uint8_t* msg3_out, uint32_t* msg3_out_len) {
+    uint64_t buf[EDHOC_INITIATOR_WORKSPACE_SIZE / sizeof(uint64_t)];
+    struct edhoc_workspace ws;
+    EdhocError r;
+
+    workspace_init(&ws, (uint8_t*)buf, sizeof(buf));
+    r = initiator_run(
+        &ws, c, cred_r_array, num_cred_r, err_msg, err_msg_len,
+        ad_2, ad_2_len, prk_4x3m, prk_4x3m_len, th4, th4_len,
+        msg3_out, msg3_out_len);
+    workspace_release(&ws);
+    return r;
+}
+
+/**
+ * @brief   Executes initiator_run() in the workspace of c or, if there is 
+ *          none, in a workspace on the stack.
+ */
+static EdhocError initiator_run_ws(
+    const struct edhoc_initiator_context* c,
+    struct other_party_cred* cred_r_array, uint16_t num_cred_r,
+    uint8_t* err_msg, uint32_t* err_msg_len,
+    uint8_t* ad_2, uint64_t* ad_2_len,
+    uint8_t* prk_4x3m, uint8_t prk_4x3m_len,
+    uint8_t* th4, uint8_t th4_len,
+    uint8_t* msg3_out, uint32_t* msg3_out_len) {
+    EdhocError r;
+    TRACE_DECLARE(tr, INITIATOR, c->method_type, c);
+
+    TRACE_BEGIN(tr, EDHOC_PHASE_HANDSHAKE);
+    if (c->workspace == NULL) {
+        r = initiator_run_on_stack(
+            c, cred_r_array, num_cred_r, err_msg, err_msg_len,
+            ad_2, ad_2_len, prk_4x3m, prk_4x3m_len, th4, th4_len,
+            msg3_out, msg3_out_len);
+    } else {
+        r = initiator_run(
+            c->workspace, c, cred_r_array, num_cred_r, err_msg, err_msg_len,
+            ad_2, ad_2_len, prk_4x3m, prk_4x3m_len, th4, th4_len,
+            msg3_out, msg3_out_len);
+        workspace_release(c->workspace);
+    }
+    TRACE_END(tr, EDHOC_PHASE_HANDSHAKE, 0, r);
+    return r;
+}
+
+EdhocError edhoc_initiator_run(
+    const struct edhoc_initiator_context* c,
+    struct other_party_cred* cred_r_array, uint16_t num_cred_r,
+    uint8_t* err_msg, uint32_t* err_msg_len,
+    uint8_t* ad_2, uint64_t* ad_2_len,
+    uint8_t* prk_4x3m, uint8_t prk_4x3m_len,
+    uint8_t* th4, uint8_t th4_len) {
+    return initiator_run_ws(
+        c, cred_r_array, num_cred_r, err_msg, err_msg_len,
+        ad_2, ad_2_len, prk_4x3m, prk_4x3m_len, th4, th4_len,
+        NULL, NULL);
+}
+
+EdhocError edhoc_initiator_run_combined(
+    const struct edhoc_initiator_context* c,
+    struct other_party_cred* cred_r_array, uint16_t num_cred_r,
+    uint8_t* err_msg, uint32_t* err_msg_len,
+    uint8_t* ad_2, uint64_t* ad_2_len,
+    uint8_t* prk_4x3m, uint8_t prk_4x3m_len,
+    uint8_t* th4, uint8_t th4_len,
+    uint8_t* msg3, uint32_t* msg3_len) {
+    if (msg3 == NULL || msg3_len == NULL) return DestBufferToSmall;
+    return initiator_run_ws(
+        c, cred_r_array, num_cred_r, err_msg, err_msg_len,
+        ad_2, ad_2_len, prk_4x3m, prk_4x3m_len, th4, th4_len,
+        msg3, msg3_len);
+}
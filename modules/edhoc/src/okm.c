@@ -25,11 +25,62 @@ EdhocError okm_calc(
     uint8_t info[INFO_DEFAULT_SIZE];
     uint8_t info_len = sizeof(info);
 
-    r = create_hkdf_info(aead_alg, th, th_len, label, okm_len, (uint8_t*)&info, &info_len);
+    r = hkdf_info_encode(aead_alg, th, th_len, label, okm_len, (uint8_t*)&info, &info_len);
     if (r != EdhocNoError) return r;
     PRINT_ARRAY("info", info, info_len);
 
     r = hkdf_expand(hash_alg, prk, prk_len, (uint8_t*)&info, info_len, okm, okm_len);
     if (r != EdhocNoError) return r;
     return EdhocNoError;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief   completes the info started with hkdf_info_prefix_encode() with 
+ *          a label and expands the prepared PRK with it
+ */
+static EdhocError okm_label_calc(
+    const struct hkdf_prk* k,
+    uint8_t* info, uint8_t info_size, uint8_t prefix_len,
+    const char* label,
+    uint8_t* okm, uint64_t okm_len) {
+    EdhocError r;
+    uint8_t label_len = info_size - prefix_len;
+
+    r = hkdf_info_label_encode(label, okm_len, info + prefix_len, &label_len);
+    if (r != EdhocNoError) return r;
+    PRINT_ARRAY("info", info, prefix_len + label_len);
+    return hkdf_expand_prk(k, info, prefix_len + label_len, okm, okm_len);
+}
+
+EdhocError okm_key_iv_calc(
+    enum aead_alg aead_alg,
+    enum hash_alg hash_alg,
+    const char* label_k,
+    const char* label_iv,
+    const uint8_t* prk, uint8_t prk_len,
+    const uint8_t* th, uint8_t th_len,
+    uint8_t* k, uint64_t k_len,
+    uint8_t* iv, uint64_t iv_len) {
+    EdhocError r;
+    struct hkdf_prk p;
+    volatile uint8_t* v = (volatile uint8_t*)&p;
+    uint8_t info[INFO_DEFAULT_SIZE];
+    uint8_t prefix_len = sizeof(info);
+
+    /*both infos are [aead_alg, th, label, length], the first two elements 
+    are encoded only once*/
+    r = hkdf_info_prefix_encode(aead_alg, th, th_len, info, &prefix_len);
+    if (r != EdhocNoError) return r;
+
+    r = hkdf_prk_init(hash_alg, prk, prk_len, &p);
+    if (r != EdhocNoError) return r;
+
+    r = okm_label_calc(&p, info, sizeof(info), prefix_len, label_k, k, k_len);
+    if (r == EdhocNoError) {
+        r = okm_label_calc(
+            &p, info, sizeof(info), prefix_len, label_iv, iv, iv_len);
+    }
+
+    for (uint16_t i = 0; i < sizeof(p); i++) v[i] = 0;
+    return r;
+}
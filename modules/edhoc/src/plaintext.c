@@ -13,7 +13,7 @@
 #include <stdint.h>
 
 #include "../edhoc.h"
-#include "../inc/cbor_decoder.h"
+#include "../inc/cbor_view.h"
 #include "../inc/error.h"
 #include "../inc/memcpy_s.h"
 #include "../inc/print_util.h"
@@ -44,60 +44,31 @@ EdhocError kid2id_cred(
 EdhocError plaintext_split(
     uint8_t* ptxt, const uint16_t ptxt_len,
     uint8_t* id_cred_x, uint64_t* id_cred_x_len,
-    uint8_t* sign_or_mac, uint64_t* sign_or_mac_len,
-    uint8_t* ad, uint64_t* ad_len) {
+    struct byte_array* sign_or_mac,
+    struct byte_array* ad) {
+    struct byte_array rest = {.ptr = ptxt, .len = ptxt_len};
+    struct cbor_item item;
     EdhocError r;
-    CborParser parser;
-    CborValue value;
-    CborType type, ignore;
-    CborError err;
-    uint8_t* next_temp_ptr;
-    uint8_t* temp_ptr;
-    uint32_t temp_len;
-    uint64_t id_cred_x_buf_cap = *id_cred_x_len;
 
-    /* Initialization */
-    err = cbor_parser_init(ptxt, ptxt_len, 0, &parser, &value);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-    /* Get type of input CBOR object */
-    type = cbor_value_get_type(&value);
+    r = cbor_item_next(&rest, &item);
+    if (r != EdhocNoError) return r;
 
-    if (type == CborMapType) {
+    if (item.type == CborMapType) {
         /*the first element in plaintext is a ID_CRED_x, which starts with a map */
-        /*we move to the label of the map*/
-        temp_ptr = ptxt + 1;
-        temp_len = ptxt_len - 1;
-
-        int map_label;
-        uint64_t map_label_len;
-
-        r = cbor_decoder(
-            &next_temp_ptr, temp_ptr, temp_len,
-            &map_label, &map_label_len, &ignore);
+        r = cbor_item_next(&rest, &item);
         if (r != EdhocNoError) return r;
-        temp_len -= (next_temp_ptr - temp_ptr);
-        temp_ptr = next_temp_ptr;
+        if (item.type != CborIntegerType) return UnknownIdCredMapLabel;
 
-        switch (map_label) {
+        switch (item.int_val) {
             case kid:
-                break;
             case x5bag:
-                /* If a single certificate is conveyed, it is placed in a CBOR
-		 bstr. If multiple certificates are conveyed, a CBOR array of bstrs is used, with each certificate being in its own bstr.*/
+            case x5u:
                 break;
             case x5chain:
                 /* If a single certificate is conveyed, it is placed in a CBOR
 		 bstr. If multiple certificates are conveyed, a CBOR array of bstrs
 		 is used, with each certificate being in its own bstr.*/
                 PRINT_MSG("ID_CRED of the other party has label x5chain\n");
-                r = cbor_decoder(
-                    &next_temp_ptr, temp_ptr, temp_len,
-                    id_cred_x, id_cred_x_len, &ignore);
-                temp_len -= (next_temp_ptr - temp_ptr);
-                temp_ptr = next_temp_ptr;
-                r = _memcpy_s(id_cred_x, id_cred_x_buf_cap, ptxt, ptxt_len - temp_len);
-                if (r != EdhocNoError) return r;
-                *id_cred_x_len = ptxt_len - temp_len;
                 break;
             case x5t:
                 /* The attribute is an array of two
@@ -106,83 +77,43 @@ EdhocError plaintext_split(
 		 The algorithm is registered in the "COSE Algorithms" registry The
 		 second element is a binary string containing the hash value. */
                 PRINT_MSG("ID_CRED of the other party has label x5t\n");
-                temp_len--;
-                temp_ptr++;
-                int alg_id;
-                uint64_t alg_id_len;
-                uint8_t hash_val[SHA_DEFAULT_SIZE];
-                uint64_t hash_val_len = sizeof(hash_val);
-
-                r = cbor_decoder(
-                    &next_temp_ptr, temp_ptr, temp_len,
-                    &alg_id, &alg_id_len, &ignore);
-                if (r != EdhocNoError) return r;
-                temp_len -= (next_temp_ptr - temp_ptr);
-                temp_ptr = next_temp_ptr;
-
-                r = cbor_decoder(
-                    &next_temp_ptr, temp_ptr, temp_len,
-                    &hash_val, &hash_val_len, &ignore);
-                if (r != EdhocNoError) return r;
-                temp_len -= (next_temp_ptr - temp_ptr);
-                temp_ptr = next_temp_ptr;
-
-                r = _memcpy_s(id_cred_x, id_cred_x_buf_cap, ptxt, ptxt_len - temp_len);
-                *id_cred_x_len = ptxt_len - temp_len;
-                break;
-            case x5u:
                 break;
             default:
                 return UnknownIdCredMapLabel;
-                break;
         }
+
+        /*ID_CRED_x is the whole map, i.e., everything up to the end of the 
+        value*/
+        r = cbor_item_skip(&rest);
+        if (r != EdhocNoError) return r;
+        r = _memcpy_s(id_cred_x, *id_cred_x_len, ptxt, rest.ptr - ptxt);
+        if (r != EdhocNoError) return r;
+        *id_cred_x_len = rest.ptr - ptxt;
     } else {
         /*
         - when ID_CRED_x = {4:kix_x} only kid_x is conveyed and  kid_x is encoded as bstr_identifier.
         - when the kid is longer then one byte it is encoded as byte string
         else as integer
         */
-        temp_ptr = ptxt;
-        temp_len = ptxt_len;
         PRINT_MSG("ID_CRED of the other party has label kid\n");
-        if (type == CborIntegerType) {
-            int kid;
-            uint64_t kid_len = sizeof(kid);
-            r = cbor_decoder(
-                &next_temp_ptr, temp_ptr, temp_len,
-                &kid, &kid_len, &ignore);
-            if (r != EdhocNoError) return r;
-            kid += 24;
-            r = kid2id_cred(&kid, 1, id_cred_x, id_cred_x_len);
-            if (r != EdhocNoError) return r;
-        } else {
-            uint8_t kid[ID_CRED_DEFAULT_SIZE];
-            uint64_t kid_len = sizeof(kid);
-            r = cbor_decoder(
-                &next_temp_ptr, temp_ptr, temp_len,
-                &kid, &kid_len, &ignore);
-            if (r != EdhocNoError) return r;
-            r = kid2id_cred(&kid, 1, id_cred_x, id_cred_x_len);
-            if (r != EdhocNoError) return r;
-        }
-        temp_len -= (next_temp_ptr - temp_ptr);
-        temp_ptr = next_temp_ptr;
+        uint8_t kid_single;
+        struct byte_array kid_view;
+        rest.ptr = ptxt;
+        rest.len = ptxt_len;
+        r = cbor_bstr_identifier_next(&rest, &kid_single, &kid_view);
+        if (r != EdhocNoError) return r;
+        r = kid2id_cred(kid_view.ptr, kid_view.len, id_cred_x, id_cred_x_len);
+        if (r != EdhocNoError) return r;
     }
 
-    r = cbor_decoder(
-        &next_temp_ptr, temp_ptr, temp_len,
-        sign_or_mac, sign_or_mac_len, &ignore);
+    r = cbor_bstr_next(&rest, sign_or_mac);
     if (r != EdhocNoError) return r;
-    temp_len -= (next_temp_ptr - temp_ptr);
-    temp_ptr = next_temp_ptr;
 
-    if (temp_len) {
-        r = cbor_decoder(
-            &next_temp_ptr, temp_ptr, temp_len,
-            ad, ad_len, &ignore);
+    if (rest.len) {
+        r = cbor_bstr_next(&rest, ad);
         if (r != EdhocNoError) return r;
     } else {
-        *ad_len = 0;
+        *ad = EMPTY_ARRAY;
     }
     return EdhocNoError;
 }
@@ -190,44 +121,25 @@ EdhocError plaintext_split(
 EdhocError id_cred2kid(
     uint8_t* id_cred, uint8_t id_cred_len,
     uint8_t* _kid, uint32_t* kid_len) {
-    CborParser parser;
-    CborValue value;
-    CborError err;
-    uint8_t* next_temp_ptr;
-    uint8_t* temp_ptr;
-    uint32_t temp_len;
-    CborType ignore;
+    struct byte_array rest = {.ptr = id_cred, .len = id_cred_len};
+    struct cbor_item item;
     EdhocError r;
 
-    /* Initialization */
-    err = cbor_parser_init(id_cred, id_cred_len, 0, &parser, &value);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-
-    /*the first element in plaintext is a ID_CRED_x, which starts with a map */
-    /*we move to the label of the map*/
-    temp_ptr = id_cred + 1;
-    temp_len = id_cred_len - 1;
-
-    int map_label;
-    uint64_t map_label_len;
+    /*ID_CRED_x is a map, we move to the label of the map*/
+    r = cbor_item_next(&rest, &item);
+    if (r != EdhocNoError) return r;
+    if (item.type != CborMapType) return ErrorDuringCborDecoding;
 
-    r = cbor_decoder(
-        &next_temp_ptr, temp_ptr, temp_len,
-        &map_label, &map_label_len, &ignore);
+    r = cbor_item_next(&rest, &item);
     if (r != EdhocNoError) return r;
-    temp_len -= (next_temp_ptr - temp_ptr);
-    temp_ptr = next_temp_ptr;
 
-    if (map_label == kid) {
-        uint8_t kid_str[KID_DEFAULT_SIZE];
-        uint64_t kid_str_len = sizeof(kid_str);
-        r = cbor_decoder(
-            &next_temp_ptr, temp_ptr, temp_len,
-            &kid_str, &kid_str_len, &ignore);
+    if (item.type == CborIntegerType && item.int_val == kid) {
+        struct byte_array kid_str;
+        r = cbor_bstr_next(&rest, &kid_str);
         if (r != EdhocNoError) return r;
 
-        if (kid_str_len == 1) {
-            int64_t t = kid_str[0] - 24;
+        if (kid_str.len == 1) {
+            int64_t t = kid_str.ptr[0] - 24;
             CborEncoder enc;
             CborError r;
             cbor_encoder_init(&enc, _kid, *kid_len, 0);
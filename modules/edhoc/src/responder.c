@@ -10,10 +10,11 @@
 */
 
 #include <cbor.h>
+#include <string.h>
 
 #include "../edhoc.h"
 #include "../inc/a_Xae_encode.h"
-#include "../inc/cbor_decoder.h"
+#include "../inc/cbor_view.h"
 #include "../inc/crypto_wrapper.h"
 #include "../inc/err_msg.h"
 #include "../inc/error.h"
@@ -28,92 +29,97 @@
 #include "../inc/signature_or_mac_msg.h"
 #include "../inc/suites.h"
 #include "../inc/th.h"
+#include "../inc/trace.h"
 #include "../inc/txrx_wrapper.h"
+#include "../inc/workspace.h"
 
 /**
- * @brief   Parses message 1
+ * @brief   Parses message 1 in a single pass. The fields of m point into msg1.
  * @param   msg1 buffer containing message 1
  * @param   msg1_len length of msg1
- * @param   method_corr 4*method+corr
- * @param   suites_i
- * @param   suites_i_len length of suites_i
- * @param   g_x Public ephemeral key of the initiator
- * @param   g_x_len length of g_x
- * @param   c_i connection identifier of the initiator
- * @param   c_i_len length of c_i
- * @param   ad1 axillary data 1
- * @param   ad1_len length of ad1
+ * @param   m the parsed message
  * @retval an EdhocError code
  */
 static inline EdhocError msg1_parse(
     uint8_t* msg1, uint32_t msg1_len,
-    uint8_t* method_corr,
-    uint8_t* suites_i, uint64_t* suites_i_len,
-    uint8_t* g_x, uint64_t* g_x_len,
-    uint8_t* c_i, uint64_t* c_i_len,
-    uint8_t* ad1, uint64_t* ad1_len) {
+    struct msg_1* m) {
+    struct byte_array rest = {.ptr = msg1, .len = msg1_len};
+    struct cbor_item item;
     EdhocError r;
-    uint8_t* temp_ptr = msg1;
-    uint8_t* next_temp_ptr;
-    uint32_t temp_len = msg1_len;
-    uint64_t method_len;
-    CborType ignore;
-
-    int tmp;
-    r = cbor_decoder(
-        &next_temp_ptr, temp_ptr, temp_len,
-        &tmp, &method_len, &ignore);
-    *method_corr = tmp;
-    if (r != EdhocNoError) return r;
-    temp_len -= (next_temp_ptr - temp_ptr);
-    temp_ptr = next_temp_ptr;
-    PRINT_ARRAY("msg1 METHOD_CORR", method_corr, method_len);
 
-    r = cbor_decoder(
-        &next_temp_ptr, temp_ptr, temp_len,
-        suites_i, suites_i_len, &ignore);
+    /*METHOD_CORR*/
+    r = cbor_item_next(&rest, &item);
     if (r != EdhocNoError) return r;
-    temp_len -= (next_temp_ptr - temp_ptr);
-    temp_ptr = next_temp_ptr;
+    if (item.type != CborIntegerType || item.int_val < 0 ||
+        item.int_val > 0xff) {
+        return ErrorDuringCborDecoding;
+    }
+    m->method_corr = (uint8_t)item.int_val;
+    PRINT_ARRAY("msg1 METHOD_CORR", &m->method_corr, 1);
 
-    PRINT_ARRAY("msg1 SUITES_I", suites_i, *suites_i_len);
+    /*SUITES_I is a single suite or an array of suites. Suite labels are 
+    small unsigned integers which are encoded as a single byte holding the 
+    label itself, so the view can point into msg1*/
+    uint8_t* suites_start = rest.ptr;
+    r = cbor_item_next(&rest, &item);
+    if (r != EdhocNoError) return r;
+    if (item.type == CborIntegerType && item.int_val >= 0) {
+        m->suites_i.ptr = suites_start;
+        m->suites_i.len = 1;
+    } else if (item.type == CborArrayType && item.len != 0 &&
+               item.len <= rest.len) {
+        m->suites_i.ptr = rest.ptr;
+        m->suites_i.len = (uint32_t)item.len;
+        for (uint32_t i = 0; i < m->suites_i.len; i++) {
+            r = cbor_item_next(&rest, &item);
+            if (r != EdhocNoError) return r;
+            if (item.type != CborIntegerType || item.int_val < 0) {
+                return UnsupportedCipherSuite;
+            }
+        }
+    } else {
+        return ErrorDuringCborDecoding;
+    }
+    if ((uint32_t)(rest.ptr - m->suites_i.ptr) != m->suites_i.len) {
+        return UnsupportedCipherSuite;
+    }
+    PRINT_ARRAY("msg1 SUITES_I", m->suites_i.ptr, m->suites_i.len);
 
-    r = cbor_decoder(
-        &next_temp_ptr, temp_ptr, temp_len,
-        g_x, g_x_len, &ignore);
+    /*G_X*/
+    r = cbor_bstr_next(&rest, &m->g_x);
     if (r != EdhocNoError) return r;
-    temp_len -= (next_temp_ptr - temp_ptr);
-    temp_ptr = next_temp_ptr;
-    PRINT_ARRAY("msg1 G_X", g_x, *g_x_len);
+    PRINT_ARRAY("msg1 G_X", m->g_x.ptr, m->g_x.len);
 
-    r = cbor_decoder(
-        &next_temp_ptr, temp_ptr, temp_len,
-        c_i, c_i_len, &ignore);
+    /*C_I*/
+    r = cbor_bstr_identifier_next(&rest, &m->c_i_single, &m->c_i);
     if (r != EdhocNoError) return r;
+    PRINT_ARRAY("msg1 C_I", m->c_i.ptr, m->c_i.len);
 
-    if (c_i_len[0] == 1) {
-        /*C_I is encoded as bstr_identifier*/
-        int t;
-        uint64_t t_len = sizeof(t);
-        r = cbor_decoder(
-            &next_temp_ptr, temp_ptr, temp_len,
-            &t, &t_len, &ignore);
+    /*AD_1*/
+    if (rest.len) {
+        r = cbor_bstr_next(&rest, &m->ad_1);
         if (r != EdhocNoError) return r;
-        *c_i = t + 24;
+        PRINT_ARRAY("msg1 AD_1", m->ad_1.ptr, m->ad_1.len);
+    } else {
+        m->ad_1 = EMPTY_ARRAY;
     }
-    temp_len -= (next_temp_ptr - temp_ptr);
-    temp_ptr = next_temp_ptr;
-    PRINT_ARRAY("msg1 C_I", c_i, *c_i_len);
+    if (rest.len) return MalformedMessage;
+    return EdhocNoError;
+}
 
-    if (temp_len) {
-        r = cbor_decoder(
-            &next_temp_ptr, temp_ptr, temp_len,
-            ad1, ad1_len, &ignore);
-        if (r != EdhocNoError) return r;
-        temp_len -= (next_temp_ptr - temp_ptr);
-        temp_ptr = next_temp_ptr;
-        PRINT_ARRAY("msg1 AD_1", ad1, *ad1_len);
+/**
+ * @brief   Checks the fields of a parsed message 1 which the responder uses 
+ *          before any key is derived
+ * @param   m the parsed message
+ * @retval  an EdhocError code
+ */
+static inline EdhocError msg1_check(const struct msg_1* m) {
+    if ((m->method_corr >> 2) > INITIATOR_SDHK_RESPONDER_SDHK) {
+        return MalformedMessage;
     }
+    /*G_X is the x-coordinate of P-256 or an X25519 key, both 32 bytes*/
+    if (m->g_x.len != G_X_DEFAULT_SIZE) return InvalidPublicKey;
+    if (m->c_i.len > C_I_DEFAULT_SIZE) return MalformedMessage;
     return EdhocNoError;
 }
 
@@ -133,61 +139,55 @@ static inline bool selected_suite_is_supported(
     return false;
 }
 
+EdhocError edhoc_msg1_prevalidate(uint8_t* msg1, uint32_t msg1_len) {
+    struct msg_1 m;
+    EdhocError r;
+
+    if (msg1_len > MSG_1_DEFAULT_SIZE) return MessageBuffToSmall;
+    r = msg1_parse(msg1, msg1_len, &m);
+    if (r != EdhocNoError) return r;
+    return msg1_check(&m);
+}
+
 /**
- * @brief   Parses message 3
+ * @brief   Parses message 3 in a single pass. The fields of m point into msg3.
  * @param   corr correlation parameter
  * @param   msg3 buffer containing message 3
  * @param   msg3_len length of msg3
- * @param   c_r connection identifier of the responder
- * @param   c_r_len length of c_r
- * @param   ciphertext_3 ciphertext 3
- * @param   ciphertext_3_len length of ciphertext_3
+ * @param   m the parsed message
  */
 static inline EdhocError msg3_parse(
     uint8_t corr,
-    uint8_t* msg3, uint16_t msg3_len,
-    uint8_t* c_r, uint64_t* c_r_len,
-    uint8_t* ciphertext_3, uint64_t* ciphertext_3_len) {
-    uint8_t* temp_ptr = msg3;
-    uint8_t* next_temp_ptr;
-    uint32_t temp_len = msg3_len;
-    CborType cbor_type;
+    uint8_t* msg3, uint32_t msg3_len,
+    struct msg_3* m) {
+    struct byte_array rest = {.ptr = msg3, .len = msg3_len};
+    struct cbor_item item;
     EdhocError r;
 
     if (corr != 2 && corr != 3) {
         /*C_R is present*/
-        if (*c_r_len == 1) {
-            /*C_R is encoded as int*/
-            int buf;
-            r = cbor_decoder(
-                &next_temp_ptr, temp_ptr, temp_len,
-                &buf, c_r_len, &cbor_type);
-            c_r[0] = (uint8_t)buf;
-        } else {
-            r = cbor_decoder(
-                &next_temp_ptr, temp_ptr, temp_len,
-                c_r, c_r_len, &cbor_type);
-        }
+        r = cbor_bstr_identifier_next(&rest, &m->c_r_single, &m->c_r);
         if (r != EdhocNoError) return r;
-        temp_len -= (next_temp_ptr - temp_ptr);
-        temp_ptr = next_temp_ptr;
-        PRINT_ARRAY("msg3 C_R", c_r, *c_r_len);
+        PRINT_ARRAY("msg3 C_R", m->c_r.ptr, m->c_r.len);
+    } else {
+        m->c_r = NULL_ARRAY;
     }
 
-    /*get cyphertext_2 or DIAG_MSG*/
-    r = cbor_decoder(
-        &next_temp_ptr, temp_ptr, temp_len,
-        ciphertext_3, ciphertext_3_len, &cbor_type);
+    /*get cyphertext_3 or DIAG_MSG*/
+    r = cbor_item_next(&rest, &item);
     if (r != EdhocNoError) return r;
-    if (cbor_type == CborTextStringType) {
+    if (item.type == CborTextStringType) {
         /*the error message and message 3 differ in the type of the second 
         element. In the error message the second element is DIAG_MSG : tstr and 
-        in message 2 it is cyphertext_2 : bstr*/
+        in message 3 it is cyphertext_3 : bstr*/
         return ErrorMessageReceived;
     }
-    PRINT_ARRAY("msg3 CIPHERTEXT_3", ciphertext_3, *ciphertext_3_len);
+    if (item.type != CborByteStringType) return UnsupportedCborType;
+    m->ciphertext = item.view;
+    PRINT_ARRAY("msg3 CIPHERTEXT_3", m->ciphertext.ptr, m->ciphertext.len);
+    if (rest.len) return MalformedMessage;
     return EdhocNoError;
-};
+}
 
 /**
  * @brief   Encodes message 2
@@ -246,45 +246,93 @@ static inline EdhocError msg2_encode(
     return EdhocNoError;
 }
 
-EdhocError edhoc_responder_run(
+/**
+ * The state of the responder between message 2 and message 3. Everything 
+ * which depends on message 2 is condensed into TH_3 and PRK_3e2m.
+ */
+struct responder_state {
+    uint8_t suite_label;
+    uint8_t method;
+    uint8_t corr;
+    uint8_t c_i_len;
+    uint8_t c_i[C_I_DEFAULT_SIZE];
+    uint8_t th3[SHA_DEFAULT_SIZE];
+    uint8_t prk_3e2m[PRK_DEFAULT_SIZE];
+    uint8_t y_len; /*0 if the initiator does not authenticate with static DH*/
+    uint8_t y[EPHEMERAL_KEY_DEFAULT_SIZE];
+};
+
+/*size of a serialized struct responder_state, see state_seal()*/
+#define RESPONDER_STATE_SIZE                                         \
+    (4 + C_I_DEFAULT_SIZE + SHA_DEFAULT_SIZE + PRK_DEFAULT_SIZE + 1 + \
+     EPHEMERAL_KEY_DEFAULT_SIZE)
+
+#if EDHOC_STATE_TOKEN_SIZE !=                                   \
+    (1 + EDHOC_STATE_NONCE_SIZE + RESPONDER_STATE_SIZE + \
+     EDHOC_STATE_TAG_SIZE)
+#error "EDHOC_STATE_TOKEN_SIZE does not match struct responder_state"
+#endif
+
+/**
+ * @brief   Sends an error message or, if out is not NULL, encodes it into out
+ *          so that the caller can send it
+ */
+static EdhocError responder_err_msg(
+    struct byte_array* out, uint8_t corr,
+    uint8_t* c_i, uint8_t c_i_len,
+    uint8_t* suites, uint8_t suites_len) {
+    if (out == NULL) {
+        return tx_err_msg(RESPONDER, corr, c_i, c_i_len, NULL, 0,
+                          suites, suites_len);
+    }
+    return err_msg_encode(RESPONDER, corr, c_i, c_i_len, NULL, 0,
+                          suites, suites_len, out->ptr, &out->len);
+}
+
+/**
+ * @brief   Processes message 1 and creates message 2. All buffers which 
+ *          depend on the message sizes are carved from ws.
+ * @param   err_out where an error message is encoded, if NULL error 
+ *          messages are sent with tx()
+ * @param   st the state needed to process message 3
+ * @param   msg2 buffer for message 2
+ * @param   msg2_len in: size of msg2, out: length of message 2
+ */
+static EdhocError msg2_gen(
+    struct edhoc_workspace* ws,
     struct edhoc_responder_context* c,
-    struct other_party_cred* cred_i_array,
-    uint16_t num_cred_i,
-    uint8_t* err_msg, uint32_t* err_msg_len,
+    uint8_t* msg1, uint32_t msg1_len,
     uint8_t* ad_1, uint64_t* ad_1_len,
-    uint8_t* ad_3, uint64_t* ad_3_len,
-    uint8_t* prk_4x3m, uint16_t prk_4x3m_len,
-    uint8_t* th4, uint16_t th4_len) {
+    struct byte_array* err_out,
+    struct responder_state* st,
+    uint8_t* msg2, uint32_t* msg2_len) {
     EdhocError r;
-    /******************** receive and process message 1 ***********************/
-    uint8_t msg1[MSG_1_DEFAULT_SIZE];
-    uint32_t msg1_len = sizeof(msg1);
+    TRACE_DECLARE(tr, RESPONDER, EDHOC_TRACE_METHOD_UNKNOWN, c);
+    PRINT_ARRAY("message_1 (CBOR Sequence)", msg1, msg1_len);
 
-    r = rx(msg1, &msg1_len);
+    struct msg_1 m1;
+    TRACE_BEGIN(tr, EDHOC_PHASE_DECODE);
+    r = msg1_parse(msg1, msg1_len, &m1);
+    if (r == EdhocNoError) r = msg1_check(&m1);
+    TRACE_END(tr, EDHOC_PHASE_DECODE, msg1_len, r);
     if (r != EdhocNoError) return r;
-    PRINT_ARRAY("message_1 (CBOR Sequence)", msg1, msg1_len);
 
-    uint8_t method_corr;
-    uint8_t suites_i[5];
-    uint64_t suites_i_len = sizeof(suites_i);
-    uint8_t g_x[G_X_DEFAULT_SIZE];
-    uint64_t g_x_len = sizeof(g_x);
-    uint8_t c_i[C_I_DEFAULT_SIZE];
-    uint64_t c_i_len = sizeof(c_i);
-
-    r = msg1_parse(
-        msg1, msg1_len, &method_corr,
-        suites_i, &suites_i_len,
-        g_x, &g_x_len,
-        c_i, &c_i_len,
-        ad_1, ad_1_len);
+    /*AD_1 is handed to the caller*/
+    r = _memcpy_s(ad_1, *ad_1_len, m1.ad_1.ptr, m1.ad_1.len);
     if (r != EdhocNoError) return r;
+    *ad_1_len = m1.ad_1.len;
+
+    uint8_t method_corr = m1.method_corr;
+    uint8_t* suites_i = m1.suites_i.ptr;
+    uint8_t* g_x = m1.g_x.ptr;
+    uint32_t g_x_len = m1.g_x.len;
+    uint8_t* c_i = m1.c_i.ptr;
+    uint32_t c_i_len = m1.c_i.len;
 
     if (!(selected_suite_is_supported(suites_i[0], &c->suites_r))) {
-        r = tx_err_msg(
-            RESPONDER, method_corr,
+        r = responder_err_msg(
+            err_out, method_corr,
             c_i, c_i_len,
-            NULL, 0,
             c->suites_r.ptr, c->suites_r.len);
         if (r != EdhocNoError) return r;
 
@@ -294,6 +342,7 @@ EdhocError edhoc_responder_run(
 
     /*get the method*/
     enum method_type method = method_corr >> 2;
+    TRACE_METHOD(tr, method);
     /*get corr*/
     uint8_t corr = method_corr - 4 * method;
     /*get cipher suite*/
@@ -301,9 +350,36 @@ EdhocError edhoc_responder_run(
     r = get_suite((enum suite_label)suites_i[0], &suite);
     if (r != EdhocNoError) return r;
 
+    /*msg1 is the first part of the input of th2*/
+    struct hash_state th2_state;
+    TRACE_BEGIN(tr, EDHOC_PHASE_TH);
+    r = th2_init(suite.edhoc_hash, msg1, msg1_len, &th2_state);
+    TRACE_END(tr, EDHOC_PHASE_TH, msg1_len, r);
+    if (r != EdhocNoError) return r;
+
     bool static_dh_i, static_dh_r;
     authentication_type_get(method, &static_dh_i, &static_dh_r);
 
+    /*ephemeral DH key pair, taken from the key pool if the caller set one*/
+    struct byte_array y = c->y;
+    struct byte_array g_y = c->g_y;
+    uint8_t y_buf[EPHEMERAL_KEY_DEFAULT_SIZE];
+    uint8_t g_y_buf[EPHEMERAL_KEY_DEFAULT_SIZE];
+    /*y_buf, g_xy and PRK_2e are secret and erased at out on every exit*/
+    uint8_t g_xy[ECDH_SECRET_DEFAULT_SIZE];
+    uint8_t PRK_2e[PRK_DEFAULT_SIZE];
+    if (c->key_pool != NULL) {
+        r = ephemeral_key_pool_take(
+            c->key_pool, suite.edhoc_ecdh_curve,
+            y_buf, sizeof(y_buf),
+            g_y_buf, sizeof(g_y_buf));
+        if (r != EdhocNoError) goto out;
+        y.ptr = y_buf;
+        y.len = sizeof(y_buf);
+        g_y.ptr = g_y_buf;
+        g_y.len = sizeof(g_y_buf);
+    }
+
     /*********************** create and send message 2*************************/
 
     uint8_t th2[SHA_DEFAULT_SIZE];
@@ -314,132 +390,206 @@ EdhocError edhoc_responder_run(
         tmp_c_i_len = c_i_len;
     }
 
-    r = th2_calculate(
-        suite.edhoc_hash,
-        msg1, msg1_len,
+    TRACE_BEGIN(tr, EDHOC_PHASE_TH);
+    r = th2_final(
+        &th2_state,
         c_i, tmp_c_i_len,
-        c->g_y.ptr, c->g_y.len,
+        g_y.ptr, g_y.len,
         c->c_r.ptr, c->c_r.len,
         th2);
-    if (r != EdhocNoError) return r;
+    TRACE_END(tr, EDHOC_PHASE_TH, sizeof(th2), r);
+    if (r != EdhocNoError) goto out;
 
     /*calculate the DH shared secret*/
-    uint8_t g_xy[ECDH_SECRET_DEFAULT_SIZE];
+    TRACE_BEGIN(tr, EDHOC_PHASE_DH);
     r = shared_secret_derive(
         suite.edhoc_ecdh_curve,
-        c->y.ptr, c->y.len,
+        y.ptr, y.len,
         g_x, g_x_len,
         g_xy);
-    if (r != EdhocNoError) return r;
+    TRACE_END(tr, EDHOC_PHASE_DH, sizeof(g_xy), r);
+    if (r != EdhocNoError) goto out;
     PRINT_ARRAY("G_XY (ECDH shared secret) ", g_xy, sizeof(g_xy));
 
-    uint8_t PRK_3e2m[PRK_DEFAULT_SIZE];
-    uint8_t ciphertext_2[CIPHERTEXT2_DEFAULT_SIZE];
-    uint32_t ciphertext_2_len = sizeof(ciphertext_2);
-
-    uint8_t PRK_2e[PRK_DEFAULT_SIZE];
+    TRACE_BEGIN(tr, EDHOC_PHASE_KDF);
     r = hkdf_extract(suite.edhoc_hash, NULL, 0, g_xy, sizeof(g_xy), PRK_2e);
-    if (r != EdhocNoError) return r;
+    TRACE_END(tr, EDHOC_PHASE_KDF, sizeof(PRK_2e), r);
+    if (r != EdhocNoError) goto out;
     PRINT_ARRAY("PRK_2e", PRK_2e, sizeof(PRK_2e));
 
     /*derive prk_3e2m*/
+    TRACE_BEGIN(tr, static_dh_r ? EDHOC_PHASE_DH : EDHOC_PHASE_KDF);
     r = prk_derive(
         static_dh_r, suite,
         PRK_2e, sizeof(PRK_2e),
         g_x, g_x_len,
         c->r.ptr, c->r.len,
-        PRK_3e2m);
-    if (r != EdhocNoError) return r;
-    PRINT_ARRAY("prk_3e2m", PRK_3e2m, sizeof(PRK_3e2m));
+        st->prk_3e2m);
+    TRACE_END(tr, static_dh_r ? EDHOC_PHASE_DH : EDHOC_PHASE_KDF,
+              sizeof(st->prk_3e2m), r);
+    if (r != EdhocNoError) goto out;
+    PRINT_ARRAY("prk_3e2m", st->prk_3e2m, sizeof(st->prk_3e2m));
 
-    uint8_t m_2[A_2M_DEFAULT_SIZE];
-    uint16_t m_2_len = sizeof(m_2);
+    uint8_t* m_2;
+    r = workspace_alloc(ws, A_2M_DEFAULT_SIZE, &m_2);
+    if (r != EdhocNoError) goto out;
+    uint16_t m_2_len = A_2M_DEFAULT_SIZE;
     uint8_t sign_or_mac_2[64];
     uint32_t sign_or_mac_2_len = sizeof(sign_or_mac_2);
+    TRACE_BEGIN(tr, EDHOC_PHASE_MAC);
     r = signature_or_mac_msg_create(
         static_dh_r, suite, "K_2m", "IV_2m",
-        (uint8_t*)&PRK_3e2m, sizeof(PRK_3e2m),
+        st->prk_3e2m, sizeof(st->prk_3e2m),
         (uint8_t*)&th2, sizeof(th2),
         c->id_cred_r.ptr, c->id_cred_r.len,
         c->cred_r.ptr, c->cred_r.len,
         c->ad_2.ptr, c->ad_2.len,
         m_2, &m_2_len,
         sign_or_mac_2, (uint8_t*)&sign_or_mac_2_len);
-    if (r != EdhocNoError) return r;
+    TRACE_END(tr, EDHOC_PHASE_MAC, m_2_len, r);
+    if (r != EdhocNoError) goto out;
 
     /*Signature_or_mac_2*/
     if (!static_dh_r) {
         /*Calculate a signature*/
         sign_or_mac_2_len = 64;
+        TRACE_BEGIN(tr, EDHOC_PHASE_SIGN);
         r = sign(
             suite.edhoc_sign_curve,
             c->sk_r.ptr, c->sk_r.len,
             c->pk_r.ptr, c->pk_r.len,
             m_2, m_2_len,
             sign_or_mac_2, &sign_or_mac_2_len);
-        if (r != EdhocNoError) return r;
+        TRACE_END(tr, EDHOC_PHASE_SIGN, m_2_len, r);
+        if (r != EdhocNoError) goto out;
         PRINT_ARRAY("Signature_or_MAC_2", sign_or_mac_2, sign_or_mac_2_len);
     }
 
     /*Calculate P_2e*/
     uint16_t P_2e_len = c->id_cred_r.len + sign_or_mac_2_len + 2 + c->ad_2.len;
-    uint8_t P_2e[P_2e_len];
+    if (P_2e_len > CIPHERTEXT2_DEFAULT_SIZE) {
+        r = DestBufferToSmall;
+        goto out;
+    }
+    uint8_t* P_2e;
+    r = workspace_alloc(ws, P_2e_len, &P_2e);
+    if (r != EdhocNoError) goto out;
 
+    TRACE_BEGIN(tr, EDHOC_PHASE_ENCODE);
     r = plaintext_encode(
         c->id_cred_r.ptr, c->id_cred_r.len,
         sign_or_mac_2, sign_or_mac_2_len,
         c->ad_2.ptr, c->ad_2.len,
         P_2e, &P_2e_len);
-    if (r != EdhocNoError) return r;
+    TRACE_END(tr, EDHOC_PHASE_ENCODE, P_2e_len, r);
+    if (r != EdhocNoError) goto out;
     PRINT_ARRAY("P_2e", P_2e, P_2e_len);
 
     /*Calculate K_2e*/
-    uint8_t K_2e[P_2e_len];
+    uint8_t* K_2e;
+    r = workspace_alloc(ws, P_2e_len, &K_2e);
+    if (r != EdhocNoError) goto out;
+    TRACE_BEGIN(tr, EDHOC_PHASE_KDF);
     r = okm_calc(
         suite.edhoc_aead, suite.edhoc_hash, "K_2e",
         (uint8_t*)&PRK_2e, sizeof(PRK_2e),
         (uint8_t*)&th2, sizeof(th2),
-        K_2e, sizeof(K_2e));
-    if (r != EdhocNoError) return r;
-    PRINT_ARRAY("K_2e", K_2e, sizeof(K_2e));
+        K_2e, P_2e_len);
+    TRACE_END(tr, EDHOC_PHASE_KDF, P_2e_len, r);
+    if (r != EdhocNoError) goto out;
+    PRINT_ARRAY("K_2e", K_2e, P_2e_len);
 
     /*Ciphertext 2 calculate*/
-    ciphertext_2_len = P_2e_len;
+    uint32_t ciphertext_2_len = P_2e_len;
+    uint8_t* ciphertext_2;
+    r = workspace_alloc(ws, ciphertext_2_len, &ciphertext_2);
+    if (r != EdhocNoError) goto out;
     for (uint16_t i = 0; i < P_2e_len; i++) {
         ciphertext_2[i] = P_2e[i] ^ K_2e[i];
     }
     PRINT_ARRAY("ciphertext_2", ciphertext_2, ciphertext_2_len);
 
-    /*message 2 create and send*/
-    uint8_t msg2[MSG_2_DEFAULT_SIZE];
-    uint32_t msg2_len = sizeof(msg2);
+    /*message 2 create*/
+    TRACE_BEGIN(tr, EDHOC_PHASE_ENCODE);
     r = msg2_encode(
         corr,
         c_i, c_i_len,
-        c->g_y.ptr, c->g_y.len,
+        g_y.ptr, g_y.len,
         c->c_r.ptr, c->c_r.len,
         ciphertext_2, ciphertext_2_len,
-        msg2, &msg2_len);
-    if (r != EdhocNoError) return r;
-    r = tx(msg2, msg2_len);
-    if (r != EdhocNoError) return r;
+        msg2, msg2_len);
+    TRACE_END(tr, EDHOC_PHASE_ENCODE, r == EdhocNoError ? *msg2_len : 0, r);
+    if (r != EdhocNoError) goto out;
 
-    /********message 3 receive and process*********************************/
-    uint8_t msg3[MSG_3_DEFAULT_SIZE];
-    uint32_t msg3_len = sizeof(msg3);
-    r = rx(msg3, &msg3_len);
-    if (r != EdhocNoError) return r;
+    /*TH_3 does not depend on message 3, so that message 2 is not needed 
+    anymore when message 3 arrives*/
+    TRACE_BEGIN(tr, EDHOC_PHASE_TH);
+    r = th3_calculate(
+        suite.edhoc_hash,
+        (uint8_t*)&th2, sizeof(th2),
+        ciphertext_2, ciphertext_2_len,
+        c->c_r.ptr, c->c_r.len,
+        st->th3);
+    TRACE_END(tr, EDHOC_PHASE_TH, sizeof(st->th3), r);
+    if (r != EdhocNoError) goto out;
 
-    uint8_t c_r[c->c_r.len];
-    uint64_t c_r_len = sizeof(c_r);
-    uint8_t ciphertext_3[CIPHERTEXT3_DEFAULT_SIZE];
-    uint64_t ciphertext_3_len = sizeof(ciphertext_3);
+    st->suite_label = suites_i[0];
+    st->method = method;
+    st->corr = corr;
+    st->c_i_len = (uint8_t)c_i_len;
+    memcpy(st->c_i, c_i, c_i_len);
+    st->y_len = 0;
+    if (static_dh_i) {
+        if (y.len > sizeof(st->y)) {
+            r = DestBufferToSmall;
+            goto out;
+        }
+        memcpy(st->y, y.ptr, y.len);
+        st->y_len = (uint8_t)y.len;
+    }
+out:
+    memset(y_buf, 0, sizeof(y_buf));
+    memset(g_xy, 0, sizeof(g_xy));
+    memset(PRK_2e, 0, sizeof(PRK_2e));
+    return r;
+}
 
-    r = msg3_parse(
-        corr,
-        msg3, msg3_len,
-        c_r, &c_r_len,
-        ciphertext_3, &ciphertext_3_len);
+/**
+ * @brief   Processes message 3 with the state kept since message 2. All 
+ *          buffers which depend on the message sizes are carved from ws.
+ * @param   st the state returned by msg2_gen()
+ * @param   err_out where an error message is encoded, if NULL error 
+ *          messages are sent with tx()
+ */
+static EdhocError msg3_process(
+    struct edhoc_workspace* ws,
+    struct edhoc_responder_context* c,
+    const struct responder_state* st,
+    struct other_party_cred* cred_i_array,
+    uint16_t num_cred_i,
+    uint8_t* msg3, uint32_t msg3_len,
+    uint8_t* err_msg, uint32_t* err_msg_len,
+    struct byte_array* err_out,
+    uint8_t* ad_3, uint64_t* ad_3_len,
+    uint8_t* prk_4x3m, uint16_t prk_4x3m_len,
+    uint8_t* th4, uint16_t th4_len) {
+    EdhocError r;
+    uint8_t corr = st->corr;
+    uint8_t* c_i = (uint8_t*)st->c_i;
+    uint8_t c_i_len = st->c_i_len;
+    const uint8_t* th3 = st->th3;
+    TRACE_DECLARE(tr, RESPONDER, st->method, c);
+
+    struct suite suite;
+    r = get_suite((enum suite_label)st->suite_label, &suite);
+    if (r != EdhocNoError) return r;
+    bool static_dh_i, static_dh_r;
+    authentication_type_get((enum method_type)st->method, &static_dh_i, &static_dh_r);
+
+    struct msg_3 m3;
+    TRACE_BEGIN(tr, EDHOC_PHASE_DECODE);
+    r = msg3_parse(corr, msg3, msg3_len, &m3);
+    TRACE_END(tr, EDHOC_PHASE_DECODE, msg3_len, r);
     if (r == ErrorMessageReceived) {
         /*provide the error message to the caller*/;
         r = _memcpy_s(err_msg, *err_msg_len, msg3, msg3_len);
@@ -448,41 +598,31 @@ EdhocError edhoc_responder_run(
         return ErrorMessageReceived;
     }
     if (r != EdhocNoError) return r;
-
-    uint8_t th3[32];
-    r = th3_calculate(
-        suite.edhoc_hash,
-        (uint8_t*)&th2, sizeof(th2),
-        ciphertext_2, ciphertext_2_len,
-        c->c_r.ptr, c->c_r.len,
-        th3);
-    if (r != EdhocNoError) return r;
+    uint8_t* ciphertext_3 = m3.ciphertext.ptr;
+    uint32_t ciphertext_3_len = m3.ciphertext.len;
 
     uint8_t K_3ae[AEAD_KEY_DEFAULT_SIZE];
     uint8_t IV_3ae[AEAD_IV_DEFAULT_SIZE];
 
-    /*Calculate K_3ae*/
-    r = okm_calc(
-        suite.edhoc_aead, suite.edhoc_hash, "K_3ae",
-        PRK_3e2m, sizeof(PRK_3e2m),
-        (uint8_t*)&th3, sizeof(th3),
-        K_3ae, sizeof(K_3ae));
-    if (r != EdhocNoError) return r;
-    PRINT_ARRAY("K_3ae", K_3ae, sizeof(K_3ae));
-
-    /*Calculate IV_3ae*/
-    r = okm_calc(
-        suite.edhoc_aead, suite.edhoc_hash, "IV_3ae",
-        PRK_3e2m, sizeof(PRK_3e2m),
-        (uint8_t*)&th3, sizeof(th3),
+    /*Calculate K_3ae and IV_3ae*/
+    TRACE_BEGIN(tr, EDHOC_PHASE_KDF);
+    r = okm_key_iv_calc(
+        suite.edhoc_aead, suite.edhoc_hash, "K_3ae", "IV_3ae",
+        (uint8_t*)st->prk_3e2m, sizeof(st->prk_3e2m),
+        (uint8_t*)th3, SHA_DEFAULT_SIZE,
+        K_3ae, sizeof(K_3ae),
         IV_3ae, sizeof(IV_3ae));
+    TRACE_END(tr, EDHOC_PHASE_KDF, sizeof(K_3ae) + sizeof(IV_3ae), r);
     if (r != EdhocNoError) return r;
+    PRINT_ARRAY("K_3ae", K_3ae, sizeof(K_3ae));
     PRINT_ARRAY("IV_3ae", IV_3ae, sizeof(IV_3ae));
 
     /*Associated data A_3ae*/
-    uint8_t A_3ae[A_3AE_DEFAULT_SIZE];
-    uint32_t A_3ae_len = sizeof(A_3ae);
-    r = a_Xae_encode(th3, sizeof(th3), (uint8_t*)&A_3ae, &A_3ae_len);
+    uint8_t* A_3ae;
+    r = workspace_alloc(ws, A_3AE_DEFAULT_SIZE, &A_3ae);
+    if (r != EdhocNoError) return r;
+    uint32_t A_3ae_len = A_3AE_DEFAULT_SIZE;
+    r = a_Xae_encode((uint8_t*)th3, SHA_DEFAULT_SIZE, A_3ae, &A_3ae_len);
     if (r != EdhocNoError) return r;
 
     uint8_t tag[16];
@@ -492,33 +632,46 @@ EdhocError edhoc_responder_run(
     } else {
         mac_len = 16;
     }
-    uint8_t P_3ae[ciphertext_3_len - mac_len];
+    if (ciphertext_3_len < mac_len) return ErrorDuringAEAD;
+    uint32_t P_3ae_len = ciphertext_3_len - mac_len;
+    uint8_t* P_3ae;
+    r = workspace_alloc(ws, P_3ae_len, &P_3ae);
+    if (r != EdhocNoError) return r;
     //memcpy(tag, &ciphertext_3[ciphertext_3_len - mac_len], mac_len);
     r = _memcpy_s(tag, sizeof(tag), &ciphertext_3[ciphertext_3_len - mac_len], mac_len);
     if (r != EdhocNoError) return r;
+    TRACE_BEGIN(tr, EDHOC_PHASE_AEAD);
     r = aead(DECRYPT,
              ciphertext_3, ciphertext_3_len,
              K_3ae, sizeof(K_3ae),
              IV_3ae, sizeof(IV_3ae),
              A_3ae, A_3ae_len,
-             P_3ae, sizeof(P_3ae),
+             P_3ae, P_3ae_len,
              tag, mac_len);
+    TRACE_END(tr, EDHOC_PHASE_AEAD, ciphertext_3_len, r);
     if (r != EdhocNoError) return r;
-    PRINT_ARRAY("P_3ae", P_3ae, sizeof(P_3ae));
+    PRINT_ARRAY("P_3ae", P_3ae, P_3ae_len);
 
-    uint8_t id_cred_i[ID_CRED_DEFAULT_SIZE];
-    uint64_t id_cred_i_len = sizeof(id_cred_i);
-    uint8_t sign_or_mac[SGN_OR_MAC_DEFAULT_SIZE];
-    uint64_t sign_or_mac_len = sizeof(sign_or_mac);
+    uint8_t* id_cred_i;
+    r = workspace_alloc(ws, ID_CRED_DEFAULT_SIZE, &id_cred_i);
+    if (r != EdhocNoError) return r;
+    uint64_t id_cred_i_len = ID_CRED_DEFAULT_SIZE;
+    struct byte_array sign_or_mac, ad_3_view;
+    TRACE_BEGIN(tr, EDHOC_PHASE_DECODE);
     r = plaintext_split(
-        P_3ae, sizeof(P_3ae),
+        P_3ae, P_3ae_len,
         id_cred_i, &id_cred_i_len,
-        sign_or_mac, &sign_or_mac_len,
-        ad_3, ad_3_len);
+        &sign_or_mac, &ad_3_view);
+    TRACE_END(tr, EDHOC_PHASE_DECODE, P_3ae_len, r);
     if (r != EdhocNoError) return r;
 
     PRINT_ARRAY("ID_CRED_I", id_cred_i, id_cred_i_len);
-    PRINT_ARRAY("sign_or_mac", sign_or_mac, sign_or_mac_len);
+    PRINT_ARRAY("sign_or_mac", sign_or_mac.ptr, sign_or_mac.len);
+
+    /*AD_3 is handed to the caller*/
+    r = _memcpy_s(ad_3, *ad_3_len, ad_3_view.ptr, ad_3_view.len);
+    if (r != EdhocNoError) return r;
+    *ad_3_len = ad_3_view.len;
     if (*ad_3_len) {
         PRINT_ARRAY("AD_3", ad_3, *ad_3_len);
     }
@@ -531,48 +684,58 @@ EdhocError edhoc_responder_run(
     uint8_t* g_i;
     uint16_t g_i_len = 0;
 
+    TRACE_BEGIN(tr, EDHOC_PHASE_CRED);
     r = retrieve_cred(
-        static_dh_i,
+        static_dh_i, c->trust_anchors, c->revoked,
         cred_i_array, num_cred_i,
         id_cred_i, id_cred_i_len,
         &cred_i, &cred_i_len,
         &pk, &pk_len,
         &g_i, &g_i_len);
+    TRACE_END(tr, EDHOC_PHASE_CRED, r == EdhocNoError ? cred_i_len : 0, r);
     if (r != EdhocNoError) return r;
     PRINT_ARRAY("CRED_I", cred_i, cred_i_len);
     PRINT_ARRAY("pk", pk, pk_len);
     PRINT_ARRAY("g_i", g_i, g_i_len);
 
     /*derive prk_4x3m*/
+    TRACE_BEGIN(tr, static_dh_i ? EDHOC_PHASE_DH : EDHOC_PHASE_KDF);
     r = prk_derive(
         static_dh_i, suite,
-        (uint8_t*)&PRK_3e2m, sizeof(PRK_3e2m),
+        (uint8_t*)st->prk_3e2m, sizeof(st->prk_3e2m),
         g_i, g_i_len,
-        c->y.ptr, c->y.len,
+        (uint8_t*)st->y, st->y_len,
         prk_4x3m);
+    TRACE_END(tr, static_dh_i ? EDHOC_PHASE_DH : EDHOC_PHASE_KDF,
+              prk_4x3m_len, r);
     if (r != EdhocNoError) return r;
     PRINT_ARRAY("prk_4x3m", prk_4x3m, prk_4x3m_len);
 
-    uint8_t m_3[A_2M_DEFAULT_SIZE];
-    uint16_t m_3_len = sizeof(m_3);
+    uint8_t* m_3;
+    r = workspace_alloc(ws, A_2M_DEFAULT_SIZE, &m_3);
+    if (r != EdhocNoError) return r;
+    uint16_t m_3_len = A_2M_DEFAULT_SIZE;
     uint8_t mac_3[16];
     uint8_t mac_3_len = sizeof(mac_3);
+    TRACE_BEGIN(tr, EDHOC_PHASE_MAC);
     r = signature_or_mac_msg_create(
         static_dh_i, suite, "K_3m", "IV_3m",
         prk_4x3m, prk_4x3m_len,
-        (uint8_t*)&th3, sizeof(th3),
+        (uint8_t*)th3, SHA_DEFAULT_SIZE,
         id_cred_i, id_cred_i_len,
         cred_i, cred_i_len,
         ad_3, *ad_3_len,
         m_3, &m_3_len,
         mac_3, &mac_3_len);
+    TRACE_END(tr, EDHOC_PHASE_MAC, m_3_len, r);
     if (r != EdhocNoError) return r;
 
     if (static_dh_i) {
         /*check inner mac MAC_3*/
-        if (0 != memcmp(mac_3, sign_or_mac, mac_3_len)) {
+        if (sign_or_mac.len != mac_3_len ||
+            0 != memcmp(mac_3, sign_or_mac.ptr, mac_3_len)) {
             PRINT_MSG("Initiator authentication failed!");
-            r = tx_err_msg(RESPONDER, corr, c_i, c_i_len, NULL, 0, NULL, 0);
+            r = responder_err_msg(err_out, corr, c_i, c_i_len, NULL, 0);
             if (r != EdhocNoError) return r;
             return ResponderAuthenticationFailed;
         } else {
@@ -581,22 +744,576 @@ EdhocError edhoc_responder_run(
     } else {
         /*the initiator authenticates with a signature*/
         bool verified = false;
+        TRACE_BEGIN(tr, EDHOC_PHASE_VERIFY);
         r = verify(
             suite.edhoc_sign_curve,
             pk, pk_len,
-            (uint8_t*)&m_3, m_3_len,
-            (uint8_t*)&sign_or_mac, sign_or_mac_len,
+            m_3, m_3_len,
+            sign_or_mac.ptr, sign_or_mac.len,
             &verified);
+        TRACE_END(tr, EDHOC_PHASE_VERIFY, m_3_len, r);
         if (verified) {
             PRINT_MSG("Initiator authentication successful!\n");
         } else {
             PRINT_MSG("Initiator authentication failed!\n");
-            r = tx_err_msg(RESPONDER, corr, c_i, c_i_len, NULL, 0, NULL, 0);
+            r = responder_err_msg(err_out, corr, c_i, c_i_len, NULL, 0);
             if (r != EdhocNoError) return r;
             return ResponderAuthenticationFailed;
         }
     }
 
     /*TH4*/
-    return th4_calculate(suite.edhoc_hash, th3, sizeof(th3), ciphertext_3, ciphertext_3_len, th4);
+    TRACE_BEGIN(tr, EDHOC_PHASE_TH);
+    r = th4_calculate(suite.edhoc_hash, (uint8_t*)th3, SHA_DEFAULT_SIZE, ciphertext_3, ciphertext_3_len, th4);
+    TRACE_END(tr, EDHOC_PHASE_TH, th4_len, r);
+    return r;
+}
+
+/**
+ * @brief   Executes the responder side of the protocol, see 
+ *          edhoc_responder_run(). All buffers which depend on the 
+ *          message sizes are carved from ws.
+ */
+static EdhocError responder_run(
+    struct edhoc_workspace* ws,
+    struct edhoc_responder_context* c,
+    struct other_party_cred* cred_i_array,
+    uint16_t num_cred_i,
+    uint8_t* err_msg, uint32_t* err_msg_len,
+    uint8_t* ad_1, uint64_t* ad_1_len,
+    uint8_t* ad_3, uint64_t* ad_3_len,
+    uint8_t* prk_4x3m, uint16_t prk_4x3m_len,
+    uint8_t* th4, uint16_t th4_len) {
+    EdhocError r;
+    struct responder_state st;
+    TRACE_DECLARE(tr, RESPONDER, EDHOC_TRACE_METHOD_UNKNOWN, c);
+
+    TRACE_BEGIN(tr, EDHOC_PHASE_HANDSHAKE);
+    /******************** receive and process message 1 ***********************/
+    uint8_t* msg1;
+    r = workspace_alloc(ws, MSG_1_DEFAULT_SIZE, &msg1);
+    if (r != EdhocNoError) goto out;
+    uint32_t msg1_len = MSG_1_DEFAULT_SIZE;
+
+    TRACE_BEGIN(tr, EDHOC_PHASE_RX);
+    r = rx(msg1, &msg1_len);
+    TRACE_END(tr, EDHOC_PHASE_RX, r == EdhocNoError ? msg1_len : 0, r);
+    if (r != EdhocNoError) goto out;
+
+    /*********************** create and send message 2*************************/
+    uint8_t* msg2;
+    r = workspace_alloc(ws, MSG_2_DEFAULT_SIZE, &msg2);
+    if (r != EdhocNoError) goto out;
+    uint32_t msg2_len = MSG_2_DEFAULT_SIZE;
+    r = msg2_gen(ws, c, msg1, msg1_len, ad_1, ad_1_len, NULL,
+                 &st, msg2, &msg2_len);
+    if (r != EdhocNoError) goto out;
+    TRACE_METHOD(tr, st.method);
+    TRACE_BEGIN(tr, EDHOC_PHASE_TX);
+    r = tx(msg2, msg2_len);
+    TRACE_END(tr, EDHOC_PHASE_TX, msg2_len, r);
+    if (r != EdhocNoError) goto out;
+
+    /********message 3 receive and process*********************************/
+    uint8_t* msg3;
+    r = workspace_alloc(ws, MSG_3_DEFAULT_SIZE, &msg3);
+    if (r != EdhocNoError) goto out;
+    uint32_t msg3_len = MSG_3_DEFAULT_SIZE;
+    TRACE_BEGIN(tr, EDHOC_PHASE_RX);
+    r = rx(msg3, &msg3_len);
+    TRACE_END(tr, EDHOC_PHASE_RX, r == EdhocNoError ? msg3_len : 0, r);
+    if (r != EdhocNoError) goto out;
+
+    r = msg3_process(ws, c, &st, cred_i_array, num_cred_i, msg3, msg3_len,
+                     err_msg, err_msg_len, NULL, ad_3, ad_3_len,
+                     prk_4x3m, prk_4x3m_len, th4, th4_len);
+out:
+    TRACE_END(tr, EDHOC_PHASE_HANDSHAKE, 0, r);
+    memset(&st, 0, sizeof(st));
+    return r;
+}
+
+/*
+ * keys->epoch holds the current epoch in the low byte and STATE_PREVIOUS_VALID
+ * if tokens of the previous epoch are accepted. The key and the slots of 
+ * epoch e are read only under a reference, see epoch_get(). 
+ * edhoc_state_keys_rotate() clears STATE_PREVIOUS_VALID, waits until the 
+ * references of the previous epoch are dropped and then reuses its key and 
+ * slots. Taking a reference and retiring an epoch are sequentially 
+ * consistent: either the rotation sees the reference or the handshake sees 
+ * the epoch retired.
+ */
+#define STATE_EPOCH_MASK 0xff
+#define STATE_PREVIOUS_VALID 0x100
+
+static inline bool epoch_accepted(uint32_t state, uint8_t e) {
+    return e == (uint8_t)state ||
+           ((state & STATE_PREVIOUS_VALID) && e == (uint8_t)(state - 1));
+}
+
+/**
+ * @brief   Takes a reference on the key and the slots of an epoch
+ * @param   keys the local state keys
+ * @param   e the epoch
+ * @retval  the index of the key and the slots of e, -1 if tokens of e are 
+ *          not accepted
+ */
+static int epoch_get(struct edhoc_state_keys* keys, uint8_t e) {
+    int i = e & 1;
+
+    if (!epoch_accepted(__atomic_load_n(&keys->epoch, __ATOMIC_SEQ_CST), e)) {
+        return -1;
+    }
+    __atomic_add_fetch(&keys->readers[i], 1, __ATOMIC_SEQ_CST);
+    /*a rotation may have retired e before the reference was taken*/
+    if (!epoch_accepted(__atomic_load_n(&keys->epoch, __ATOMIC_SEQ_CST), e)) {
+        __atomic_sub_fetch(&keys->readers[i], 1, __ATOMIC_RELEASE);
+        return -1;
+    }
+    return i;
+}
+
+static inline void epoch_put(struct edhoc_state_keys* keys, int i) {
+    __atomic_sub_fetch(&keys->readers[i], 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief   Serializes and encrypts the responder state into a state token
+ * @param   keys the local state keys, the current key is used
+ * @param   st the state
+ * @param   token buffer of EDHOC_STATE_TOKEN_SIZE bytes
+ */
+static EdhocError state_seal(
+    struct edhoc_state_keys* keys,
+    const struct responder_state* st,
+    uint8_t* token) {
+    uint8_t p[RESPONDER_STATE_SIZE];
+    uint8_t tag[EDHOC_STATE_TAG_SIZE];
+    uint8_t key[AEAD_KEY_DEFAULT_SIZE];
+    uint8_t* q = p;
+    uint8_t e;
+    int i;
+    EdhocError r;
+
+    *q++ = st->suite_label;
+    *q++ = st->method;
+    *q++ = st->corr;
+    *q++ = st->c_i_len;
+    memcpy(q, st->c_i, sizeof(st->c_i));
+    q += sizeof(st->c_i);
+    memcpy(q, st->th3, sizeof(st->th3));
+    q += sizeof(st->th3);
+    memcpy(q, st->prk_3e2m, sizeof(st->prk_3e2m));
+    q += sizeof(st->prk_3e2m);
+    *q++ = st->y_len;
+    memcpy(q, st->y, sizeof(st->y));
+
+    /*the current epoch, it fails only if two rotations passed meanwhile*/
+    do {
+        e = (uint8_t)__atomic_load_n(&keys->epoch, __ATOMIC_SEQ_CST);
+        i = epoch_get(keys, e);
+    } while (i < 0);
+    memcpy(key, keys->key[i], sizeof(key));
+    epoch_put(keys, i);
+
+    /*epoch || nonce || ciphertext || tag, the epoch is authenticated as 
+    associated data*/
+    token[0] = e;
+    r = random_bytes(token + 1, EDHOC_STATE_NONCE_SIZE);
+    if (r != EdhocNoError) goto out;
+    r = aead(ENCRYPT,
+             p, sizeof(p),
+             key, AEAD_KEY_DEFAULT_SIZE,
+             token + 1, EDHOC_STATE_NONCE_SIZE,
+             token, 1,
+             token + 1 + EDHOC_STATE_NONCE_SIZE, sizeof(p) + sizeof(tag),
+             tag, sizeof(tag));
+out:
+    memset(p, 0, sizeof(p));
+    memset(key, 0, sizeof(key));
+    return r;
+}
+
+/**
+ * @brief   Decrypts a state token. Tokens of the current and the previous 
+ *          key epoch are accepted.
+ * @param   keys the local state keys
+ * @param   token the state token
+ * @param   token_len length of token
+ * @param   st the state
+ */
+static EdhocError state_open(
+    struct edhoc_state_keys* keys,
+    const uint8_t* token, uint32_t token_len,
+    struct responder_state* st) {
+    uint8_t p[RESPONDER_STATE_SIZE];
+    uint8_t nonce[EDHOC_STATE_NONCE_SIZE];
+    uint8_t tag[EDHOC_STATE_TAG_SIZE];
+    uint8_t key[AEAD_KEY_DEFAULT_SIZE];
+    const uint8_t* q = p;
+    int i;
+    EdhocError r;
+
+    if (token_len != EDHOC_STATE_TOKEN_SIZE) return InvalidStateToken;
+    i = epoch_get(keys, token[0]);
+    if (i < 0) {
+        /*sealed with a key which was rotated out, i.e., expired*/
+        return InvalidStateToken;
+    }
+    /*the AEAD may wait for a crypto provider, the reference is not held*/
+    memcpy(key, keys->key[i], sizeof(key));
+    epoch_put(keys, i);
+
+    memcpy(nonce, token + 1, sizeof(nonce));
+    memcpy(tag, token + token_len - sizeof(tag), sizeof(tag));
+    r = aead(DECRYPT,
+             token + 1 + sizeof(nonce), sizeof(p) + sizeof(tag),
+             key, AEAD_KEY_DEFAULT_SIZE,
+             nonce, sizeof(nonce),
+             token, 1,
+             p, sizeof(p),
+             tag, sizeof(tag));
+    memset(key, 0, sizeof(key));
+    if (r != EdhocNoError) return InvalidStateToken;
+
+    st->suite_label = *q++;
+    st->method = *q++;
+    st->corr = *q++;
+    st->c_i_len = *q++;
+    memcpy(st->c_i, q, sizeof(st->c_i));
+    q += sizeof(st->c_i);
+    memcpy(st->th3, q, sizeof(st->th3));
+    q += sizeof(st->th3);
+    memcpy(st->prk_3e2m, q, sizeof(st->prk_3e2m));
+    q += sizeof(st->prk_3e2m);
+    st->y_len = *q++;
+    memcpy(st->y, q, sizeof(st->y));
+    memset(p, 0, sizeof(p));
+
+    if (st->c_i_len > sizeof(st->c_i) || st->y_len > sizeof(st->y)) {
+        return InvalidStateToken;
+    }
+    return EdhocNoError;
+}
+
+/**
+ * @brief   Records the nonce of an opened state token so that the token is 
+ *          accepted only once. Lock free, the slots are claimed with 
+ *          compare and swap.
+ * @param   keys the local state keys
+ * @param   token the state token, already opened with state_open()
+ * @retval  InvalidStateToken if the token was used before or its epoch was 
+ *          rotated out since it was opened, TooManyHandshakes if all slots 
+ *          of the epoch are used
+ */
+static EdhocError state_use(
+    struct edhoc_state_keys* keys, const uint8_t* token) {
+    uint64_t* used;
+    uint64_t n = 0;
+    uint32_t i, k;
+    EdhocError r = TooManyHandshakes;
+    int e = epoch_get(keys, token[0]);
+
+    if (e < 0) return InvalidStateToken;
+    used = keys->used[e];
+
+    /*the first 8 bytes of the random nonce, 0 marks a free slot*/
+    for (i = 0; i < sizeof(n); i++) n = (n << 8) | token[1 + i];
+    if (n == 0) n = 1;
+
+    for (i = 0, k = n % keys->used_num; i < keys->used_num;
+         i++, k = (k + 1) % keys->used_num) {
+        uint64_t seen = 0;
+        if (__atomic_compare_exchange_n(&used[k], &seen, n, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            __atomic_add_fetch(&keys->used_cnt[e], 1, __ATOMIC_RELAXED);
+            r = EdhocNoError;
+            break;
+        }
+        /*the slot is taken, seen holds its nonce*/
+        if (seen == n) {
+            r = InvalidStateToken;
+            break;
+        }
+    }
+    epoch_put(keys, e);
+    return r;
+}
+
+EdhocError edhoc_state_keys_init(
+    struct edhoc_state_keys* keys, uint64_t* used, uint32_t used_len) {
+    if (used_len < 2) return DestBufferToSmall;
+    memset(keys, 0, sizeof(*keys));
+    memset(used, 0, used_len * sizeof(uint64_t));
+    keys->used_num = used_len / 2;
+    keys->used[0] = used;
+    keys->used[1] = used + keys->used_num;
+    return random_bytes(keys->key[0], AEAD_KEY_DEFAULT_SIZE);
+}
+
+EdhocError edhoc_state_keys_rotate_used(
+    struct edhoc_state_keys* keys, uint32_t min_used) {
+    uint8_t key[AEAD_KEY_DEFAULT_SIZE];
+    uint32_t state;
+    uint8_t next;
+    EdhocError r = EdhocNoError;
+
+    if (__atomic_exchange_n(&keys->rotating, true, __ATOMIC_ACQUIRE)) {
+        return EdhocNoError;
+    }
+    state = __atomic_load_n(&keys->epoch, __ATOMIC_ACQUIRE);
+    next = (uint8_t)(state + 1);
+    /*the epoch cannot change while rotating is set*/
+    if (__atomic_load_n(&keys->used_cnt[state & 1], __ATOMIC_RELAXED) <
+        min_used) {
+        goto out;
+    }
+    /*the new key is prepared before the previous epoch is retired*/
+    r = random_bytes(key, sizeof(key));
+    if (r != EdhocNoError) goto out;
+
+    /*the new epoch takes the key and the slots of the previous one*/
+    __atomic_store_n(&keys->epoch, state & STATE_EPOCH_MASK, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&keys->readers[next & 1], __ATOMIC_SEQ_CST) != 0) {
+        /*a reference is held only to copy the key or to claim a slot*/
+    }
+    memcpy(keys->key[next & 1], key, sizeof(key));
+    memset(keys->used[next & 1], 0, keys->used_num * sizeof(uint64_t));
+    __atomic_store_n(&keys->used_cnt[next & 1], 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&keys->epoch, next | STATE_PREVIOUS_VALID,
+                     __ATOMIC_SEQ_CST);
+out:
+    memset(key, 0, sizeof(key));
+    __atomic_store_n(&keys->rotating, false, __ATOMIC_RELEASE);
+    return r;
+}
+
+EdhocError edhoc_state_keys_rotate(struct edhoc_state_keys* keys) {
+    return edhoc_state_keys_rotate_used(keys, 0);
+}
+
+/**
+ * @brief   Processes message 1, creates message 2 and seals the state into 
+ *          a state token, see edhoc_responder_stateless_msg2()
+ */
+static EdhocError stateless_msg2(
+    struct edhoc_workspace* ws,
+    struct edhoc_responder_context* c,
+    struct edhoc_state_keys* keys,
+    uint8_t* msg1, uint32_t msg1_len,
+    uint8_t* ad_1, uint64_t* ad_1_len,
+    uint8_t* msg2, uint32_t* msg2_len,
+    uint8_t* state_token, uint32_t* state_token_len) {
+    struct responder_state st;
+    struct byte_array err_out = {.ptr = msg2, .len = *msg2_len};
+    EdhocError r;
+    TRACE_DECLARE(tr, RESPONDER, EDHOC_TRACE_METHOD_UNKNOWN, c);
+
+    if (*state_token_len < EDHOC_STATE_TOKEN_SIZE) return DestBufferToSmall;
+
+    TRACE_BEGIN(tr, EDHOC_PHASE_HANDSHAKE);
+    r = msg2_gen(ws, c, msg1, msg1_len, ad_1, ad_1_len, &err_out,
+                 &st, msg2, msg2_len);
+    if (r == ErrorMessageSent) {
+        /*msg2 contains the error message*/
+        *msg2_len = err_out.len;
+    } else if (r == EdhocNoError) {
+        TRACE_METHOD(tr, st.method);
+        r = state_seal(keys, &st, state_token);
+        if (r == EdhocNoError) *state_token_len = EDHOC_STATE_TOKEN_SIZE;
+    }
+    TRACE_END(tr, EDHOC_PHASE_HANDSHAKE, 0, r);
+    memset(&st, 0, sizeof(st));
+    return r;
+}
+
+/**
+ * @brief   Opens a state token and processes message 3, see 
+ *          edhoc_responder_stateless_msg3()
+ */
+static EdhocError stateless_msg3(
+    struct edhoc_workspace* ws,
+    struct edhoc_responder_context* c,
+    struct edhoc_state_keys* keys,
+    struct other_party_cred* cred_i_array,
+    uint16_t num_cred_i,
+    const uint8_t* state_token, uint32_t state_token_len,
+    uint8_t* msg3, uint32_t msg3_len,
+    uint8_t* err_msg, uint32_t* err_msg_len,
+    uint8_t* ad_3, uint64_t* ad_3_len,
+    uint8_t* prk_4x3m, uint16_t prk_4x3m_len,
+    uint8_t* th4, uint16_t th4_len) {
+    struct responder_state st;
+    struct byte_array err_out = {.ptr = err_msg, .len = *err_msg_len};
+    EdhocError r;
+    TRACE_DECLARE(tr, RESPONDER, EDHOC_TRACE_METHOD_UNKNOWN, c);
+
+    TRACE_BEGIN(tr, EDHOC_PHASE_HANDSHAKE);
+    r = state_open(keys, state_token, state_token_len, &st);
+    if (r == EdhocNoError) r = state_use(keys, state_token);
+    if (r == EdhocNoError) {
+        TRACE_METHOD(tr, st.method);
+        r = msg3_process(ws, c, &st, cred_i_array, num_cred_i, msg3, msg3_len,
+                         err_msg, err_msg_len, &err_out, ad_3, ad_3_len,
+                         prk_4x3m, prk_4x3m_len, th4, th4_len);
+        /*err_msg contains the error message for the initiator*/
+        if (r == ResponderAuthenticationFailed) *err_msg_len = err_out.len;
+    }
+    TRACE_END(tr, EDHOC_PHASE_HANDSHAKE, 0, r);
+    memset(&st, 0, sizeof(st));
+    return r;
+}
+
+/**
+ * @brief   Executes stateless_msg2() with a workspace on the stack, see 
+ *          responder_run_on_stack()
+ */
+static EdhocError __attribute__((noinline)) stateless_msg2_on_stack(
+    struct edhoc_responder_context* c,
+    struct edhoc_state_keys* keys,
+    uint8_t* msg1, uint32_t msg1_len,
+    uint8_t* ad_1, uint64_t* ad_1_len,
+    uint8_t* msg2, uint32_t* msg2_len,
+    uint8_t* state_token, uint32_t* state_token_len) {
+    uint64_t buf[EDHOC_RESPONDER_WORKSPACE_SIZE / sizeof(uint64_t)];
+    struct edhoc_workspace ws;
+    EdhocError r;
+
+    workspace_init(&ws, (uint8_t*)buf, sizeof(buf));
+    r = stateless_msg2(
+        &ws, c, keys, msg1, msg1_len, ad_1, ad_1_len,
+        msg2, msg2_len, state_token, state_token_len);
+    workspace_release(&ws);
+    return r;
+}
+
+/**
+ * @brief   Executes stateless_msg3() with a workspace on the stack, see 
+ *          responder_run_on_stack()
+ */
+static EdhocError __attribute__((noinline)) stateless_msg3_on_stack(
+    struct edhoc_responder_context* c,
+    struct edhoc_state_keys* keys,
+    struct other_party_cred* cred_i_array,
+    uint16_t num_cred_i,
+    const uint8_t* state_token, uint32_t state_token_len,
+    uint8_t* msg3, uint32_t msg3_len,
+    uint8_t* err_msg, uint32_t* err_msg_len,
+    uint8_t* ad_3, uint64_t* ad_3_len,
+    uint8_t* prk_4x3m, uint16_t prk_4x3m_len,
+    uint8_t* th4, uint16_t th4_len) {
+    uint64_t buf[EDHOC_RESPONDER_WORKSPACE_SIZE / sizeof(uint64_t)];
+    struct edhoc_workspace ws;
+    EdhocError r;
+
+    workspace_init(&ws, (uint8_t*)buf, sizeof(buf));
+    r = stateless_msg3(
+        &ws, c, keys, cred_i_array, num_cred_i, state_token, state_token_len,
+        msg3, msg3_len, err_msg, err_msg_len, ad_3, ad_3_len,
+        prk_4x3m, prk_4x3m_len, th4, th4_len);
+    workspace_release(&ws);
+    return r;
+}
+
+EdhocError edhoc_responder_stateless_msg2(
+    struct edhoc_responder_context* c,
+    struct edhoc_state_keys* keys,
+    uint8_t* msg1, uint32_t msg1_len,
+    uint8_t* ad_1, uint64_t* ad_1_len,
+    uint8_t* msg2, uint32_t* msg2_len,
+    uint8_t* state_token, uint32_t* state_token_len) {
+    EdhocError r;
+
+    if (c->workspace == NULL) {
+        return stateless_msg2_on_stack(
+            c, keys, msg1, msg1_len, ad_1, ad_1_len,
+            msg2, msg2_len, state_token, state_token_len);
+    }
+
+    r = stateless_msg2(
+        c->workspace, c, keys, msg1, msg1_len, ad_1, ad_1_len,
+        msg2, msg2_len, state_token, state_token_len);
+    workspace_release(c->workspace);
+    return r;
+}
+
+EdhocError edhoc_responder_stateless_msg3(
+    struct edhoc_responder_context* c,
+    struct edhoc_state_keys* keys,
+    struct other_party_cred* cred_i_array,
+    uint16_t num_cred_i,
+    const uint8_t* state_token, uint32_t state_token_len,
+    uint8_t* msg3, uint32_t msg3_len,
+    uint8_t* err_msg, uint32_t* err_msg_len,
+    uint8_t* ad_3, uint64_t* ad_3_len,
+    uint8_t* prk_4x3m, uint16_t prk_4x3m_len,
+    uint8_t* th4, uint16_t th4_len) {
+    EdhocError r;
+
+    if (c->workspace == NULL) {
+        return stateless_msg3_on_stack(
+            c, keys, cred_i_array, num_cred_i, state_token, state_token_len,
+            msg3, msg3_len, err_msg, err_msg_len, ad_3, ad_3_len,
+            prk_4x3m, prk_4x3m_len, th4, th4_len);
+    }
+
+    r = stateless_msg3(
+        c->workspace, c, keys, cred_i_array, num_cred_i,
+        state_token, state_token_len, msg3, msg3_len, err_msg, err_msg_len,
+        ad_3, ad_3_len, prk_4x3m, prk_4x3m_len, th4, th4_len);
+    workspace_release(c->workspace);
+    return r;
+}
+
+/**
+ * @brief   Executes responder_run() with a workspace on the stack. Kept out of 
+ *          line so that the stack is only used if the caller did not provide 
+ *          a workspace.
+ */
+static EdhocError __attribute__((noinline)) responder_run_on_stack(
+    struct edhoc_responder_context* c,
+    struct other_party_cred* cred_i_array,
+    uint16_t num_cred_i,
+    uint8_t* err_msg, uint32_t* err_msg_len,
+    uint8_t* ad_1, uint64_t* ad_1_len,
+    uint8_t* ad_3, uint64_t* ad_3_len,
+    uint8_t* prk_4x3m, uint16_t prk_4x3m_len,
+    uint8_t* th4, uint16_t th4_len) {
+    uint64_t buf[EDHOC_RESPONDER_WORKSPACE_SIZE / sizeof(uint64_t)];
+    struct edhoc_workspace ws;
+    EdhocError r;
+
+    workspace_init(&ws, (uint8_t*)buf, sizeof(buf));
+    r = responder_run(
+        &ws, c, cred_i_array, num_cred_i, err_msg, err_msg_len,
+        ad_1, ad_1_len, ad_3, ad_3_len, prk_4x3m, prk_4x3m_len,
+        th4, th4_len);
+    workspace_release(&ws);
+    return r;
+}
+
+EdhocError edhoc_responder_run(
+    struct edhoc_responder_context* c,
+    struct other_party_cred* cred_i_array,
+    uint16_t num_cred_i,
+    uint8_t* err_msg, uint32_t* err_msg_len,
+    uint8_t* ad_1, uint64_t* ad_1_len,
+    uint8_t* ad_3, uint64_t* ad_3_len,
+    uint8_t* prk_4x3m, uint16_t prk_4x3m_len,
+    uint8_t* th4, uint16_t th4_len) {
+    EdhocError r;
+
+    if (c->workspace == NULL) {
+        return responder_run_on_stack(
+            c, cred_i_array, num_cred_i, err_msg, err_msg_len,
+            ad_1, ad_1_len, ad_3, ad_3_len, prk_4x3m, prk_4x3m_len,
+            th4, th4_len);
+    }
+
+    r = responder_run(
+        c->workspace, c, cred_i_array, num_cred_i, err_msg, err_msg_len,
+        ad_1, ad_1_len, ad_3, ad_3_len, prk_4x3m, prk_4x3m_len,
+        th4, th4_len);
+    workspace_release(c->workspace);
+    return r;
 }
@@ -11,231 +11,635 @@
 #include "../inc/retrieve_cred.h"
 
 #include <cbor.h>
-#include <inttypes.h>
 #include <string.h>
 
 #include "../edhoc.h"
-#include "../inc/cbor_decoder.h"
+#include "../inc/cbor_view.h"
 #include "../inc/crypto_wrapper.h"
 #include "../inc/error.h"
 #include "../inc/print_util.h"
+#include "../inc/revocation_list.h"
+
+/*keyUsage keyCertSign in the extensions of a native CBOR certificate, which
+encode keyUsage as an integer, negative if the extension is critical*/
+#define CERT_KEY_USAGE_KEY_CERT_SIGN 0x20
+
+/*a parsed native CBOR certificate, all fields point into the certificate*/
+struct cbor_cert {
+    struct byte_array issuer;
+    int64_t not_before;
+    int64_t not_after;
+    int64_t ext;
+    struct byte_array subject;
+    struct byte_array pk;
+    struct byte_array tbs; /*the signed part of the certificate*/
+    struct byte_array signature;
+};
+
+static inline bool byte_array_equal(
+    const struct byte_array* a, const struct byte_array* b) {
+    return a->len == b->len && 0 == memcmp(a->ptr, b->ptr, a->len);
+}
+
+/**
+ * @brief   Orders byte arrays by length and then by content
+ */
+static int byte_array_cmp(
+    const struct byte_array* a, const struct byte_array* b) {
+    if (a->len != b->len) return (a->len < b->len) ? -1 : 1;
+    if (a->len == 0) return 0;
+    return memcmp(a->ptr, b->ptr, a->len);
+}
+
+/**
+ * @brief   Decodes the next data item which must be a byte or a text string
+ */
+static EdhocError cbor_name_next(struct byte_array* in, struct byte_array* out) {
+    struct cbor_item item;
+    EdhocError r = cbor_item_next(in, &item);
+    if (r != EdhocNoError) return r;
+    if (item.type != CborByteStringType && item.type != CborTextStringType)
+        return ErrorDuringCborDecoding;
+    *out = item.view;
+    return EdhocNoError;
+}
+
+/**
+ * @brief   Decodes the next data item which must be an integer
+ */
+static EdhocError cbor_int_next(struct byte_array* in, int64_t* out) {
+    struct cbor_item item;
+    EdhocError r = cbor_item_next(in, &item);
+    if (r != EdhocNoError) return r;
+    if (item.type != CborIntegerType) return ErrorDuringCborDecoding;
+    *out = item.int_val;
+    return EdhocNoError;
+}
+
+/**
+ * @brief   Parses a native CBOR certificate, i.e., the CBOR sequence type, 
+ *          serial number, issuer, validity_notBefore, validity_notAfter, 
+ *          subject, public key, extensions, signature
+ * @param   cert the certificate
+ * @param   c the parsed certificate
+ */
+static EdhocError cert_parse(const struct byte_array* cert, struct cbor_cert* c) {
+    struct byte_array rest = *cert;
+    struct byte_array serial;
+    int64_t type;
+    EdhocError r;
+
+    PRINT_MSG("start parsing a CBOR certificate\n");
+    r = cbor_int_next(&rest, &type);
+    if (r != EdhocNoError) return r;
+    r = cbor_bstr_next(&rest, &serial);
+    if (r != EdhocNoError) return r;
+    PRINT_ARRAY("serial number", serial.ptr, serial.len);
+    r = cbor_name_next(&rest, &c->issuer);
+    if (r != EdhocNoError) return r;
+    PRINT_ARRAY("issuer", c->issuer.ptr, c->issuer.len);
+    r = cbor_int_next(&rest, &c->not_before);
+    if (r != EdhocNoError) return r;
+    r = cbor_int_next(&rest, &c->not_after);
+    if (r != EdhocNoError) return r;
+    r = cbor_name_next(&rest, &c->subject);
+    if (r != EdhocNoError) return r;
+    PRINT_ARRAY("subject", c->subject.ptr, c->subject.len);
+    r = cbor_bstr_next(&rest, &c->pk);
+    if (r != EdhocNoError) return r;
+    PRINT_ARRAY("pk", c->pk.ptr, c->pk.len);
+    r = cbor_int_next(&rest, &c->ext);
+    if (r != EdhocNoError) return r;
+
+    c->tbs.ptr = cert->ptr;
+    c->tbs.len = cert->len - rest.len;
+    r = cbor_bstr_next(&rest, &c->signature);
+    if (r != EdhocNoError) return r;
+    PRINT_ARRAY("signature", c->signature.ptr, c->signature.len);
+    if (rest.len != 0) return ErrorDuringCborDecoding;
+    return EdhocNoError;
+}
+
+/**
+ * @brief   Returns the length of a parsed certificate
+ */
+static inline uint32_t cert_size(const struct cbor_cert* c) {
+    return (uint32_t)(c->signature.ptr + c->signature.len - c->tbs.ptr);
+}
+
+/**
+ * @brief   Returns true if the certificate may issue other certificates, 
+ *          i.e., has the keyCertSign key usage
+ */
+static inline bool cert_is_ca(const struct cbor_cert* c) {
+    int64_t key_usage = c->ext < 0 ? -c->ext : c->ext;
+    return (key_usage & CERT_KEY_USAGE_KEY_CERT_SIGN) != 0;
+}
+
+/**
+ * @brief   Verifies the signature of a certificate
+ * @param   c the certificate
+ * @param   issuer_pk public key of the issuer of c
+ */
+static EdhocError cert_signature_verify(
+    const struct cbor_cert* c, const struct byte_array* issuer_pk,
+    bool* verified) {
+    *verified = false;
+    if (c->tbs.len > UINT16_MAX || c->signature.len > UINT16_MAX ||
+        issuer_pk->len > UINT8_MAX) {
+        return CertificateAuthenticationFailed;
+    }
+    return verify(Ed25519_SIGN,
+                  issuer_pk->ptr, (uint8_t)issuer_pk->len,
+                  c->tbs.ptr, (uint16_t)c->tbs.len,
+                  c->signature.ptr, (uint16_t)c->signature.len,
+                  verified);
+}
+
+/**
+ * @brief   Returns the index of the first trust anchor with the given 
+ *          subject or store->num if there is none. The anchors are sorted, 
+ *          see edhoc_trust_anchors_init(), so this is a binary search.
+ */
+static uint16_t trust_anchor_find(
+    const struct trust_anchor_store* store, const struct byte_array* subject) {
+    uint16_t lo = 0, hi = store->num;
+    while (lo < hi) {
+        uint16_t mid = lo + (hi - lo) / 2;
+        if (byte_array_cmp(&store->anchors[mid].subject, subject) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < store->num && byte_array_equal(&store->anchors[lo].subject, subject)) {
+        return lo;
+    }
+    return store->num;
+}
+
+EdhocError edhoc_trust_anchors_init(
+    struct trust_anchor_store* store,
+    struct trust_anchor* anchors, uint16_t num,
+    int64_t now) {
+    /*insertion sort, done once when the store is set up*/
+    for (uint16_t i = 1; i < num; i++) {
+        struct trust_anchor t = anchors[i];
+        uint16_t j = i;
+        while (j > 0 && byte_array_cmp(&anchors[j - 1].subject, &t.subject) > 0) {
+            anchors[j] = anchors[j - 1];
+            j--;
+        }
+        anchors[j] = t;
+    }
+    store->anchors = anchors;
+    store->num = num;
+    store->now = now;
+    return EdhocNoError;
+}
 
 /**
- * @brief   Verifies an certificate
- * @param   cert a native CBOR encoded certificate
- * @param   cer_len the length of the certificate
- * @param   cred_array an array containing credentials 
- * @param   cred_num number of elements in cred_array
- * @param   pk public key contained in the certificate
- * @param   pk_len the length pk
- * @param   verified true if verification successfull
+ * @brief   Checks if c is issued by a trust anchor. If there is a trust anchor 
+ *          store only the store is used, otherwise the ca and ca_pk of the 
+ *          elements in cred_array.
+ * @param   found true if a trust anchor with the name of the issuer of c 
+ *          exists
+ * @param   verified true if c is signed by such a trust anchor
  */
-static EdhocError cert_verify(
-    uint8_t* cert, uint16_t cert_len,
+static EdhocError trust_anchor_verify(
+    const struct cbor_cert* c,
+    const struct trust_anchor_store* trust_anchors,
+    const struct other_party_cred* cred_array, uint16_t cred_num,
+    bool* found, bool* verified) {
+    EdhocError r;
+    *found = false;
+    *verified = false;
+
+    if (trust_anchors != NULL) {
+        /*anchors with the same subject are adjacent, e.g., during a CA key 
+        rollover*/
+        for (uint16_t i = trust_anchor_find(trust_anchors, &c->issuer);
+             i < trust_anchors->num &&
+             byte_array_equal(&trust_anchors->anchors[i].subject, &c->issuer);
+             i++) {
+            *found = true;
+            PRINT_ARRAY("Root PK of the CA", trust_anchors->anchors[i].pk.ptr,
+                        trust_anchors->anchors[i].pk.len);
+            r = cert_signature_verify(c, &trust_anchors->anchors[i].pk, verified);
+            if (r != EdhocNoError) return r;
+            if (*verified) return EdhocNoError;
+        }
+        return EdhocNoError;
+    }
+
+    for (uint16_t i = 0; i < cred_num; i++) {
+        if (byte_array_equal(&cred_array[i].ca, &c->issuer)) {
+            *found = true;
+            PRINT_ARRAY("Root PK of the CA", cred_array[i].ca_pk.ptr,
+                        cred_array[i].ca_pk.len);
+            r = cert_signature_verify(c, &cred_array[i].ca_pk, verified);
+            if (r != EdhocNoError) return r;
+            if (*verified) return EdhocNoError;
+        }
+    }
+    return EdhocNoError;
+}
+
+/**
+ * @brief   Verifies a certification path starting at certs[leaf]. The issuer 
+ *          of each certificate is looked up first in the trust anchors and 
+ *          then among the subjects of the other certificates in certs, so 
+ *          that both an ordered x5chain and an unordered x5bag can be used. 
+ *          Only certificates with the keyCertSign key usage are issuers. 
+ *          With a trust anchor store the certificates on the path must be 
+ *          valid at trust_anchors->now.
+ * @param   certs the parsed certificates
+ * @param   cert_num number of elements in certs
+ * @param   leaf the index of the certificate of the other party
+ * @param   revoked if not NULL the certificates on the path must not be 
+ *          contained in this list
+ * @param   verified true if all certificates on the path are verified
+ */
+static EdhocError cert_path_verify(
+    const struct cbor_cert* certs, uint16_t cert_num, uint16_t leaf,
+    const struct trust_anchor_store* trust_anchors,
+    const struct revocation_list* revoked,
     const struct other_party_cred* cred_array, uint16_t cred_num,
-    uint8_t** pk, uint16_t* pk_len,
     bool* verified) {
-    CborParser parser;
-    CborValue value;
-    CborError err;
-    uint64_t len = 0;
-    uint32_t offset = 0;
+    EdhocError r;
+    bool found;
+    uint32_t used = 0;
+    uint16_t cur = leaf;
 
-    uint8_t signature[SGN_OR_MAC_DEFAULT_SIZE];
-    uint64_t signature_len = sizeof(signature);
+    *verified = false;
+    for (uint16_t depth = 0; depth < cert_num; depth++) {
+        used |= (uint32_t)1 << cur;
 
-    PRINT_MSG("start parsing a CBOR certificate\n");
+        if (trust_anchors != NULL &&
+            (trust_anchors->now < certs[cur].not_before ||
+             trust_anchors->now > certs[cur].not_after)) {
+            PRINT_ARRAY("certificate not valid", certs[cur].subject.ptr,
+                        certs[cur].subject.len);
+            return CertificateExpired;
+        }
 
-    /*1) type encoded as int in single byte */
-    err = cbor_parser_init(cert, cert_len, 0, &parser, &value);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-    int64_t type;
-    err = cbor_value_get_int64(&value, &type);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-    PRINTF("%" PRId64 "\n", type);
-    offset++;
-
-    /*2) serial number as bytestring */
-    err = cbor_parser_init(cert + offset, cert_len - offset, 0, &parser, &value);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-
-    err = cbor_value_calculate_string_length(&value, (size_t*)&len);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-    offset++;
-    PRINT_ARRAY("serial number", cert + offset, len);
-    offset += len;
-
-    /*3) issuer as bytestring */
-    err = cbor_parser_init(cert + offset, cert_len - offset, 0, &parser, &value);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-
-    err = cbor_value_calculate_string_length(&value, (size_t*)&len);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-    offset++;
-    PRINT_ARRAY("issuer", cert + offset, len);
-    /*get the CAs public key*/
-    uint8_t* root_pk = NULL;
-    uint8_t root_pk_len = 0;
+        if (revoked != NULL) {
+            bool is_revoked;
+            r = revocation_list_check(revoked, certs[cur].tbs.ptr,
+                                      cert_size(&certs[cur]), &is_revoked);
+            if (r != EdhocNoError) return r;
+            if (is_revoked) {
+                PRINT_ARRAY("revoked certificate", certs[cur].subject.ptr,
+                            certs[cur].subject.len);
+                return CertificateRevoked;
+            }
+        }
+
+        r = trust_anchor_verify(&certs[cur], trust_anchors, cred_array,
+                                cred_num, &found, verified);
+        if (r != EdhocNoError) return r;
+        if (found) return EdhocNoError;
+
+        /*the issuer must be an intermediate CA contained in certs*/
+        uint16_t next = cert_num;
+        for (uint16_t j = 0; j < cert_num; j++) {
+            if (!(used & ((uint32_t)1 << j)) && cert_is_ca(&certs[j]) &&
+                byte_array_equal(&certs[j].subject, &certs[cur].issuer)) {
+                next = j;
+                break;
+            }
+        }
+        if (next == cert_num) return NoSuchCA;
+
+        r = cert_signature_verify(&certs[cur], &certs[next].pk, verified);
+        if (r != EdhocNoError) return r;
+        if (!*verified) return EdhocNoError;
+        *verified = false;
+        cur = next;
+    }
+    return NoSuchCA;
+}
+
+/**
+ * @brief   Provides the parameters of a preestablished credential
+ * @param   c the credential
+ * @param   static_dh_auth true if static DH authentication is used
+ */
+static void cred_select(
+    const struct other_party_cred* c,
+    bool static_dh_auth,
+    uint8_t** cred, uint16_t* cred_len,
+    uint8_t** pk, uint16_t* pk_len,
+    uint8_t** g, uint16_t* g_len) {
+    *cred = c->cred.ptr;
+    *cred_len = c->cred.len;
+    if (static_dh_auth) {
+        *pk_len = 0;
+        *g = c->g.ptr;
+        *g_len = c->g.len;
+    } else {
+        *g_len = 0;
+        *pk = c->pk.ptr;
+        *pk_len = c->pk.len;
+    }
+}
+
+/**
+ * @brief   Reads the certificates of a COSE_X509, i.e., a single certificate 
+ *          or an array of certificates
+ * @param   rest the not yet parsed part of ID_CRED_x
+ * @param   certs the parsed certificates
+ * @param   cert_num the number of certificates
+ */
+static EdhocError cose_x509_parse(
+    struct byte_array* rest,
+    struct cbor_cert* certs, uint16_t* cert_num) {
+    EdhocError r;
+    struct cbor_item item;
+    struct byte_array cert;
+
+    r = cbor_item_next(rest, &item);
+    if (r != EdhocNoError) return r;
+
+    if (item.type == CborByteStringType) {
+        PRINT_ARRAY("ID_CRED_x contains certificate", item.view.ptr, item.view.len);
+        *cert_num = 1;
+        return cert_parse(&item.view, &certs[0]);
+    }
+    if (item.type != CborArrayType || item.len == 0) return ErrorDuringCborDecoding;
+    if (item.len > CERT_CHAIN_MAX_DEPTH) return CertificateChainTooLong;
+
+    *cert_num = (uint16_t)item.len;
+    for (uint16_t i = 0; i < *cert_num; i++) {
+        r = cbor_bstr_next(rest, &cert);
+        if (r != EdhocNoError) return r;
+        PRINT_ARRAY("ID_CRED_x contains certificate", cert.ptr, cert.len);
+        r = cert_parse(&cert, &certs[i]);
+        if (r != EdhocNoError) return r;
+    }
+    return EdhocNoError;
+}
+
+/**
+ * @brief   Provides the credential and the public key of a verified 
+ *          certificate
+ */
+static void cert_select(
+    const struct cbor_cert* c,
+    bool static_dh_auth,
+    uint8_t** cred, uint16_t* cred_len,
+    uint8_t** pk, uint16_t* pk_len,
+    uint8_t** g, uint16_t* g_len) {
+    /*CRED_x is the whole certificate*/
+    *cred = c->tbs.ptr;
+    *cred_len = (uint16_t)cert_size(c);
+    if (static_dh_auth) {
+        *pk_len = 0;
+        *g = c->pk.ptr;
+        *g_len = (uint16_t)c->pk.len;
+    } else {
+        *g_len = 0;
+        *pk = c->pk.ptr;
+        *pk_len = (uint16_t)c->pk.len;
+    }
+}
+
+/**
+ * @brief   Maps a COSE hash algorithm used in x5t to the length of the 
+ *          thumbprint. Only SHA-256 and SHA-256/64 are supported.
+ */
+static EdhocError x5t_alg_len(int64_t alg, uint8_t* len) {
+    switch (alg) {
+        case x5t_sha_256:
+            *len = SHA_DEFAULT_SIZE;
+            return EdhocNoError;
+        case x5t_sha_256_64:
+            *len = 8;
+            return EdhocNoError;
+        default:
+            return UnsupportedHashAlg;
+    }
+}
+
+/**
+ * @brief   Compares the thumbprint of c with the first len byte of th. 
+ *          Credentials which are not indexed order after all thumbprints.
+ */
+static int x5t_cmp(
+    const struct other_party_cred* c, const uint8_t* th, uint8_t len) {
+    if (c->x5t_hash_len == 0) return 1;
+    return memcmp(c->x5t_hash, th, len);
+}
+
+EdhocError edhoc_x5t_index(
+    struct other_party_cred* cred_array, uint16_t cred_num) {
+    EdhocError r;
     for (uint16_t i = 0; i < cred_num; i++) {
-        if (memcmp(cred_array[i].ca.ptr, (cert + offset), cred_array[i].ca.len)) {
-            root_pk = cred_array[i].ca_pk.ptr;
-            root_pk_len = cred_array[i].ca_pk.len;
-            PRINT_ARRAY("Root PK of the CA", root_pk, root_pk_len);
-            break;
+        cred_array[i].x5t_hash_len = 0;
+        if (cred_array[i].cred.len == 0) continue;
+        r = hash(SHA_256, cred_array[i].cred.ptr, cred_array[i].cred.len,
+                 cred_array[i].x5t_hash);
+        if (r != EdhocNoError) return r;
+        cred_array[i].x5t_hash_len = SHA_DEFAULT_SIZE;
+    }
+
+    /*insertion sort, done once when the credentials are set up*/
+    for (uint16_t i = 1; i < cred_num; i++) {
+        struct other_party_cred t = cred_array[i];
+        uint16_t j = i;
+        while (j > 0 && t.x5t_hash_len != 0 &&
+               x5t_cmp(&cred_array[j - 1], t.x5t_hash, SHA_DEFAULT_SIZE) > 0) {
+            cred_array[j] = cred_array[j - 1];
+            j--;
         }
-        return NoSuchCA;
-    }
-    offset += len;
-
-    /*4) validity_notBefore as uint */
-    err = cbor_parser_init(cert + offset, cert_len - offset, 0, &parser, &value);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-    uint64_t notBefore;
-    cbor_value_get_uint64(&value, &notBefore);
-    offset += 5;
-
-    /*5)  validity_notAfter as uint,*/
-    err = cbor_parser_init(cert + offset, cert_len - offset, 0, &parser, &value);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-    uint64_t notAfter;
-    cbor_value_get_uint64(&value, &notAfter);
-    offset += 5;
-
-    /*6) subject*/
-    err = cbor_parser_init(cert + offset, cert_len - offset, 0, &parser, &value);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-    err = cbor_value_calculate_string_length(&value, (size_t*)&len);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-    offset++;
-    PRINT_ARRAY("subject", cert + offset, len);
-    offset += len;
-
-    /*7) pk*/
-    err = cbor_parser_init(cert + offset, cert_len - offset, 0, &parser, &value);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-    err = cbor_value_calculate_string_length(&value, (size_t*)&len);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-    offset += 2;
-    *pk = cert + offset;
-    *pk_len = len;
-    PRINT_ARRAY("pk", *pk, *pk_len);
-    offset += len;
-
-    /*8)extentions*/
-    err = cbor_parser_init(cert + offset, cert_len - offset, 0, &parser, &value);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-    int64_t ext;
-    cbor_value_get_int64(&value, &ext);
-    PRINT_ARRAY("extensions", (uint8_t*)&ext, sizeof(ext));
-    offset++;
+        cred_array[j] = t;
+    }
+    return EdhocNoError;
+}
+
+/**
+ * @brief   Finds the first credential whose thumbprint starts with th. 
+ *          cred_array is sorted by thumbprint, see edhoc_x5t_index(), so 
+ *          this is a binary search.
+ * @retval  the index of the credential or cred_num if there is none
+ */
+static uint16_t x5t_find(
+    const struct other_party_cred* cred_array, uint16_t cred_num,
+    const uint8_t* th, uint8_t len) {
+    uint16_t lo = 0, hi = cred_num;
+    while (lo < hi) {
+        uint16_t mid = lo + (hi - lo) / 2;
+        if (x5t_cmp(&cred_array[mid], th, len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < cred_num && x5t_cmp(&cred_array[lo], th, len) == 0) return lo;
+    return cred_num;
+}
 
-    /*9)signature*/
-    err = cbor_parser_init(cert + offset, cert_len - offset, 0, &parser, &value);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-    err = cbor_value_calculate_string_length(&value, (size_t*)&len);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-    if (len > signature_len) return CborByteStringBufferToSmall;
-    signature_len = len;
-    err = cbor_value_copy_byte_string(&value, signature, (size_t*)&signature_len, &value);
+/**
+ * @brief   Resolves ID_CRED_x = {x5t: [alg, hash]} against the certificates 
+ *          in cred_array
+ * @param   rest the not yet parsed part of ID_CRED_x, i.e., the COSE_CertHash
+ */
+static EdhocError x5t_lookup(
+    struct byte_array* rest,
+    bool static_dh_auth,
+    const struct revocation_list* revoked,
+    const struct other_party_cred* cred_array, uint16_t cred_num,
+    uint8_t** cred, uint16_t* cred_len,
+    uint8_t** pk, uint16_t* pk_len,
+    uint8_t** g, uint16_t* g_len) {
+    EdhocError r;
+    struct cbor_item item;
+    struct byte_array thumbprint;
+    uint8_t th_len;
+    uint8_t th[SHA_DEFAULT_SIZE];
 
-    PRINT_ARRAY("signature", signature, signature_len);
-    return verify(Ed25519_SIGN, root_pk, root_pk_len, cert, cert_len - 2 - signature_len, signature, signature_len, verified);
+    r = cbor_item_next(rest, &item);
+    if (r != EdhocNoError) return r;
+    if (item.type != CborArrayType || item.len != 2) return ErrorDuringCborDecoding;
+    r = cbor_item_next(rest, &item);
+    if (r != EdhocNoError) return r;
+    if (item.type != CborIntegerType) return ErrorDuringCborDecoding;
+    r = x5t_alg_len(item.int_val, &th_len);
+    if (r != EdhocNoError) return r;
+    r = cbor_bstr_next(rest, &thumbprint);
+    if (r != EdhocNoError) return r;
+    if (thumbprint.len != th_len) return CredentialNotFound;
+    PRINT_ARRAY("ID_CRED_x contains certificate thumbprint", thumbprint.ptr, thumbprint.len);
+
+    /*an indexed cred_array starts with the indexed credentials*/
+    bool indexed = cred_num > 0 && cred_array[0].x5t_hash_len != 0;
+    uint16_t i = 0;
+    if (indexed) {
+        i = x5t_find(cred_array, cred_num, thumbprint.ptr, th_len);
+    }
+    for (; i < cred_num; i++) {
+        const uint8_t* h = cred_array[i].x5t_hash;
+        if (indexed) {
+            if (x5t_cmp(&cred_array[i], thumbprint.ptr, th_len) != 0) break;
+        } else {
+            if (cred_array[i].cred.len == 0) continue;
+            r = hash(SHA_256, cred_array[i].cred.ptr, cred_array[i].cred.len, th);
+            if (r != EdhocNoError) return r;
+            h = th;
+        }
+        if (0 == memcmp(h, thumbprint.ptr, th_len)) {
+            if (revoked != NULL) {
+                bool is_revoked;
+                revocation_list_lookup(revoked, h, &is_revoked);
+                if (is_revoked) return CertificateRevoked;
+            }
+            cred_select(&cred_array[i], static_dh_auth,
+                        cred, cred_len, pk, pk_len, g, g_len);
+            return EdhocNoError;
+        }
+    }
+    return CredentialNotFound;
+}
+
+/**
+ * @brief   Verifies the certificates contained in ID_CRED_x = {x5chain: 
+ *          COSE_X509} or {x5bag: COSE_X509}. In a chain the first certificate 
+ *          is the certificate of the other party. In a bag it is a certificate 
+ *          which is not the issuer of another certificate in the bag.
+ * @param   rest the not yet parsed part of ID_CRED_x, i.e., the COSE_X509
+ * @param   bag true for x5bag
+ */
+static EdhocError cose_x509_verify(
+    struct byte_array* rest, bool bag,
+    bool static_dh_auth,
+    const struct trust_anchor_store* trust_anchors,
+    const struct revocation_list* revoked,
+    const struct other_party_cred* cred_array, uint16_t cred_num,
+    uint8_t** cred, uint16_t* cred_len,
+    uint8_t** pk, uint16_t* pk_len,
+    uint8_t** g, uint16_t* g_len) {
+    EdhocError r;
+    struct cbor_cert certs[CERT_CHAIN_MAX_DEPTH];
+    uint16_t cert_num;
+    bool verified;
+
+    r = cose_x509_parse(rest, certs, &cert_num);
+    if (r != EdhocNoError) return r;
+
+    r = NoSuchCA;
+    for (uint16_t leaf = 0; leaf < cert_num; leaf++) {
+        if (bag && cert_is_ca(&certs[leaf])) {
+            bool issuer = false;
+            for (uint16_t j = 0; j < cert_num && !issuer; j++) {
+                issuer = j != leaf &&
+                         byte_array_equal(&certs[j].issuer, &certs[leaf].subject);
+            }
+            if (issuer) continue;
+        }
+
+        r = cert_path_verify(certs, cert_num, leaf, trust_anchors, revoked,
+                             cred_array, cred_num, &verified);
+        if (r == EdhocNoError) {
+            if (verified) {
+                PRINT_MSG("Certificate verification successful!\n");
+                cert_select(&certs[leaf], static_dh_auth,
+                            cred, cred_len, pk, pk_len, g, g_len);
+                return EdhocNoError;
+            }
+            r = CertificateAuthenticationFailed;
+        }
+        if (!bag) break;
+    }
+    return r;
 }
 
 EdhocError retrieve_cred(
     bool static_dh_auth,
+    const struct trust_anchor_store* trust_anchors,
+    const struct revocation_list* revoked,
     struct other_party_cred* cred_array, uint16_t cred_num,
     uint8_t* id_cred, uint8_t id_cred_len,
     uint8_t** cred, uint16_t* cred_len,
     uint8_t** pk, uint16_t* pk_len,
     uint8_t** g, uint16_t* g_len) {
     EdhocError r1;
-    CborParser parser;
-    CborValue value;
-    CborType type, ignore;
-    CborError err;
-    uint8_t* next_temp_ptr;
-    uint8_t* temp_ptr;
-    uint32_t temp_len;
 
     /*check first if the credential is preestablished (RPK)*/
     for (uint16_t i = 0; i < cred_num; i++) {
-        if (0 == memcmp(cred_array[i].id_cred.ptr, id_cred, id_cred_len)) {
-            *cred = cred_array[i].cred.ptr;
-            *cred_len = cred_array[i].cred.len;
-            if (static_dh_auth) {
-                *pk_len = 0;
-                *g = cred_array[i].g.ptr;
-                *g_len = cred_array[i].g.len;
-            } else {
-                *g_len = 0;
-                *pk = cred_array[i].pk.ptr;
-                *pk_len = cred_array[i].pk.len;
-            }
+        if (cred_array[i].id_cred.len == id_cred_len &&
+            0 == memcmp(cred_array[i].id_cred.ptr, id_cred, id_cred_len)) {
+            cred_select(&cred_array[i], static_dh_auth,
+                        cred, cred_len, pk, pk_len, g, g_len);
             return EdhocNoError;
         }
     }
 
-    /* if the credential is not preestablished a certificate may be contained in the ID_CRED_x */
+    /* if the credential is not preestablished a certificate or a reference to 
+    a certificate may be contained in the ID_CRED_x */
 
-    /* Initialization */
-    err = cbor_parser_init(id_cred, id_cred_len, 0, &parser, &value);
-    if (err != CborNoError) return ErrorDuringCborDecoding;
-    /* Get type of input CBOR object */
-    type = cbor_value_get_type(&value);
+    struct byte_array rest = {.ptr = id_cred, .len = id_cred_len};
+    struct cbor_item item;
+    r1 = cbor_item_next(&rest, &item);
+    if (r1 != EdhocNoError) return r1;
 
-    if (type == CborMapType) {
+    if (item.type == CborMapType) {
         /*the first element in plaintext is a ID_CRED_x, which starts with a map */
         /*we move to the label of the map*/
-        temp_ptr = id_cred + 1;
-        temp_len = id_cred_len - 1;
-
-        int map_label;
-        uint64_t map_label_len;
-
-        r1 = cbor_decoder(
-            &next_temp_ptr, temp_ptr, temp_len,
-            &map_label, &map_label_len, &ignore);
-        temp_len -= (next_temp_ptr - temp_ptr);
-        temp_ptr = next_temp_ptr;
+        r1 = cbor_item_next(&rest, &item);
+        if (r1 != EdhocNoError) return r1;
+        if (item.type != CborIntegerType) return CredentialNotFound;
 
-        uint8_t cert[CERT_DEFAUT_SIZE];
-        uint64_t cert_len = sizeof(cert);
-        switch (map_label) {
+        switch (item.int_val) {
+            case x5t:
+                return x5t_lookup(&rest, static_dh_auth, revoked,
+                                  cred_array, cred_num,
+                                  cred, cred_len, pk, pk_len, g, g_len);
             case x5bag:
-                /*implement the x5bag parsing here*/
-                break;
             case x5chain:
-                r1 = cbor_decoder(
-                    &next_temp_ptr, temp_ptr, temp_len,
-                    cert, &cert_len, &ignore);
-                if (r1 != EdhocNoError) return r1;
-                PRINT_ARRAY("ID_CRED_x contains certificate", cert, cert_len);
-                *cred = temp_ptr + 2;
-                *cred_len = cert_len;
-                bool verified;
-
-                if (static_dh_auth) {
-                    *pk_len = 0;
-                    r1 = cert_verify(*cred, *cred_len,
-                                     cred_array, cred_num,
-                                     g, g_len, &verified);
-                } else {
-                    *g_len = 0;
-                    r1 = cert_verify(*cred, *cred_len,
-                                     cred_array, cred_num,
-                                     pk, pk_len, &verified);
-                }
-
-                if (r1 != EdhocNoError) return r1;
-
-                if (verified) {
-                    PRINT_MSG("Certificate verification successful!\n");
-                    return EdhocNoError;
-                } else {
-                    return CertificateAuthenticationFailed;
-                }
-                break;
+                return cose_x509_verify(&rest, item.int_val == x5bag,
+                                        static_dh_auth, trust_anchors, revoked,
+                                        cred_array, cred_num,
+                                        cred, cred_len, pk, pk_len, g, g_len);
         }
     }
 
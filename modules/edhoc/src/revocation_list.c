@@ -0,0 +1,177 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#include "../inc/revocation_list.h"
+
+#include <string.h>
+
+#include "../edhoc.h"
+#include "../inc/crypto_wrapper.h"
+#include "../inc/error.h"
+#include "../inc/print_util.h"
+
+static const uint8_t magic[4] = {'E', 'D', 'R', 'L'};
+
+static inline uint32_t be32_get(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline void be32_put(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/**
+ * @brief   Returns the i-th bit position of an entry in a Bloom filter of m
+ *          bits. The entries are hashes already, two 32 bit words of it are
+ *          combined by double hashing.
+ */
+static inline uint32_t bloom_pos(const uint8_t *entry, uint8_t i, uint32_t m) {
+    uint64_t h1 = be32_get(entry);
+    uint64_t h2 = be32_get(entry + 4) | 1;
+    return (uint32_t)((h1 + i * h2) % m);
+}
+
+EdhocError revocation_list_init(
+    struct revocation_list *rl,
+    const uint8_t *buf, uint32_t buf_len) {
+    uint64_t len;
+    uint32_t pos;
+
+    if (buf_len < REVOCATION_LIST_HEADER_SIZE) return InvalidRevocationList;
+    if (0 != memcmp(buf, magic, sizeof(magic)) ||
+        buf[4] != REVOCATION_LIST_VERSION ||
+        buf[5] == 0 || buf[5] > REVOCATION_BLOOM_MAX_K ||
+        buf[6] != REVOCATION_HASH_SIZE) {
+        return InvalidRevocationList;
+    }
+
+    rl->k = buf[5];
+    rl->bloom_bits = be32_get(buf + 8);
+    rl->entry_num = be32_get(buf + 12);
+    if (rl->bloom_bits == 0 || rl->bloom_bits % 8) return InvalidRevocationList;
+
+    len = (uint64_t)REVOCATION_LIST_HEADER_SIZE + rl->bloom_bits / 8 +
+          (uint64_t)rl->entry_num * REVOCATION_HASH_SIZE;
+    if (len != buf_len) return InvalidRevocationList;
+
+    rl->bloom = buf + REVOCATION_LIST_HEADER_SIZE;
+    rl->entries = rl->bloom + rl->bloom_bits / 8;
+
+    /*a lookup misses an entry which is out of order or not in the filter*/
+    for (uint32_t j = 0; j < rl->entry_num; j++) {
+        const uint8_t *e = rl->entries + (uint64_t)j * REVOCATION_HASH_SIZE;
+        if (j > 0 &&
+            memcmp(e - REVOCATION_HASH_SIZE, e, REVOCATION_HASH_SIZE) >= 0) {
+            return InvalidRevocationList;
+        }
+        for (uint8_t i = 0; i < rl->k; i++) {
+            pos = bloom_pos(e, i, rl->bloom_bits);
+            if (!(rl->bloom[pos >> 3] & (0x80 >> (pos & 7)))) {
+                return InvalidRevocationList;
+            }
+        }
+    }
+    PRINTF("revocation list with %u entries\n", (unsigned)rl->entry_num);
+    return EdhocNoError;
+}
+
+void revocation_list_lookup(
+    const struct revocation_list *rl,
+    const uint8_t *entry,
+    bool *revoked) {
+    uint32_t lo, hi, mid, pos;
+    int c;
+
+    *revoked = false;
+    for (uint8_t i = 0; i < rl->k; i++) {
+        pos = bloom_pos(entry, i, rl->bloom_bits);
+        if (!(rl->bloom[pos >> 3] & (0x80 >> (pos & 7)))) return;
+    }
+
+    /*the filter does not exclude the entry, search the exact set*/
+    lo = 0;
+    hi = rl->entry_num;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        c = memcmp(rl->entries + (uint64_t)mid * REVOCATION_HASH_SIZE, entry,
+                   REVOCATION_HASH_SIZE);
+        if (c == 0) {
+            *revoked = true;
+            return;
+        } else if (c < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+}
+
+EdhocError revocation_list_check(
+    const struct revocation_list *rl,
+    const uint8_t *cert, uint32_t cert_len,
+    bool *revoked) {
+    uint8_t h[SHA_DEFAULT_SIZE];
+    EdhocError r;
+
+    r = hash(SHA_256, cert, cert_len, h);
+    if (r != EdhocNoError) return r;
+    revocation_list_lookup(rl, h, revoked);
+    return EdhocNoError;
+}
+
+EdhocError revocation_list_encode(
+    const uint8_t *entries, uint32_t entry_num,
+    uint32_t bloom_bits, uint8_t k,
+    uint8_t *out, uint32_t *out_len) {
+    uint64_t len;
+    uint8_t *bloom;
+    uint32_t pos;
+
+    if (bloom_bits == 0 || bloom_bits % 8 || k == 0 ||
+        k > REVOCATION_BLOOM_MAX_K) {
+        return InvalidRevocationList;
+    }
+    len = (uint64_t)REVOCATION_LIST_HEADER_SIZE + bloom_bits / 8 +
+          (uint64_t)entry_num * REVOCATION_HASH_SIZE;
+    if (len > *out_len) return DestBufferToSmall;
+
+    memcpy(out, magic, sizeof(magic));
+    out[4] = REVOCATION_LIST_VERSION;
+    out[5] = k;
+    out[6] = REVOCATION_HASH_SIZE;
+    out[7] = 0;
+    be32_put(out + 8, bloom_bits);
+    be32_put(out + 12, entry_num);
+
+    bloom = out + REVOCATION_LIST_HEADER_SIZE;
+    memset(bloom, 0, bloom_bits / 8);
+    for (uint32_t j = 0; j < entry_num; j++) {
+        const uint8_t *e = entries + (uint64_t)j * REVOCATION_HASH_SIZE;
+        /*the exact set is searched with a binary search*/
+        if (j > 0 && memcmp(e - REVOCATION_HASH_SIZE, e, REVOCATION_HASH_SIZE) >= 0) {
+            return InvalidRevocationList;
+        }
+        for (uint8_t i = 0; i < k; i++) {
+            pos = bloom_pos(e, i, bloom_bits);
+            bloom[pos >> 3] |= 0x80 >> (pos & 7);
+        }
+    }
+    if (entry_num) {
+        memcpy(bloom + bloom_bits / 8, entries,
+               (size_t)entry_num * REVOCATION_HASH_SIZE);
+    }
+
+    *out_len = (uint32_t)len;
+    return EdhocNoError;
+}
@@ -106,24 +106,17 @@ EdhocError signature_or_mac_msg_create(
     uint8_t* mac, uint8_t* mac_len) {
     EdhocError r;
 
-    /*calculate K_2m K_3m*/
+    /*calculate K_2m K_3m and IV_2m IV_3m*/
     uint8_t K_m[AEAD_KEY_DEFAULT_SIZE];
-    r = okm_calc(
-        suite.edhoc_aead, suite.edhoc_hash, label_k,
-        prk, prk_len,
-        th, th_len,
-        K_m, sizeof(K_m));
-    if (r != EdhocNoError) return r;
-    PRINT_ARRAY("inner MAC key (K_2m or K_3m)", K_m, sizeof(K_m));
-
-    /*calculate IV_2m*/
     uint8_t IV_m[AEAD_IV_DEFAULT_SIZE];
-    r = okm_calc(
-        suite.edhoc_aead, suite.edhoc_hash, label_iv,
+    r = okm_key_iv_calc(
+        suite.edhoc_aead, suite.edhoc_hash, label_k, label_iv,
         prk, prk_len,
         th, th_len,
+        K_m, sizeof(K_m),
         IV_m, sizeof(IV_m));
     if (r != EdhocNoError) return r;
+    PRINT_ARRAY("inner MAC key (K_2m or K_3m)", K_m, sizeof(K_m));
     PRINT_ARRAY("inner MAC IV (IV_2m or IV_3m)", IV_m, sizeof(IV_m));
 
     /*A_2m or A_3m encode (additional data for msg2 msg3)*/
@@ -141,8 +134,9 @@ EdhocError signature_or_mac_msg_create(
     if (r != EdhocNoError) return r;
     PRINT_ARRAY("A_2m or A_3m", A_m, A_m_len);
 
-    /*calculate MAC_2*/
-    uint8_t in, out;
+    /*calculate MAC_2, the AEAD writes the tag after the (empty) ciphertext
+    into out*/
+    uint8_t in, out[16];
     *mac_len = 8;
     if (suite.edhoc_aead == AES_CCM_16_64_128) {
         *mac_len = 8;
@@ -155,7 +149,7 @@ EdhocError signature_or_mac_msg_create(
         K_m, sizeof(K_m),
         IV_m, sizeof(IV_m),
         A_m, A_m_len,
-        &out, 0,
+        out, sizeof(out),
         mac, *mac_len);
     if (r != EdhocNoError) return r;
     PRINT_ARRAY("MAC (MAC_2 or MAC_3)", mac, *mac_len);
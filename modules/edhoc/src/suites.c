@@ -38,9 +38,9 @@ EdhocError get_suite(enum suite_label label, struct suite* suite) {
             suite->suite_label = SUITE_2;
             suite->edhoc_aead = AES_CCM_16_64_128;
             suite->edhoc_hash = SHA_256;
-            suite->edhoc_ecdh_curve = 1;
+            suite->edhoc_ecdh_curve = P_256_ECDH;
             suite->edhoc_sign_alg = ES256;
-            suite->edhoc_sign_curve = 1;
+            suite->edhoc_sign_curve = P_256_SIGN;
             suite->app_aead = AES_CCM_16_64_128;
             suite->app_hash = SHA_256;
             break;
@@ -48,9 +48,9 @@ EdhocError get_suite(enum suite_label label, struct suite* suite) {
             suite->suite_label = SUITE_3;
             suite->edhoc_aead = AES_CCM_16_128_128;
             suite->edhoc_hash = SHA_256;
-            suite->edhoc_ecdh_curve = 1;
+            suite->edhoc_ecdh_curve = P_256_ECDH;
             suite->edhoc_sign_alg = ES256;
-            suite->edhoc_sign_curve = 1;
+            suite->edhoc_sign_curve = P_256_SIGN;
             suite->app_aead = AES_CCM_16_64_128;
             suite->app_hash = SHA_256;
             break;
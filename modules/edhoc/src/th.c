@@ -10,141 +10,127 @@
 */
 #include "../inc/th.h"
 
-#include <cbor.h>
-
 #include "../edhoc.h"
 #include "../inc/crypto_wrapper.h"
 #include "../inc/error.h"
-#include "../inc/memcpy_s.h"
 #include "../inc/print_util.h"
 
+/*CBOR major types used in the transcript hash inputs*/
+#define CBOR_MT_UINT 0x00
+#define CBOR_MT_NINT 0x20
+#define CBOR_MT_BSTR 0x40
+
 /**
- * @brief   Setups a data structure used as input for th2
- * @param   msg1 pointer to a message 1
- * @param   msg1_len length of message 1
- * @param   c_i Pointer to the conception identifier of the initiator
- * @param   g_y Pointer to the public DH parameter
- * @param   c_r Pointer to the conception identifier of the responder
- * @param   th2_input ouput buffer for the data structure
- * @param   th2_input_len length of th2_input
+ * @brief   Absorbs the CBOR head of a data item into a hash state
+ * @param   s the hash state
+ * @param   major_type CBOR major type (already shifted)
+ * @param   val the argument of the head, e.g., the length of a bstr
  */
-static inline EdhocError th2_input_encode(
-    uint8_t* msg1, uint32_t msg1_len,
-    uint8_t* c_i, uint32_t c_i_len,
-    uint8_t* g_y, uint32_t g_y_len,
-    uint8_t* c_r, uint32_t c_r_len,
-    uint8_t* th2_input,
-    uint16_t* th2_input_len) {
-    CborEncoder enc;
-    CborError r;
-    EdhocError err;
-
-    err = _memcpy_s(th2_input, *th2_input_len, msg1, msg1_len);
-    if (err != EdhocNoError) return err;
-
-    cbor_encoder_init(&enc, (th2_input + msg1_len), (*th2_input_len - msg1_len), 0);
-
-    /*Encode C_I if present*/
-    if (c_i_len) {
-        r = cbor_encode_byte_string(&enc, c_i, c_i_len);
-        if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
-    }
-
-    /*Encode G_Y*/
-    r = cbor_encode_byte_string(&enc, g_y, g_y_len);
-    if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
-
-    /*Encode C_R as bstr_identifier*/
-    if (c_r_len == 1) {
-        r = cbor_encode_int(&enc, (*c_r - 24));
-        if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
+static EdhocError cbor_head_absorb(
+    struct hash_state* s,
+    uint8_t major_type,
+    uint64_t val) {
+    uint8_t head[9];
+    uint8_t len, i;
+
+    if (val < 24) {
+        head[0] = major_type | (uint8_t)val;
+        return hash_update(s, head, 1);
+    } else if (val <= 0xff) {
+        head[0] = major_type | 24;
+        len = 1;
+    } else if (val <= 0xffff) {
+        head[0] = major_type | 25;
+        len = 2;
+    } else if (val <= 0xffffffff) {
+        head[0] = major_type | 26;
+        len = 4;
     } else {
-        r = cbor_encode_byte_string(&enc, c_r, c_r_len);
-        if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
+        head[0] = major_type | 27;
+        len = 8;
     }
-
-    /* Get the CBOR length */
-    *th2_input_len = cbor_encoder_get_buffer_size(&enc, th2_input);
-
-    PRINT_ARRAY("Input to calculate TH_2 (CBOR Sequence)", th2_input, *th2_input_len);
-    return EdhocNoError;
+    for (i = 0; i < len; i++) {
+        head[len - i] = (uint8_t)(val >> (8 * i));
+    }
+    return hash_update(s, head, len + 1);
 }
 
 /**
- * @brief   Setups a data structure used as input for th3
- * @param   th2 pointer to a th2
- * @param   th2_len length of th2
- * @param   ciphertext_2 
- * @param   ciphertext_2_len  length of ciphertext_2_len
- * @param   data_3 
- * @param   data_3_len  length of data_3_len
- * @param   th3_input ouput buffer for the data structure
- * @param   th3_input_len length of th3_input
+ * @brief   Absorbs a CBOR byte string into a hash state
+ * @param   s the hash state
+ * @param   in content of the byte string
+ * @param   in_len length of in
  */
-static inline EdhocError th3_input_encode(
-    uint8_t* th2, uint8_t th2_len,
-    uint8_t* ciphertext_2, uint16_t ciphertext_2_len,
-    uint8_t* data_3, uint8_t data_3_len,
-    uint8_t* th3_input, uint16_t* th3_input_len) {
-    CborEncoder enc;
-    CborError r;
-
-    cbor_encoder_init(&enc, th3_input, *th3_input_len, 0);
-
-    /*Encode th2*/
-    r = cbor_encode_byte_string(&enc, th2, th2_len);
-    if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
-
-    /*Encode ciphertext_2*/
-    r = cbor_encode_byte_string(&enc, ciphertext_2, ciphertext_2_len);
-    if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
+static EdhocError bstr_absorb(
+    struct hash_state* s,
+    const uint8_t* in, uint32_t in_len) {
+    EdhocError r = cbor_head_absorb(s, CBOR_MT_BSTR, in_len);
+    if (r != EdhocNoError || in_len == 0) return r;
+    return hash_update(s, in, in_len);
+}
 
-    /*Encode C_R*/
-    if (data_3_len == 1) {
-        r = cbor_encode_int(&enc, (*data_3 - 24));
-        if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
-    } else {
-        r = cbor_encode_byte_string(&enc, data_3, data_3_len);
-        if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
+/**
+ * @brief   Absorbs a connection identifier encoded as bstr_identifier, i.e.,
+ *          single byte identifiers are encoded as integer (value - 24)
+ * @param   s the hash state
+ * @param   c the connection identifier
+ * @param   c_len length of c
+ */
+static EdhocError bstr_identifier_absorb(
+    struct hash_state* s,
+    const uint8_t* c, uint32_t c_len) {
+    if (c_len == 1) {
+        int32_t v = (int32_t)*c - 24;
+        if (v < 0) {
+            return cbor_head_absorb(s, CBOR_MT_NINT, (uint64_t)(-1 - v));
+        }
+        return cbor_head_absorb(s, CBOR_MT_UINT, (uint64_t)v);
     }
+    return bstr_absorb(s, c, c_len);
+}
 
-    /* Get the CBOR length */
-    *th3_input_len = cbor_encoder_get_buffer_size(&enc, th3_input);
+EdhocError th2_init(
+    enum hash_alg alg,
+    uint8_t* msg1, uint32_t msg1_len,
+    struct hash_state* th2_state) {
+    EdhocError r;
 
-    PRINT_ARRAY("Input to calculate TH_3 (CBOR Sequence)", th3_input, *th3_input_len);
-    return EdhocNoError;
+    PRINT_ARRAY("msg1", msg1, msg1_len);
+
+    r = hash_init(alg, th2_state);
+    if (r != EdhocNoError) return r;
+    return hash_update(th2_state, msg1, msg1_len);
 }
 
-/**
- * @brief   Setups a data structure used as input for th4
- * @param   th3 pointer to a th3
- * @param   th3_len length of th3
- * @param   ciphertext_3
- * @param   ciphertext_3_len  length of ciphertext_3_len
- * @param   th4_input ouput buffer for the data structure
- * @param   th4_input_len length of th4_input
- */
-static inline EdhocError th4_input_encode(
-    uint8_t* th3, uint8_t th3_len,
-    uint8_t* ciphertext_3, uint16_t ciphertext_3_len,
-    uint8_t* th4_input, uint64_t* th4_input_len) {
-    CborEncoder enc;
-    CborError r;
+EdhocError th2_final(
+    const struct hash_state* th2_state,
+    uint8_t* c_i, uint32_t c_i_len,
+    uint8_t* g_y, uint32_t g_y_len,
+    uint8_t* c_r, uint32_t c_r_len,
+    uint8_t* th2) {
+    /*fork the state so that msg1 does not have to be absorbed again*/
+    struct hash_state s = *th2_state;
+    EdhocError r;
 
-    cbor_encoder_init(&enc, th4_input, *th4_input_len, 0);
+    PRINT_ARRAY("c_r", c_r, c_r_len);
 
-    /*Encode th2*/
-    r = cbor_encode_byte_string(&enc, th3, th3_len);
-    if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
+    /*C_I if present*/
+    if (c_i_len) {
+        r = bstr_absorb(&s, c_i, c_i_len);
+        if (r != EdhocNoError) return r;
+    }
 
-    /*Encode ciphertext_2*/
-    r = cbor_encode_byte_string(&enc, ciphertext_3, ciphertext_3_len);
-    if (r == CborErrorOutOfMemory) return CborEncodingBufferToSmall;
+    /*G_Y*/
+    r = bstr_absorb(&s, g_y, g_y_len);
+    if (r != EdhocNoError) return r;
 
-    /* Get the CBOR length */
-    *th4_input_len = cbor_encoder_get_buffer_size(&enc, th4_input);
+    /*C_R as bstr_identifier*/
+    r = bstr_identifier_absorb(&s, c_r, c_r_len);
+    if (r != EdhocNoError) return r;
 
-    PRINT_ARRAY("Input to calculate TH_4 (CBOR Sequence)", th4_input, *th4_input_len);
+    r = hash_final(&s, th2);
+    if (r != EdhocNoError) return r;
+    PRINT_ARRAY("TH2", th2, SHA_DEFAULT_SIZE);
     return EdhocNoError;
 }
 
@@ -155,27 +141,10 @@ EdhocError th2_calculate(
     uint8_t* g_y, uint32_t g_y_len,
     uint8_t* c_r, uint32_t c_r_len,
     uint8_t* th2) {
-    uint8_t th2_input[TH_INPUT_DEFAULT_SIZE];
-    uint16_t th2_input_len = sizeof(th2_input);
-    EdhocError r;
-
-    PRINT_ARRAY("msg1", msg1, msg1_len);
-    PRINT_ARRAY("c_r", c_r, c_r_len);
-    PRINT_ARRAY("msg1", msg1, 37);
-    PRINT_ARRAY("c_r", c_r, 1);
-
-    r = th2_input_encode(
-        msg1, msg1_len,
-        c_i, c_i_len,
-        g_y, g_y_len,
-        c_r, c_r_len,
-        th2_input, &th2_input_len);
+    struct hash_state s;
+    EdhocError r = th2_init(alg, msg1, msg1_len, &s);
     if (r != EdhocNoError) return r;
-
-    r = hash(alg, th2_input, th2_input_len, th2);
-    if (r != EdhocNoError) return r;
-    PRINT_ARRAY("TH2", th2, SHA_DEFAULT_SIZE);
-    return EdhocNoError;
+    return th2_final(&s, c_i, c_i_len, g_y, g_y_len, c_r, c_r_len, th2);
 }
 
 EdhocError th3_calculate(
@@ -184,17 +153,25 @@ EdhocError th3_calculate(
     uint8_t* ciphertext_2, uint16_t ciphertext_2_len,
     uint8_t* data_3, uint8_t data_3_len,
     uint8_t* th3) {
-    uint8_t th3_input[th2_len + ciphertext_2_len + data_3_len + 6];
-    uint16_t th3_input_len = sizeof(th3_input);
-    EdhocError r = th3_input_encode(
-        th2, th2_len,
-        ciphertext_2, ciphertext_2_len,
-        data_3, data_3_len,
-        th3_input, &th3_input_len);
+    struct hash_state s;
+    EdhocError r;
+
+    r = hash_init(alg, &s);
+    if (r != EdhocNoError) return r;
+
+    r = bstr_absorb(&s, th2, th2_len);
+    if (r != EdhocNoError) return r;
+
+    r = bstr_absorb(&s, ciphertext_2, ciphertext_2_len);
     if (r != EdhocNoError) return r;
-    r = hash(alg, th3_input, th3_input_len, th3);
+
+    /*C_R as bstr_identifier, an omitted C_R is encoded as empty bstr*/
+    r = bstr_identifier_absorb(&s, data_3, data_3_len);
     if (r != EdhocNoError) return r;
-    PRINT_ARRAY("TH3", th3, 32);
+
+    r = hash_final(&s, th3);
+    if (r != EdhocNoError) return r;
+    PRINT_ARRAY("TH3", th3, SHA_DEFAULT_SIZE);
     return EdhocNoError;
 }
 
@@ -203,16 +180,19 @@ EdhocError th4_calculate(
     uint8_t* th3, uint8_t th3_len,
     uint8_t* ciphertext_3, uint16_t ciphertext_3_len,
     uint8_t* th4) {
-    uint8_t th4_input[th3_len + ciphertext_3_len + 4];
-    uint64_t th4_input_len = sizeof(th4_input);
+    struct hash_state s;
+    EdhocError r;
+
+    r = hash_init(alg, &s);
+    if (r != EdhocNoError) return r;
+
+    r = bstr_absorb(&s, th3, th3_len);
+    if (r != EdhocNoError) return r;
 
-    EdhocError r = th4_input_encode(
-        th3, th3_len,
-        ciphertext_3, ciphertext_3_len,
-        th4_input, &th4_input_len);
+    r = bstr_absorb(&s, ciphertext_3, ciphertext_3_len);
     if (r != EdhocNoError) return r;
 
-    r = hash(alg, th4_input, th4_input_len, th4);
+    r = hash_final(&s, th4);
     if (r != EdhocNoError) return r;
     PRINT_ARRAY("TH4", th4, SHA_DEFAULT_SIZE);
     return EdhocNoError;
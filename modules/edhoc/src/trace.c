@@ -0,0 +1,126 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifdef EDHOC_WITH_TRACE
+
+#include "../inc/trace.h"
+
+#include <time.h>
+
+static void (*trace_hook)(const struct edhoc_trace_event *e, void *arg);
+static void *trace_arg;
+
+void edhoc_trace_hook_set(
+    void (*hook)(const struct edhoc_trace_event *e, void *arg), void *arg) {
+    trace_arg = arg;
+    trace_hook = hook;
+}
+
+uint64_t __attribute__((weak)) edhoc_trace_time_ns(void) {
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+void edhoc_trace_begin(struct edhoc_trace *t, enum edhoc_phase phase) {
+    struct edhoc_trace_event e;
+
+    if (trace_hook == NULL) return;
+    t->begin_ns[phase] = edhoc_trace_time_ns();
+    e.handshake = t->handshake;
+    e.role = t->role;
+    e.method = t->method;
+    e.phase = phase;
+    e.end = false;
+    e.time_ns = t->begin_ns[phase];
+    e.duration_ns = 0;
+    e.bytes = 0;
+    e.r = EdhocNoError;
+    trace_hook(&e, trace_arg);
+}
+
+void edhoc_trace_end(
+    struct edhoc_trace *t, enum edhoc_phase phase, uint32_t bytes,
+    EdhocError r) {
+    struct edhoc_trace_event e;
+
+    if (trace_hook == NULL) return;
+    e.handshake = t->handshake;
+    e.role = t->role;
+    e.method = t->method;
+    e.phase = phase;
+    e.end = true;
+    e.time_ns = edhoc_trace_time_ns();
+    e.duration_ns = e.time_ns - t->begin_ns[phase];
+    e.bytes = bytes;
+    e.r = r;
+    trace_hook(&e, trace_arg);
+}
+
+/**
+ * @brief   Returns the histogram bucket of a duration
+ */
+static uint32_t bucket(uint64_t duration_ns) {
+    uint64_t us = duration_ns / 1000;
+    uint32_t b = 0;
+
+    while (us != 0 && b < EDHOC_TRACE_BUCKETS - 1) {
+        us >>= 1;
+        b++;
+    }
+    return b;
+}
+
+void edhoc_trace_stats_hook(const struct edhoc_trace_event *e, void *arg) {
+    struct edhoc_trace_stats *s = arg;
+    uint8_t m = e->method;
+
+    if (!e->end) return;
+    if (m > EDHOC_TRACE_METHOD_UNKNOWN) m = EDHOC_TRACE_METHOD_UNKNOWN;
+    __atomic_fetch_add(&s->count[m][e->phase], 1, __ATOMIC_RELAXED);
+    if (e->r != EdhocNoError) {
+        __atomic_fetch_add(&s->errors[m][e->phase], 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&s->bytes[m][e->phase], e->bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->total_ns[m][e->phase], e->duration_ns,
+                       __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->hist[m][e->phase][bucket(e->duration_ns)], 1,
+                       __ATOMIC_RELAXED);
+}
+
+uint64_t edhoc_trace_stats_percentile(
+    const struct edhoc_trace_stats *s, uint8_t method, enum edhoc_phase phase,
+    uint8_t percent) {
+    uint64_t n = 0, rank, seen = 0;
+    uint32_t b;
+
+    if (method > EDHOC_TRACE_METHOD_UNKNOWN || phase >= EDHOC_PHASE_NUM) {
+        return 0;
+    }
+    for (b = 0; b < EDHOC_TRACE_BUCKETS; b++) {
+        n += __atomic_load_n(&s->hist[method][phase][b], __ATOMIC_RELAXED);
+    }
+    if (n == 0) return 0;
+
+    /*the rank of the percentile, rounded up*/
+    rank = (n * percent + 99) / 100;
+    if (rank == 0) rank = 1;
+    for (b = 0; b < EDHOC_TRACE_BUCKETS - 1; b++) {
+        seen += __atomic_load_n(&s->hist[method][phase][b], __ATOMIC_RELAXED);
+        if (seen >= rank) break;
+    }
+    return (uint64_t)1 << b;
+}
+
+#endif
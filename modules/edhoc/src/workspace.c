@@ -0,0 +1,53 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#include "../inc/workspace.h"
+
+#include "../edhoc.h"
+#include "../inc/error.h"
+
+void workspace_init(struct edhoc_workspace *ws, uint8_t *buf, uint32_t size) {
+    ws->buf = buf;
+    ws->size = size;
+    ws->used = 0;
+    ws->peak = 0;
+}
+
+EdhocError workspace_alloc(
+    struct edhoc_workspace *ws,
+    uint32_t len,
+    uint8_t **out) {
+    uint32_t aligned = WORKSPACE_ALIGN_UP(len);
+
+    if (aligned < len || aligned > ws->size - ws->used) {
+        return WorkspaceTooSmall;
+    }
+    *out = ws->buf + ws->used;
+    ws->used += aligned;
+    if (ws->used > ws->peak) ws->peak = ws->used;
+    return EdhocNoError;
+}
+
+void workspace_release(struct edhoc_workspace *ws) {
+    /*volatile so that the erasure is not optimized away*/
+    volatile uint8_t *p = ws->buf;
+    for (uint32_t i = 0; i < ws->used; i++) {
+        p[i] = 0;
+    }
+    ws->used = 0;
+}
+
+uint32_t edhoc_initiator_workspace_size(void) {
+    return EDHOC_INITIATOR_WORKSPACE_SIZE;
+}
+
+uint32_t edhoc_responder_workspace_size(void) {
+    return EDHOC_RESPONDER_WORKSPACE_SIZE;
+}
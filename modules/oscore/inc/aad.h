@@ -12,7 +12,7 @@
 #ifndef AAD_H
 #define AAD_H
 
-#include "byte_array.h"
+#include "../../common/inc/byte_array.h"
 #include "error.h"
 #include "option.h"
 #include "supported_algorithm.h"
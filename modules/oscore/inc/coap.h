@@ -14,7 +14,7 @@
 
 #include <stdint.h>
 
-#include "byte_array.h"
+#include "../../common/inc/byte_array.h"
 #include "error.h"
 
 #define MAX_PIV_LEN 5
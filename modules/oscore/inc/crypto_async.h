@@ -0,0 +1,184 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifndef CRYPTO_ASYNC_H
+#define CRYPTO_ASYNC_H
+
+/*
+ * Asynchronous crypto provider, built with -DOSCORE_WITH_ASYNC_CRYPTO on
+ * hosts with <ucontext.h>. This is the OSCORE counterpart of the EDHOC
+ * interface of the same name.
+ *
+ * coap2oscore(), oscore2coap() or oscore_context_init() are run as a crypto
+ * task on a stack of its own. Inside the task aes_ccm_16_64_128() and the
+ * HKDF functions hand a struct oscore_crypto_op to the provider of the task.
+ * If the provider does not complete the operation right away the task is
+ * suspended and oscore_crypto_task_start() returns OscoreCryptoPending. The
+ * provider calls oscore_crypto_op_complete() when the result is ready,
+ * which calls the ready callback of the task, and its owner continues with
+ * oscore_crypto_task_resume(). Like the EDHOC tasks the OSCORE tasks are
+ * fibers of the common module, see fiber.h.
+ */
+#ifdef OSCORE_WITH_ASYNC_CRYPTO
+
+#include <stdint.h>
+
+#include "../../common/inc/byte_array.h"
+#include "../../common/inc/fiber.h"
+#include "crypto_wrapper.h"
+#include "error.h"
+
+enum oscore_crypto_op_type {
+    OSCORE_CRYPTO_OP_AES_CCM,
+    OSCORE_CRYPTO_OP_HKDF,
+    OSCORE_CRYPTO_OP_HKDF_EXTRACT,
+    OSCORE_CRYPTO_OP_HKDF_EXPAND,
+};
+
+struct oscore_crypto_task;
+
+/**
+ * An operation handed to a provider. The arguments are the ones of
+ * aes_ccm_16_64_128(), hkdf_sha_256(), hkdf_sha_256_extract() and
+ * hkdf_sha_256_expand(), they stay valid until the operation is completed.
+ */
+struct oscore_crypto_op {
+    enum oscore_crypto_op_type type;
+    union {
+        struct {
+            enum aes_operation op;
+            struct byte_array *in;
+            struct byte_array *out;
+            const struct aead_key *key;
+            struct byte_array *nonce;
+            struct byte_array *aad;
+            struct byte_array *tag;
+        } aes_ccm;
+        struct {
+            struct byte_array *master_secret;
+            struct byte_array *master_salt;
+            struct byte_array *info;
+            struct byte_array *out;
+        } hkdf;
+        struct {
+            struct byte_array *master_secret;
+            struct byte_array *master_salt;
+            struct hkdf_sha_256_prk *k;
+        } hkdf_extract;
+        struct {
+            const struct hkdf_sha_256_prk *k;
+            struct byte_array *info;
+            struct byte_array *out;
+        } hkdf_expand;
+    } u;
+    OscoreError r;                   /*set by oscore_crypto_op_complete()*/
+    struct oscore_crypto_task *task; /*set by the library*/
+};
+
+struct oscore_crypto_provider {
+    /**
+     * @brief   Starts an operation. oscore_crypto_op_complete() must be
+     *          called exactly once for every operation accepted, from any
+     *          thread and possibly before submit() returns.
+     * @param   p the provider
+     * @param   op the operation
+     * @retval  an OscoreError code, on error op is not completed
+     */
+    OscoreError (*submit)(
+        struct oscore_crypto_provider *p, struct oscore_crypto_op *op);
+    void *ctx; /*not used by the library*/
+};
+
+/*minimal stack of a task*/
+#ifndef OSCORE_CRYPTO_TASK_MIN_STACK_SIZE
+#define OSCORE_CRYPTO_TASK_MIN_STACK_SIZE 8192
+#endif
+
+/**
+ * A call into the library which can be suspended while the provider
+ * computes. A task must always be started and resumed by the same thread.
+ */
+struct oscore_crypto_task {
+    struct fiber f; /*first member*/
+    struct oscore_crypto_provider *provider;
+    void (*ready)(struct oscore_crypto_task *t, void *arg);
+    void *ready_arg;
+    OscoreError (*fn)(void *arg);
+    void *arg;
+    OscoreError r;
+};
+
+/**
+ * @brief   Initializes a task
+ * @param   t the task
+ * @param   stack stack of the task, at least OSCORE_CRYPTO_TASK_MIN_STACK_SIZE
+ *          bytes
+ * @param   stack_size size of stack
+ * @param   provider the provider the operations are handed to
+ * @param   ready called by oscore_crypto_op_complete() from the thread of the
+ *          provider when the task can be resumed. It must not resume the
+ *          task itself but wake up its owner.
+ * @param   ready_arg argument of ready
+ * @retval  an OscoreError code
+ */
+OscoreError oscore_crypto_task_init(
+    struct oscore_crypto_task *t,
+    void *stack, uint32_t stack_size,
+    struct oscore_crypto_provider *provider,
+    void (*ready)(struct oscore_crypto_task *t, void *arg), void *ready_arg);
+
+/**
+ * @brief   Runs fn(arg) in a task until it returns or waits for the provider
+ * @param   t the task
+ * @param   fn e.g., a wrapper of coap2oscore()
+ * @param   arg argument of fn
+ * @retval  OscoreCryptoPending if fn waits for the provider, otherwise the
+ *          return value of fn
+ */
+OscoreError oscore_crypto_task_start(
+    struct oscore_crypto_task *t, OscoreError (*fn)(void *arg), void *arg);
+
+/**
+ * @brief   Continues a suspended task after its ready callback was called
+ * @param   t the task
+ * @retval  OscoreCryptoPending if the task waits again, otherwise the
+ *          return value of fn
+ */
+OscoreError oscore_crypto_task_resume(struct oscore_crypto_task *t);
+
+/**
+ * @brief   Completes an operation, to be called by the provider
+ * @param   op the operation
+ * @param   r the result of the operation
+ */
+void oscore_crypto_op_complete(struct oscore_crypto_op *op, OscoreError r);
+
+/**
+ * @brief   Computes an operation synchronously, e.g., on a crypto thread
+ * @param   op the operation
+ * @retval  the result of the operation
+ */
+OscoreError oscore_crypto_op_run(struct oscore_crypto_op *op);
+
+/**
+ * @brief   Returns the task running on the calling thread or NULL
+ */
+struct oscore_crypto_task *oscore_crypto_task_current(void);
+
+/**
+ * @brief   Hands an operation to the provider of the running task and
+ *          suspends the task until it is completed
+ * @param   op the operation
+ * @retval  the result of the operation
+ */
+OscoreError oscore_crypto_offload(struct oscore_crypto_op *op);
+
+#endif
+#endif
@@ -12,20 +12,41 @@
 #define CRYPTO_WRAPPER_H
 
 #include "error.h"
-#include "byte_array.h"
+#include "../../common/inc/byte_array.h"
+#include "../../common/inc/crypto_backend.h"
 
-/*Indicates what kind of operation a symmetric cipher will execute*/
-enum aes_operation{
-    ENCRYPT,
-    DECRYPT,
+#ifndef AEAD_KEY_STATE_SIZE
+#define AEAD_KEY_STATE_SIZE 224
+#endif
+
+/**
+ * Key handle of aes_ccm_16_64_128(). It is created by aead_key_init() when
+ * the Sender or Recipient Key is derived and kept in the security context,
+ * so that the key is not imported for every message. What it holds is up to
+ * the implementation of both functions, the default holds the key prepared
+ * by the crypto backend, e.g., the expanded AES key schedule. The handle is
+ * plain memory, it can be copied and needs no free.
+ */
+struct aead_key {
+    union {
+        uint8_t bytes[AEAD_KEY_STATE_SIZE];
+        uint64_t align;
+    } ctx;
 };
 
+/**
+ * @brief   Creates the handle of a key of aes_ccm_16_64_128()
+ * @param   k the handle
+ * @param   key the key (16 Byte)
+ */
+OscoreError aead_key_init(struct aead_key *k, const struct byte_array *key);
+
 /**
  * @brief   aes_ccm_16_64_128 symmetric algorithm
  * @param   op ENCRYPT/DECRYPT
  * @param   in byte array containing the plaintext/ciphertext
  * @param   out byte array containing the plaintext/ciphertext
- * @param   key the key (16 Byte)
+ * @param   key the key handle created by aead_key_init()
  * @param   nonce the nonce (13 Byte)
  * @param   aad data which is only authenticated not encrypted
  * @param   tag outputs the authentication tag in case of encryption. 
@@ -37,7 +58,7 @@ OscoreError aes_ccm_16_64_128(
     enum aes_operation op,
     struct byte_array *in,
     struct byte_array *out,
-    struct byte_array *key,
+    const struct aead_key *key,
     struct byte_array *nonce,
     struct byte_array *aad,
     struct byte_array *tag);
@@ -56,4 +77,48 @@ OscoreError hkdf_sha_256(
     struct byte_array *info,
     struct byte_array *out);
 
+/*size of struct hkdf_sha_256_prk, large enough for the keyed HMAC-SHA256
+state of crypto_backend.h*/
+#ifndef HKDF_PRK_STATE_SIZE
+#define HKDF_PRK_STATE_SIZE 256
+#endif
+
+/**
+ * PRK of the derivation of a security context. hkdf_sha_256_extract() 
+ * computes it from the Master Secret and the Master Salt and keys the HMAC 
+ * with it, the Common IV and the Sender and Recipient Keys are expanded from 
+ * it with hkdf_sha_256_expand(). The state is plain memory, it contains key 
+ * material and should be cleared after use.
+ */
+struct hkdf_sha_256_prk {
+    union {
+        uint8_t bytes[HKDF_PRK_STATE_SIZE];
+        uint64_t align;
+    } ctx;
+};
+
+/**
+ * @brief   HKDF extract step of hkdf_sha_256(), prepares the PRK for 
+ *          hkdf_sha_256_expand()
+ * @param   master_secret the master secret
+ * @param   master_salt the master salt
+ * @param   k the prepared PRK
+ */
+OscoreError hkdf_sha_256_extract(
+    struct byte_array *master_secret,
+    struct byte_array *master_salt,
+    struct hkdf_sha_256_prk *k);
+
+/**
+ * @brief   HKDF expand step of hkdf_sha_256() with a PRK prepared by 
+ *          hkdf_sha_256_extract()
+ * @param   k the prepared PRK
+ * @param   info a CBOR structure containing id, id_context, alg_aead, type, L 
+ * @param   out the derived Common IV, Recipient/Sender keys
+ */
+OscoreError hkdf_sha_256_expand(
+    const struct hkdf_sha_256_prk *k,
+    struct byte_array *info,
+    struct byte_array *out);
+
 #endif
@@ -36,6 +36,9 @@ typedef enum OscoreError {
     DestBufferToSmall = 14,
     DeltaExtraByteError = 15,
     LenExtraByteError = 16,
+    OscoreInvalidCombinedRequest = 17,
+    OscoreTooManyOptions = 18,
+    OscoreCryptoPending = 19,
 } OscoreError;
 
 #endif
@@ -12,7 +12,7 @@
 #ifndef HKDF_INFO_H
 #define HKDF_INFO_H
 
-#include "byte_array.h"
+#include "../../common/inc/byte_array.h"
 #include "error.h"
 #include "security_context.h"
 #include "supported_algorithm.h"
@@ -12,7 +12,7 @@
 #ifndef NONCE_H
 #define NONCE_H
 
-#include "byte_array.h"
+#include "../../common/inc/byte_array.h"
 #include "error.h"
 
 /**
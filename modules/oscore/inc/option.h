@@ -15,7 +15,7 @@
 #include <stdint.h>
 //#include <net/coap.h>
 
-#include "byte_array.h"
+#include "../../common/inc/byte_array.h"
 #include "coap.h"
 #include "error.h"
 
@@ -34,6 +34,7 @@ enum o_coap_option_num {
     COAP_OPTION_URI_QUERY = 15,
     COAP_OPTION_ACCEPT = 17,
     COAP_OPTION_LOCATION_QUERY = 20,
+    COAP_OPTION_EDHOC = 21, /*draft-ietf-core-oscore-edhoc, value TBD*/
     COAP_OPTION_BLOCK2 = 23,
     COAP_OPTION_BLOCK1 = 27,
     COAP_OPTION_SIZE2 = 28,
@@ -12,7 +12,8 @@
 #ifndef OSCORE_COSE_H
 #define OSCORE_COSE_H
 
-#include "byte_array.h"
+#include "../../common/inc/byte_array.h"
+#include "crypto_wrapper.h"
 #include "error.h"
 
 /**
@@ -37,7 +38,7 @@ OscoreError enc_structure_length(struct byte_array* external_aad, size_t* out);
  * @param out_plaintext: output plaintext
  * @param nonce the nonce
  * @param aad the aad
- * @param recipient_key the recipient key
+ * @param recipient_key the handle of the recipient key
  * @return OscoreError
  */
 OscoreError cose_decrypt(
@@ -45,7 +46,7 @@ OscoreError cose_decrypt(
     struct byte_array* out_plaintext,
     struct byte_array* nonce,
     struct byte_array* aad,
-    struct byte_array* recipient_key);
+    const struct aead_key* recipient_key);
 
 /**
  * @brief Encrypt the plaintext
@@ -53,7 +54,7 @@ OscoreError cose_decrypt(
  * @param out_ciphertext: output ciphertext with authentication tag (8 bytes)
  * @param nonce the nonce
  * @param aad the aad
- * @param sender_key the sender key
+ * @param sender_key the handle of the sender key
  * @return OscoreError
  */
 OscoreError cose_encrypt(
@@ -61,5 +62,5 @@ OscoreError cose_encrypt(
     uint8_t *out_ciphertext, uint32_t out_ciphertext_len,
     struct byte_array* nonce,
     struct byte_array* sender_aad, 
-    struct byte_array* key) ;
+    const struct aead_key* key) ;
 #endif
@@ -13,10 +13,8 @@
 #define OSCORE_PRINT_UTIL_H
 
 #include <stdint.h>
-/**
- *@brief prints an array for debug pourposes 
- */
-void print_array(uint8_t* in_data, uint16_t in_len);
+
+#include "../../common/inc/print_util.h"
 
 #ifdef OSCORE_DEBUG_PRINT
 #define PRINT_ARRAY(msg, a, a_len) \
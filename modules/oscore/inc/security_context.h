@@ -12,7 +12,8 @@
 #ifndef SECURITY_CONTEXT_H
 #define SECURITY_CONTEXT_H
 
-#include "byte_array.h"
+#include "../../common/inc/byte_array.h"
+#include "crypto_wrapper.h"
 #include "error.h"
 #include "supported_algorithm.h"
 #include "coap.h"
@@ -55,6 +56,7 @@ struct sender_context {
     uint8_t sender_id_buf[7];
     struct byte_array sender_key;
     uint8_t sender_key_buf[SENDER_KEY_LEN_];
+    struct aead_key sender_key_handle; /*sender_key for aes_ccm_16_64_128()*/
     uint64_t sender_seq_num;
 };
 
@@ -63,6 +65,8 @@ struct recipient_context {
     struct byte_array recipient_id;
     struct byte_array recipient_key;
     uint8_t recipient_key_buf[RECIPIENT_KEY_LEN_];
+    /*recipient_key for aes_ccm_16_64_128()*/
+    struct aead_key recipient_key_handle;
     /*replay window not implement yet*/
     //replay_window replay_window;
 };
@@ -15,7 +15,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-#include "inc/byte_array.h"
+#include "../common/inc/byte_array.h"
 #include "inc/error.h"
 #include "inc/print_util.h"
 #include "inc/security_context.h"
@@ -59,6 +59,27 @@ OscoreError oscore_context_init(
     struct oscore_init_params* params,
     struct context* c);
 
+/**
+ * @brief   Replaces the keys of a security context, e.g., after an 
+ *          EDHOC-KeyUpdate (see edhoc_key_update()). A new context with the 
+ *          given master secret and salt and the identifiers and algorithms 
+ *          of c is derived and swapped in. c stays unchanged if this fails.
+ *          The sender sequence number starts again at 0. Like with 
+ *          oscore_context_init() the master secret and salt are referenced,
+ *          not copied.
+ *
+ * @param   dev_type SERVER or CLIENT, as used for oscore_context_init()
+ * @param   master_secret the new master secret
+ * @param   master_salt the new master salt
+ * @param   c the context to be updated
+ * @return  OscoreError
+ */
+OscoreError oscore_context_key_update(
+    enum dev_type dev_type,
+    const struct byte_array* master_secret,
+    const struct byte_array* master_salt,
+    struct context* c);
+
 /**
  * @brief  	Checks if the packet in buf_in is a OSCORE packet.
  * 			If so it converts it to a CoAP packet and sets the oscore_pkg to
@@ -98,4 +119,51 @@ OscoreError coap2oscore(
     uint8_t* buf_oscore, uint16_t* buf_oscore_len,
     struct context* c);
 
+/**
+ *@brief 	Builds a combined EDHOC+OSCORE request (see 
+ *			draft-ietf-core-oscore-edhoc), i.e., adds the EDHOC option to an 
+ *			OSCORE request and prepends EDHOC message 3 to its payload. The 
+ *			request must have been protected with the context derived from 
+ *			the handshake (see edhoc_initiator_run_combined()) and must not 
+ *			carry an EDHOC option yet.
+ *
+ *@param	oscore_req the OSCORE request created with coap2oscore()
+ *@param	oscore_req_len length of oscore_req
+ *@param	edhoc_msg3 EDHOC message 3
+ *@param	edhoc_msg3_len length of edhoc_msg3
+ *@param	payload_buf a buffer for the payload of the combined request. It 
+ *			must hold edhoc_msg3_len + 3 byte plus the OSCORE payload.
+ *@param	payload_buf_len size of payload_buf
+ *@param	out a buffer where the combined request will be written
+ *@param	out_len in: size of out, out: length of the combined request
+ *@return 	OscoreError
+ */
+OscoreError oscore_combined_request_build(
+    uint8_t* oscore_req, uint16_t oscore_req_len,
+    const uint8_t* edhoc_msg3, uint16_t edhoc_msg3_len,
+    uint8_t* payload_buf, uint16_t payload_buf_len,
+    uint8_t* out, uint16_t* out_len);
+
+/**
+ *@brief 	Splits a combined EDHOC+OSCORE request into EDHOC message 3 and 
+ *			the OSCORE request. The responder hands message 3 to 
+ *			edhoc_responder_run() and passes the OSCORE request to 
+ *			oscore2coap() once the context was derived from the handshake.
+ *
+ *@param	in the received packet
+ *@param	in_len length of in
+ *@param	combined true if in was a combined request. If false, nothing 
+ *			was written to the output buffers.
+ *@param	edhoc_msg3 buffer for EDHOC message 3
+ *@param	edhoc_msg3_len in: size of edhoc_msg3, out: length of message 3
+ *@param	oscore_req buffer for the OSCORE request
+ *@param	oscore_req_len in: size of oscore_req, out: length of the request
+ *@return 	OscoreError
+ */
+OscoreError oscore_combined_request_split(
+    uint8_t* in, uint16_t in_len,
+    bool* combined,
+    uint8_t* edhoc_msg3, uint16_t* edhoc_msg3_len,
+    uint8_t* oscore_req, uint16_t* oscore_req_len);
+
 #endif
@@ -39,14 +39,16 @@ OscoreError options_into_byte_string(
         if (options[i].delta < 13 && options[i].len < 13)
             *(temp_ptr) = (uint8_t)(options[i].delta << 4) | (uint8_t)(options[i].len);
         else {
-            if (options[i].delta >= 13 && options[i].delta < 243)
+            /* RFC7252 3.1: 13 - one extra byte holding the value minus 13, 
+            14 - two extra bytes holding the value minus 269 */
+            if (options[i].delta >= 13 && options[i].delta < 269)
                 delta_extra_byte = 1;
-            else if (options[i].delta >= 243)
+            else if (options[i].delta >= 269)
                 delta_extra_byte = 2;
 
-            if (options[i].len >= 13 && options[i].len < 243)
+            if (options[i].len >= 13 && options[i].len < 269)
                 len_extra_byte = 1;
-            else if (options[i].len >= 243)
+            else if (options[i].len >= 269)
                 len_extra_byte = 2;
 
             switch (delta_extra_byte) {
@@ -55,11 +57,11 @@ OscoreError options_into_byte_string(
                     break;
                 case 1:
                     *(temp_ptr) = (uint8_t)(13 << 4);
-                    *(temp_ptr + 1) = options[i].delta + 13;
+                    *(temp_ptr + 1) = options[i].delta - 13;
                     break;
                 case 2:
                     *(temp_ptr) = (uint8_t)(14 << 4);
-                    uint16_t temp_delta = options[i].delta + 269;
+                    uint16_t temp_delta = options[i].delta - 269;
                     *(temp_ptr + 1) = (uint8_t)((temp_delta & 0xFF00) >> 8);
                     *(temp_ptr + 2) = (uint8_t)((temp_delta & 0x00FF) >> 0);
                     break;
@@ -73,11 +75,11 @@ OscoreError options_into_byte_string(
                     break;
                 case 1:
                     *(temp_ptr) |= 13;
-                    *(temp_ptr + delta_extra_byte + 1) = options[i].len + 13;
+                    *(temp_ptr + delta_extra_byte + 1) = options[i].len - 13;
                     break;
                 case 2:
                     *(temp_ptr) |= 14;
-                    uint16_t temp_len = options[i].len + 269;
+                    uint16_t temp_len = options[i].len - 269;
                     *(temp_ptr + delta_extra_byte + 1) = (uint8_t)((temp_len & 0xFF00) >> 8);
                     *(temp_ptr + delta_extra_byte + 2) = (uint8_t)((temp_len & 0x00FF) >> 0);
                     break;
@@ -131,12 +133,12 @@ static inline OscoreError buf2options(uint8_t *in_data, uint16_t in_data_len,
         switch (temp_option_delta) {
             case 13:
                 temp_option_header_len += 1;
-                temp_option_delta = *temp_options_ptr - 13;
+                temp_option_delta = *temp_options_ptr + 13;
                 temp_options_ptr += 1;
                 break;
             case 14:
                 temp_option_header_len += 2;
-                temp_option_delta = ((uint16_t)(*temp_options_ptr) << 8 | *(temp_options_ptr + 1)) - 269;
+                temp_option_delta = ((uint16_t)(*temp_options_ptr) << 8 | *(temp_options_ptr + 1)) + 269;
                 temp_options_ptr += 2;
                 break;
             case 15:
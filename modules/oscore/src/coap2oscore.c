@@ -13,7 +13,7 @@
 #include <string.h>
 
 #include "../inc/aad.h"
-#include "../inc/byte_array.h"
+#include "../../common/inc/byte_array.h"
 #include "../inc/coap.h"
 #include "../inc/error.h"
 #include "../inc/memcpy_s.h"
@@ -173,7 +173,7 @@ static inline OscoreError plaintext_encrypt(
         in_plaintext,
         out_ciphertext, out_ciphertext_len,
         &c->rrc.nonce,
-        &c->rrc.aad, &c->sc.sender_key);
+        &c->rrc.aad, &c->sc.sender_key_handle);
 }
 
 /**
@@ -0,0 +1,182 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../common/inc/byte_array.h"
+#include "../inc/coap.h"
+#include "../inc/error.h"
+#include "../inc/memcpy_s.h"
+#include "../inc/option.h"
+#include "../inc/print_util.h"
+
+/*
+ * A combined request (draft-ietf-core-oscore-edhoc) is an OSCORE request
+ * with an empty EDHOC option. Its payload is the EDHOC message 3 wrapped in
+ * a CBOR byte string followed by the OSCORE payload.
+ */
+
+#define CBOR_BSTR_MAJOR 0x40
+#define CBOR_AI_1BYTE 24
+#define CBOR_AI_2BYTE 25
+
+/**
+ * @brief   Encodes the head of a CBOR byte string of length len
+ * @param   len length of the byte string
+ * @param   out buffer of at least 3 byte
+ * @return  the length of the head
+ */
+static uint8_t bstr_head_encode(uint16_t len, uint8_t *out) {
+    if (len < CBOR_AI_1BYTE) {
+        out[0] = CBOR_BSTR_MAJOR | (uint8_t)len;
+        return 1;
+    } else if (len <= 0xFF) {
+        out[0] = CBOR_BSTR_MAJOR | CBOR_AI_1BYTE;
+        out[1] = (uint8_t)len;
+        return 2;
+    }
+    out[0] = CBOR_BSTR_MAJOR | CBOR_AI_2BYTE;
+    out[1] = (uint8_t)(len >> 8);
+    out[2] = (uint8_t)len;
+    return 3;
+}
+
+/**
+ * @brief   Decodes the head of a CBOR byte string
+ * @param   in the encoded data
+ * @param   in_len length of in
+ * @param   head_len length of the head
+ * @param   len length of the byte string
+ * @return  OscoreError
+ */
+static OscoreError bstr_head_decode(
+    const uint8_t *in, uint16_t in_len,
+    uint8_t *head_len, uint16_t *len) {
+    if (in_len < 1 || (in[0] & 0xE0) != CBOR_BSTR_MAJOR) {
+        return OscoreInvalidCombinedRequest;
+    }
+    uint8_t ai = in[0] & 0x1F;
+    if (ai < CBOR_AI_1BYTE) {
+        *head_len = 1;
+        *len = ai;
+    } else if (ai == CBOR_AI_1BYTE && in_len >= 2) {
+        *head_len = 2;
+        *len = in[1];
+    } else if (ai == CBOR_AI_2BYTE && in_len >= 3) {
+        *head_len = 3;
+        *len = (uint16_t)((in[1] << 8) | in[2]);
+    } else {
+        return OscoreInvalidCombinedRequest;
+    }
+    if (*len > in_len - *head_len) return OscoreInvalidCombinedRequest;
+    return OscoreNoError;
+}
+
+OscoreError oscore_combined_request_build(
+    uint8_t *oscore_req, uint16_t oscore_req_len,
+    const uint8_t *edhoc_msg3, uint16_t edhoc_msg3_len,
+    uint8_t *payload_buf, uint16_t payload_buf_len,
+    uint8_t *out, uint16_t *out_len) {
+    struct o_coap_packet pkt;
+    struct byte_array in = {.len = oscore_req_len, .ptr = oscore_req};
+    OscoreError r;
+    uint8_t i, prev_num = 0;
+
+    r = buf2coap(&in, &pkt);
+    if (r != OscoreNoError) return r;
+    if (pkt.options_cnt >= MAX_OPTION_COUNT) return OscoreTooManyOptions;
+
+    /*insert the EDHOC option in option number order*/
+    for (i = 0; i < pkt.options_cnt; i++) {
+        if (pkt.options[i].option_number == COAP_OPTION_EDHOC) {
+            return OscoreInvalidCombinedRequest;
+        }
+        if (pkt.options[i].option_number > COAP_OPTION_EDHOC) break;
+        prev_num = pkt.options[i].option_number;
+    }
+    memmove(&pkt.options[i + 1], &pkt.options[i],
+            (pkt.options_cnt - i) * sizeof(pkt.options[0]));
+    pkt.options[i].delta = COAP_OPTION_EDHOC - prev_num;
+    pkt.options[i].len = 0;
+    pkt.options[i].value = NULL;
+    pkt.options[i].option_number = COAP_OPTION_EDHOC;
+    if (i < pkt.options_cnt) {
+        pkt.options[i + 1].delta -= pkt.options[i].delta;
+    }
+    pkt.options_cnt++;
+
+    /*payload: bstr(message 3) | OSCORE payload*/
+    uint8_t head[3];
+    uint8_t head_len = bstr_head_encode(edhoc_msg3_len, head);
+    if ((uint32_t)head_len + edhoc_msg3_len + pkt.payload_len >
+        payload_buf_len) {
+        return DestBufferToSmall;
+    }
+    memcpy(payload_buf, head, head_len);
+    memcpy(payload_buf + head_len, edhoc_msg3, edhoc_msg3_len);
+    if (pkt.payload_len) {
+        memcpy(payload_buf + head_len + edhoc_msg3_len, pkt.payload,
+               pkt.payload_len);
+    }
+    pkt.payload = payload_buf;
+    pkt.payload_len = head_len + edhoc_msg3_len + pkt.payload_len;
+
+    return coap2buf(&pkt, out, out_len);
+}
+
+OscoreError oscore_combined_request_split(
+    uint8_t *in, uint16_t in_len,
+    bool *combined,
+    uint8_t *edhoc_msg3, uint16_t *edhoc_msg3_len,
+    uint8_t *oscore_req, uint16_t *oscore_req_len) {
+    struct o_coap_packet pkt;
+    struct byte_array in_array = {.len = in_len, .ptr = in};
+    OscoreError r;
+    uint8_t i;
+
+    *combined = false;
+    r = buf2coap(&in_array, &pkt);
+    if (r != OscoreNoError) return r;
+
+    for (i = 0; i < pkt.options_cnt; i++) {
+        if (pkt.options[i].option_number == COAP_OPTION_EDHOC) break;
+    }
+    if (i == pkt.options_cnt) return OscoreNoError;
+
+    /*remove the EDHOC option*/
+    if (i + 1 < pkt.options_cnt) {
+        pkt.options[i + 1].delta += pkt.options[i].delta;
+    }
+    memmove(&pkt.options[i], &pkt.options[i + 1],
+            (pkt.options_cnt - i - 1) * sizeof(pkt.options[0]));
+    pkt.options_cnt--;
+
+    /*the payload starts with message 3*/
+    uint8_t head_len;
+    uint16_t len;
+    r = bstr_head_decode(pkt.payload, pkt.payload_len, &head_len, &len);
+    if (r != OscoreNoError) return r;
+    r = _memcpy_s(edhoc_msg3, *edhoc_msg3_len, pkt.payload + head_len, len);
+    if (r != OscoreNoError) return r;
+    *edhoc_msg3_len = len;
+    PRINT_ARRAY("EDHOC message 3 of the combined request", edhoc_msg3, len);
+
+    pkt.payload += head_len + len;
+    pkt.payload_len -= head_len + len;
+    if (pkt.payload_len == 0) pkt.payload = NULL;
+
+    r = coap2buf(&pkt, oscore_req, oscore_req_len);
+    if (r != OscoreNoError) return r;
+    *combined = true;
+    return OscoreNoError;
+}
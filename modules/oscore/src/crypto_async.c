@@ -0,0 +1,106 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifdef OSCORE_WITH_ASYNC_CRYPTO
+
+#include "../inc/crypto_async.h"
+
+#include <string.h>
+
+#include "../inc/crypto_wrapper.h"
+#include "../inc/error.h"
+
+/*the fiber of a task, see fiber.h*/
+static void task_body(struct fiber *f) {
+    struct oscore_crypto_task *t = (struct oscore_crypto_task *)f;
+
+    t->r = t->fn(t->arg);
+}
+
+static void task_ready(struct fiber *f, void *arg) {
+    struct oscore_crypto_task *t = (struct oscore_crypto_task *)f;
+
+    t->ready(t, t->ready_arg);
+}
+
+OscoreError oscore_crypto_task_init(
+    struct oscore_crypto_task *t,
+    void *stack, uint32_t stack_size,
+    struct oscore_crypto_provider *provider,
+    void (*ready)(struct oscore_crypto_task *t, void *arg), void *ready_arg) {
+    if (stack_size < OSCORE_CRYPTO_TASK_MIN_STACK_SIZE) return DestBufferToSmall;
+    memset(t, 0, sizeof(*t));
+    fiber_init(&t->f, stack, stack_size, ready != NULL ? task_ready : NULL,
+               NULL);
+    t->provider = provider;
+    t->ready = ready;
+    t->ready_arg = ready_arg;
+    return OscoreNoError;
+}
+
+OscoreError oscore_crypto_task_start(
+    struct oscore_crypto_task *t, OscoreError (*fn)(void *arg), void *arg) {
+    t->fn = fn;
+    t->arg = arg;
+    return fiber_start(&t->f, task_body) ? t->r : OscoreCryptoPending;
+}
+
+OscoreError oscore_crypto_task_resume(struct oscore_crypto_task *t) {
+    return fiber_resume(&t->f) ? t->r : OscoreCryptoPending;
+}
+
+struct oscore_crypto_task *oscore_crypto_task_current(void) {
+    struct fiber *f = fiber_current();
+
+    /*the fiber may also run an EDHOC task*/
+    if (f == NULL || f->fn != task_body) return NULL;
+    return (struct oscore_crypto_task *)f;
+}
+
+OscoreError oscore_crypto_offload(struct oscore_crypto_op *op) {
+    struct oscore_crypto_task *t =
+        (struct oscore_crypto_task *)fiber_wait_begin();
+    OscoreError r;
+
+    op->task = t;
+    r = t->provider->submit(t->provider, op);
+    fiber_wait(&t->f, r == OscoreNoError);
+    return r == OscoreNoError ? op->r : r;
+}
+
+void oscore_crypto_op_complete(struct oscore_crypto_op *op, OscoreError r) {
+    op->r = r;
+    fiber_wake(&op->task->f);
+}
+
+OscoreError oscore_crypto_op_run(struct oscore_crypto_op *op) {
+    switch (op->type) {
+        case OSCORE_CRYPTO_OP_AES_CCM:
+            return aes_ccm_16_64_128(
+                op->u.aes_ccm.op, op->u.aes_ccm.in, op->u.aes_ccm.out,
+                op->u.aes_ccm.key, op->u.aes_ccm.nonce, op->u.aes_ccm.aad,
+                op->u.aes_ccm.tag);
+        case OSCORE_CRYPTO_OP_HKDF:
+            return hkdf_sha_256(
+                op->u.hkdf.master_secret, op->u.hkdf.master_salt,
+                op->u.hkdf.info, op->u.hkdf.out);
+        case OSCORE_CRYPTO_OP_HKDF_EXTRACT:
+            return hkdf_sha_256_extract(op->u.hkdf_extract.master_secret,
+                                        op->u.hkdf_extract.master_salt,
+                                        op->u.hkdf_extract.k);
+        case OSCORE_CRYPTO_OP_HKDF_EXPAND:
+            return hkdf_sha_256_expand(op->u.hkdf_expand.k,
+                                       op->u.hkdf_expand.info,
+                                       op->u.hkdf_expand.out);
+    }
+    return OscoreInvalidAlgorithmAEAD;
+}
+
+#endif
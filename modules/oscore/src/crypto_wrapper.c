@@ -10,80 +10,64 @@
 */
 #include "../inc/crypto_wrapper.h"
 
-#include "../inc/byte_array.h"
+#include <string.h>
+
+#include "../../common/inc/byte_array.h"
+#include "../inc/crypto_async.h"
+#include "../../common/inc/crypto_backend.h"
 #include "../inc/error.h"
 
-#ifdef OSCORE_WITH_TINYCRYPT
+#define TAG_SIZE 8
 
-#include <string.h>
-#include <tinycrypt/aes.h>
-#include <tinycrypt/ccm_mode.h>
-#include <tinycrypt/constants.h>
-#include <tinycrypt/hmac.h>
+#ifndef OSCORE_WITH_OPENSSL
+/*replaced by crypto_wrapper_openssl.c*/
 
-#define try_tc(e)                        \
-    do {                                 \
-        int res = (e);                   \
-        if (res != TC_CRYPTO_SUCCESS) {  \
-            return OscoreTinyCryptError; \
-        }                                \
-    } while (0)
+/*the prepared key must fit into struct aead_key*/
+typedef char aead_key_size_check
+    [(sizeof(struct crypto_aes_key) <= AEAD_KEY_STATE_SIZE) ? 1 : -1];
 
-#define SALT_SIZE 32
-
-#endif
+OscoreError __attribute__((weak)) aead_key_init(
+    struct aead_key *k,
+    const struct byte_array *key) {
+    if (key->len != 16) return OscoreTinyCryptError;
+    crypto_aes_key_init((struct crypto_aes_key *)k->ctx.bytes, key->ptr);
+    return OscoreNoError;
+}
 
 OscoreError __attribute__((weak)) aes_ccm_16_64_128(
     enum aes_operation op,
     struct byte_array *in,
     struct byte_array *out,
-    struct byte_array *key,
+    const struct aead_key *key,
     struct byte_array *nonce,
     struct byte_array *aad,
     struct byte_array *tag) {
-#ifdef OSCORE_WITH_TINYCRYPT
-    int result = TC_CRYPTO_SUCCESS;
-
-    struct tc_ccm_mode_struct c;
-    struct tc_aes_key_sched_struct sched;
-    tc_aes128_set_encrypt_key(&sched, key->ptr);
-
-    result = tc_ccm_config(&c, &sched, nonce->ptr, nonce->len, 8);
-    if (result == 0) {
-        return OscoreTinyCryptError;
+#ifdef OSCORE_WITH_ASYNC_CRYPTO
+    /*inside a crypto task the provider computes, see crypto_async.h*/
+    if (oscore_crypto_task_current() != NULL) {
+        struct oscore_crypto_op o = {
+            .type = OSCORE_CRYPTO_OP_AES_CCM,
+            .u.aes_ccm = {op, in, out, key, nonce, aad, tag}};
+        return oscore_crypto_offload(&o);
     }
+#endif
+    int result;
 
+    /*the tag follows the ciphertext in out when encrypting and in in when
+    decrypting*/
     if (op == DECRYPT) {
-        result = tc_ccm_decryption_verification(
-            out->ptr,
-            out->len,
-            aad->ptr,
-            aad->len,
-            in->ptr,
-            in->len,
-            &c);
-
-        if (result == 0) {
-            return OscoreAuthenticationError;
-        }
-
-    } else {
-        result = tc_ccm_generation_encryption(
-            out->ptr,
-            out->len,
-            aad->ptr,
-            aad->len,
-            in->ptr,
-            in->len,
-            &c);
-
-        if (result == 0) {
-            return OscoreTinyCryptError;
-        }
+        if (in->len < TAG_SIZE) return OscoreAuthenticationError;
+        if (out->len < in->len - TAG_SIZE) return DestBufferToSmall;
+    } else if (out->len < in->len + TAG_SIZE) {
+        return DestBufferToSmall;
     }
 
-#endif /* TINYCRYPT */
-
+    result = crypto_aes_ccm_key((const struct crypto_aes_key *)key->ctx.bytes,
+                                op, nonce->ptr, (uint8_t)nonce->len, aad->ptr,
+                                aad->len, in->ptr, in->len, out->ptr,
+                                TAG_SIZE);
+    if (result == CRYPTO_BACKEND_AUTH_FAILED) return OscoreAuthenticationError;
+    if (result != CRYPTO_BACKEND_OK) return OscoreTinyCryptError;
     return OscoreNoError;
 };
 
@@ -92,60 +76,72 @@ OscoreError __attribute__((weak)) hkdf_sha_256(
     struct byte_array *master_salt,
     struct byte_array *info,
     struct byte_array *out) {
-#ifdef OSCORE_WITH_TINYCRYPT
+#ifdef OSCORE_WITH_ASYNC_CRYPTO
+    if (oscore_crypto_task_current() != NULL) {
+        struct oscore_crypto_op o = {
+            .type = OSCORE_CRYPTO_OP_HKDF,
+            .u.hkdf = {master_secret, master_salt, info, out}};
+        return oscore_crypto_offload(&o);
+    }
+#endif
+    struct hkdf_sha_256_prk k;
+    OscoreError r;
+
+    r = hkdf_sha_256_extract(master_secret, master_salt, &k);
+    if (r == OscoreNoError) r = hkdf_sha_256_expand(&k, info, out);
+    memset(&k, 0, sizeof(k));
+    return r;
+};
+#endif
 
-    uint8_t default_salt[SALT_SIZE] = {0};
-    struct byte_array salt;
+/*the keyed HMAC state must fit into struct hkdf_sha_256_prk*/
+typedef char hkdf_prk_size_check
+    [(sizeof(struct crypto_hmac_sha256) <= HKDF_PRK_STATE_SIZE) ? 1 : -1];
+
+OscoreError __attribute__((weak)) hkdf_sha_256_extract(
+    struct byte_array *master_secret,
+    struct byte_array *master_salt,
+    struct hkdf_sha_256_prk *k) {
+#ifdef OSCORE_WITH_ASYNC_CRYPTO
+    if (oscore_crypto_task_current() != NULL) {
+        struct oscore_crypto_op o = {
+            .type = OSCORE_CRYPTO_OP_HKDF_EXTRACT,
+            .u.hkdf_extract = {master_secret, master_salt, k}};
+        return oscore_crypto_offload(&o);
+    }
+#endif
+    uint8_t prk[CRYPTO_SHA256_SIZE];
 
     // "Note that [RFC5869] specifies that if the salt is not provided, it is
     // set to a string of zeros.  For implementation purposes, not providing
     // the salt is the same as setting the salt to the empty byte string.
     // OSCORE sets the salt default value to empty byte string, which is
     // converted to a string of zeroes (see Section 2.2 of [RFC5869])".
-    if (master_salt->ptr == NULL || master_salt->len == 0) {
-        salt.ptr = default_salt;
-        salt.len = sizeof(default_salt);
-    } else {
-        salt = *master_salt;
-    }
-
-    struct tc_hmac_state_struct h;
-
-    // extract
-    uint8_t prk[32];
-    memset(&h, 0x00, sizeof(h));
-    try_tc(tc_hmac_set_key(&h, salt.ptr, salt.len));
-    try_tc(tc_hmac_init(&h));
-    try_tc(tc_hmac_update(&h, master_secret->ptr, master_secret->len));
-    try_tc(tc_hmac_final(prk, TC_SHA256_DIGEST_SIZE, &h));
+    crypto_hkdf_sha256_extract(master_salt->ptr, master_salt->len,
+                               master_secret->ptr, master_secret->len, prk);
+    crypto_hmac_sha256_init((struct crypto_hmac_sha256 *)k->ctx.bytes, prk,
+                            sizeof(prk));
+    memset(prk, 0, sizeof(prk));
+    return OscoreNoError;
+}
 
-    // expand
-    // "N = ceil(L/HashLen)"
-    size_t iterations = (out->len + 31) / 32;
+OscoreError __attribute__((weak)) hkdf_sha_256_expand(
+    const struct hkdf_sha_256_prk *k,
+    struct byte_array *info,
+    struct byte_array *out) {
+#ifdef OSCORE_WITH_ASYNC_CRYPTO
+    if (oscore_crypto_task_current() != NULL) {
+        struct oscore_crypto_op o = {
+            .type = OSCORE_CRYPTO_OP_HKDF_EXPAND,
+            .u.hkdf_expand = {k, info, out}};
+        return oscore_crypto_offload(&o);
+    }
+#endif
     // "L length of output keying material in octets (<= 255*HashLen)"
-    if (iterations > 255) {
+    if (crypto_hkdf_sha256_expand(
+            (const struct crypto_hmac_sha256 *)k->ctx.bytes, info->ptr,
+            info->len, out->ptr, out->len) != CRYPTO_BACKEND_OK) {
         return OscoreOutTooLong;
     }
-
-    uint8_t t[32] = {0};
-    for (uint8_t i = 1; i <= iterations; i++) {
-        memset(&h, 0x00, sizeof(h));
-        try_tc(tc_hmac_set_key(&h, prk, 32));
-        try_tc(tc_hmac_init(&h));
-        if (i > 1) {
-            try_tc(tc_hmac_update(&h, t, 32));
-        }
-        try_tc(tc_hmac_update(&h, info->ptr, info->len));
-        try_tc(tc_hmac_update(&h, &i, 1));
-        try_tc(tc_hmac_final(t, TC_SHA256_DIGEST_SIZE, &h));
-        if (out->len < i * 32) {
-            memcpy(&out->ptr[(i - 1) * 32], t, out->len % 32);
-        } else {
-            memcpy(&out->ptr[(i - 1) * 32], t, 32);
-        }
-    }
-
     return OscoreNoError;
-
-#endif /* TINYCRYPT */
-};
+}
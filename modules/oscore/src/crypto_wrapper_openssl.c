@@ -0,0 +1,252 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+/*
+Crypto for hosts with OpenSSL 3, built on the EVP API of libcrypto.
+
+Define OSCORE_WITH_OPENSSL and link with -lcrypto to replace aead_key_init(),
+aes_ccm_16_64_128() and hkdf_sha_256(). Every thread keeps its cipher and KDF
+context, a packet is protected without allocating them.
+
+hkdf_sha_256_extract() and hkdf_sha_256_expand() are kept on
+crypto_backend.h, struct hkdf_sha_256_prk must be plain memory which can be
+dropped without a free, which an EVP_MAC_CTX is not.
+
+An EVP context must be freed and can not be kept in struct aead_key, the
+handle holds the key only. A thread has a cipher context for encryption and
+one for decryption, libcrypto sets up a CCM key for one direction. A context
+is keyed again only if the key differs from the one of its last packet. A
+thread serving one security context encrypts with the Sender Key and decrypts
+with the Recipient Key, it keys its contexts once.
+*/
+
+#ifdef OSCORE_WITH_OPENSSL
+
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <openssl/opensslv.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../inc/crypto_wrapper.h"
+
+#include "../../common/inc/byte_array.h"
+#include "../inc/crypto_async.h"
+#include "../inc/error.h"
+
+#if OPENSSL_VERSION_NUMBER < 0x30000000L
+#error "OSCORE_WITH_OPENSSL requires OpenSSL 3.0 or later"
+#endif
+
+#define TAG_SIZE 8
+#define KEY_SIZE 16
+
+/*a cipher context and its key*/
+struct ossl_cipher {
+    EVP_CIPHER_CTX *ctx;
+    bool keyed;
+    uint8_t key[KEY_SIZE];
+};
+
+/*objects reused by all operations of a thread*/
+struct ossl_thread {
+    EVP_CIPHER *ccm;
+    struct ossl_cipher cipher[2]; /*indexed by enum aes_operation*/
+    EVP_KDF_CTX *kdf_ctx;
+};
+
+static pthread_once_t ossl_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ossl_key;
+
+static void ossl_thread_free(void *arg) {
+    struct ossl_thread *s = arg;
+
+    EVP_CIPHER_free(s->ccm);
+    EVP_CIPHER_CTX_free(s->cipher[ENCRYPT].ctx);
+    EVP_CIPHER_CTX_free(s->cipher[DECRYPT].ctx);
+    EVP_KDF_CTX_free(s->kdf_ctx);
+    OPENSSL_cleanse(s, sizeof(*s));
+    free(s);
+}
+
+static void ossl_key_create(void) {
+    pthread_key_create(&ossl_key, ossl_thread_free);
+}
+
+/**
+ * @brief   Returns the objects of the calling thread, creates them on the
+ *          first call
+ * @retval  NULL if libcrypto could not allocate them
+ */
+static struct ossl_thread *ossl_thread(void) {
+    struct ossl_thread *s;
+    EVP_KDF *kdf;
+    OSSL_PARAM params[2];
+
+    pthread_once(&ossl_once, ossl_key_create);
+    s = pthread_getspecific(ossl_key);
+    if (s != NULL) return s;
+
+    s = calloc(1, sizeof(*s));
+    if (s == NULL) return NULL;
+    s->ccm = EVP_CIPHER_fetch(NULL, "AES-128-CCM", NULL);
+    s->cipher[ENCRYPT].ctx = EVP_CIPHER_CTX_new();
+    s->cipher[DECRYPT].ctx = EVP_CIPHER_CTX_new();
+    kdf = EVP_KDF_fetch(NULL, OSSL_KDF_NAME_HKDF, NULL);
+    if (kdf != NULL) s->kdf_ctx = EVP_KDF_CTX_new(kdf);
+    EVP_KDF_free(kdf);
+    /*the algorithms are set once, later calls only set the keys*/
+    params[0] = OSSL_PARAM_construct_utf8_string(OSSL_KDF_PARAM_DIGEST,
+                                                 "SHA256", 0);
+    params[1] = OSSL_PARAM_construct_end();
+    if (s->ccm == NULL || s->cipher[ENCRYPT].ctx == NULL ||
+        s->cipher[DECRYPT].ctx == NULL || s->kdf_ctx == NULL ||
+        EVP_CipherInit_ex2(s->cipher[ENCRYPT].ctx, s->ccm, NULL, NULL, 1,
+                           NULL) != 1 ||
+        EVP_CipherInit_ex2(s->cipher[DECRYPT].ctx, s->ccm, NULL, NULL, 0,
+                           NULL) != 1 ||
+        EVP_KDF_CTX_set_params(s->kdf_ctx, params) != 1 ||
+        pthread_setspecific(ossl_key, s) != 0) {
+        ossl_thread_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+/*the handle holds the key*/
+OscoreError aead_key_init(struct aead_key *k, const struct byte_array *key) {
+    if (key->len != KEY_SIZE) return OscoreTinyCryptError;
+    memcpy(k->ctx.bytes, key->ptr, KEY_SIZE);
+    return OscoreNoError;
+}
+
+OscoreError aes_ccm_16_64_128(
+    enum aes_operation op,
+    struct byte_array *in,
+    struct byte_array *out,
+    const struct aead_key *key,
+    struct byte_array *nonce,
+    struct byte_array *aad,
+    struct byte_array *tag) {
+#ifdef OSCORE_WITH_ASYNC_CRYPTO
+    /*inside a crypto task the provider computes, see crypto_async.h*/
+    if (oscore_crypto_task_current() != NULL) {
+        struct oscore_crypto_op o = {
+            .type = OSCORE_CRYPTO_OP_AES_CCM,
+            .u.aes_ccm = {op, in, out, key, nonce, aad, tag}};
+        return oscore_crypto_offload(&o);
+    }
+#endif
+    struct ossl_thread *s = ossl_thread();
+    int enc = (op == ENCRYPT), len;
+    struct ossl_cipher *c;
+    const uint8_t *k = NULL;
+    uint32_t n;
+
+    /*the tag follows the ciphertext in out when encrypting and in in when
+    decrypting*/
+    if (s == NULL) return OscoreTinyCryptError;
+    c = &s->cipher[op];
+    if (op == DECRYPT) {
+        if (in->len < TAG_SIZE) return OscoreAuthenticationError;
+        n = in->len - TAG_SIZE;
+        if (out->len < n) return DestBufferToSmall;
+    } else {
+        n = in->len;
+        if (out->len < n + TAG_SIZE) return DestBufferToSmall;
+    }
+
+    /*without a cipher the context keeps its provider context, it is reset
+    instead of allocated. Without a key it keeps the expanded key, the
+    keyed flag is cleared until the new key is set.*/
+    if (!c->keyed || CRYPTO_memcmp(c->key, key->ctx.bytes, KEY_SIZE) != 0) {
+        k = key->ctx.bytes;
+        c->keyed = false;
+    }
+    if (EVP_CipherInit_ex2(c->ctx, NULL, NULL, NULL, enc, NULL) != 1 ||
+        EVP_CIPHER_CTX_ctrl(c->ctx, EVP_CTRL_AEAD_SET_IVLEN, (int)nonce->len,
+                            NULL) != 1 ||
+        EVP_CIPHER_CTX_ctrl(c->ctx, EVP_CTRL_AEAD_SET_TAG, TAG_SIZE,
+                            enc ? NULL : in->ptr + n) != 1 ||
+        EVP_CipherInit_ex2(c->ctx, NULL, k, nonce->ptr, enc, NULL) != 1 ||
+        EVP_CipherUpdate(c->ctx, NULL, &len, NULL, (int)n) != 1 ||
+        (aad->len != 0 && EVP_CipherUpdate(c->ctx, NULL, &len, aad->ptr,
+                                           (int)aad->len) != 1)) {
+        return OscoreTinyCryptError;
+    }
+    if (k != NULL) {
+        memcpy(c->key, k, KEY_SIZE);
+        c->keyed = true;
+    }
+    if (EVP_CipherUpdate(c->ctx, out->ptr, &len, in->ptr, (int)n) !=
+        1) {
+        if (enc) return OscoreTinyCryptError;
+        OPENSSL_cleanse(out->ptr, n);
+        return OscoreAuthenticationError;
+    }
+    if (enc && EVP_CIPHER_CTX_ctrl(c->ctx, EVP_CTRL_AEAD_GET_TAG, TAG_SIZE,
+                                   out->ptr + n) != 1) {
+        return OscoreTinyCryptError;
+    }
+    return OscoreNoError;
+};
+
+OscoreError hkdf_sha_256(
+    struct byte_array *master_secret,
+    struct byte_array *master_salt,
+    struct byte_array *info,
+    struct byte_array *out) {
+#ifdef OSCORE_WITH_ASYNC_CRYPTO
+    if (oscore_crypto_task_current() != NULL) {
+        struct oscore_crypto_op o = {
+            .type = OSCORE_CRYPTO_OP_HKDF,
+            .u.hkdf = {master_secret, master_salt, info, out}};
+        return oscore_crypto_offload(&o);
+    }
+#endif
+    static uint8_t zero_salt[32] = {0};
+    struct ossl_thread *s = ossl_thread();
+    OSSL_PARAM params[4], *p = params;
+
+    if (s == NULL) return OscoreTinyCryptError;
+    // "L length of output keying material in octets (<= 255*HashLen)"
+    if (out->len > 255 * 32) return OscoreOutTooLong;
+
+    // "Note that [RFC5869] specifies that if the salt is not provided, it is
+    // set to a string of zeros.  For implementation purposes, not providing
+    // the salt is the same as setting the salt to the empty byte string.
+    // OSCORE sets the salt default value to empty byte string, which is
+    // converted to a string of zeroes (see Section 2.2 of [RFC5869])".
+    *p++ = OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_KEY,
+                                             master_secret->ptr,
+                                             master_secret->len);
+    if (master_salt->ptr != NULL && master_salt->len != 0) {
+        *p++ = OSSL_PARAM_construct_octet_string(
+            OSSL_KDF_PARAM_SALT, master_salt->ptr, master_salt->len);
+    } else {
+        *p++ = OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_SALT,
+                                                 zero_salt, sizeof(zero_salt));
+    }
+    *p++ = OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_INFO, info->ptr,
+                                             info->len);
+    *p = OSSL_PARAM_construct_end();
+
+    if (EVP_KDF_derive(s->kdf_ctx, out->ptr, out->len, params) != 1) {
+        return OscoreTinyCryptError;
+    }
+    return OscoreNoError;
+};
+
+#endif
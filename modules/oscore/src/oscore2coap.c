@@ -14,7 +14,7 @@
 #include <string.h>
 
 #include "../inc/aad.h"
-#include "../inc/byte_array.h"
+#include "../../common/inc/byte_array.h"
 #include "../inc/coap.h"
 #include "../inc/error.h"
 #include "../inc/nonce.h"
@@ -134,7 +134,7 @@ static inline OscoreError payload_decrypt(
         out_plaintext,
         &c->rrc.nonce,
         &c->rrc.aad,
-        &c->rc.recipient_key);
+        &c->rc.recipient_key_handle);
 }
 
 /**
@@ -55,7 +55,7 @@ OscoreError cose_decrypt(
     struct byte_array* out_plaintext,
     struct byte_array* nonce,
     struct byte_array* recipient_aad,
-    struct byte_array* key) {
+    const struct aead_key* key) {
     /* get enc_structure */
     OscoreError r;
     size_t aad_len;
@@ -96,7 +96,7 @@ OscoreError cose_encrypt(
     struct byte_array* in_plaintext,
     uint8_t* out_ciphertext, uint32_t out_ciphertext_len,
     struct byte_array* nonce,
-    struct byte_array* sender_aad, struct byte_array* key) {
+    struct byte_array* sender_aad, const struct aead_key* key) {
     /* get enc_structure  */
     OscoreError r;
     size_t aad_len;
@@ -28,6 +28,7 @@
  * @brief       Common derive procedure used to derive the Common IV and 
  *              Sender / Recipient Keys
  * @param cc    pointer to the common context
+ * @param k     the PRK prepared from the Master Secret and Master Salt
  * @param id    empty array for Common IV, sender / recipient ID for keys
  * @param type  IV for Common IV, KEY for Sender / Recipient Keys
  * @param out   out-array. Must be initialized
@@ -35,6 +36,7 @@
  */
 static OscoreError derive(
     struct common_context* cc,
+    const struct hkdf_sha_256_prk* k,
     struct byte_array* id,
     enum derive_type type,
     struct byte_array* out) {
@@ -52,58 +54,82 @@ static OscoreError derive(
     if (r != OscoreNoError) return r;
     PRINT_ARRAY("info struct", info.ptr, info.len);
 
-    switch (cc->kdf) {
-        case SHA_256:
-            r = hkdf_sha_256(&cc->master_secret, &cc->master_salt, &info, out);
-            break;
-        default:
-            r = OscoreUnknownHkdf;
-            break;
-    }
-    return r;
+    return hkdf_sha_256_expand(k, &info, out);
 }
 
 /**
  * @brief    Derives the Common IV 
  * @param    cc    pointer to the common context
+ * @param    k     the prepared PRK
  * @return   OscoreError
  */
-static OscoreError derive_common_iv(struct common_context* cc) {
+static OscoreError derive_common_iv(struct common_context* cc,
+                                    const struct hkdf_sha_256_prk* k) {
     OscoreError r;
-    r = derive(cc, &EMPTY_ARRAY, IV, &cc->common_iv);
+    r = derive(cc, k, &EMPTY_ARRAY, IV, &cc->common_iv);
     PRINT_ARRAY("Common IV", cc->common_iv.ptr, cc->common_iv.len);
     return r;
 };
 
 /**
- * @brief    Derives the Sender Key 
+ * @brief    Derives the Sender Key and creates its handle
  * @param    cc    pointer to the common context
+ * @param    k     the prepared PRK
  * @param    sc    pointer to the sender context
  * @return   OscoreError
  */
 static OscoreError derive_sender_key(struct common_context* cc,
+                                     const struct hkdf_sha_256_prk* k,
                                      struct sender_context* sc) {
     OscoreError r;
-    r = derive(cc, &sc->sender_id, KEY, &sc->sender_key);
+    r = derive(cc, k, &sc->sender_id, KEY, &sc->sender_key);
+    if (r != OscoreNoError) return r;
     PRINT_ARRAY("Sender Key", sc->sender_key.ptr, sc->sender_key.len);
-    return r;
+    return aead_key_init(&sc->sender_key_handle, &sc->sender_key);
 };
 
 /**
- * @brief    Derives the Recipient Key 
+ * @brief    Derives the Recipient Key and creates its handle
  * @param    cc    pointer to the common context
+ * @param    k     the prepared PRK
  * @param    sc    pointer to the recipient context
  * @return   OscoreError
  */
 static OscoreError derive_recipient_key(struct common_context* cc,
+                                        const struct hkdf_sha_256_prk* k,
                                         struct recipient_context* rc) {
     OscoreError r;
-    r = derive(cc, &rc->recipient_id, KEY, &rc->recipient_key);
+    r = derive(cc, k, &rc->recipient_id, KEY, &rc->recipient_key);
+    if (r != OscoreNoError) return r;
 
     PRINT_ARRAY("Recipient Key", rc->recipient_key.ptr, rc->recipient_key.len);
-    return r;
+    return aead_key_init(&rc->recipient_key_handle, &rc->recipient_key);
 };
 
+/**
+ * @brief    Derives the Common IV and the Sender and Recipient Keys. The 
+ *           PRK is extracted from the Master Secret and the Master Salt 
+ *           once and expanded for all three.
+ * @param    c     the context, its byte arrays must be initialized
+ * @return   OscoreError
+ */
+static OscoreError derive_all(struct context* c) {
+    OscoreError r;
+    struct hkdf_sha_256_prk k;
+    volatile uint8_t* p = (volatile uint8_t*)&k;
+
+    if (c->cc.kdf != SHA_256) return OscoreUnknownHkdf;
+    r = hkdf_sha_256_extract(&c->cc.master_secret, &c->cc.master_salt, &k);
+    if (r != OscoreNoError) return r;
+
+    r = derive_common_iv(&c->cc, &k);
+    if (r == OscoreNoError) r = derive_recipient_key(&c->cc, &k, &c->rc);
+    if (r == OscoreNoError) r = derive_sender_key(&c->cc, &k, &c->sc);
+
+    for (uint32_t i = 0; i < sizeof(k); i++) p[i] = 0;
+    return r;
+}
+
 OscoreError context_update(
     enum dev_type dev,
     struct o_coap_option* options,
@@ -140,13 +166,7 @@ OscoreError context_update(
 
             PRINT_MSG("Common Context Updated*****************\n");
 
-            r = derive_common_iv(&c->cc);
-            if (r != OscoreNoError) return r;
-
-            r = derive_sender_key(&c->cc, &c->sc);
-            if (r != OscoreNoError) return r;
-
-            r = derive_recipient_key(&c->cc, &c->rc);
+            r = derive_all(c);
             if (r != OscoreNoError) return r;
         }
     }
@@ -192,21 +212,19 @@ OscoreError oscore_context_init(struct oscore_init_params* params,
     c->cc.id_context = params->id_context;
     c->cc.common_iv.len = sizeof(c->cc.common_iv_buf);
     c->cc.common_iv.ptr = c->cc.common_iv_buf;
-    r = derive_common_iv(&c->cc);
-    if (r != OscoreNoError) return r;
 
     /*derive Recipient Context*************************************************/
     c->rc.recipient_id = params->recipient_id;
     c->rc.recipient_key.len = sizeof(c->rc.recipient_key_buf);
     c->rc.recipient_key.ptr = c->rc.recipient_key_buf;
-    r = derive_recipient_key(&c->cc, &c->rc);
-    if (r != OscoreNoError) return r;
 
     /*derive Sender Context****************************************************/
     c->sc.sender_id = params->sender_id;
     c->sc.sender_key.len = sizeof(c->sc.sender_key_buf);
     c->sc.sender_key.ptr = c->sc.sender_key_buf;
-    r = derive_sender_key(&c->cc, &c->sc);
+
+    /*the Common IV and both keys are expanded from the same PRK*/
+    r = derive_all(c);
     if (r != OscoreNoError) return r;
 
     c->sc.sender_seq_num = 0;
@@ -253,6 +271,57 @@ OscoreError oscore_context_init(struct oscore_init_params* params,
     return OscoreNoError;
 }
 
+/**
+ * @brief   Lets a byte array which points into the context from point to the 
+ *          same offset in the context to.
+ */
+static void rebase(
+    struct byte_array* a,
+    const struct context* from,
+    struct context* to) {
+    const uint8_t* begin = (const uint8_t*)from;
+    if (a->ptr >= begin && a->ptr < begin + sizeof(*from)) {
+        a->ptr = (uint8_t*)to + (a->ptr - begin);
+    }
+}
+
+OscoreError oscore_context_key_update(
+    enum dev_type dev_type,
+    const struct byte_array* master_secret,
+    const struct byte_array* master_salt,
+    struct context* c) {
+    OscoreError r;
+    struct context new_c;
+    volatile uint8_t* p = (volatile uint8_t*)&new_c;
+    struct oscore_init_params params = {
+        .dev_type = dev_type,
+        .master_secret = *master_secret,
+        .sender_id = c->sc.sender_id,
+        .recipient_id = c->rc.recipient_id,
+        .id_context = c->cc.id_context,
+        .master_salt = *master_salt,
+        .aead_alg = c->cc.aead_alg,
+        .hkdf = c->cc.kdf,
+    };
+
+    /*derive aside so that c stays usable if the derivation fails*/
+    r = oscore_context_init(&params, &new_c);
+    if (r == OscoreNoError) {
+        *c = new_c;
+        rebase(&c->cc.common_iv, &new_c, c);
+        rebase(&c->sc.sender_key, &new_c, c);
+        rebase(&c->rc.recipient_key, &new_c, c);
+        rebase(&c->rrc.nonce, &new_c, c);
+        rebase(&c->rrc.aad, &new_c, c);
+        rebase(&c->rrc.piv, &new_c, c);
+        rebase(&c->rrc.kid_context, &new_c, c);
+        rebase(&c->rrc.kid, &new_c, c);
+    }
+
+    for (uint32_t i = 0; i < sizeof(new_c); i++) p[i] = 0;
+    return r;
+}
+
 OscoreError sender_seq_num2piv(uint64_t ssn, struct byte_array* piv) {
     uint8_t* p = (uint8_t*)&ssn;
     OscoreError r;
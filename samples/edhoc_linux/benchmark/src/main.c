@@ -0,0 +1,950 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef EDHOC_WITH_OPENSSL
+#include <openssl/crypto.h>
+#endif
+
+#include "../../../../modules/edhoc/edhoc.h"
+#include "../../../../modules/common/inc/crypto_backend.h"
+#include "../../../../modules/edhoc/inc/executor.h"
+#include "test_vectors_edhoc.h"
+
+/*
+ * Initiator and responder run in the same process and exchange their
+ * messages over an in-memory transport. edhoc_initiator_run() and
+ * edhoc_responder_run() read and write through the blocking rx()/tx()
+ * callbacks, so every handshake pair consists of two threads, one per
+ * role. rx()/tx() find the mailboxes of their thread through thread local
+ * pointers.
+ *
+ * With -x the responders do not run in threads of their own. The initiators
+ * hand their messages as jobs to an executor running the stateless responder
+ * on a pool of worker threads, the main thread collects the finished jobs and
+ * delivers message 2 like a server I/O thread.
+ *
+ * With -a the workers hand the public key operations to a pool of crypto
+ * threads, as they would to an offload engine, and run other handshakes
+ * while they wait (see crypto_async.h).
+ *
+ * With -p the library reports its phases to a trace hook (see trace.h) and
+ * the latency of every phase is printed per role below the result line.
+ */
+
+#define BENCH_MSG_SIZE 512
+#define BENCH_RX_TIMEOUT_S 5
+#define BENCH_MAX_PAIRS 256
+#define BENCH_MAX_HANDSHAKES 1000000 /*per pair*/
+#define BENCH_MAX_WORKERS 64
+#define BENCH_MAX_CRYPTO_THREADS 64
+/*slots of the state keys per pair and epoch, see bench_run()*/
+#define BENCH_SLOTS_PER_PAIR 64
+/*at most EDHOC_EXECUTOR_TASKS operations per worker are in flight*/
+#define BENCH_CRYPTO_QUEUE_SIZE 256
+
+/*timestamps taken during one handshake, the phases are the differences*/
+enum timestamp {
+    TS_START,     /*initiator starts, before its ephemeral key is generated*/
+    TS_MSG1_SENT, /*message 1 handed to the transport*/
+    TS_MSG2_SENT, /*message 2 handed to the transport*/
+    TS_MSG3_SENT, /*message 3 handed to the transport*/
+    TS_DONE,      /*responder has processed message 3*/
+    TS_CNT,
+};
+
+static const char *phase_names[TS_CNT - 1] = {
+    "msg1", "msg2", "msg3", "msg3 proc"};
+
+static const char *trace_phase_names[EDHOC_PHASE_NUM] = {
+    "handshake", "tx", "rx", "encode", "decode", "dh", "kdf",
+    "th", "cred", "mac", "sign", "verify", "aead"};
+
+/*phases reported by the library, -p only*/
+static struct edhoc_trace_stats trace_stats[2]; /*initiator, responder*/
+
+struct hs_times {
+    struct timespec t[TS_CNT];
+};
+
+struct mailbox {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t buf[BENCH_MSG_SIZE];
+    uint32_t len;
+    bool full;
+};
+
+/*credentials of both parties, taken from the test vectors*/
+struct bench_creds {
+    struct byte_array id_cred_i, cred_i, sk_i, pk_i, g_i, i;
+    struct other_party_cred cred_i_at_r; /*the initiator as seen by the responder*/
+    struct byte_array id_cred_r, cred_r, sk_r, pk_r, g_r, r;
+    struct other_party_cred cred_r_at_i; /*the responder as seen by the initiator*/
+};
+
+struct pair {
+    pthread_t initiator, responder;
+    struct mailbox to_r, to_i;
+    const struct bench_creds *creds;
+    enum method_type method;
+    uint8_t suite;
+    uint32_t n;
+    struct hs_times *times;
+    uint32_t completed; /*handshakes the responder completed*/
+    volatile bool failed;
+    struct edhoc_job job; /*in flight while to_r is full, -x only*/
+    bool done;            /*the initiator finished, -x only*/
+};
+
+static __thread struct mailbox *rx_box, *tx_box;
+static __thread struct hs_times *cur_times;
+static __thread bool is_initiator;
+static __thread uint8_t tx_cnt;
+static __thread struct pair *cur_pair;
+
+/*the executor running the responders, NULL if they run in threads*/
+static struct edhoc_executor *executor;
+static pthread_mutex_t io_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t io_cond = PTHREAD_COND_INITIALIZER;
+static bool io_ready;
+
+static void now(struct timespec *t) {
+    clock_gettime(CLOCK_MONOTONIC, t);
+}
+
+static double ms_between(const struct timespec *a, const struct timespec *b) {
+    return (b->tv_sec - a->tv_sec) * 1e3 + (b->tv_nsec - a->tv_nsec) / 1e6;
+}
+
+static void mailbox_init(struct mailbox *m) {
+    pthread_mutex_init(&m->lock, NULL);
+    pthread_cond_init(&m->cond, NULL);
+    m->len = 0;
+    m->full = false;
+}
+
+static void mailbox_destroy(struct mailbox *m) {
+    pthread_mutex_destroy(&m->lock);
+    pthread_cond_destroy(&m->cond);
+}
+
+/**
+ * @brief   Hands a message of the initiator to the executor. to_r is kept
+ *          full until the job has finished, so that the single job of the
+ *          pair is not reused while it is in flight.
+ */
+static EdhocError tx_job(uint8_t *data, uint32_t data_len) {
+    struct edhoc_job *job = &cur_pair->job;
+    EdhocError r;
+
+    if (data_len > sizeof(job->in)) return MessageBuffToSmall;
+
+    pthread_mutex_lock(&tx_box->lock);
+    while (tx_box->full) {
+        pthread_cond_wait(&tx_box->cond, &tx_box->lock);
+    }
+    now(&cur_times->t[tx_cnt == 0 ? TS_MSG1_SENT : TS_MSG3_SENT]);
+    tx_box->full = true;
+    pthread_mutex_unlock(&tx_box->lock);
+
+    /*the state token created by the message 2 job stays in the job*/
+    job->type = tx_cnt == 0 ? EDHOC_JOB_MSG2 : EDHOC_JOB_MSG3;
+    job->user = cur_pair;
+    memcpy(job->in, data, data_len);
+    job->in_len = data_len;
+    tx_cnt++;
+
+    r = edhoc_executor_submit(executor, job);
+    if (r != EdhocNoError) {
+        pthread_mutex_lock(&tx_box->lock);
+        tx_box->full = false;
+        pthread_mutex_unlock(&tx_box->lock);
+    }
+    return r;
+}
+
+EdhocError tx(uint8_t *data, uint32_t data_len) {
+    if (executor != NULL && is_initiator) return tx_job(data, data_len);
+    if (data_len > sizeof(tx_box->buf)) return MessageBuffToSmall;
+
+    /*message 1 of the next handshake must not overwrite message 3 before
+    the responder has read it*/
+    pthread_mutex_lock(&tx_box->lock);
+    while (tx_box->full) {
+        pthread_cond_wait(&tx_box->cond, &tx_box->lock);
+    }
+
+    if (is_initiator) {
+        now(&cur_times->t[tx_cnt == 0 ? TS_MSG1_SENT : TS_MSG3_SENT]);
+    } else {
+        now(&cur_times->t[TS_MSG2_SENT]);
+    }
+    tx_cnt++;
+
+    memcpy(tx_box->buf, data, data_len);
+    tx_box->len = data_len;
+    tx_box->full = true;
+    pthread_cond_signal(&tx_box->cond);
+    pthread_mutex_unlock(&tx_box->lock);
+    return EdhocNoError;
+}
+
+EdhocError rx(uint8_t *data, uint32_t *data_len) {
+    struct timespec deadline;
+    EdhocError r = EdhocNoError;
+    int err = 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += BENCH_RX_TIMEOUT_S;
+
+    pthread_mutex_lock(&rx_box->lock);
+    while (!rx_box->full && err != ETIMEDOUT) {
+        err = pthread_cond_timedwait(&rx_box->cond, &rx_box->lock, &deadline);
+    }
+    if (!rx_box->full) {
+        r = TransportError;
+    } else if (*data_len < rx_box->len) {
+        r = MessageBuffToSmall;
+    } else {
+        memcpy(data, rx_box->buf, rx_box->len);
+        *data_len = rx_box->len;
+    }
+    rx_box->full = false;
+    pthread_cond_signal(&rx_box->cond);
+    pthread_mutex_unlock(&rx_box->lock);
+    return r;
+}
+
+/*a software crypto provider, the crypto threads take the operations from a
+queue*/
+struct bench_provider {
+    struct crypto_provider p; /*first member*/
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct crypto_op *queue[BENCH_CRYPTO_QUEUE_SIZE];
+    uint32_t head, tail;
+    bool stop;
+    pthread_t threads[BENCH_MAX_CRYPTO_THREADS];
+    uint32_t threads_cnt;
+};
+
+static EdhocError provider_submit(struct crypto_provider *p, struct crypto_op *op) {
+    struct bench_provider *bp = (struct bench_provider *)p;
+
+    /*symmetric operations take less time than the round trip*/
+    if (op->type != CRYPTO_OP_SIGN && op->type != CRYPTO_OP_VERIFY &&
+        op->type != CRYPTO_OP_SHARED_SECRET) {
+        crypto_op_complete(op, crypto_op_run(op));
+        return EdhocNoError;
+    }
+
+    pthread_mutex_lock(&bp->lock);
+    if (bp->tail - bp->head == BENCH_CRYPTO_QUEUE_SIZE) {
+        pthread_mutex_unlock(&bp->lock);
+        return TooManyHandshakes;
+    }
+    bp->queue[bp->tail++ % BENCH_CRYPTO_QUEUE_SIZE] = op;
+    pthread_cond_signal(&bp->cond);
+    pthread_mutex_unlock(&bp->lock);
+    return EdhocNoError;
+}
+
+static void *crypto_thread(void *arg) {
+    struct bench_provider *bp = (struct bench_provider *)arg;
+    struct crypto_op *op;
+
+    while (1) {
+        pthread_mutex_lock(&bp->lock);
+        while (bp->head == bp->tail && !bp->stop) {
+            pthread_cond_wait(&bp->cond, &bp->lock);
+        }
+        if (bp->head == bp->tail) {
+            pthread_mutex_unlock(&bp->lock);
+            return NULL;
+        }
+        op = bp->queue[bp->head++ % BENCH_CRYPTO_QUEUE_SIZE];
+        pthread_mutex_unlock(&bp->lock);
+
+        crypto_op_complete(op, crypto_op_run(op));
+    }
+}
+
+static void provider_start(struct bench_provider *bp, uint32_t threads_cnt) {
+    memset(bp, 0, sizeof(*bp));
+    bp->p.submit = provider_submit;
+    pthread_mutex_init(&bp->lock, NULL);
+    pthread_cond_init(&bp->cond, NULL);
+    for (bp->threads_cnt = 0; bp->threads_cnt < threads_cnt; bp->threads_cnt++) {
+        if (pthread_create(&bp->threads[bp->threads_cnt], NULL,
+                           crypto_thread, bp) != 0) {
+            printf("Error in pthread_create\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void provider_stop(struct bench_provider *bp) {
+    pthread_mutex_lock(&bp->lock);
+    bp->stop = true;
+    pthread_cond_broadcast(&bp->cond);
+    pthread_mutex_unlock(&bp->lock);
+    for (uint32_t i = 0; i < bp->threads_cnt; i++) {
+        pthread_join(bp->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&bp->lock);
+    pthread_cond_destroy(&bp->cond);
+}
+
+/*called by the workers of the executor*/
+static void io_notify(void *arg) {
+    pthread_mutex_lock(&io_lock);
+    io_ready = true;
+    pthread_cond_signal(&io_cond);
+    pthread_mutex_unlock(&io_lock);
+}
+
+/**
+ * @brief   Delivers the result of a finished job, run by the main thread
+ */
+static void job_done(struct edhoc_job *job) {
+    struct pair *p = (struct pair *)job->user;
+
+    if (job->r != EdhocNoError) {
+        printf("responder: handshake %u failed (Error code %d)\n",
+               p->completed, job->r);
+        p->failed = true;
+    }
+
+    if (job->type == EDHOC_JOB_MSG2 && job->out_len > 0) {
+        /*message 2 or an error message*/
+        pthread_mutex_lock(&p->to_i.lock);
+        while (p->to_i.full) {
+            pthread_cond_wait(&p->to_i.cond, &p->to_i.lock);
+        }
+        now(&p->times[p->completed].t[TS_MSG2_SENT]);
+        memcpy(p->to_i.buf, job->out, job->out_len);
+        p->to_i.len = job->out_len;
+        p->to_i.full = true;
+        pthread_cond_signal(&p->to_i.cond);
+        pthread_mutex_unlock(&p->to_i.lock);
+    } else if (job->type == EDHOC_JOB_MSG3 && job->r == EdhocNoError) {
+        now(&p->times[p->completed].t[TS_DONE]);
+        p->completed++;
+    }
+
+    /*the initiator may send its next message*/
+    pthread_mutex_lock(&p->to_r.lock);
+    p->to_r.full = false;
+    pthread_cond_signal(&p->to_r.cond);
+    pthread_mutex_unlock(&p->to_r.lock);
+}
+
+/**
+ * @brief   Collects finished jobs until all initiators are done and no job
+ *          is in flight
+ */
+static void io_loop(struct pair *pairs, uint32_t pairs_cnt) {
+    struct edhoc_job *job;
+    bool busy = true;
+
+    while (busy) {
+        while ((job = edhoc_executor_poll(executor)) != NULL) {
+            job_done(job);
+        }
+
+        busy = false;
+        for (uint32_t k = 0; k < pairs_cnt; k++) {
+            struct pair *p = &pairs[k];
+            pthread_mutex_lock(&p->to_r.lock);
+            if (!p->done || p->to_r.full) busy = true;
+            pthread_mutex_unlock(&p->to_r.lock);
+        }
+        if (!busy) break;
+
+        pthread_mutex_lock(&io_lock);
+        while (!io_ready) {
+            pthread_cond_wait(&io_cond, &io_lock);
+        }
+        io_ready = false;
+        pthread_mutex_unlock(&io_lock);
+    }
+}
+
+#define BA(x) ((struct byte_array){x##_LEN, (uint8_t *)x})
+
+/*the own credentials of the initiator and how the responder sees them*/
+#define INITIATOR_CREDS(c, T)                          \
+    do {                                               \
+        (c)->id_cred_i = BA(T##I__ID_CRED_I);          \
+        (c)->cred_i = BA(T##I__CRED_I);                \
+        (c)->sk_i = BA(T##I__SK_I);                    \
+        (c)->pk_i = BA(T##I__PK_I);                    \
+        (c)->g_i = BA(T##I__G_I);                      \
+        (c)->i = BA(T##I__I);                          \
+        (c)->cred_i_at_r.id_cred = BA(T##R__ID_CRED_I); \
+        (c)->cred_i_at_r.cred = BA(T##R__CRED_I);      \
+        (c)->cred_i_at_r.pk = BA(T##R__PK_I);          \
+        (c)->cred_i_at_r.g = BA(T##R__G_I);            \
+        (c)->cred_i_at_r.ca = BA(T##R__CA);            \
+        (c)->cred_i_at_r.ca_pk = BA(T##R__CA_PK);      \
+    } while (0)
+
+/*the own credentials of the responder and how the initiator sees them*/
+#define RESPONDER_CREDS(c, T)                          \
+    do {                                               \
+        (c)->id_cred_r = BA(T##R__ID_CRED_R);          \
+        (c)->cred_r = BA(T##R__CRED_R);                \
+        (c)->sk_r = BA(T##R__SK_R);                    \
+        (c)->pk_r = BA(T##R__PK_R);                    \
+        (c)->g_r = BA(T##R__G_R);                      \
+        (c)->r = BA(T##R__R);                          \
+        (c)->cred_r_at_i.id_cred = BA(T##I__ID_CRED_R); \
+        (c)->cred_r_at_i.cred = BA(T##I__CRED_R);      \
+        (c)->cred_r_at_i.pk = BA(T##I__PK_R);          \
+        (c)->cred_r_at_i.g = BA(T##I__G_R);            \
+        (c)->cred_r_at_i.ca = BA(T##I__CA);            \
+        (c)->cred_r_at_i.ca_pk = BA(T##I__CA_PK);      \
+    } while (0)
+
+/*the P-256 credentials serve as signature and static DH keys, G_I and G_R
+are the x coordinates of the public keys*/
+#define P256_CREDS(c)                                                   \
+    do {                                                                \
+        (c)->id_cred_i = BA(P256__ID_CRED_I);                           \
+        (c)->cred_i = BA(P256__CRED_I);                                 \
+        (c)->sk_i = BA(P256__SK_I);                                     \
+        (c)->pk_i = BA(P256__PK_I);                                     \
+        (c)->g_i = (struct byte_array){P256_SCALAR_SIZE, P256__PK_I};   \
+        (c)->i = BA(P256__SK_I);                                        \
+        (c)->cred_i_at_r.id_cred = BA(P256__ID_CRED_I);                 \
+        (c)->cred_i_at_r.cred = BA(P256__CRED_I);                       \
+        (c)->cred_i_at_r.pk = BA(P256__PK_I);                           \
+        (c)->cred_i_at_r.g = (c)->g_i;                                  \
+        (c)->id_cred_r = BA(P256__ID_CRED_R);                           \
+        (c)->cred_r = BA(P256__CRED_R);                                 \
+        (c)->sk_r = BA(P256__SK_R);                                     \
+        (c)->pk_r = BA(P256__PK_R);                                     \
+        (c)->g_r = (struct byte_array){P256_SCALAR_SIZE, P256__PK_R};   \
+        (c)->r = BA(P256__SK_R);                                        \
+        (c)->cred_r_at_i.id_cred = BA(P256__ID_CRED_R);                 \
+        (c)->cred_r_at_i.cred = BA(P256__CRED_R);                       \
+        (c)->cred_r_at_i.pk = BA(P256__PK_R);                           \
+        (c)->cred_r_at_i.g = (c)->g_r;                                  \
+    } while (0)
+
+/**
+ * @brief   Selects the credentials for a method and suite. The test vectors
+ *          contain signature keys (T1, T3 with certificates) and static DH
+ *          keys (T2, T4 with certificates) for both parties, the methods 1
+ *          and 2 mix them. The P-256 suites 2 and 3 use the P-256 keys of
+ *          the test vectors, which exist as raw public keys only.
+ * @param   c the credentials
+ * @param   method the EDHOC method
+ * @param   suite the cipher suite
+ * @param   certs true to use certificates instead of raw public keys
+ */
+static void creds_init(
+    struct bench_creds *c, enum method_type method, uint8_t suite,
+    bool certs) {
+    bool i_sdhk = method == INITIATOR_SDHK_RESPONDER_SK ||
+                  method == INITIATOR_SDHK_RESPONDER_SDHK;
+    bool r_sdhk = method == INITIATOR_SK_RESPONDER_SDHK ||
+                  method == INITIATOR_SDHK_RESPONDER_SDHK;
+
+    memset(c, 0, sizeof(*c));
+    if (suite == SUITE_2 || suite == SUITE_3) {
+        P256_CREDS(c);
+    } else if (!certs) {
+        if (i_sdhk) {
+            INITIATOR_CREDS(c, T2);
+        } else {
+            INITIATOR_CREDS(c, T1);
+        }
+        if (r_sdhk) {
+            RESPONDER_CREDS(c, T2);
+        } else {
+            RESPONDER_CREDS(c, T1);
+        }
+    } else {
+        if (i_sdhk) {
+            INITIATOR_CREDS(c, T4);
+        } else {
+            INITIATOR_CREDS(c, T3);
+        }
+        if (r_sdhk) {
+            RESPONDER_CREDS(c, T4);
+        } else {
+            RESPONDER_CREDS(c, T3);
+        }
+    }
+}
+
+static void *initiator_thread(void *arg) {
+    struct pair *p = (struct pair *)arg;
+    uint8_t x[32], g_x[32];
+    uint8_t prk_4x3m[PRK_DEFAULT_SIZE];
+    uint8_t th4[SHA_DEFAULT_SIZE];
+    uint8_t err_msg[ERR_MSG_DEFAULT_SIZE];
+    uint32_t err_msg_len;
+    uint8_t ad_2[AD_DEFAULT_SIZE];
+    uint64_t ad_2_len;
+    uint8_t suites_i[] = {p->suite};
+    struct suite suite;
+    EdhocError r;
+
+    r = get_suite((enum suite_label)p->suite, &suite);
+    if (r != EdhocNoError) {
+        p->failed = true;
+        return NULL;
+    }
+
+    rx_box = &p->to_i;
+    tx_box = &p->to_r;
+    is_initiator = true;
+    cur_pair = p;
+
+    struct edhoc_initiator_context c = {
+        p->method,
+        T1I__CORR,
+        {sizeof(suites_i), suites_i},
+        BA(T1I__C_I),
+        BA(T1I__AD_1),
+        BA(T1I__AD_3),
+        p->creds->id_cred_i,
+        p->creds->cred_i,
+        {sizeof(g_x), g_x},
+        {sizeof(x), x},
+        p->creds->g_i,
+        p->creds->i,
+        p->creds->sk_i,
+        p->creds->pk_i,
+        NULL,
+        NULL,
+    };
+    struct other_party_cred cred_r = p->creds->cred_r_at_i;
+
+    for (uint32_t k = 0; k < p->n && !p->failed; k++) {
+        cur_times = &p->times[k];
+        tx_cnt = 0;
+        now(&cur_times->t[TS_START]);
+
+        /*fresh ephemeral key for every handshake*/
+        r = ephemeral_dh_key_pair_gen(suite.edhoc_ecdh_curve, x, g_x);
+        if (r == EdhocNoError) {
+            err_msg_len = sizeof(err_msg);
+            ad_2_len = sizeof(ad_2);
+            r = edhoc_initiator_run(&c, &cred_r, 1, err_msg, &err_msg_len,
+                                    ad_2, &ad_2_len,
+                                    prk_4x3m, sizeof(prk_4x3m),
+                                    th4, sizeof(th4));
+        }
+        if (r != EdhocNoError) {
+            printf("initiator: handshake %u failed (Error code %d)\n", k, r);
+            p->failed = true;
+        }
+    }
+
+    if (executor != NULL) {
+        pthread_mutex_lock(&p->to_r.lock);
+        p->done = true;
+        pthread_mutex_unlock(&p->to_r.lock);
+        io_notify(NULL);
+    }
+    return NULL;
+}
+
+static void *responder_thread(void *arg) {
+    struct pair *p = (struct pair *)arg;
+    uint8_t y[32], g_y[32];
+    uint8_t prk_4x3m[PRK_DEFAULT_SIZE];
+    uint8_t th4[SHA_DEFAULT_SIZE];
+    uint8_t err_msg[ERR_MSG_DEFAULT_SIZE];
+    uint32_t err_msg_len;
+    uint8_t ad_1[AD_DEFAULT_SIZE];
+    uint64_t ad_1_len;
+    uint8_t ad_3[AD_DEFAULT_SIZE];
+    uint64_t ad_3_len;
+    uint8_t suites_r[] = {p->suite};
+    struct suite suite;
+    EdhocError r;
+
+    r = get_suite((enum suite_label)p->suite, &suite);
+    if (r != EdhocNoError) {
+        p->failed = true;
+        return NULL;
+    }
+
+    rx_box = &p->to_r;
+    tx_box = &p->to_i;
+    is_initiator = false;
+
+    struct edhoc_responder_context c = {
+        {sizeof(suites_r), suites_r},
+        {sizeof(g_y), g_y},
+        {sizeof(y), y},
+        BA(T1R__C_R),
+        p->creds->g_r,
+        p->creds->r,
+        BA(T1R__AD_2),
+        p->creds->id_cred_r,
+        p->creds->cred_r,
+        p->creds->sk_r,
+        p->creds->pk_r,
+        NULL,
+        NULL,
+    };
+    struct other_party_cred cred_i = p->creds->cred_i_at_r;
+
+    for (uint32_t k = 0; k < p->n && !p->failed; k++) {
+        cur_times = &p->times[k];
+
+        /*the key of the responder is generated while it waits for message 1
+        and is not part of the measured latency*/
+        r = ephemeral_dh_key_pair_gen(suite.edhoc_ecdh_curve, y, g_y);
+        if (r == EdhocNoError) {
+            err_msg_len = sizeof(err_msg);
+            ad_1_len = sizeof(ad_1);
+            ad_3_len = sizeof(ad_3);
+            r = edhoc_responder_run(&c, &cred_i, 1, err_msg, &err_msg_len,
+                                    ad_1, &ad_1_len, ad_3, &ad_3_len,
+                                    prk_4x3m, sizeof(prk_4x3m),
+                                    th4, sizeof(th4));
+        }
+        if (r != EdhocNoError) {
+            printf("responder: handshake %u failed (Error code %d)\n", k, r);
+            p->failed = true;
+            break;
+        }
+        now(&cur_times->t[TS_DONE]);
+        p->completed++;
+    }
+    return NULL;
+}
+
+/*sorts the events of the library by role*/
+static void trace_hook(const struct edhoc_trace_event *e, void *arg) {
+    struct edhoc_trace_stats *s = (struct edhoc_trace_stats *)arg;
+    edhoc_trace_stats_hook(e, &s[e->role ? 1 : 0]);
+}
+
+/**
+ * @brief   Prints count, average and percentiles of the phases the library
+ *          reported for one method
+ */
+static void trace_print(enum method_type method) {
+    static const char *roles[2] = {"initiator", "responder"};
+
+    printf("  %-9s %-9s %10s %10s %8s %8s\n", "role", "phase", "count",
+           "avg us", "p50 us<", "p99 us<");
+    for (int r = 0; r < 2; r++) {
+        const struct edhoc_trace_stats *s = &trace_stats[r];
+        for (int ph = 0; ph < EDHOC_PHASE_NUM; ph++) {
+            uint64_t cnt = s->count[method][ph];
+            if (cnt == 0) continue;
+            printf("  %-9s %-9s %10llu %10.1f %8llu %8llu\n", roles[r],
+                   trace_phase_names[ph], (unsigned long long)cnt,
+                   s->total_ns[method][ph] / 1e3 / cnt,
+                   (unsigned long long)edhoc_trace_stats_percentile(
+                       s, method, ph, 50),
+                   (unsigned long long)edhoc_trace_stats_percentile(
+                       s, method, ph, 99));
+        }
+    }
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, uint32_t n, double p) {
+    uint32_t i = (uint32_t)(p * (n - 1) + 0.5);
+    return sorted[i];
+}
+
+/**
+ * @brief   Starts the executor which runs the responders of all pairs
+ * @param   used slots for the used state tokens, see edhoc_state_keys_init()
+ * @param   used_len number of elements of used
+ * @retval  0 on success, -1 on error
+ */
+static int executor_start(
+    struct edhoc_executor *ex, uint32_t workers_cnt,
+    struct crypto_provider *provider,
+    const struct bench_creds *creds, uint8_t *suites_r,
+    struct other_party_cred *cred_i, struct edhoc_state_keys *keys,
+    uint64_t *used, uint32_t used_len) {
+    static struct edhoc_worker workers[BENCH_MAX_WORKERS];
+    /*the workers take g_y and y from their key pools*/
+    static uint8_t y[32], g_y[32];
+    struct suite suite;
+    EdhocError r;
+
+    struct edhoc_responder_context c = {
+        {1, suites_r},
+        {sizeof(g_y), g_y},
+        {sizeof(y), y},
+        BA(T1R__C_R),
+        creds->g_r,
+        creds->r,
+        BA(T1R__AD_2),
+        creds->id_cred_r,
+        creds->cred_r,
+        creds->sk_r,
+        creds->pk_r,
+        NULL,
+        NULL,
+    };
+
+    r = get_suite((enum suite_label)suites_r[0], &suite);
+    if (r == EdhocNoError) r = edhoc_state_keys_init(keys, used, used_len);
+    if (r == EdhocNoError) r = edhoc_x5t_index(cred_i, 1);
+    if (r == EdhocNoError) {
+        r = edhoc_executor_start(ex, workers, workers_cnt, &c, cred_i, 1,
+                                 keys, suite.edhoc_ecdh_curve, provider,
+                                 io_notify, NULL);
+    }
+    if (r != EdhocNoError) {
+        printf("Error in edhoc_executor_start (Error code %d)\n", r);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Runs n handshakes on each of pairs_cnt concurrent pairs and
+ *          prints the result
+ * @param   workers_cnt 0 to run every responder in a thread of its own,
+ *          otherwise the number of worker threads of the executor
+ * @param   crypto_cnt 0 to compute the crypto on the workers, otherwise the
+ *          number of crypto threads of the provider
+ * @param   trace print the phases reported by the library
+ * @retval  0 on success, -1 if a handshake failed
+ */
+static int bench_run(
+    enum method_type method, uint8_t suite, bool certs,
+    uint32_t pairs_cnt, uint32_t n, uint32_t workers_cnt,
+    uint32_t crypto_cnt, bool trace) {
+    static struct pair pairs[BENCH_MAX_PAIRS];
+    static struct edhoc_executor ex;
+    static struct bench_provider provider;
+    struct edhoc_state_keys keys;
+    uint64_t *used = NULL;
+    uint32_t used_len;
+    struct other_party_cred cred_i;
+    uint8_t suites_r[] = {suite};
+    struct bench_creds creds;
+    struct timespec start, end;
+    uint32_t completed = 0, k, j;
+    double phase_sum[TS_CNT - 1] = {0};
+    double *lat;
+    int ret = 0;
+
+    creds_init(&creds, method, suite, certs);
+    if (trace) {
+        memset(trace_stats, 0, sizeof(trace_stats));
+        edhoc_trace_hook_set(trace_hook, trace_stats);
+    }
+    if (workers_cnt) {
+        if (crypto_cnt) provider_start(&provider, crypto_cnt);
+        cred_i = creds.cred_i_at_r;
+        /*the workers rotate the keys once an epoch is half full, a pair
+        has one handshake in flight, which must not see two rotations*/
+        used_len = 2 * BENCH_SLOTS_PER_PAIR * pairs_cnt;
+        used = calloc(used_len, sizeof(*used));
+        if (used == NULL) {
+            printf("out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        if (executor_start(&ex, workers_cnt, crypto_cnt ? &provider.p : NULL,
+                           &creds, suites_r, &cred_i, &keys,
+                           used, used_len) < 0) {
+            free(used);
+            return -1;
+        }
+        executor = &ex;
+    }
+
+    now(&start);
+    for (k = 0; k < pairs_cnt; k++) {
+        struct pair *p = &pairs[k];
+        memset(p, 0, sizeof(*p));
+        mailbox_init(&p->to_r);
+        mailbox_init(&p->to_i);
+        p->creds = &creds;
+        p->method = method;
+        p->suite = suite;
+        p->n = n;
+        p->times = calloc(n, sizeof(*p->times));
+        if (p->times == NULL) {
+            printf("out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        if ((!workers_cnt &&
+             pthread_create(&p->responder, NULL, responder_thread, p) != 0) ||
+            pthread_create(&p->initiator, NULL, initiator_thread, p) != 0) {
+            printf("Error in pthread_create\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (workers_cnt) io_loop(pairs, pairs_cnt);
+    for (k = 0; k < pairs_cnt; k++) {
+        pthread_join(pairs[k].initiator, NULL);
+        if (!workers_cnt) pthread_join(pairs[k].responder, NULL);
+        completed += pairs[k].completed;
+        if (pairs[k].failed) ret = -1;
+    }
+    now(&end);
+    if (workers_cnt) {
+        edhoc_executor_stop(&ex);
+        executor = NULL;
+        if (crypto_cnt) provider_stop(&provider);
+        free(used);
+    }
+    edhoc_trace_hook_set(NULL, NULL);
+
+    lat = malloc((completed ? completed : 1) * sizeof(*lat));
+    if (lat == NULL) {
+        printf("out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    completed = 0;
+    for (k = 0; k < pairs_cnt; k++) {
+        for (j = 0; j < pairs[k].completed; j++) {
+            struct hs_times *t = &pairs[k].times[j];
+            lat[completed++] = ms_between(&t->t[TS_START], &t->t[TS_DONE]);
+            for (int ph = 0; ph < TS_CNT - 1; ph++) {
+                phase_sum[ph] += ms_between(&t->t[ph], &t->t[ph + 1]);
+            }
+        }
+        free(pairs[k].times);
+        mailbox_destroy(&pairs[k].to_r);
+        mailbox_destroy(&pairs[k].to_i);
+    }
+
+    printf("%6u %5u %5u %10u", method, suite, pairs_cnt, completed);
+    if (completed) {
+        qsort(lat, completed, sizeof(*lat), cmp_double);
+        printf(" %10.1f %8.3f %8.3f",
+               completed / (ms_between(&start, &end) / 1e3),
+               percentile(lat, completed, 0.50),
+               percentile(lat, completed, 0.99));
+        for (int ph = 0; ph < TS_CNT - 1; ph++) {
+            printf(" %9.3f", phase_sum[ph] / completed);
+        }
+    }
+    printf("%s\n", ret ? "  (failed)" : "");
+    if (trace) trace_print(method);
+    free(lat);
+    return ret;
+}
+
+static void usage(const char *name) {
+    printf("Usage: %s [-n handshakes] [-t pairs] [-m method] [-s suite] [-c]\n"
+           "          [-x workers [-a crypto_threads]] [-p]\n"
+           "  -n  handshakes per initiator/responder pair (default 1000)\n"
+           "  -t  number of concurrent pairs, i.e., 2 threads each (default 1)\n"
+           "  -x  run the responders on an executor with this many worker\n"
+           "      threads instead of a thread per pair\n"
+           "  -a  compute the public key operations of the workers on this\n"
+           "      many crypto threads\n"
+           "  -m  EDHOC method 0-3 (default all)\n"
+           "  -s  cipher suite 0-3 (default all)\n"
+           "  -c  authenticate with certificates instead of raw public keys,\n"
+           "      suites 0 and 1 only\n"
+           "  -p  print the latency of the phases reported by the library\n",
+           name);
+}
+
+int main(int argc, char **argv) {
+    uint32_t n = 1000, pairs_cnt = 1, workers_cnt = 0, crypto_cnt = 0;
+    int method = -1, suite = -1;
+    bool certs = false, trace = false;
+    int opt, ret = 0;
+
+    while ((opt = getopt(argc, argv, "n:t:m:s:x:a:cph")) != -1) {
+        switch (opt) {
+            case 'n':
+                n = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                pairs_cnt = strtoul(optarg, NULL, 0);
+                break;
+            case 'm':
+                method = atoi(optarg);
+                break;
+            case 's':
+                suite = atoi(optarg);
+                break;
+            case 'c':
+                certs = true;
+                break;
+            case 'p':
+                trace = true;
+                break;
+            case 'x':
+                workers_cnt = strtoul(optarg, NULL, 0);
+                break;
+            case 'a':
+                crypto_cnt = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    /*there are no P-256 certificates in the test vectors*/
+    if (n == 0 || n > BENCH_MAX_HANDSHAKES ||
+        pairs_cnt == 0 || pairs_cnt > BENCH_MAX_PAIRS ||
+        workers_cnt > BENCH_MAX_WORKERS ||
+        crypto_cnt > BENCH_MAX_CRYPTO_THREADS ||
+        (crypto_cnt && !workers_cnt) ||
+        method > INITIATOR_SDHK_RESPONDER_SDHK || suite > SUITE_3 ||
+        (certs && suite > SUITE_1)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+#ifdef EDHOC_WITH_OPENSSL
+    printf("crypto: %s, hash states on crypto backend: %s\n",
+           OpenSSL_version(OPENSSL_VERSION), crypto_backend_get()->name);
+#else
+    printf("crypto backend: %s\n", crypto_backend_get()->name);
+#endif
+    printf("%6s %5s %5s %10s %10s %8s %8s", "method", "suite", "pairs",
+           "handshakes", "hs/s", "p50 ms", "p99 ms");
+    for (int ph = 0; ph < TS_CNT - 1; ph++) {
+        printf(" %9s", phase_names[ph]);
+    }
+    printf("\n");
+
+    for (int m = INITIATOR_SK_RESPONDER_SK; m <= INITIATOR_SDHK_RESPONDER_SDHK; m++) {
+        if (method >= 0 && m != method) continue;
+        for (int s = SUITE_0; s <= SUITE_3; s++) {
+            if (suite >= 0 && s != suite) continue;
+            if (certs && s > SUITE_1) continue;
+            if (bench_run((enum method_type)m, (uint8_t)s, certs,
+                          pairs_cnt, n, workers_cnt, crypto_cnt, trace) != 0) {
+                ret = EXIT_FAILURE;
+            }
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,157 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../../../modules/edhoc/edhoc.h"
+#include "../../../../modules/edhoc/inc/crypto_wrapper.h"
+#include "gateway.h"
+
+/*
+ * A message 1 is admitted in three steps, from the cheapest to the most
+ * expensive: the structural check of the library, the Echo round trip which
+ * shows that the client receives at its source address, and a token of the
+ * token bucket. Only then a handshake thread computes the ECDH.
+ *
+ * The Echo value is stateless: window || HMAC(key, window || peer) truncated
+ * to GW_ECHO_MAC_LEN bytes, where window counts GW_ECHO_WINDOW_S intervals.
+ * Values of the current and the previous window are accepted.
+ */
+#define GW_ECHO_MAC_LEN 8
+
+static struct admission adm;
+static uint8_t echo_key[16];
+static bool echo_enabled;
+static uint32_t echo_sent, echo_failed;
+/*protects adm and the counters, the event loop admits and the handshake
+threads release*/
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint32_t)((uint64_t)t.tv_sec * 1000 + t.tv_nsec / 1000000);
+}
+
+static uint32_t echo_window(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint32_t)(t.tv_sec / GW_ECHO_WINDOW_S);
+}
+
+/**
+ * @brief   Computes the Echo value of a peer for a window
+ */
+static int echo_compute(
+    const struct sockaddr_storage *peer, socklen_t peer_len,
+    uint32_t window, uint8_t *echo) {
+    uint8_t in[4 + sizeof(struct sockaddr_storage)];
+    uint8_t mac[SHA_DEFAULT_SIZE];
+
+    echo[0] = in[0] = (uint8_t)(window >> 24);
+    echo[1] = in[1] = (uint8_t)(window >> 16);
+    echo[2] = in[2] = (uint8_t)(window >> 8);
+    echo[3] = in[3] = (uint8_t)window;
+    memcpy(in + 4, peer, peer_len);
+    /*HKDF-Extract is HMAC with the salt as key*/
+    if (hkdf_extract(SHA_256, echo_key, sizeof(echo_key),
+                     in, (uint8_t)(4 + peer_len), mac) != EdhocNoError) {
+        return -1;
+    }
+    memcpy(echo + 4, mac, GW_ECHO_MAC_LEN);
+    return 0;
+}
+
+int gw_admission_init(
+    uint32_t rate, uint32_t burst, uint32_t max_active, bool echo) {
+    admission_init(&adm, rate, burst, max_active, now_ms());
+    echo_enabled = echo;
+    if (echo && random_bytes(echo_key, sizeof(echo_key)) != EdhocNoError) {
+        return -1;
+    }
+    return 0;
+}
+
+bool gw_echo_required(void) { return echo_enabled; }
+
+int gw_echo_create(
+    const struct sockaddr_storage *peer, socklen_t peer_len,
+    uint8_t *echo) {
+    pthread_mutex_lock(&lock);
+    echo_sent++;
+    pthread_mutex_unlock(&lock);
+    return echo_compute(peer, peer_len, echo_window(), echo);
+}
+
+bool gw_echo_verify(
+    const struct sockaddr_storage *peer, socklen_t peer_len,
+    const uint8_t *echo, uint32_t echo_len) {
+    uint8_t expected[GW_ECHO_LEN];
+    uint32_t window = echo_window();
+
+    if (echo_len == GW_ECHO_LEN) {
+        for (uint32_t i = 0; i < 2 && i <= window; i++) {
+            if (echo_compute(peer, peer_len, window - i, expected) == 0 &&
+                memcmp(expected, echo, GW_ECHO_LEN) == 0) {
+                return true;
+            }
+        }
+    }
+    pthread_mutex_lock(&lock);
+    echo_failed++;
+    pthread_mutex_unlock(&lock);
+    return false;
+}
+
+int gw_msg1_prevalidate(const uint8_t *msg1, uint32_t msg1_len) {
+    if (edhoc_msg1_prevalidate((uint8_t *)msg1, msg1_len) == EdhocNoError) {
+        return 0;
+    }
+    pthread_mutex_lock(&lock);
+    adm.stats.malformed++;
+    pthread_mutex_unlock(&lock);
+    return -1;
+}
+
+int gw_admit(void) {
+    EdhocError r;
+
+    pthread_mutex_lock(&lock);
+    r = admission_acquire(&adm, now_ms());
+    pthread_mutex_unlock(&lock);
+    return r == EdhocNoError ? 0 : -1;
+}
+
+void gw_admission_release(void) {
+    pthread_mutex_lock(&lock);
+    admission_release(&adm);
+    pthread_mutex_unlock(&lock);
+}
+
+void gw_admission_stats_print(void) {
+    struct admission_stats s;
+    uint32_t active, sent, failed;
+
+    pthread_mutex_lock(&lock);
+    s = adm.stats;
+    active = adm.active;
+    sent = echo_sent;
+    failed = echo_failed;
+    pthread_mutex_unlock(&lock);
+    printf("admission: %u admitted, %u active, %u malformed, %u rate limited, "
+           "%u busy, %u echo challenges, %u echo failures\n",
+           (unsigned)s.admitted, (unsigned)active, (unsigned)s.malformed,
+           (unsigned)s.rate_limited, (unsigned)s.busy, (unsigned)sent,
+           (unsigned)failed);
+}
@@ -0,0 +1,191 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../../../modules/edhoc/edhoc.h"
+#include "credentials.h"
+#include "gateway.h"
+
+/*
+ * edhoc_responder_run() reads and writes its messages through the blocking
+ * rx()/tx() callbacks. Each handshake therefore runs in its own thread and
+ * the event loop feeds it through the mailbox of the session. rx()/tx() find
+ * their session through a thread local pointer.
+ */
+static __thread struct gw_session *current_session;
+
+EdhocError tx(uint8_t *data, uint32_t data_len) {
+    if (gw_send_edhoc_response(current_session, data, data_len) < 0) {
+        return TransportError;
+    }
+    return EdhocNoError;
+}
+
+EdhocError rx(uint8_t *data, uint32_t *data_len) {
+    struct gw_session *s = current_session;
+    struct timespec deadline;
+    EdhocError r = EdhocNoError;
+    int err = 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += GW_HANDSHAKE_TIMEOUT_S;
+
+    pthread_mutex_lock(&s->lock);
+    while (!s->rx_ready && err != ETIMEDOUT) {
+        err = pthread_cond_timedwait(&s->cond, &s->lock, &deadline);
+    }
+    if (!s->rx_ready) {
+        r = TransportError;
+    } else if (*data_len < s->rx_len) {
+        r = MessageBuffToSmall;
+    } else {
+        memcpy(data, s->rx_buf, s->rx_len);
+        *data_len = s->rx_len;
+    }
+    s->rx_ready = false;
+    pthread_mutex_unlock(&s->lock);
+    return r;
+}
+
+int edhoc_session_post(struct gw_session *s, const uint8_t *msg, uint32_t msg_len) {
+    if (msg_len > sizeof(s->rx_buf)) return -1;
+
+    pthread_mutex_lock(&s->lock);
+    memcpy(s->rx_buf, msg, msg_len);
+    s->rx_len = msg_len;
+    s->rx_ready = true;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+    return 0;
+}
+
+/**
+ * @brief   Runs one responder handshake and derives the OSCORE context
+ * @param   arg the session
+ */
+static void *handshake_thread(void *arg) {
+    struct gw_session *s = (struct gw_session *)arg;
+    uint8_t y[32], g_y[32];
+    uint8_t prk_4x3m[PRK_DEFAULT_SIZE];
+    uint8_t th4[SHA_DEFAULT_SIZE];
+    uint8_t err_msg[ERR_MSG_DEFAULT_SIZE];
+    uint32_t err_msg_len = sizeof(err_msg);
+    uint8_t ad_1[AD_DEFAULT_SIZE];
+    uint64_t ad_1_len = sizeof(ad_1);
+    uint8_t ad_3[AD_DEFAULT_SIZE];
+    uint64_t ad_3_len = sizeof(ad_3);
+    uint8_t master_secret[16];
+    uint8_t master_salt[8];
+    uint8_t oscore_req[MAXLINE];
+    uint16_t oscore_req_len;
+    uint64_t ws_buf[EDHOC_RESPONDER_WORKSPACE_SIZE / sizeof(uint64_t)];
+    struct edhoc_workspace ws;
+    const struct revocation_list *revoked = gw_revocation_acquire();
+    bool established = false;
+    EdhocError r;
+
+    current_session = s;
+    workspace_init(&ws, (uint8_t *)ws_buf, sizeof(ws_buf));
+
+    /*the key pool of the library has a single consumer, every handshake
+    thread generates its own ephemeral key*/
+    r = ephemeral_dh_key_pair_gen(X25519, y, g_y);
+    if (r != EdhocNoError) {
+        printf("Error in ephemeral_dh_key_pair_gen (Error code %d)\n", r);
+        goto out;
+    }
+
+    struct other_party_cred cred_i = {
+        {ID_CRED_I_LEN, ID_CRED_I},
+        {CRED_I_LEN, CRED_I},
+        {PK_I_LEN, PK_I},
+        {G_I_LEN, G_I},
+        {CA_LEN, CA},
+        {CA_PK_LEN, CA_PK}};
+    struct edhoc_responder_context c = {
+        {SUITES_R_LEN, SUITES_R},
+        {sizeof(g_y), g_y},
+        {sizeof(y), y},
+        {1, &s->c_r},
+        {G_R_LEN, G_R},
+        {R_LEN, R},
+        {AD_2_LEN, AD_2},
+        {ID_CRED_R_LEN, ID_CRED_R},
+        {CRED_R_LEN, CRED_R},
+        {SK_R_LEN, SK_R},
+        {PK_R_LEN, PK_R},
+        NULL,
+        &ws,
+        NULL,
+        revoked,
+    };
+
+    r = edhoc_responder_run(&c, &cred_i, 1, err_msg, &err_msg_len,
+                            ad_1, &ad_1_len, ad_3, &ad_3_len,
+                            prk_4x3m, sizeof(prk_4x3m), th4, sizeof(th4));
+    if (r != EdhocNoError) {
+        printf("Handshake with C_R 0x%02x failed (Error code %d)\n", s->c_r, r);
+        goto out;
+    }
+
+    r = edhoc_exporter_oscore(SHA_256, AES_CCM_16_64_128,
+                              prk_4x3m, sizeof(prk_4x3m), th4, sizeof(th4),
+                              master_secret, sizeof(master_secret),
+                              master_salt, sizeof(master_salt));
+    if (r != EdhocNoError) goto out;
+
+    if (oscore_session_init(s, master_secret, sizeof(master_secret),
+                            master_salt, sizeof(master_salt)) != 0) {
+        goto out;
+    }
+    established = true;
+    printf("Handshake with C_R 0x%02x completed\n", s->c_r);
+
+    /*answer the request which carried message 3, in a combined request 
+    this is the response to its OSCORE part*/
+    pthread_mutex_lock(&s->lock);
+    oscore_req_len = s->oscore_req_len;
+    memcpy(oscore_req, s->oscore_req, oscore_req_len);
+    s->oscore_req_len = 0;
+    pthread_mutex_unlock(&s->lock);
+    if (oscore_req_len) {
+        gw_serve_oscore(s, oscore_req, oscore_req_len);
+    } else {
+        gw_send_edhoc_response(s, NULL, 0);
+    }
+
+out:
+    memset(y, 0, sizeof(y));
+    memset(prk_4x3m, 0, sizeof(prk_4x3m));
+    memset(master_secret, 0, sizeof(master_secret));
+    memset(master_salt, 0, sizeof(master_salt));
+    gw_revocation_release(revoked);
+    gw_session_handshake_done(s, established);
+    return NULL;
+}
+
+int edhoc_session_start(struct gw_session *s) {
+    pthread_attr_t attr;
+    pthread_t thread;
+    int r;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, GW_HANDSHAKE_STACK_SIZE);
+    r = pthread_create(&thread, &attr, handshake_thread, s);
+    pthread_attr_destroy(&attr);
+    return r == 0 ? 0 : -1;
+}
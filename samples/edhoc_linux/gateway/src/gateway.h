@@ -0,0 +1,296 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "../../../common/sock.h"
+#ifdef __cplusplus
+}
+#endif
+
+/*
+ * edhoc.h and oscore.h cannot be included in the same translation unit (both
+ * modules use the same header guards and error names). This header is
+ * therefore shared by main.cpp, edhoc_session.c and oscore_session.c and
+ * includes neither.
+ */
+
+/*maximal number of concurrent clients (handshakes and OSCORE sessions)*/
+#define GW_MAX_SESSIONS 64
+/*how long a handshake waits for message 3 before it is aborted*/
+#define GW_HANDSHAKE_TIMEOUT_S 10
+/*how long an established session is kept without traffic*/
+#define GW_SESSION_IDLE_TIMEOUT_S 300
+/*stack size of the handshake threads*/
+#define GW_HANDSHAKE_STACK_SIZE (64 * 1024)
+#define GW_TOKEN_MAX_LEN 8
+/*handshakes per second admitted in the long run and at once*/
+#define GW_HANDSHAKE_RATE 20
+#define GW_HANDSHAKE_BURST 8
+/*handshakes which compute at the same time*/
+#define GW_MAX_ACTIVE_HANDSHAKES 8
+/*lifetime of an Echo value (RFC 9175) is one to two windows*/
+#define GW_ECHO_WINDOW_S 30
+#define GW_ECHO_LEN 12
+
+enum gw_session_state {
+    GW_FREE,
+    GW_HANDSHAKE,   /*a handshake thread owns the session*/
+    GW_ESTABLISHED, /*an OSCORE context is available*/
+};
+
+/**
+ * Per client state. The session table, the peer address and the state are
+ * protected by the table lock of main.cpp, the mailbox by lock.
+ */
+struct gw_session {
+    enum gw_session_state state;
+    struct sockaddr_storage peer;
+    socklen_t peer_len;
+    time_t last_activity;
+    uint8_t c_r; /*connection identifier of the gateway, unique per session*/
+
+    /*mailbox from the event loop to the handshake thread*/
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t rx_buf[MAXLINE];
+    uint32_t rx_len;
+    bool rx_ready;
+
+    /*CoAP request the next EDHOC message answers*/
+    uint8_t token[GW_TOKEN_MAX_LEN];
+    uint8_t token_len;
+    uint16_t message_id;
+    bool confirmable;
+
+    /*OSCORE part of a combined EDHOC+OSCORE request, answered once the
+    handshake completed*/
+    uint8_t oscore_req[MAXLINE];
+    uint16_t oscore_req_len;
+
+    void *oscore; /*owned by oscore_session.c*/
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Sends payload as piggybacked 2.04 response to the last EDHOC
+ *          request of the session (implemented in main.cpp)
+ * @param   s the session
+ * @param   payload the payload, may be empty
+ * @param   payload_len length of payload
+ * @retval  0 or a negative value on error
+ */
+int gw_send_edhoc_response(
+    struct gw_session *s,
+    const uint8_t *payload,
+    uint32_t payload_len);
+
+/**
+ * @brief   Marks a session as established or frees it after its handshake
+ *          thread finished (implemented in main.cpp)
+ * @param   s the session
+ * @param   established true if an OSCORE context was derived
+ */
+void gw_session_handshake_done(struct gw_session *s, bool established);
+
+/**
+ * @brief   Answers an OSCORE request with the context of s (implemented in
+ *          main.cpp)
+ * @param   s the session
+ * @param   req the OSCORE request
+ * @param   req_len length of req
+ */
+void gw_serve_oscore(struct gw_session *s, uint8_t *req, uint16_t req_len);
+
+/**
+ * @brief   Starts a handshake thread for a session whose mailbox contains
+ *          message 1
+ * @param   s the session
+ * @retval  0 or a negative value on error
+ */
+int edhoc_session_start(struct gw_session *s);
+
+/**
+ * @brief   Hands a received EDHOC message to the handshake thread of s
+ * @param   s the session
+ * @param   msg the message
+ * @param   msg_len length of msg
+ * @retval  0 or a negative value if the message does not fit the mailbox
+ */
+int edhoc_session_post(struct gw_session *s, const uint8_t *msg, uint32_t msg_len);
+
+/**
+ * @brief   Creates the OSCORE context of s from the EDHOC exporter output
+ * @param   s the session
+ * @param   master_secret the OSCORE master secret
+ * @param   master_secret_len length of master_secret
+ * @param   master_salt the OSCORE master salt
+ * @param   master_salt_len length of master_salt
+ * @retval  0 or a negative value on error
+ */
+int oscore_session_init(
+    struct gw_session *s,
+    const uint8_t *master_secret, uint32_t master_secret_len,
+    const uint8_t *master_salt, uint32_t master_salt_len);
+
+/**
+ * @brief   Converts an OSCORE request of the session to CoAP
+ * @param   s the session
+ * @param   in the received packet
+ * @param   in_len length of in
+ * @param   out buffer for the CoAP packet
+ * @param   out_len in: size of out, out: length of the CoAP packet
+ * @retval  0 or a negative value on error
+ */
+int oscore_session_unprotect(
+    struct gw_session *s,
+    uint8_t *in, uint16_t in_len,
+    uint8_t *out, uint16_t *out_len);
+
+/**
+ * @brief   Converts a CoAP response of the session to OSCORE
+ * @param   s the session
+ * @param   in the CoAP packet
+ * @param   in_len length of in
+ * @param   out buffer for the OSCORE packet
+ * @param   out_len in: size of out, out: length of the OSCORE packet
+ * @retval  0 or a negative value on error
+ */
+int oscore_session_protect(
+    struct gw_session *s,
+    uint8_t *in, uint16_t in_len,
+    uint8_t *out, uint16_t *out_len);
+
+/**
+ * @brief   Splits a combined EDHOC+OSCORE request
+ * @param   in the received packet
+ * @param   in_len length of in
+ * @param   combined true if in was a combined request
+ * @param   msg3 buffer for EDHOC message 3
+ * @param   msg3_len in: size of msg3, out: length of message 3
+ * @param   oscore_req buffer for the OSCORE request
+ * @param   oscore_req_len in: size of oscore_req, out: length of the request
+ * @retval  0 or a negative value on error
+ */
+int combined_request_split(
+    uint8_t *in, uint16_t in_len,
+    bool *combined,
+    uint8_t *msg3, uint16_t *msg3_len,
+    uint8_t *oscore_req, uint16_t *oscore_req_len);
+
+struct revocation_list;
+
+/**
+ * @brief   Reads a revocation list file (see revocation_list.h of the EDHOC
+ *          module) into memory and makes it the list used by new handshakes
+ * @param   path the file
+ * @retval  0 or a negative value on error, the current list is kept then
+ */
+int gw_revocation_load(const char *path);
+
+/**
+ * @brief   Returns the current revocation list or NULL, the list stays valid
+ *          until it is released with gw_revocation_release()
+ */
+const struct revocation_list *gw_revocation_acquire(void);
+
+/**
+ * @brief   Releases a revocation list returned by gw_revocation_acquire()
+ * @param   rl the list, may be NULL
+ */
+void gw_revocation_release(const struct revocation_list *rl);
+
+/**
+ * @brief   Initializes the admission control of new handshakes
+ * @param   rate handshakes per second admitted in the long run
+ * @param   burst handshakes admitted at once
+ * @param   max_active handshakes which may run at the same time
+ * @param   echo true to require an Echo round trip before a handshake
+ * @retval  0 or a negative value on error
+ */
+int gw_admission_init(
+    uint32_t rate, uint32_t burst, uint32_t max_active, bool echo);
+
+/**
+ * @brief   Checks the structure of message 1 without any cryptographic
+ *          operation
+ * @retval  0 or a negative value if message 1 is malformed
+ */
+int gw_msg1_prevalidate(const uint8_t *msg1, uint32_t msg1_len);
+
+/**
+ * @brief   Returns true if a client must echo an Echo value before its
+ *          handshake is admitted
+ */
+bool gw_echo_required(void);
+
+/**
+ * @brief   Creates the Echo value of a peer
+ * @param   peer the address of the peer
+ * @param   peer_len length of peer
+ * @param   echo buffer of GW_ECHO_LEN bytes
+ * @retval  0 or a negative value on error
+ */
+int gw_echo_create(
+    const struct sockaddr_storage *peer, socklen_t peer_len,
+    uint8_t *echo);
+
+/**
+ * @brief   Checks an Echo value returned by a peer
+ * @param   peer the address of the peer
+ * @param   peer_len length of peer
+ * @param   echo the value of the Echo option
+ * @param   echo_len length of echo
+ * @retval  true if the value was created for peer and has not expired
+ */
+bool gw_echo_verify(
+    const struct sockaddr_storage *peer, socklen_t peer_len,
+    const uint8_t *echo, uint32_t echo_len);
+
+/**
+ * @brief   Takes a token of the token bucket for a new handshake
+ * @retval  0 or a negative value if the handshake must be rejected
+ */
+int gw_admit(void);
+
+/**
+ * @brief   Returns the token of a handshake admitted with gw_admit()
+ */
+void gw_admission_release(void);
+
+/**
+ * @brief   Prints the counters of the admission control
+ */
+void gw_admission_stats_print(void);
+
+/**
+ * @brief   Wipes and frees the OSCORE context of s
+ * @param   s the session
+ */
+void oscore_session_free(struct gw_session *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
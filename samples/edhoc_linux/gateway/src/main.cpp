@@ -0,0 +1,581 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../../../externals/cantcoap/cantcoap.h"
+#include "gateway.h"
+
+#define USE_IPV4
+
+#define EDHOC_URI ".well-known/edhoc"
+#define COAP_OPTION_OSCORE 9
+#define COAP_OPTION_ECHO 252
+
+static struct gw_session sessions[GW_MAX_SESSIONS];
+/*set by SIGHUP, the revocation list is reloaded by the event loop*/
+static volatile sig_atomic_t reload_revocation;
+/*set by SIGUSR1, the admission counters are printed by the event loop*/
+static volatile sig_atomic_t print_stats;
+/*protects state, peer and last_activity of all sessions*/
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief	Initializes the sessions. C_R is the index of a session, i.e.,
+ *          it is unique among all concurrent handshakes.
+ */
+static void sessions_init(void) {
+    for (uint8_t i = 0; i < GW_MAX_SESSIONS; i++) {
+        memset(&sessions[i], 0, sizeof(sessions[i]));
+        pthread_mutex_init(&sessions[i].lock, NULL);
+        pthread_cond_init(&sessions[i].cond, NULL);
+        sessions[i].c_r = i;
+    }
+}
+
+/**
+ * @brief	Returns the session of a peer. Must be called with table_lock
+ *          held.
+ * @param	peer address of the peer
+ * @param	peer_len length of peer
+ * @retval	the session or NULL
+ */
+static struct gw_session *session_find(
+    const struct sockaddr_storage *peer, socklen_t peer_len) {
+    for (int i = 0; i < GW_MAX_SESSIONS; i++) {
+        if (sessions[i].state != GW_FREE && sessions[i].peer_len == peer_len &&
+            memcmp(&sessions[i].peer, peer, peer_len) == 0) {
+            return &sessions[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief	Returns an unused session. Must be called with table_lock held.
+ * @retval	the session or NULL if all sessions are in use
+ */
+static struct gw_session *session_alloc(void) {
+    for (int i = 0; i < GW_MAX_SESSIONS; i++) {
+        if (sessions[i].state == GW_FREE) {
+            return &sessions[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief	Frees established sessions without traffic for
+ *          GW_SESSION_IDLE_TIMEOUT_S. Sessions in a handshake are freed by
+ *          their thread.
+ */
+static void sessions_reap(void) {
+    time_t now = time(NULL);
+    pthread_mutex_lock(&table_lock);
+    for (int i = 0; i < GW_MAX_SESSIONS; i++) {
+        if (sessions[i].state == GW_ESTABLISHED &&
+            now - sessions[i].last_activity > GW_SESSION_IDLE_TIMEOUT_S) {
+            oscore_session_free(&sessions[i]);
+            sessions[i].state = GW_FREE;
+        }
+    }
+    pthread_mutex_unlock(&table_lock);
+}
+
+void gw_session_handshake_done(struct gw_session *s, bool established) {
+    gw_admission_release();
+    pthread_mutex_lock(&table_lock);
+    if (established) {
+        s->state = GW_ESTABLISHED;
+        s->last_activity = time(NULL);
+    } else {
+        oscore_session_free(s);
+        s->state = GW_FREE;
+    }
+    pthread_mutex_unlock(&table_lock);
+}
+
+int gw_send_edhoc_response(
+    struct gw_session *s,
+    const uint8_t *payload,
+    uint32_t payload_len) {
+    CoapPDU pdu;
+    int r;
+
+    pthread_mutex_lock(&s->lock);
+    pdu.setVersion(1);
+    pdu.setType(s->confirmable ? CoapPDU::COAP_ACKNOWLEDGEMENT
+                               : CoapPDU::COAP_NON_CONFIRMABLE);
+    pdu.setCode(CoapPDU::COAP_CHANGED);
+    pdu.setMessageID(s->message_id);
+    pdu.setToken(s->token, s->token_len);
+    pthread_mutex_unlock(&s->lock);
+    if (payload_len) {
+        pdu.setPayload((uint8_t *)payload, payload_len);
+    }
+
+    r = sendto(sockfd, pdu.getPDUPointer(), pdu.getPDULength(), 0,
+               (struct sockaddr *)&s->peer, s->peer_len);
+    if (r < 0) {
+        printf("Error: failed to send reply (Code: %d, ErrNo: %d)\n", r, errno);
+        return r;
+    }
+    return 0;
+}
+
+/**
+ * @brief	Sends an empty response with code to the sender of req.
+ */
+static void send_empty_response(
+    CoapPDU *req, CoapPDU::Code code,
+    const struct sockaddr_storage *peer, socklen_t peer_len) {
+    CoapPDU pdu;
+    pdu.setVersion(1);
+    pdu.setType(req->getType() == CoapPDU::COAP_CONFIRMABLE
+                    ? CoapPDU::COAP_ACKNOWLEDGEMENT
+                    : CoapPDU::COAP_NON_CONFIRMABLE);
+    pdu.setCode(code);
+    pdu.setMessageID(req->getMessageID());
+    pdu.setToken(req->getTokenPointer(), req->getTokenLength());
+    sendto(sockfd, pdu.getPDUPointer(), pdu.getPDULength(), 0,
+           (const struct sockaddr *)peer, peer_len);
+}
+
+/**
+ * @brief	Answers req with 4.01 (Unauthorized) and an Echo option. The 
+ *          client repeats its request with the Echo option to show that it 
+ *          receives at its source address (RFC 9175).
+ */
+static void send_echo_challenge(
+    CoapPDU *req,
+    const struct sockaddr_storage *peer, socklen_t peer_len) {
+    uint8_t echo[GW_ECHO_LEN];
+    CoapPDU pdu;
+
+    if (gw_echo_create(peer, peer_len, echo) != 0) return;
+    pdu.setVersion(1);
+    pdu.setType(req->getType() == CoapPDU::COAP_CONFIRMABLE
+                    ? CoapPDU::COAP_ACKNOWLEDGEMENT
+                    : CoapPDU::COAP_NON_CONFIRMABLE);
+    pdu.setCode(CoapPDU::COAP_UNAUTHORIZED);
+    pdu.setMessageID(req->getMessageID());
+    pdu.setToken(req->getTokenPointer(), req->getTokenLength());
+    pdu.addOption(COAP_OPTION_ECHO, sizeof(echo), echo);
+    sendto(sockfd, pdu.getPDUPointer(), pdu.getPDULength(), 0,
+           (const struct sockaddr *)peer, peer_len);
+}
+
+/**
+ * @brief	Remembers the request the next EDHOC message of s answers.
+ */
+static void session_save_request(struct gw_session *s, CoapPDU *req) {
+    pthread_mutex_lock(&s->lock);
+    s->token_len = req->getTokenLength();
+    if (s->token_len > GW_TOKEN_MAX_LEN) s->token_len = GW_TOKEN_MAX_LEN;
+    memcpy(s->token, req->getTokenPointer(), s->token_len);
+    s->message_id = req->getMessageID();
+    s->confirmable = req->getType() == CoapPDU::COAP_CONFIRMABLE;
+    s->oscore_req_len = 0;
+    pthread_mutex_unlock(&s->lock);
+}
+
+/**
+ * @brief	Checks if a request carries the OSCORE option.
+ */
+static bool has_oscore_option(CoapPDU *pdu) {
+    CoapPDU::CoapOption *options = pdu->getOptions();
+    int num = pdu->getNumOptions();
+    bool found = false;
+
+    for (int i = 0; i < num; i++) {
+        if (options[i].optionNumber == COAP_OPTION_OSCORE) {
+            found = true;
+        }
+    }
+    free(options);
+    return found;
+}
+
+/**
+ * @brief	Checks if a request carries the Echo option and verifies its 
+ *          value.
+ * @retval	false if the option is missing or its value is not valid
+ */
+static bool echo_option_valid(
+    CoapPDU *pdu,
+    const struct sockaddr_storage *peer, socklen_t peer_len) {
+    CoapPDU::CoapOption *options = pdu->getOptions();
+    int num = pdu->getNumOptions();
+    bool valid = false;
+
+    for (int i = 0; i < num; i++) {
+        if (options[i].optionNumber == COAP_OPTION_ECHO) {
+            valid = gw_echo_verify(peer, peer_len,
+                                   options[i].optionValuePointer,
+                                   options[i].optionValueLength);
+        }
+    }
+    free(options);
+    return valid;
+}
+
+/**
+ * @brief	Checks if a request targets the EDHOC resource.
+ */
+static bool is_edhoc_request(CoapPDU *pdu) {
+    char uri[32];
+    int uri_len = 0;
+
+    if (pdu->getCode() != CoapPDU::COAP_POST) return false;
+    if (pdu->getURI(uri, sizeof(uri), &uri_len) != 0) return false;
+    const char *p = uri[0] == '/' ? uri + 1 : uri;
+    return strcmp(p, EDHOC_URI) == 0;
+}
+
+/**
+ * @brief	Decides if message 1 in req may start a handshake, from the 
+ *          cheapest check to the most expensive one, and answers req if 
+ *          not. An admitted handshake returns its token in 
+ *          gw_session_handshake_done().
+ * @retval	true if the handshake was admitted
+ */
+static bool admit_handshake(
+    CoapPDU *req,
+    const struct sockaddr_storage *peer, socklen_t peer_len) {
+    if (gw_msg1_prevalidate(req->getPayloadPointer(),
+                            req->getPayloadLength()) != 0) {
+        send_empty_response(req, CoapPDU::COAP_BAD_REQUEST, peer, peer_len);
+        return false;
+    }
+    if (gw_echo_required() && !echo_option_valid(req, peer, peer_len)) {
+        send_echo_challenge(req, peer, peer_len);
+        return false;
+    }
+    if (gw_admit() != 0) {
+        send_empty_response(req, CoapPDU::COAP_SERVICE_UNAVAILABLE, peer, peer_len);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief	Handles a message of the EDHOC exchange. Message 1 starts a
+ *          new handshake thread, message 3 is handed to the running one.
+ */
+static void handle_edhoc(
+    CoapPDU *req,
+    const struct sockaddr_storage *peer, socklen_t peer_len) {
+    struct gw_session *s;
+    bool start = false;
+
+    pthread_mutex_lock(&table_lock);
+    s = session_find(peer, peer_len);
+    if (s != NULL && s->state == GW_ESTABLISHED) {
+        /*the client starts over, drop the old context*/
+        oscore_session_free(s);
+        s->state = GW_FREE;
+        s = NULL;
+    }
+    pthread_mutex_unlock(&table_lock);
+
+    if (s == NULL) {
+        /*only the event loop allocates sessions, s cannot be taken by
+        someone else in between*/
+        if (!admit_handshake(req, peer, peer_len)) return;
+        pthread_mutex_lock(&table_lock);
+        s = session_alloc();
+        if (s != NULL) {
+            memcpy(&s->peer, peer, peer_len);
+            s->peer_len = peer_len;
+            s->state = GW_HANDSHAKE;
+            s->rx_ready = false;
+            start = true;
+        }
+        pthread_mutex_unlock(&table_lock);
+        if (s == NULL) {
+            gw_admission_release();
+            send_empty_response(req, CoapPDU::COAP_SERVICE_UNAVAILABLE, peer, peer_len);
+            return;
+        }
+    }
+
+    if (!start) {
+        pthread_mutex_lock(&s->lock);
+        bool duplicate = s->message_id == req->getMessageID();
+        pthread_mutex_unlock(&s->lock);
+        /*a retransmission, the handshake thread answers the original*/
+        if (duplicate) return;
+    }
+
+    session_save_request(s, req);
+    if (edhoc_session_post(s, req->getPayloadPointer(), req->getPayloadLength()) != 0) {
+        send_empty_response(req, CoapPDU::COAP_REQUEST_ENTITY_TOO_LARGE, peer, peer_len);
+        return;
+    }
+    if (start && edhoc_session_start(s) != 0) {
+        gw_session_handshake_done(s, false);
+        send_empty_response(req, CoapPDU::COAP_SERVICE_UNAVAILABLE, peer, peer_len);
+    }
+}
+
+void gw_serve_oscore(struct gw_session *s, uint8_t *buf, uint16_t len) {
+    uint8_t response_msg[] = {"This is a response!"};
+    uint8_t coap_buf[MAXLINE];
+    uint16_t coap_buf_len = sizeof(coap_buf);
+    uint8_t oscore_buf[MAXLINE];
+    uint16_t oscore_buf_len = sizeof(oscore_buf);
+
+    if (oscore_session_unprotect(s, buf, len, coap_buf, &coap_buf_len) != 0) {
+        return;
+    }
+    CoapPDU req(coap_buf, coap_buf_len);
+    if (!req.validate()) return;
+
+    CoapPDU resp;
+    resp.setVersion(1);
+    resp.setType(req.getType() == CoapPDU::COAP_CONFIRMABLE
+                     ? CoapPDU::COAP_ACKNOWLEDGEMENT
+                     : CoapPDU::COAP_NON_CONFIRMABLE);
+    resp.setCode(CoapPDU::COAP_CONTENT);
+    resp.setMessageID(req.getMessageID());
+    resp.setToken(req.getTokenPointer(), req.getTokenLength());
+    resp.setPayload(response_msg, sizeof(response_msg));
+
+    if (oscore_session_protect(s, resp.getPDUPointer(), resp.getPDULength(),
+                               oscore_buf, &oscore_buf_len) != 0) {
+        return;
+    }
+    sendto(sockfd, oscore_buf, oscore_buf_len, 0,
+           (const struct sockaddr *)&s->peer, s->peer_len);
+}
+
+/**
+ * @brief	Handles an OSCORE request of an established session. Only the
+ *          event loop thread uses the OSCORE contexts of established 
+ *          sessions.
+ */
+static void handle_oscore(
+    uint8_t *buf, uint16_t len,
+    const struct sockaddr_storage *peer, socklen_t peer_len) {
+    struct gw_session *s;
+
+    pthread_mutex_lock(&table_lock);
+    s = session_find(peer, peer_len);
+    if (s != NULL && s->state == GW_ESTABLISHED) {
+        s->last_activity = time(NULL);
+    } else {
+        s = NULL;
+    }
+    pthread_mutex_unlock(&table_lock);
+    if (s == NULL) return;
+
+    gw_serve_oscore(s, buf, len);
+}
+
+/**
+ * @brief	Handles a combined EDHOC+OSCORE request. Message 3 is handed to
+ *          the handshake thread, which answers the OSCORE part once the
+ *          context is derived. This saves the round trip between message 3
+ *          and the first OSCORE request.
+ * @retval	false if the request was not a combined request
+ */
+static bool handle_combined(
+    CoapPDU *req, uint8_t *buf, uint16_t len,
+    const struct sockaddr_storage *peer, socklen_t peer_len) {
+    uint8_t msg3[MAXLINE];
+    uint16_t msg3_len = sizeof(msg3);
+    uint8_t oscore_req[MAXLINE];
+    uint16_t oscore_req_len = sizeof(oscore_req);
+    struct gw_session *s;
+    bool combined;
+
+    if (combined_request_split(buf, len, &combined, msg3, &msg3_len,
+                               oscore_req, &oscore_req_len) != 0) {
+        return true;
+    }
+    if (!combined) return false;
+
+    pthread_mutex_lock(&table_lock);
+    s = session_find(peer, peer_len);
+    if (s != NULL && s->state != GW_HANDSHAKE) s = NULL;
+    pthread_mutex_unlock(&table_lock);
+    if (s == NULL) {
+        send_empty_response(req, CoapPDU::COAP_BAD_REQUEST, peer, peer_len);
+        return true;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    bool duplicate = s->message_id == req->getMessageID();
+    pthread_mutex_unlock(&s->lock);
+    if (duplicate) return true;
+
+    session_save_request(s, req);
+    pthread_mutex_lock(&s->lock);
+    memcpy(s->oscore_req, oscore_req, oscore_req_len);
+    s->oscore_req_len = oscore_req_len;
+    pthread_mutex_unlock(&s->lock);
+    edhoc_session_post(s, msg3, msg3_len);
+    return true;
+}
+
+/**
+ * @brief	Dispatches one received datagram.
+ */
+static void handle_datagram(
+    uint8_t *buf, int n,
+    const struct sockaddr_storage *peer, socklen_t peer_len) {
+    CoapPDU pdu(buf, n);
+
+    if (!pdu.validate()) return;
+
+    if (has_oscore_option(&pdu)) {
+        if (!handle_combined(&pdu, buf, n, peer, peer_len)) {
+            handle_oscore(buf, n, peer, peer_len);
+        }
+    } else if (is_edhoc_request(&pdu)) {
+        handle_edhoc(&pdu, peer, peer_len);
+    } else if (pdu.getType() == CoapPDU::COAP_CONFIRMABLE) {
+        send_empty_response(&pdu, CoapPDU::COAP_NOT_FOUND, peer, peer_len);
+    }
+}
+
+/**
+ * @brief	Initializes socket for CoAP server.
+ * @param
+ * @retval	error code
+ */
+static int start_coap_server(void) {
+    int err;
+#ifdef USE_IPV4
+    struct sockaddr_in servaddr;
+    const char IPV4_SERVADDR[] = {"127.0.0.1"};
+    err = sock_init(
+        SOCK_SERVER, IPV4_SERVADDR,
+        IPv4, &servaddr, sizeof(servaddr));
+#endif
+#ifdef USE_IPV6
+    struct sockaddr_in6 servaddr;
+    const char IPV6_SERVADDR[] = {"::1"};
+    err = sock_init(
+        SOCK_SERVER, IPV6_SERVADDR,
+        IPv6, &servaddr, sizeof(servaddr));
+#endif
+    if (err < 0) {
+        printf("error during socket initialization (error code: %d)", err);
+        return -1;
+    }
+    return fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL) | O_NONBLOCK);
+}
+
+static void on_sighup(int) { reload_revocation = 1; }
+
+static void on_sigusr1(int) { print_stats = 1; }
+
+static void usage(const char *name) {
+    printf("usage: %s [-e] [-r rate] [-b burst] [-a active] [revocation_list]\n", name);
+    printf("  -e  require an Echo round trip before a handshake\n");
+    printf("  -r  handshakes per second (default %d)\n", GW_HANDSHAKE_RATE);
+    printf("  -b  handshakes admitted at once (default %d)\n", GW_HANDSHAKE_BURST);
+    printf("  -a  handshakes running at the same time (default %d)\n",
+           GW_MAX_ACTIVE_HANDSHAKES);
+}
+
+int main(int argc, char *argv[]) {
+    struct epoll_event ev, events[1];
+    uint8_t buffer[MAXLINE];
+    struct sockaddr_storage peer;
+    socklen_t peer_len;
+    int epfd, n, opt;
+    uint32_t rate = GW_HANDSHAKE_RATE, burst = GW_HANDSHAKE_BURST;
+    uint32_t max_active = GW_MAX_ACTIVE_HANDSHAKES;
+    bool echo = false;
+    struct sigaction sa;
+
+    while ((opt = getopt(argc, argv, "er:b:a:h")) != -1) {
+        switch (opt) {
+            case 'e':
+                echo = true;
+                break;
+            case 'r':
+                rate = strtoul(optarg, NULL, 0);
+                break;
+            case 'b':
+                burst = strtoul(optarg, NULL, 0);
+                break;
+            case 'a':
+                max_active = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : -1;
+        }
+    }
+    const char *revocation_path = optind < argc ? argv[optind] : NULL;
+
+    sessions_init();
+    if (gw_admission_init(rate, burst, max_active, echo) < 0) return -1;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigusr1;
+    sigaction(SIGUSR1, &sa, NULL);
+    if (revocation_path != NULL) {
+        sa.sa_handler = on_sighup;
+        sigaction(SIGHUP, &sa, NULL);
+        if (gw_revocation_load(revocation_path) < 0) return -1;
+    }
+    if (start_coap_server() < 0) return -1;
+
+    epfd = epoll_create1(0);
+    if (epfd < 0) return -1;
+    ev.events = EPOLLIN;
+    ev.data.fd = sockfd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, sockfd, &ev) < 0) return -1;
+
+    while (1) {
+        n = epoll_wait(epfd, events, 1, 1000);
+        if (n < 0 && errno != EINTR) break;
+        if (reload_revocation) {
+            reload_revocation = 0;
+            gw_revocation_load(revocation_path);
+        }
+        if (print_stats) {
+            print_stats = 0;
+            gw_admission_stats_print();
+        }
+        sessions_reap();
+        if (n <= 0) continue;
+
+        /*drain the socket*/
+        while (1) {
+            peer_len = sizeof(peer);
+            n = recvfrom(sockfd, buffer, sizeof(buffer), 0,
+                         (struct sockaddr *)&peer, &peer_len);
+            if (n < 0) break;
+            handle_datagram(buffer, n, &peer, peer_len);
+        }
+    }
+
+    close(epfd);
+    close(sockfd);
+    return 0;
+}
@@ -0,0 +1,125 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../../../modules/oscore/oscore.h"
+#include "gateway.h"
+
+/*the OSCORE context only references its inputs, they live next to it*/
+struct oscore_session {
+    struct context c;
+    uint8_t master_secret[16];
+    uint8_t master_salt[8];
+    uint8_t recipient_id;
+};
+
+int oscore_session_init(
+    struct gw_session *s,
+    const uint8_t *master_secret, uint32_t master_secret_len,
+    const uint8_t *master_salt, uint32_t master_salt_len) {
+    struct oscore_session *o;
+    OscoreError r;
+
+    o = calloc(1, sizeof(*o));
+    if (o == NULL) return -1;
+    if (master_secret_len != sizeof(o->master_secret) ||
+        master_salt_len != sizeof(o->master_salt)) {
+        free(o);
+        return -1;
+    }
+    memcpy(o->master_secret, master_secret, master_secret_len);
+    memcpy(o->master_salt, master_salt, master_salt_len);
+
+    /*The client addresses the gateway with C_R as kid. edhoc_responder_run()
+    does not return C_I, the Sender ID of the gateway is left empty.*/
+    o->recipient_id = s->c_r;
+    struct oscore_init_params params = {
+        SERVER,
+        {sizeof(o->master_secret), o->master_secret},
+        {0, NULL},
+        {1, &o->recipient_id},
+        {0, NULL},
+        {sizeof(o->master_salt), o->master_salt},
+        AES_CCM_16_64_128,
+        SHA_256,
+    };
+    r = oscore_context_init(&params, &o->c);
+    if (r != OscoreNoError) {
+        printf("Error in oscore_context_init (error code %d)\n", r);
+        free(o);
+        return -1;
+    }
+
+    s->oscore = o;
+    return 0;
+}
+
+int oscore_session_unprotect(
+    struct gw_session *s,
+    uint8_t *in, uint16_t in_len,
+    uint8_t *out, uint16_t *out_len) {
+    struct oscore_session *o = (struct oscore_session *)s->oscore;
+    bool oscore_flag;
+    OscoreError r;
+
+    if (o == NULL) return -1;
+    r = oscore2coap(in, in_len, out, out_len, &oscore_flag, &o->c);
+    if (r != OscoreNoError || !oscore_flag) {
+        printf("Error in oscore2coap (error code %d)\n", r);
+        return -1;
+    }
+    return 0;
+}
+
+int oscore_session_protect(
+    struct gw_session *s,
+    uint8_t *in, uint16_t in_len,
+    uint8_t *out, uint16_t *out_len) {
+    struct oscore_session *o = (struct oscore_session *)s->oscore;
+    OscoreError r;
+
+    if (o == NULL) return -1;
+    r = coap2oscore(in, in_len, out, out_len, &o->c);
+    if (r != OscoreNoError) {
+        printf("Error in coap2oscore (error code %d)\n", r);
+        return -1;
+    }
+    return 0;
+}
+
+int combined_request_split(
+    uint8_t *in, uint16_t in_len,
+    bool *combined,
+    uint8_t *msg3, uint16_t *msg3_len,
+    uint8_t *oscore_req, uint16_t *oscore_req_len) {
+    OscoreError r = oscore_combined_request_split(
+        in, in_len, combined, msg3, msg3_len, oscore_req, oscore_req_len);
+    if (r != OscoreNoError) {
+        printf("Error in oscore_combined_request_split (error code %d)\n", r);
+        return -1;
+    }
+    return 0;
+}
+
+void oscore_session_free(struct gw_session *s) {
+    volatile uint8_t *p = (volatile uint8_t *)s->oscore;
+    size_t i;
+
+    if (p == NULL) return;
+    for (i = 0; i < sizeof(struct oscore_session); i++) {
+        p[i] = 0;
+    }
+    free(s->oscore);
+    s->oscore = NULL;
+}
@@ -0,0 +1,121 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../../../../modules/edhoc/edhoc.h"
+#include "gateway.h"
+
+/*
+ * The revocation list is read into a private copy, so that a file which is
+ * rewritten in place does not change under running handshakes. A reload
+ * reads the new file and makes it the current list. Handshakes which already
+ * took the previous list keep using it, its copy is freed when the last of
+ * them released it.
+ */
+struct gw_revocation {
+    struct revocation_list rl; /*first member, see gw_revocation_release()*/
+    uint8_t *buf;
+    size_t buf_len;
+    unsigned refs;
+};
+
+static struct gw_revocation *current;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void revocation_free(struct gw_revocation *g) {
+    free(g->buf);
+    free(g);
+}
+
+int gw_revocation_load(const char *path) {
+    struct gw_revocation *g, *old;
+    struct stat st;
+    EdhocError r;
+    size_t done;
+    ssize_t n;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("open revocation list");
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size <= 0 || st.st_size > UINT32_MAX) {
+        close(fd);
+        return -1;
+    }
+
+    g = calloc(1, sizeof(*g));
+    if (g != NULL) g->buf = malloc((size_t)st.st_size);
+    if (g == NULL || g->buf == NULL) {
+        free(g);
+        close(fd);
+        return -1;
+    }
+
+    /*a file which is shorter than its size in st is rejected by
+    revocation_list_init()*/
+    for (done = 0; done < (size_t)st.st_size; done += (size_t)n) {
+        n = read(fd, g->buf + done, (size_t)st.st_size - done);
+        if (n < 0) {
+            perror("read revocation list");
+            close(fd);
+            revocation_free(g);
+            return -1;
+        }
+        if (n == 0) break;
+    }
+    close(fd);
+    g->buf_len = done;
+
+    r = revocation_list_init(&g->rl, g->buf, (uint32_t)g->buf_len);
+    if (r != EdhocNoError) {
+        printf("Invalid revocation list %s (Error code %d)\n", path, r);
+        revocation_free(g);
+        return -1;
+    }
+
+    pthread_mutex_lock(&lock);
+    old = current;
+    current = g;
+    if (old != NULL && old->refs == 0) revocation_free(old);
+    pthread_mutex_unlock(&lock);
+
+    printf("Loaded revocation list %s with %u entries\n", path,
+           (unsigned)g->rl.entry_num);
+    return 0;
+}
+
+const struct revocation_list *gw_revocation_acquire(void) {
+    struct gw_revocation *g;
+
+    pthread_mutex_lock(&lock);
+    g = current;
+    if (g != NULL) g->refs++;
+    pthread_mutex_unlock(&lock);
+    return g != NULL ? &g->rl : NULL;
+}
+
+void gw_revocation_release(const struct revocation_list *rl) {
+    struct gw_revocation *g = (struct gw_revocation *)rl;
+
+    if (g == NULL) return;
+    pthread_mutex_lock(&lock);
+    g->refs--;
+    if (g->refs == 0 && g != current) revocation_free(g);
+    pthread_mutex_unlock(&lock);
+}
@@ -427,7 +427,7 @@ uint8_t G_R[] = {};
 uint8_t G_R_LEN = sizeof(G_R);
 
 uint8_t CA[] = {"RFC test CA"};
-uint8_t CA_LEN = sizeof(CA);
+uint8_t CA_LEN = sizeof(CA) - 1;
 
 uint8_t CA_PK[] = {0xdb, 0xd9, 0xdc, 0x8c, 0xd0, 0x3f, 0xb7, 0xc3, 0x91, 0x35, 0x11, 0x46, 0x2b, 0xb2, 0x38, 0x16, 0x47, 0x7c, 0x6b, 0xd8, 0xd6, 0x6e, 0xf5, 0xa1, 0xa0, 0x70, 0xac, 0x85, 0x4e, 0xd7, 0x3f, 0xd2};
 uint8_t CA_PK_LEN = sizeof(CA_PK);
@@ -481,7 +481,7 @@ uint8_t* G_I = NULL;
 uint32_t G_I_LEN = 0;
 
 uint8_t CA[] = {"RFC test CA"};
-uint8_t CA_LEN = sizeof(CA);
+uint8_t CA_LEN = sizeof(CA) - 1;
 
 uint8_t CA_PK[] = {0xdb, 0xd9, 0xdc, 0x8c, 0xd0, 0x3f, 0xb7, 0xc3, 0x91, 0x35, 0x11, 0x46, 0x2b, 0xb2, 0x38, 0x16, 0x47, 0x7c, 0x6b, 0xd8, 0xd6, 0x6e, 0xf5, 0xa1, 0xa0, 0x70, 0xac, 0x85, 0x4e, 0xd7, 0x3f, 0xd2};
 uint8_t CA_PK_LEN = sizeof(CA_PK);
@@ -591,7 +591,7 @@ uint8_t G_R[] = {};
 uint8_t G_R_LEN = sizeof(G_R);
 
 uint8_t CA[] = {"RFC test CA"};
-uint8_t CA_LEN = sizeof(CA);
+uint8_t CA_LEN = sizeof(CA) - 1;
 
 uint8_t CA_PK[] = {0xdb, 0xd9, 0xdc, 0x8c, 0xd0, 0x3f, 0xb7, 0xc3, 0x91, 0x35, 0x11, 0x46, 0x2b, 0xb2, 0x38, 0x16, 0x47, 0x7c, 0x6b, 0xd8, 0xd6, 0x6e, 0xf5, 0xa1, 0xa0, 0x70, 0xac, 0x85, 0x4e, 0xd7, 0x3f, 0xd2};
 uint8_t CA_PK_LEN = sizeof(CA_PK);
@@ -645,7 +645,7 @@ uint8_t* G_I = NULL;
 uint32_t G_I_LEN = 0;
 
 uint8_t CA[] = {"RFC test CA"};
-uint8_t CA_LEN = sizeof(CA);
+uint8_t CA_LEN = sizeof(CA) - 1;
 
 uint8_t CA_PK[] = {0xdb, 0xd9, 0xdc, 0x8c, 0xd0, 0x3f, 0xb7, 0xc3, 0x91, 0x35, 0x11, 0x46, 0x2b, 0xb2, 0x38, 0x16, 0x47, 0x7c, 0x6b, 0xd8, 0xd6, 0x6e, 0xf5, 0xa1, 0xa0, 0x70, 0xac, 0x85, 0x4e, 0xd7, 0x3f, 0xd2};
 uint8_t CA_PK_LEN = sizeof(CA_PK);
@@ -64,14 +64,23 @@ static int start_coap_client(void) {
     return 0;
 }
 
+#define COAP_OPTION_ECHO 252
+
+/*the last request, it is repeated if the server asks for an Echo option*/
+static uint8_t last_msg[MAXLINE];
+static uint32_t last_msg_len;
+
 /**
  * @brief	Creates CoAP packet and sends supplied payload over network.
  * @param	msg pointer to message payload
  * @param	msg_len length of message payload
- * @param
+ * @param	echo value of the Echo option or NULL
+ * @param	echo_len length of echo
  * @retval	
  */
-void send_coap(uint8_t *msg, uint32_t msg_len) {
+static void send_coap_echo(
+    uint8_t *msg, uint32_t msg_len,
+    uint8_t *echo, uint16_t echo_len) {
     /*construct a CoAP packet*/
     static uint16_t mid = 0;
     static uint32_t token = 0;
@@ -83,13 +92,34 @@ void send_coap(uint8_t *msg, uint32_t msg_len) {
     pdu->setToken((uint8_t *)&(++token), sizeof(token));
     pdu->setMessageID(mid++);
     pdu->setURI((char *)".well-known/edhoc", 17);
+    if (echo != NULL) {
+        pdu->addOption(COAP_OPTION_ECHO, echo_len, echo);
+    }
     pdu->setPayload(msg, msg_len);
 
     send(sockfd, pdu->getPDUPointer(), pdu->getPDULength(), 0);
+    delete pdu;
+}
+
+/**
+ * @brief	Creates CoAP packet and sends supplied payload over network.
+ * @param	msg pointer to message payload
+ * @param	msg_len length of message payload
+ * @param
+ * @retval	
+ */
+void send_coap(uint8_t *msg, uint32_t msg_len) {
+    if (msg_len <= sizeof(last_msg)) {
+        memcpy(last_msg, msg, msg_len);
+        last_msg_len = msg_len;
+    }
+    send_coap_echo(msg, msg_len, NULL, 0);
 }
 
 /**
  * @brief	Waits for CoAP response packet and provides payload to callee.
+ *          A 4.01 response with an Echo option (RFC 9175) is answered by 
+ *          repeating the last request with that option.
  * @param	msg buffer to store received message payload
  * @param	msg_len integer to store length of received message payload
  * @param
@@ -97,18 +127,37 @@ void send_coap(uint8_t *msg, uint32_t msg_len) {
  */
 void recv_coap(uint8_t **msg, uint32_t *msg_len) {
     int n;
-    char buffer[MAXLINE];
+    static char buffer[MAXLINE];
     CoapPDU *recvPDU;
-    /* receive */
-    n = recv(sockfd, (char *)buffer, MAXLINE, MSG_WAITALL);
-    if (n < 0) {
-        printf("recv error");
-    }
-
-    recvPDU = new CoapPDU((uint8_t *)buffer, n);
 
-    if (recvPDU->validate()) {
-        recvPDU->printHuman();
+    while (1) {
+        /* receive */
+        n = recv(sockfd, (char *)buffer, MAXLINE, MSG_WAITALL);
+        if (n < 0) {
+            printf("recv error");
+        }
+
+        recvPDU = new CoapPDU((uint8_t *)buffer, n);
+
+        if (recvPDU->validate()) {
+            recvPDU->printHuman();
+        }
+        if (recvPDU->getCode() != CoapPDU::COAP_UNAUTHORIZED) break;
+
+        CoapPDU::CoapOption *options = recvPDU->getOptions();
+        int num = recvPDU->getNumOptions();
+        bool echoed = false;
+        for (int i = 0; i < num; i++) {
+            if (options[i].optionNumber == COAP_OPTION_ECHO) {
+                send_coap_echo(last_msg, last_msg_len,
+                               options[i].optionValuePointer,
+                               options[i].optionValueLength);
+                echoed = true;
+            }
+        }
+        free(options);
+        if (!echoed) break;
+        delete recvPDU;
     }
 
     *msg = recvPDU->getPayloadPointer();
@@ -129,21 +178,13 @@ int main() {
     int err;
 
 #ifdef USE_RANDOM_EPHEMERAL_DH_KEY
-    uint32_t seed;
     uint8_t G_X_random[32];
     uint8_t X_random[32];
 
-    /*create a random seed*/
-    FILE *fp;
-    fp = fopen("/dev/urandom", "r");
-    uint64_t seed_len = fread((uint8_t *)&seed, 1, sizeof(seed), fp);
-    fclose(fp);
-    PRINT_ARRAY("seed", (uint8_t *)&seed, seed_len);
-
-    /*create ephemeral DH keys from seed*/
-    r = ephemeral_dh_key_gen(X25519, seed, X_random, G_X_random);
+    /*create ephemeral DH keys from the random number generator*/
+    r = ephemeral_dh_key_pair_gen(X25519, X_random, G_X_random);
     if (r != EdhocNoError) {
-        printf("Error in ephemeral_dh_key_gen, (Error code %d)\n", r);
+        printf("Error in ephemeral_dh_key_pair_gen, (Error code %d)\n", r);
     }
     PRINT_ARRAY("secret ephemeral DH key", X_random, sizeof(X_random));
     PRINT_ARRAY("public ephemeral DH key", G_X_random, sizeof(G_X_random));
@@ -197,10 +238,8 @@ int main() {
     PRINT_ARRAY("PRK_4x3m", PRK_4x3m, sizeof(PRK_4x3m));
     PRINT_ARRAY("th4", th4, sizeof(th4));
 
-    edhoc_exporter(SHA_256, AES_CCM_16_64_128, PRK_4x3m, sizeof(PRK_4x3m), th4, sizeof(th4), "OSCORE Master Secret", oscore_master_secret, 16);
+    edhoc_exporter_oscore(SHA_256, AES_CCM_16_64_128, PRK_4x3m, sizeof(PRK_4x3m), th4, sizeof(th4), oscore_master_secret, 16, oscore_master_salt, 8);
     PRINT_ARRAY("OSCORE Master Secret", oscore_master_secret, 16);
-
-    edhoc_exporter(SHA_256, AES_CCM_16_64_128, PRK_4x3m, sizeof(PRK_4x3m), th4, sizeof(th4), "OSCORE Master Salt", oscore_master_salt, 8);
     PRINT_ARRAY("OSCORE Master Salt", oscore_master_salt, 8);
 
     close(sockfd);
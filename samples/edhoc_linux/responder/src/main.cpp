@@ -12,6 +12,7 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <netinet/in.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -46,6 +47,28 @@ struct sockaddr_in client_addr;
 #endif
 socklen_t client_addr_len;
 
+#ifdef USE_RANDOM_EPHEMERAL_DH_KEY
+struct ephemeral_key_pool key_pool;
+
+/**
+ * @brief	Keeps the ephemeral key pool filled so that key generation is not 
+ *          part of the handshake.
+ * @param	arg pointer to the pool
+ * @retval	
+ */
+static void *key_pool_refill_thread(void *arg) {
+    struct ephemeral_key_pool *pool = (struct ephemeral_key_pool *)arg;
+    while (1) {
+        EdhocError r = ephemeral_key_pool_refill(pool, EPHEMERAL_KEY_POOL_SIZE);
+        if (r != EdhocNoError) {
+            printf("Error in ephemeral_key_pool_refill, (Error code %d)\n", r);
+        }
+        usleep(10000);
+    }
+    return NULL;
+}
+#endif
+
 /**
  * @brief	Initializes socket for CoAP server.
  * @param	
@@ -174,24 +197,18 @@ int main() {
     EdhocError r;
 
 #ifdef USE_RANDOM_EPHEMERAL_DH_KEY
-    uint32_t seed;
-    uint8_t G_Y_random[32];
-    uint8_t Y_random[32];
-
-    /*create a random seed*/
-    FILE *fp;
-    fp = fopen("/dev/urandom", "r");
-    uint64_t seed_len = fread((uint8_t *)&seed, 1, sizeof(seed), fp);
-    fclose(fp);
-    PRINT_ARRAY("seed", (uint8_t *)&seed, seed_len);
-
-    /*create ephemeral DH keys from seed*/
-    r = ephemeral_dh_key_gen(X25519, seed, Y_random, G_Y_random);
+    /*every handshake takes a fresh key pair from the pool*/
+    pthread_t refill_thread;
+    ephemeral_key_pool_init(&key_pool, X25519);
+    r = ephemeral_key_pool_refill(&key_pool, EPHEMERAL_KEY_POOL_SIZE);
     if (r != EdhocNoError) {
-        printf("Error in ephemeral_dh_key_gen, (Error code %d)\n", r);
+        printf("Error in ephemeral_key_pool_refill, (Error code %d)\n", r);
+    }
+    if (pthread_create(&refill_thread, NULL, key_pool_refill_thread,
+                       &key_pool) != 0) {
+        /*the pool falls back to generating key pairs on demand*/
+        printf("Error in pthread_create, the key pool is not refilled\n");
     }
-    PRINT_ARRAY("secret ephemeral DH key", Y_random, sizeof(Y_random));
-    PRINT_ARRAY("public ephemeral DH key", G_Y_random, sizeof(G_Y_random));
 #endif
 
     struct other_party_cred cred_i = {
@@ -204,13 +221,8 @@ int main() {
     uint16_t cred_num = 1;
     struct edhoc_responder_context c_r = {
         {SUITES_R_LEN, SUITES_R},
-#ifdef USE_RANDOM_EPHEMERAL_DH_KEY
-        {sizeof(G_Y_random), G_Y_random},
-        {sizeof(Y_random), Y_random},
-#else
         {G_Y_LEN, G_Y},
         {Y_LEN, Y},
-#endif
         {C_R_LEN, C_R},
         {G_R_LEN, G_R},
         {R_LEN, R},
@@ -218,7 +230,13 @@ int main() {
         {ID_CRED_R_LEN, ID_CRED_R},
         {CRED_R_LEN, CRED_R},
         {SK_R_LEN, SK_R},
-        {PK_R_LEN, PK_R}};
+        {PK_R_LEN, PK_R},
+#ifdef USE_RANDOM_EPHEMERAL_DH_KEY
+        &key_pool,
+#else
+        NULL,
+#endif
+    };
 
     start_coap_server();
 
@@ -233,10 +251,8 @@ int main() {
         PRINT_ARRAY("PRK_4x3m", PRK_4x3m, sizeof(PRK_4x3m));
         PRINT_ARRAY("th4", th4, sizeof(th4));
 
-        edhoc_exporter(SHA_256, AES_CCM_16_64_128, PRK_4x3m, sizeof(PRK_4x3m), th4, sizeof(th4), "OSCORE Master Secret", oscore_master_secret, 16);
+        edhoc_exporter_oscore(SHA_256, AES_CCM_16_64_128, PRK_4x3m, sizeof(PRK_4x3m), th4, sizeof(th4), oscore_master_secret, 16, oscore_master_salt, 8);
         PRINT_ARRAY("OSCORE Master Secret", oscore_master_secret, 16);
-
-        edhoc_exporter(SHA_256, AES_CCM_16_64_128, PRK_4x3m, sizeof(PRK_4x3m), th4, sizeof(th4), "OSCORE Master Salt", oscore_master_salt, 8);
         PRINT_ARRAY("OSCORE Master Salt", oscore_master_salt, 8);
     }
 
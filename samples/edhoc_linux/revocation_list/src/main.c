@@ -0,0 +1,144 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "edhoc.h"
+#include "inc/crypto_wrapper.h"
+
+/*the library needs a transport, this tool does not run handshakes*/
+EdhocError tx(uint8_t *data, uint32_t data_len) {
+    return TransportError;
+}
+
+EdhocError rx(uint8_t *data, uint32_t *data_len) {
+    return TransportError;
+}
+
+static void usage(const char *name) {
+    printf("usage: %s [-b bits] [-k k] out cert...\n", name);
+    printf("  -b bits of the Bloom filter per entry (default 10)\n");
+    printf("  -k bit positions per entry (default 7)\n");
+    printf("  out the revocation list file\n");
+    printf("  cert files containing revoked CBOR encoded certificates\n");
+}
+
+static int entry_cmp(const void *a, const void *b) {
+    return memcmp(a, b, REVOCATION_HASH_SIZE);
+}
+
+/**
+ * @brief   Computes the entry of a certificate file
+ * @param   path the file
+ * @param   entry the truncated SHA-256 hash of the certificate
+ * @retval  0 or a negative value on error
+ */
+static int cert_entry(const char *path, uint8_t *entry) {
+    uint8_t cert[CRED_DEFAULT_SIZE * 8];
+    uint8_t h[SHA_DEFAULT_SIZE];
+    size_t len;
+    FILE *f;
+
+    f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    len = fread(cert, 1, sizeof(cert), f);
+    if (!feof(f) || len == 0) {
+        printf("%s: empty or larger than %zu bytes\n", path, sizeof(cert));
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+
+    if (hash(SHA_256, cert, len, h) != EdhocNoError) return -1;
+    memcpy(entry, h, REVOCATION_HASH_SIZE);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t bits_per_entry = 10, entry_num, bloom_bits, out_len, unique;
+    uint8_t k = 7;
+    uint8_t *entries, *out;
+    EdhocError r;
+    FILE *f;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:k:h")) != -1) {
+        switch (opt) {
+            case 'b':
+                bits_per_entry = strtoul(optarg, NULL, 0);
+                break;
+            case 'k':
+                k = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : -1;
+        }
+    }
+    if (argc - optind < 1 || bits_per_entry == 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    entry_num = (uint32_t)(argc - optind - 1);
+    entries = malloc((size_t)entry_num * REVOCATION_HASH_SIZE + 1);
+    if (entries == NULL) return -1;
+    for (uint32_t i = 0; i < entry_num; i++) {
+        if (cert_entry(argv[optind + 1 + i],
+                       entries + (size_t)i * REVOCATION_HASH_SIZE) < 0) {
+            return -1;
+        }
+    }
+
+    /*the entries are searched with a binary search, a certificate given
+    twice is stored once*/
+    qsort(entries, entry_num, REVOCATION_HASH_SIZE, entry_cmp);
+    unique = 0;
+    for (uint32_t i = 0; i < entry_num; i++) {
+        uint8_t *e = entries + (size_t)i * REVOCATION_HASH_SIZE;
+        if (unique == 0 ||
+            memcmp(entries + (size_t)(unique - 1) * REVOCATION_HASH_SIZE, e,
+                   REVOCATION_HASH_SIZE)) {
+            memmove(entries + (size_t)unique * REVOCATION_HASH_SIZE, e,
+                    REVOCATION_HASH_SIZE);
+            unique++;
+        }
+    }
+
+    bloom_bits = (unique * bits_per_entry + 7) / 8 * 8;
+    if (bloom_bits == 0) bloom_bits = 8;
+    out_len = REVOCATION_LIST_HEADER_SIZE + bloom_bits / 8 +
+              unique * REVOCATION_HASH_SIZE;
+    out = malloc(out_len);
+    if (out == NULL) return -1;
+
+    r = revocation_list_encode(entries, unique, bloom_bits, k, out, &out_len);
+    if (r != EdhocNoError) {
+        printf("Error in revocation_list_encode (Error code %d)\n", r);
+        return -1;
+    }
+
+    f = fopen(argv[optind], "wb");
+    if (f == NULL || fwrite(out, 1, out_len, f) != out_len) {
+        perror(argv[optind]);
+        return -1;
+    }
+    fclose(f);
+    printf("%s: %u entries, %u bytes\n", argv[optind], (unsigned)unique,
+           (unsigned)out_len);
+    return 0;
+}
@@ -64,19 +64,22 @@ def execute_ext(cmd):
             exit()
 
 
-def build(name, opt, arc):
+def build(name, opt, arc, crypto):
     """
     Builds a static library.
     name: name of the library -- libuoscore.a or libuedhoc.a
     opt: optimization level
     arc: the name of the architecture (the Zephyr OS board name)
+    crypto: builtin, openssl (native_posix boards only), radix51 or p256_64
+    (native_posix_64 only)
     """
     # crate a file containing make variable indicating the optimization level
     # and the library which we want to build -- osocre or edhoc
     print("\n")
     print("===================================================================")
     print("\nBuilding " + name + " for architecture " +
-          arc.cpu_arc + " with optimization " + opt + "\n")
+          arc.cpu_arc + " with optimization " + opt + " and " + crypto +
+          " crypto\n")
     print("===================================================================")
 
     os.mkdir(build_lib_test_path)
@@ -94,19 +97,22 @@ def build(name, opt, arc):
     m.close
 
     # build with west
-    execute_ext(['west', 'build', '-b='+arc.board])
+    execute_ext(['west', 'build', '-b='+arc.board, '--', '-DCRYPTO='+crypto])
 
 
-def save(name, arc):
+def save(name, arc, crypto):
     """
     Saves a oscore or edhoc library for a specific architecture in folder 
     packaged.
     name: name of the library -- libuoscore.a or libuedhoc.a
     arc: the name of the architecture (the Zephyr OS board name)
+    crypto: builtin, openssl, radix51 or p256_64
     """
     print("\nSaving!\n")
     Path(results_path).mkdir(parents=True, exist_ok=True)
     name_only = os.path.splitext(os.path.basename(name))[0]
+    if (crypto != 'builtin'):
+        name_only += '_' + crypto
 
     t = tarfile.open(results_path + '/' + name_only +
                      '_' + arc.cpu_arc + '.tar.gz', 'x')
@@ -138,20 +144,24 @@ def test(arc):
             "Examine the results printed over the debugger and press Enter to continue...")
 
 
-def run_tests(name, arc):
+def run_tests(name, arc, crypto='builtin'):
     """
     Builds, tests and saves an oscore or an edhoc static library for a specific
     architecture. The tests are executed for libraries build with different 
     optimizations.
     name: name of the library -- libuoscore.a or libuedhoc.a
     arc: the name of the architecture (the Zephyr OS board name)
+    crypto: builtin (TinyCrypt and compact25519), openssl (libcrypto of the
+    host, native_posix boards only), radix51 (X25519 and Ed25519 with 64 bit
+    limbs, native_posix_64 only) or p256_64 (P-256 with 64 bit limbs,
+    native_posix_64 only)
     """
     opt = ("-O0", "-O1", "-O2", "-O3")
     for o in opt:
         clean()
-        build(name, o, arc)
+        build(name, o, arc, crypto)
         test(arc)
-    save(name, arc)
+    save(name, arc, crypto)
 
 
 def main():
@@ -170,6 +180,16 @@ def main():
     #run_tests('libuoscore.a', arc('native_posix_64', 'x86-64'))
     #run_tests('libuedhoc.a', arc('native_posix_64', 'x86-64'))
 
+    # x86-64 with OpenSSL, needs the libcrypto development files of the host
+    #run_tests('libuoscore.a', arc('native_posix_64', 'x86-64'), 'openssl')
+    #run_tests('libuedhoc.a', arc('native_posix_64', 'x86-64'), 'openssl')
+
+    # x86-64 with the 64 bit X25519 and Ed25519 of uEDHOC
+    run_tests('libuedhoc.a', arc('native_posix_64', 'x86-64'), 'radix51')
+
+    # x86-64 with the 64 bit P-256 of uEDHOC, cipher suites 2 and 3
+    run_tests('libuedhoc.a', arc('native_posix_64', 'x86-64'), 'p256_64')
+
     # to run the following tests a real hardware must be connect to the PC
     # executing this script. The results of the test can be examined over a serial consol such as GTKterm
 
@@ -12,15 +12,27 @@
 #include "main.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <zephyr.h>
 #include <ztest.h>
 
 #ifdef EDHOC_TESTS
 #include <edhoc.h>
+#include <inc/crypto_wrapper.h>
+#include <inc/retrieve_cred.h>
+#include <inc/revocation_list.h>
 
 #include "test_vectors_edhoc.h"
 #include "txrx_wrapper.h"
 
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+#include <inc/crypto_async.h>
+#endif
+#ifdef EDHOC_WITH_EXECUTOR
+#include <inc/executor.h>
+#include <unistd.h>
+#endif
+
 enum party_type { INITIATOR,
                   RESPONDER };
 enum test { T1,
@@ -489,9 +501,9 @@ static void test_edhoc(enum party_type p, enum test t) {
 
     if (p == INITIATOR) {
         const uint16_t num_cred_r_elements = 1;
-        struct other_party_cred cred_r;
+        struct other_party_cred cred_r = {0};
         init_other_party_cred_r(&cred_r, t);
-        struct edhoc_initiator_context c_i;
+        struct edhoc_initiator_context c_i = {0};
         init_edhoc_initiator_context(&c_i, t);
 
         r = edhoc_initiator_run(
@@ -502,9 +514,9 @@ static void test_edhoc(enum party_type p, enum test t) {
             th4, sizeof(th4));
     } else {
         const uint16_t num_cred_i_elements = 1;
-        struct other_party_cred cred_i;
+        struct other_party_cred cred_i = {0};
         init_other_party_cred_i(&cred_i, t);
-        struct edhoc_responder_context c_r;
+        struct edhoc_responder_context c_r = {0};
         init_edhoc_responder_context(&c_r, t);
 
         r = edhoc_responder_run(
@@ -529,6 +541,16 @@ static void test_edhoc(enum party_type p, enum test t) {
         th4, sizeof(th4),
         "OSCORE Master Salt", oscore_master_salt, 8);
 
+    uint8_t master_secret[16];
+    uint8_t master_salt[8];
+    r = edhoc_exporter_oscore(
+        SHA_256, AES_CCM_16_64_128,
+        PRK_4x3m, sizeof(PRK_4x3m),
+        th4, sizeof(th4),
+        master_secret, sizeof(master_secret),
+        master_salt, sizeof(master_salt));
+    zassert_equal(r, EdhocNoError, "Error in edhoc_exporter_oscore");
+
     // check th4, PRK_4x3m, OSCORE Master secret and salt are correct
     zassert_mem_equal__(
         &PRK_4x3m, e.prk_4x3m,
@@ -540,8 +562,947 @@ static void test_edhoc(enum party_type p, enum test t) {
     zassert_mem_equal__(
         &oscore_master_salt, e.oscore_master_salt,
         sizeof(oscore_master_salt), "wrong OSCORE Master Salt");
+    zassert_mem_equal__(
+        &master_secret, e.oscore_master_secret,
+        sizeof(master_secret), "wrong OSCORE Master Secret (single call)");
+    zassert_mem_equal__(
+        &master_salt, e.oscore_master_salt,
+        sizeof(master_salt), "wrong OSCORE Master Salt (single call)");
+}
+
+/**
+ * @brief   Runs the stateless responder with message 3 and a state token
+ * @param   c_r the responder context
+ * @param   keys the state keys
+ * @param   cred_i the credentials of the initiator
+ * @param   state the state token of message 2
+ * @param   state_len length of state
+ */
+static EdhocError stateless_msg3_run(
+    struct edhoc_responder_context *c_r, struct edhoc_state_keys *keys,
+    struct other_party_cred *cred_i, uint8_t *state, uint32_t state_len) {
+    err_msg_len = sizeof(err_msg);
+    ad_3_len = sizeof(ad_3);
+    return edhoc_responder_stateless_msg3(
+        c_r, keys, cred_i, 1,
+        state, state_len,
+        M3.ptr, M3.len,
+        err_msg, &err_msg_len,
+        (uint8_t *)&ad_3, &ad_3_len,
+        PRK_4x3m, sizeof(PRK_4x3m),
+        th4, sizeof(th4));
+}
+
+/**
+ * @brief   Runs the responder in stateless mode with message 1 and 3 of the 
+ *          test vectors. Message 2 must be the same as of edhoc_responder_run(). 
+ *          A replayed message 3 with the same state token must be rejected, 
+ *          as well as a state token after two key rotations, a message 3 
+ *          with trailing bytes and a token if all slots of its epoch are 
+ *          used.
+ */
+static void test_edhoc_stateless(enum test t) {
+    EdhocError r;
+    init_test_messages(RESPONDER, t);
+    struct expected_result e;
+    init_expected_result(&e, t);
+
+    struct other_party_cred cred_i = {0};
+    init_other_party_cred_i(&cred_i, t);
+    struct edhoc_responder_context c_r = {0};
+    init_edhoc_responder_context(&c_r, t);
+    struct edhoc_state_keys keys;
+    uint64_t used[8];
+    r = edhoc_state_keys_init(&keys, used, sizeof(used) / sizeof(used[0]));
+    zassert_equal(r, EdhocNoError, "edhoc_state_keys_init failed");
+
+    uint8_t msg2[MSG_2_DEFAULT_SIZE];
+    uint32_t msg2_len;
+    uint8_t state[2][EDHOC_STATE_TOKEN_SIZE];
+    uint32_t state_len[2];
+    for (uint32_t i = 0; i < 2; i++) {
+        msg2_len = sizeof(msg2);
+        state_len[i] = sizeof(state[i]);
+        ad_1_len = sizeof(ad_1);
+        r = edhoc_responder_stateless_msg2(
+            &c_r, &keys,
+            M1.ptr, M1.len,
+            (uint8_t *)&ad_1, &ad_1_len,
+            msg2, &msg2_len,
+            state[i], &state_len[i]);
+        zassert_equal(r, EdhocNoError, "error in stateless message 2");
+        zassert_equal(msg2_len, M2.len, "wrong message 2 length");
+        zassert_mem_equal__(msg2, M2.ptr, M2.len, "wrong message 2");
+    }
+
+    /*the token is still valid after one rotation*/
+    edhoc_state_keys_rotate(&keys);
+    r = stateless_msg3_run(&c_r, &keys, &cred_i, state[0], state_len[0]);
+    zassert_equal(r, EdhocNoError, "error in stateless message 3");
+    zassert_mem_equal__(
+        &PRK_4x3m, e.prk_4x3m,
+        sizeof(PRK_4x3m), "wrong PRK_4x3m");
+    zassert_mem_equal__(&th4, e.th4, sizeof(th4), "wrong TH4");
+
+    /*each token is accepted once*/
+    r = stateless_msg3_run(&c_r, &keys, &cred_i, state[0], state_len[0]);
+    zassert_equal(r, InvalidStateToken, "replayed message 3 accepted");
+
+    edhoc_state_keys_rotate(&keys);
+    r = stateless_msg3_run(&c_r, &keys, &cred_i, state[1], state_len[1]);
+    zassert_equal(r, InvalidStateToken, "expired state token accepted");
+
+    /*message 3 with a trailing byte*/
+    msg2_len = sizeof(msg2);
+    state_len[0] = sizeof(state[0]);
+    ad_1_len = sizeof(ad_1);
+    r = edhoc_responder_stateless_msg2(
+        &c_r, &keys,
+        M1.ptr, M1.len,
+        (uint8_t *)&ad_1, &ad_1_len,
+        msg2, &msg2_len,
+        state[0], &state_len[0]);
+    zassert_equal(r, EdhocNoError, "error in stateless message 2");
+    uint8_t msg3[MSG_3_DEFAULT_SIZE + 1];
+    uint8_t *m3_ptr = M3.ptr;
+    uint32_t m3_len = M3.len;
+    memcpy(msg3, m3_ptr, m3_len);
+    msg3[m3_len] = 0;
+    M3.ptr = msg3;
+    M3.len = m3_len + 1;
+    r = stateless_msg3_run(&c_r, &keys, &cred_i, state[0], state_len[0]);
+    M3.ptr = m3_ptr;
+    M3.len = m3_len;
+    zassert_equal(r, MalformedMessage, "trailing bytes accepted");
+
+    /*one slot per epoch, the second token of the epoch is rejected*/
+    r = edhoc_state_keys_init(&keys, used, 2);
+    zassert_equal(r, EdhocNoError, "edhoc_state_keys_init failed");
+    for (uint32_t i = 0; i < 2; i++) {
+        msg2_len = sizeof(msg2);
+        state_len[i] = sizeof(state[i]);
+        ad_1_len = sizeof(ad_1);
+        r = edhoc_responder_stateless_msg2(
+            &c_r, &keys,
+            M1.ptr, M1.len,
+            (uint8_t *)&ad_1, &ad_1_len,
+            msg2, &msg2_len,
+            state[i], &state_len[i]);
+        zassert_equal(r, EdhocNoError, "error in stateless message 2");
+    }
+    r = stateless_msg3_run(&c_r, &keys, &cred_i, state[0], state_len[0]);
+    zassert_equal(r, EdhocNoError, "error in stateless message 3");
+    r = stateless_msg3_run(&c_r, &keys, &cred_i, state[1], state_len[1]);
+    zassert_equal(r, TooManyHandshakes, "token accepted with all slots used");
+}
+
+#ifdef EDHOC_WITH_P256
+/*a stateless responder which tx() of the initiator calls directly*/
+struct loopback_responder {
+    struct edhoc_responder_context c;
+    struct other_party_cred cred_i;
+    struct edhoc_state_keys keys;
+    uint64_t used[8];
+    uint8_t msg2[MSG_2_DEFAULT_SIZE];
+    uint8_t state[EDHOC_STATE_TOKEN_SIZE];
+    uint32_t state_len;
+    uint8_t msg_cnt;
+    EdhocError r; /*result of the responder*/
+    uint8_t prk_4x3m[PRK_DEFAULT_SIZE];
+    uint8_t th4[SHA_DEFAULT_SIZE];
+};
+
+static struct loopback_responder loopback;
+
+static EdhocError loopback_tx(uint8_t *data, uint32_t data_len) {
+    struct loopback_responder *l = &loopback;
+    if (l->msg_cnt++ == 0) {
+        /*message 1, message 2 is returned by the next rx()*/
+        uint32_t msg2_len = sizeof(l->msg2);
+        l->state_len = sizeof(l->state);
+        ad_1_len = sizeof(ad_1);
+        l->r = edhoc_responder_stateless_msg2(
+            &l->c, &l->keys,
+            data, data_len,
+            (uint8_t *)&ad_1, &ad_1_len,
+            l->msg2, &msg2_len,
+            l->state, &l->state_len);
+        M2.ptr = l->msg2;
+        M2.len = msg2_len;
+    } else {
+        /*message 3*/
+        uint8_t err[ERR_MSG_DEFAULT_SIZE];
+        uint32_t err_len = sizeof(err);
+        ad_3_len = sizeof(ad_3);
+        l->r = edhoc_responder_stateless_msg3(
+            &l->c, &l->keys, &l->cred_i, 1,
+            l->state, l->state_len,
+            data, data_len,
+            err, &err_len,
+            (uint8_t *)&ad_3, &ad_3_len,
+            l->prk_4x3m, sizeof(l->prk_4x3m),
+            l->th4, sizeof(l->th4));
+    }
+    return l->r;
 }
 
+/**
+ * @brief   Runs a handshake with P-256 credentials between the initiator 
+ *          and a loopback responder. Both parties must derive the same 
+ *          PRK_4x3m and TH_4.
+ */
+static void test_edhoc_p256(uint8_t suite, enum method_type method) {
+    struct loopback_responder *l = &loopback;
+    uint8_t x[P256_SCALAR_SIZE], g_x[P256_SCALAR_SIZE];
+    uint8_t y[P256_SCALAR_SIZE], g_y[P256_SCALAR_SIZE];
+    uint8_t suites[] = {suite};
+    EdhocError r;
+
+    r = ephemeral_dh_key_pair_gen(P_256_ECDH, x, g_x);
+    zassert_equal(r, EdhocNoError, "no P-256 key pair generated");
+    r = ephemeral_dh_key_pair_gen(P_256_ECDH, y, g_y);
+    zassert_equal(r, EdhocNoError, "no P-256 key pair generated");
+
+    struct edhoc_initiator_context c_i = {
+        .method_type = method,
+        .corr = 1,
+        .suites_i = {sizeof(suites), suites},
+        .c_i = {T1I__C_I_LEN, T1I__C_I},
+        .id_cred_i = {P256__ID_CRED_I_LEN, P256__ID_CRED_I},
+        .cred_i = {P256__CRED_I_LEN, P256__CRED_I},
+        .g_x = {sizeof(g_x), g_x},
+        .x = {sizeof(x), x},
+        .g_i = {P256_SCALAR_SIZE, P256__PK_I},
+        .i = {P256__SK_I_LEN, P256__SK_I},
+        .sk_i = {P256__SK_I_LEN, P256__SK_I},
+        .pk_i = {P256__PK_I_LEN, P256__PK_I},
+    };
+    struct other_party_cred cred_r = {
+        .id_cred = {P256__ID_CRED_R_LEN, P256__ID_CRED_R},
+        .cred = {P256__CRED_R_LEN, P256__CRED_R},
+        .pk = {P256__PK_R_LEN, P256__PK_R},
+        .g = {P256_SCALAR_SIZE, P256__PK_R},
+    };
+
+    memset(l, 0, sizeof(*l));
+    l->c = (struct edhoc_responder_context){
+        .suites_r = {sizeof(suites), suites},
+        .g_y = {sizeof(g_y), g_y},
+        .y = {sizeof(y), y},
+        .c_r = {T1R__C_R_LEN, T1R__C_R},
+        .g_r = {P256_SCALAR_SIZE, P256__PK_R},
+        .r = {P256__SK_R_LEN, P256__SK_R},
+        .id_cred_r = {P256__ID_CRED_R_LEN, P256__ID_CRED_R},
+        .cred_r = {P256__CRED_R_LEN, P256__CRED_R},
+        .sk_r = {P256__SK_R_LEN, P256__SK_R},
+        .pk_r = {P256__PK_R_LEN, P256__PK_R},
+    };
+    l->cred_i = (struct other_party_cred){
+        .id_cred = {P256__ID_CRED_I_LEN, P256__ID_CRED_I},
+        .cred = {P256__CRED_I_LEN, P256__CRED_I},
+        .pk = {P256__PK_I_LEN, P256__PK_I},
+        .g = {P256_SCALAR_SIZE, P256__PK_I},
+    };
+    r = edhoc_state_keys_init(
+        &l->keys, l->used, sizeof(l->used) / sizeof(l->used[0]));
+    zassert_equal(r, EdhocNoError, "edhoc_state_keys_init failed");
+
+    rx_initiator_switch = true;
+    tx_loopback = loopback_tx;
+    err_msg_len = sizeof(err_msg);
+    ad_2_len = sizeof(ad_2);
+    r = edhoc_initiator_run(
+        &c_i, &cred_r, 1,
+        err_msg, &err_msg_len,
+        ad_2, &ad_2_len,
+        PRK_4x3m, sizeof(PRK_4x3m),
+        th4, sizeof(th4));
+    tx_loopback = NULL;
+    zassert_equal(l->r, EdhocNoError, "error in the responder");
+    zassert_equal(r, EdhocNoError, "error in the initiator");
+    zassert_equal(l->msg_cnt, 2, "message 3 not sent");
+    zassert_mem_equal__(PRK_4x3m, l->prk_4x3m, sizeof(PRK_4x3m),
+                        "PRK_4x3m differs");
+    zassert_mem_equal__(th4, l->th4, sizeof(th4), "TH4 differs");
+}
+#endif
+
+/**
+ * @brief   Checks that malformed messages 1 are rejected before any key is 
+ *          derived and that the token bucket limits rate and concurrency.
+ */
+static void test_responder_admission(void) {
+    uint8_t msg1[MSG_1_DEFAULT_SIZE];
+    struct admission a;
+    EdhocError r;
+
+    memcpy(msg1, T1_MSG_1, T1_MSG_1_LEN);
+    r = edhoc_msg1_prevalidate(msg1, T1_MSG_1_LEN);
+    zassert_equal(r, EdhocNoError, "valid message 1 rejected");
+    r = edhoc_msg1_prevalidate(msg1, T1_MSG_1_LEN - 1);
+    zassert_not_equal(r, EdhocNoError, "truncated message 1 accepted");
+    msg1[T1_MSG_1_LEN] = 0x00;
+    r = edhoc_msg1_prevalidate(msg1, T1_MSG_1_LEN + 1);
+    zassert_not_equal(r, EdhocNoError, "trailing bytes accepted");
+
+    /*2 handshakes per second, burst of 2, at most 2 at once*/
+    admission_init(&a, 2, 2, 2, 0);
+    zassert_equal(admission_acquire(&a, 0), EdhocNoError, "burst rejected");
+    zassert_equal(admission_acquire(&a, 0), EdhocNoError, "burst rejected");
+    zassert_equal(admission_acquire(&a, 0), TooManyHandshakes, "max_active exceeded");
+    admission_release(&a);
+    zassert_equal(admission_acquire(&a, 100), HandshakeRateLimited, "rate exceeded");
+    zassert_equal(admission_acquire(&a, 500), EdhocNoError, "refilled token rejected");
+    zassert_equal(a.stats.admitted, 3, "wrong admitted counter");
+    zassert_equal(a.stats.busy, 1, "wrong busy counter");
+    zassert_equal(a.stats.rate_limited, 1, "wrong rate limited counter");
+}
+
+/**
+ * @brief   Checks that the key pool hands out every precomputed key pair 
+ *          once and generates key pairs on demand when it is empty or the 
+ *          curve does not match.
+ */
+static void test_key_pool1(void) {
+    static struct ephemeral_key_pool pool;
+    const uint8_t zero[EPHEMERAL_KEY_DEFAULT_SIZE] = {0};
+    uint8_t sk[EPHEMERAL_KEY_DEFAULT_SIZE], pk[EPHEMERAL_KEY_DEFAULT_SIZE];
+    struct ephemeral_key_pair first;
+    EdhocError r;
+
+    r = ephemeral_key_pool_init(&pool, X25519);
+    zassert_equal(r, EdhocNoError, "ephemeral_key_pool_init failed");
+    r = ephemeral_key_pool_refill(&pool, 3);
+    zassert_equal(r, EdhocNoError, "ephemeral_key_pool_refill failed");
+    zassert_equal(ephemeral_key_pool_available(&pool), 3, "wrong refill");
+    r = ephemeral_key_pool_refill(&pool, EPHEMERAL_KEY_POOL_SIZE + 1);
+    zassert_equal(r, EdhocNoError, "ephemeral_key_pool_refill failed");
+    zassert_equal(ephemeral_key_pool_available(&pool), EPHEMERAL_KEY_POOL_SIZE,
+                  "pool overfilled");
+
+    /*the oldest key pair is taken and erased from its slot*/
+    first = pool.slots[0];
+    r = ephemeral_key_pool_take(
+        &pool, X25519, sk, sizeof(sk), pk, sizeof(pk));
+    zassert_equal(r, EdhocNoError, "ephemeral_key_pool_take failed");
+    zassert_mem_equal__(sk, first.sk, sizeof(sk), "wrong secret key");
+    zassert_mem_equal__(pk, first.pk, sizeof(pk), "wrong public key");
+    zassert_mem_equal__(pool.slots[0].sk, zero, sizeof(zero),
+                        "taken key pair not erased");
+    zassert_equal(ephemeral_key_pool_available(&pool),
+                  EPHEMERAL_KEY_POOL_SIZE - 1, "wrong available count");
+
+    /*another curve, the pool is not touched*/
+    r = ephemeral_key_pool_take(
+        &pool, P_256_ECDH, sk, sizeof(sk), pk, sizeof(pk));
+#ifdef EDHOC_WITH_P256
+    zassert_equal(r, EdhocNoError, "no P-256 key pair generated");
+#endif
+    zassert_equal(pool.misses, 1, "curve mismatch not counted");
+    zassert_equal(ephemeral_key_pool_available(&pool),
+                  EPHEMERAL_KEY_POOL_SIZE - 1, "pool used for another curve");
+
+    /*an empty pool generates key pairs on demand*/
+    while (ephemeral_key_pool_available(&pool)) {
+        r = ephemeral_key_pool_take(
+            &pool, X25519, sk, sizeof(sk), pk, sizeof(pk));
+        zassert_equal(r, EdhocNoError, "ephemeral_key_pool_take failed");
+    }
+    zassert_equal(pool.misses, 1, "miss counted for a full pool");
+    memset(pk, 0, sizeof(pk));
+    r = ephemeral_key_pool_take(
+        &pool, X25519, sk, sizeof(sk), pk, sizeof(pk));
+    zassert_equal(r, EdhocNoError, "no key pair generated on demand");
+    zassert_equal(pool.misses, 2, "miss on an empty pool not counted");
+    zassert_true(memcmp(pk, zero, sizeof(zero)) != 0, "no public key");
+
+    r = ephemeral_key_pool_take(
+        &pool, X25519, sk, sizeof(sk) - 1, pk, sizeof(pk));
+    zassert_equal(r, DestBufferToSmall, "short buffer accepted");
+}
+
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+/*a provider which completes an operation only when the test asks for it*/
+struct deferred_provider {
+    struct crypto_provider p; /*first member*/
+    struct crypto_op *op;
+    uint32_t submitted;
+};
+
+static EdhocError deferred_submit(
+    struct crypto_provider *p, struct crypto_op *op) {
+    struct deferred_provider *d = (struct deferred_provider *)p;
+    d->op = op;
+    d->submitted++;
+    return EdhocNoError;
+}
+
+struct async_handshake {
+    struct edhoc_responder_context *c;
+    struct edhoc_state_keys *keys;
+    struct other_party_cred *cred_i;
+    uint8_t msg2[MSG_2_DEFAULT_SIZE];
+    uint32_t msg2_len;
+    uint8_t state[EDHOC_STATE_TOKEN_SIZE];
+    uint32_t state_len;
+};
+
+static EdhocError async_msg2(void *arg) {
+    struct async_handshake *h = (struct async_handshake *)arg;
+    ad_1_len = sizeof(ad_1);
+    h->msg2_len = sizeof(h->msg2);
+    h->state_len = sizeof(h->state);
+    return edhoc_responder_stateless_msg2(
+        h->c, h->keys,
+        M1.ptr, M1.len,
+        (uint8_t *)&ad_1, &ad_1_len,
+        h->msg2, &h->msg2_len,
+        h->state, &h->state_len);
+}
+
+static EdhocError async_msg3(void *arg) {
+    struct async_handshake *h = (struct async_handshake *)arg;
+    err_msg_len = sizeof(err_msg);
+    ad_3_len = sizeof(ad_3);
+    return edhoc_responder_stateless_msg3(
+        h->c, h->keys, h->cred_i, 1,
+        h->state, h->state_len,
+        M3.ptr, M3.len,
+        err_msg, &err_msg_len,
+        (uint8_t *)&ad_3, &ad_3_len,
+        PRK_4x3m, sizeof(PRK_4x3m),
+        th4, sizeof(th4));
+}
+
+/**
+ * @brief   Runs a protocol step as a crypto task and completes every
+ *          operation the step waits for
+ */
+static EdhocError async_run(
+    struct crypto_task *t, struct deferred_provider *d,
+    EdhocError (*fn)(void *arg), void *arg) {
+    EdhocError r = crypto_task_start(t, fn, arg);
+    while (r == CryptoPending) {
+        crypto_op_complete(d->op, crypto_op_run(d->op));
+        r = crypto_task_resume(t);
+    }
+    return r;
+}
+
+/**
+ * @brief   Runs the stateless responder with a crypto provider. The steps
+ *          are suspended at every crypto operation and must give the same
+ *          result as without a provider.
+ */
+static void test_responder_async1(void) {
+    static uint64_t stack[(CRYPTO_TASK_MIN_STACK_SIZE +
+                           EDHOC_RESPONDER_WORKSPACE_SIZE) /
+                          sizeof(uint64_t)];
+    struct deferred_provider d = {{deferred_submit, NULL}, NULL, 0};
+    struct async_handshake h;
+    struct crypto_task t;
+    EdhocError r;
+
+    init_test_messages(RESPONDER, T1);
+    struct expected_result e;
+    init_expected_result(&e, T1);
+    struct other_party_cred cred_i = {0};
+    init_other_party_cred_i(&cred_i, T1);
+    struct edhoc_responder_context c_r = {0};
+    init_edhoc_responder_context(&c_r, T1);
+    struct edhoc_state_keys keys;
+    uint64_t used[8];
+    r = edhoc_state_keys_init(&keys, used, sizeof(used) / sizeof(used[0]));
+    zassert_equal(r, EdhocNoError, "edhoc_state_keys_init failed");
+    h.c = &c_r;
+    h.keys = &keys;
+    h.cred_i = &cred_i;
+
+    r = crypto_task_init(&t, stack, sizeof(stack), &d.p, NULL, NULL);
+    zassert_equal(r, EdhocNoError, "crypto_task_init failed");
+
+    r = async_run(&t, &d, async_msg2, &h);
+    zassert_equal(r, EdhocNoError, "error in async message 2");
+    zassert_true(d.submitted > 0, "no operation handed to the provider");
+    zassert_equal(h.msg2_len, M2.len, "wrong message 2 length");
+    zassert_mem_equal__(h.msg2, M2.ptr, M2.len, "wrong message 2");
+
+    r = async_run(&t, &d, async_msg3, &h);
+    zassert_equal(r, EdhocNoError, "error in async message 3");
+    zassert_mem_equal__(
+        &PRK_4x3m, e.prk_4x3m,
+        sizeof(PRK_4x3m), "wrong PRK_4x3m");
+    zassert_mem_equal__(&th4, e.th4, sizeof(th4), "wrong TH4");
+}
+#endif
+
+#ifdef EDHOC_WITH_EXECUTOR
+/*a stateless responder on an executor which tx() of the initiator calls*/
+struct executor_loopback {
+    struct edhoc_executor ex;
+    struct edhoc_worker workers[2];
+    struct edhoc_job job;
+    uint8_t msg_cnt;
+    /*if not NULL message 3 is stored in the next of these jobs instead of
+    being run*/
+    struct edhoc_job *held;
+    uint32_t held_cnt;
+};
+
+static struct executor_loopback executor_loopback;
+
+/**
+ * @brief   Submits a job and waits until the executor returns it
+ */
+static EdhocError executor_job_run(
+    struct edhoc_executor *ex, struct edhoc_job *job) {
+    struct edhoc_job *done;
+    EdhocError r;
+
+    r = edhoc_executor_submit(ex, job);
+    if (r != EdhocNoError) return r;
+    while ((done = edhoc_executor_poll(ex)) == NULL) {
+        /*the job runs on a worker*/
+    }
+    return done == job ? job->r : TransportError;
+}
+
+static EdhocError executor_tx(uint8_t *data, uint32_t data_len) {
+    struct executor_loopback *l = &executor_loopback;
+    struct edhoc_job *job = &l->job;
+    EdhocError r;
+
+    if (data_len > sizeof(job->in)) return MessageBuffToSmall;
+    /*message 1 creates message 2 and the state token, message 3 uses it*/
+    job->type = l->msg_cnt++ == 0 ? EDHOC_JOB_MSG2 : EDHOC_JOB_MSG3;
+    if (job->type == EDHOC_JOB_MSG3 && l->held != NULL) {
+        struct edhoc_job *h = &l->held[l->held_cnt++];
+        memcpy(h->state, job->state, job->state_len);
+        h->state_len = job->state_len;
+        h->type = EDHOC_JOB_MSG3;
+        memcpy(h->in, data, data_len);
+        h->in_len = data_len;
+        return EdhocNoError;
+    }
+    memcpy(job->in, data, data_len);
+    job->in_len = data_len;
+    r = executor_job_run(&l->ex, job);
+    if (r == EdhocNoError && job->type == EDHOC_JOB_MSG2) {
+        /*message 2 is returned by the next rx()*/
+        M2.ptr = job->out;
+        M2.len = job->out_len;
+    }
+    return r;
+}
+
+/**
+ * @brief   Runs a handshake of test vector 1 between the initiator and the 
+ *          stateless responder on an executor with two workers. Both 
+ *          parties must derive the same PRK_4x3m and TH_4, a replayed 
+ *          message 3 must be rejected and the executor must count every 
+ *          job once.
+ */
+static void test_executor1(void) {
+    struct executor_loopback *l = &executor_loopback;
+    struct edhoc_job *job = &l->job;
+    EdhocError r;
+
+    init_test_messages(INITIATOR, T1);
+    struct edhoc_initiator_context c_i = {0};
+    init_edhoc_initiator_context(&c_i, T1);
+    struct other_party_cred cred_r = {0};
+    init_other_party_cred_r(&cred_r, T1);
+    struct other_party_cred cred_i = {0};
+    init_other_party_cred_i(&cred_i, T1);
+    struct edhoc_responder_context c_r = {0};
+    init_edhoc_responder_context(&c_r, T1);
+    struct edhoc_state_keys keys;
+    uint64_t used[8];
+    r = edhoc_state_keys_init(&keys, used, sizeof(used) / sizeof(used[0]));
+    zassert_equal(r, EdhocNoError, "edhoc_state_keys_init failed");
+
+    memset(l, 0, sizeof(*l));
+    r = edhoc_executor_start(&l->ex, l->workers, 0, &c_r, &cred_i, 1, &keys,
+                             X25519, NULL, NULL, NULL);
+    zassert_equal(r, InvalidArgument, "executor without workers started");
+    r = edhoc_executor_start(&l->ex, l->workers, 2, &c_r, &cred_i, 1, &keys,
+                             X25519, NULL, NULL, NULL);
+    zassert_equal(r, EdhocNoError, "edhoc_executor_start failed");
+
+    rx_initiator_switch = true;
+    tx_loopback = executor_tx;
+    err_msg_len = sizeof(err_msg);
+    ad_2_len = sizeof(ad_2);
+    r = edhoc_initiator_run(
+        &c_i, &cred_r, 1,
+        err_msg, &err_msg_len,
+        ad_2, &ad_2_len,
+        PRK_4x3m, sizeof(PRK_4x3m),
+        th4, sizeof(th4));
+    tx_loopback = NULL;
+    rx_initiator_switch = false;
+    zassert_equal(job->r, EdhocNoError, "error in the responder");
+    zassert_equal(r, EdhocNoError, "error in the initiator");
+    zassert_equal(l->msg_cnt, 2, "message 3 not sent");
+    zassert_mem_equal__(PRK_4x3m, job->prk_4x3m, sizeof(PRK_4x3m),
+                        "PRK_4x3m differs");
+    zassert_mem_equal__(th4, job->th4, sizeof(th4), "TH4 differs");
+
+    /*the same message 3 and state token once more*/
+    r = executor_job_run(&l->ex, job);
+    zassert_equal(r, InvalidStateToken, "replayed message 3 accepted");
+
+    zassert_equal(edhoc_executor_poll(&l->ex), NULL, "job returned twice");
+    zassert_equal(l->ex.pending, 0, "wrong pending counter");
+    zassert_equal(l->workers[0].done + l->workers[1].done, 3,
+                  "wrong number of jobs run");
+    edhoc_executor_stop(&l->ex);
+}
+
+/**
+ * @brief   Runs more handshakes of test vector 1 through the executor than 
+ *          an epoch of the state keys has slots. The workers must rotate 
+ *          the keys once half of the slots are used, so that every 
+ *          handshake is accepted.
+ */
+static void test_executor2(void) {
+    struct executor_loopback *l = &executor_loopback;
+    EdhocError r;
+
+    init_test_messages(INITIATOR, T1);
+    struct edhoc_initiator_context c_i = {0};
+    init_edhoc_initiator_context(&c_i, T1);
+    struct other_party_cred cred_r = {0};
+    init_other_party_cred_r(&cred_r, T1);
+    struct other_party_cred cred_i = {0};
+    init_other_party_cred_i(&cred_i, T1);
+    struct edhoc_responder_context c_r = {0};
+    init_edhoc_responder_context(&c_r, T1);
+    struct edhoc_state_keys keys;
+    uint64_t used[8];
+    r = edhoc_state_keys_init(&keys, used, sizeof(used) / sizeof(used[0]));
+    zassert_equal(r, EdhocNoError, "edhoc_state_keys_init failed");
+
+    memset(l, 0, sizeof(*l));
+    r = edhoc_executor_start(&l->ex, l->workers, 2, &c_r, &cred_i, 1, &keys,
+                             X25519, NULL, NULL, NULL);
+    zassert_equal(r, EdhocNoError, "edhoc_executor_start failed");
+
+    rx_initiator_switch = true;
+    tx_loopback = executor_tx;
+    /*4 slots per epoch*/
+    for (uint32_t i = 0; i < 5 * keys.used_num; i++) {
+        l->msg_cnt = 0;
+        err_msg_len = sizeof(err_msg);
+        ad_2_len = sizeof(ad_2);
+        r = edhoc_initiator_run(
+            &c_i, &cred_r, 1,
+            err_msg, &err_msg_len,
+            ad_2, &ad_2_len,
+            PRK_4x3m, sizeof(PRK_4x3m),
+            th4, sizeof(th4));
+        if (r != EdhocNoError || l->job.r != EdhocNoError) break;
+    }
+    tx_loopback = NULL;
+    rx_initiator_switch = false;
+    zassert_equal(l->job.r, EdhocNoError, "message 3 rejected");
+    zassert_equal(r, EdhocNoError, "error in the initiator");
+    /*rotated after every second handshake, the low byte is the epoch*/
+    zassert_equal(keys.epoch & 0xff, 5 * keys.used_num / 2,
+                  "wrong number of rotations");
+    edhoc_executor_stop(&l->ex);
+}
+
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+#define BATCH_TEST_HANDSHAKES 8
+
+/*a provider which computes in submit() once the test opened the gate*/
+struct gated_provider {
+    struct crypto_provider p; /*first member*/
+    bool open;
+};
+
+static EdhocError gated_submit(
+    struct crypto_provider *p, struct crypto_op *op) {
+    struct gated_provider *g = (struct gated_provider *)p;
+
+    while (!__atomic_load_n(&g->open, __ATOMIC_ACQUIRE)) {
+        usleep(100);
+    }
+    crypto_op_complete(op, crypto_op_run(op));
+    return EdhocNoError;
+}
+
+/**
+ * @brief   Submits message 3 of several handshakes of test vector 1 at once 
+ *          to an executor with one worker and a crypto provider. The worker 
+ *          must verify the signatures of message 3 together with 
+ *          verify_batch() and derive the keys of the initiators.
+ */
+static void test_executor3(void) {
+    static struct edhoc_job held[BATCH_TEST_HANDSHAKES];
+    static uint8_t prk[BATCH_TEST_HANDSHAKES][PRK_DEFAULT_SIZE];
+    static struct gated_provider provider;
+    struct executor_loopback *l = &executor_loopback;
+    struct edhoc_job *done;
+    uint32_t finished = 0;
+    EdhocError r;
+
+    init_test_messages(INITIATOR, T1);
+    struct edhoc_initiator_context c_i = {0};
+    init_edhoc_initiator_context(&c_i, T1);
+    struct other_party_cred cred_r = {0};
+    init_other_party_cred_r(&cred_r, T1);
+    struct other_party_cred cred_i = {0};
+    init_other_party_cred_i(&cred_i, T1);
+    struct edhoc_responder_context c_r = {0};
+    init_edhoc_responder_context(&c_r, T1);
+    struct edhoc_state_keys keys;
+    uint64_t used[4 * BATCH_TEST_HANDSHAKES];
+    r = edhoc_state_keys_init(&keys, used, sizeof(used) / sizeof(used[0]));
+    zassert_equal(r, EdhocNoError, "edhoc_state_keys_init failed");
+
+    memset(l, 0, sizeof(*l));
+    provider.p.submit = gated_submit;
+    provider.open = true;
+    r = edhoc_executor_start(&l->ex, l->workers, 1, &c_r, &cred_i, 1, &keys,
+                             X25519, &provider.p, NULL, NULL);
+    zassert_equal(r, EdhocNoError, "edhoc_executor_start failed");
+
+    /*message 3 of every handshake is held back*/
+    l->held = held;
+    rx_initiator_switch = true;
+    tx_loopback = executor_tx;
+    for (uint32_t i = 0; i < BATCH_TEST_HANDSHAKES; i++) {
+        l->msg_cnt = 0;
+        err_msg_len = sizeof(err_msg);
+        ad_2_len = sizeof(ad_2);
+        r = edhoc_initiator_run(
+            &c_i, &cred_r, 1,
+            err_msg, &err_msg_len,
+            ad_2, &ad_2_len,
+            prk[i], sizeof(prk[i]),
+            th4, sizeof(th4));
+        zassert_equal(r, EdhocNoError, "error in the initiator");
+        held[i].user = prk[i];
+    }
+    tx_loopback = NULL;
+    rx_initiator_switch = false;
+    zassert_equal(l->held_cnt, BATCH_TEST_HANDSHAKES, "message 3 not sent");
+
+    /*the first job waits in the provider until all jobs are queued, the
+    worker then fills its tasks before it verifies*/
+    __atomic_store_n(&provider.open, false, __ATOMIC_RELEASE);
+    for (uint32_t i = 0; i < BATCH_TEST_HANDSHAKES; i++) {
+        r = edhoc_executor_submit(&l->ex, &held[i]);
+        zassert_equal(r, EdhocNoError, "edhoc_executor_submit failed");
+    }
+    __atomic_store_n(&provider.open, true, __ATOMIC_RELEASE);
+    while (finished < BATCH_TEST_HANDSHAKES) {
+        done = edhoc_executor_poll(&l->ex);
+        if (done == NULL) continue;
+        zassert_equal(done->r, EdhocNoError, "message 3 rejected");
+        zassert_mem_equal__(done->prk_4x3m, done->user, PRK_DEFAULT_SIZE,
+                            "PRK_4x3m differs");
+        finished++;
+    }
+    edhoc_executor_stop(&l->ex);
+    zassert_equal(l->workers[0].batched, BATCH_TEST_HANDSHAKES,
+                  "signature not verified by the worker");
+    zassert_true(l->workers[0].batches <= BATCH_TEST_HANDSHAKES /
+                                              EDHOC_EXECUTOR_TASKS,
+                 "signatures not verified together");
+}
+#endif
+
+#define ROTATE_TEST_HANDSHAKES 200
+
+/*a stateless responder whose keys are rotated by another thread*/
+struct rotate_test {
+    struct edhoc_responder_context c;
+    struct other_party_cred cred_i;
+    struct edhoc_state_keys keys;
+    uint64_t used[2 * ROTATE_TEST_HANDSHAKES];
+    uint32_t started;  /*rotations started*/
+    uint32_t finished; /*rotations finished*/
+    bool stop;
+    uint32_t accepted;
+    uint32_t failed; /*handshakes rejected with at most one rotation*/
+    uint32_t expired; /*handshakes accepted after two rotations*/
+};
+
+static void *rotate_test_rotator(void *arg) {
+    struct rotate_test *t = (struct rotate_test *)arg;
+
+    while (!__atomic_load_n(&t->stop, __ATOMIC_ACQUIRE)) {
+        __atomic_add_fetch(&t->started, 1, __ATOMIC_SEQ_CST);
+        edhoc_state_keys_rotate(&t->keys);
+        __atomic_add_fetch(&t->finished, 1, __ATOMIC_SEQ_CST);
+        usleep(200);
+    }
+    return NULL;
+}
+
+static void *rotate_test_responder(void *arg) {
+    struct rotate_test *t = (struct rotate_test *)arg;
+    uint8_t msg2[MSG_2_DEFAULT_SIZE], state[EDHOC_STATE_TOKEN_SIZE];
+    uint8_t ad[AD_DEFAULT_SIZE], err[ERR_MSG_DEFAULT_SIZE];
+    uint8_t prk[PRK_DEFAULT_SIZE], th[SHA_DEFAULT_SIZE];
+    uint32_t msg2_len, state_len, err_len;
+    uint64_t ad_len;
+    EdhocError r;
+
+    for (uint32_t i = 0; i < ROTATE_TEST_HANDSHAKES / 2; i++) {
+        /*rotations which may overlap the handshake*/
+        uint32_t before = __atomic_load_n(&t->finished, __ATOMIC_SEQ_CST);
+        msg2_len = sizeof(msg2);
+        state_len = sizeof(state);
+        ad_len = sizeof(ad);
+        r = edhoc_responder_stateless_msg2(
+            &t->c, &t->keys, M1.ptr, M1.len, ad, &ad_len,
+            msg2, &msg2_len, state, &state_len);
+        if (r != EdhocNoError) break;
+        /*rotations which started after the token was sealed*/
+        uint32_t sealed = __atomic_load_n(&t->started, __ATOMIC_SEQ_CST);
+        if (i & 1) usleep(500);
+        uint32_t passed = __atomic_load_n(&t->finished, __ATOMIC_SEQ_CST);
+        err_len = sizeof(err);
+        ad_len = sizeof(ad);
+        r = edhoc_responder_stateless_msg3(
+            &t->c, &t->keys, &t->cred_i, 1, state, state_len,
+            M3.ptr, M3.len, err, &err_len, ad, &ad_len,
+            prk, sizeof(prk), th, sizeof(th));
+        if (r == EdhocNoError && passed >= sealed + 2) {
+            __atomic_add_fetch(&t->expired, 1, __ATOMIC_RELAXED);
+        } else if (r == EdhocNoError) {
+            __atomic_add_fetch(&t->accepted, 1, __ATOMIC_RELAXED);
+        } else if (__atomic_load_n(&t->started, __ATOMIC_SEQ_CST) - before <=
+                   1) {
+            /*the token can only expire after two rotations*/
+            __atomic_add_fetch(&t->failed, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief   Runs stateless handshakes of test vector 1 on two threads while a 
+ *          third one rotates the state keys. A handshake which overlaps at 
+ *          most one rotation must be accepted, a message 3 after two 
+ *          rotations must be rejected.
+ */
+static void test_state_keys_rotate1(void) {
+    static struct rotate_test t;
+    pthread_t rotator, responder[2];
+    EdhocError r;
+
+    init_test_messages(RESPONDER, T1);
+    memset(&t, 0, sizeof(t));
+    init_other_party_cred_i(&t.cred_i, T1);
+    init_edhoc_responder_context(&t.c, T1);
+    r = edhoc_state_keys_init(&t.keys, t.used,
+                              sizeof(t.used) / sizeof(t.used[0]));
+    zassert_equal(r, EdhocNoError, "edhoc_state_keys_init failed");
+
+    zassert_equal(pthread_create(&rotator, NULL, rotate_test_rotator, &t), 0,
+                  "pthread_create failed");
+    for (uint32_t i = 0; i < 2; i++) {
+        zassert_equal(pthread_create(&responder[i], NULL,
+                                     rotate_test_responder, &t),
+                      0, "pthread_create failed");
+    }
+    for (uint32_t i = 0; i < 2; i++) pthread_join(responder[i], NULL);
+    __atomic_store_n(&t.stop, true, __ATOMIC_RELEASE);
+    pthread_join(rotator, NULL);
+
+    zassert_equal(t.failed, 0, "valid state token rejected");
+    zassert_equal(t.expired, 0, "expired state token accepted");
+    zassert_not_equal(t.accepted, 0, "no handshake accepted");
+    zassert_not_equal(t.finished, 0, "keys not rotated");
+}
+#endif
+
+#ifdef EDHOC_WITH_TRACE
+/*counts the begin events and hands the end events to the stats hook*/
+struct trace_counter {
+    struct edhoc_trace_stats s;
+    uint32_t begin[EDHOC_PHASE_NUM];
+};
+
+static void trace_count(const struct edhoc_trace_event *e, void *arg) {
+    struct trace_counter *t = (struct trace_counter *)arg;
+    if (!e->end) t->begin[e->phase]++;
+    edhoc_trace_stats_hook(e, &t->s);
+}
+
+/**
+ * @brief   Runs the stateless responder with test vector 1 with a trace hook.
+ *          Every phase must end as often as it began and the phases of 
+ *          method 0 must be counted with the bytes of the messages.
+ */
+static void test_responder_trace1(void) {
+    static struct trace_counter t;
+    EdhocError r;
+
+    init_test_messages(RESPONDER, T1);
+    struct other_party_cred cred_i = {0};
+    init_other_party_cred_i(&cred_i, T1);
+    struct edhoc_responder_context c_r = {0};
+    init_edhoc_responder_context(&c_r, T1);
+    struct edhoc_state_keys keys;
+    uint64_t used[8];
+    r = edhoc_state_keys_init(&keys, used, sizeof(used) / sizeof(used[0]));
+    zassert_equal(r, EdhocNoError, "edhoc_state_keys_init failed");
+
+    memset(&t, 0, sizeof(t));
+    edhoc_trace_hook_set(trace_count, &t);
+    uint8_t msg2[MSG_2_DEFAULT_SIZE];
+    uint32_t msg2_len = sizeof(msg2);
+    uint8_t state[EDHOC_STATE_TOKEN_SIZE];
+    uint32_t state_len = sizeof(state);
+    ad_1_len = sizeof(ad_1);
+    r = edhoc_responder_stateless_msg2(
+        &c_r, &keys,
+        M1.ptr, M1.len,
+        (uint8_t *)&ad_1, &ad_1_len,
+        msg2, &msg2_len,
+        state, &state_len);
+    zassert_equal(r, EdhocNoError, "error in stateless message 2");
+    err_msg_len = sizeof(err_msg);
+    ad_3_len = sizeof(ad_3);
+    r = edhoc_responder_stateless_msg3(
+        &c_r, &keys, &cred_i, 1,
+        state, state_len,
+        M3.ptr, M3.len,
+        err_msg, &err_msg_len,
+        (uint8_t *)&ad_3, &ad_3_len,
+        PRK_4x3m, sizeof(PRK_4x3m),
+        th4, sizeof(th4));
+    edhoc_trace_hook_set(NULL, NULL);
+    zassert_equal(r, EdhocNoError, "error in stateless message 3");
+
+    for (uint8_t p = 0; p < EDHOC_PHASE_NUM; p++) {
+        uint64_t end = 0;
+        for (uint8_t m = 0; m <= EDHOC_TRACE_METHOD_UNKNOWN; m++) {
+            end += t.s.count[m][p];
+            zassert_equal(t.s.errors[m][p], 0, "phase failed");
+        }
+        zassert_equal(end, t.begin[p], "phase not ended");
+    }
+    zassert_equal(t.s.count[0][EDHOC_PHASE_HANDSHAKE], 2, "wrong step count");
+    zassert_equal(t.s.count[0][EDHOC_PHASE_SIGN], 1, "wrong sign count");
+    zassert_equal(t.s.count[0][EDHOC_PHASE_VERIFY], 1, "wrong verify count");
+    /*message 1 is parsed before the method is known*/
+    zassert_equal(t.s.bytes[EDHOC_TRACE_METHOD_UNKNOWN][EDHOC_PHASE_DECODE],
+                  M1.len, "wrong bytes of message 1");
+    zassert_true(t.s.bytes[0][EDHOC_PHASE_DECODE] >= M3.len,
+                 "wrong bytes of message 3");
+    zassert_true(edhoc_trace_stats_percentile(
+                     &t.s, 0, EDHOC_PHASE_HANDSHAKE, 99) > 0,
+                 "no handshake latency");
+}
+#endif
+
 /*
  * Test 1
  * Test No: |mode                          | RPK/Cert | suite | Ref [1]
@@ -577,6 +1538,581 @@ static void test_responder4(void) {
     test_edhoc(RESPONDER, T4);
 }
 
+#ifdef EDHOC_WITH_P256
+static void test_suite2_sk(void) {
+    test_edhoc_p256(SUITE_2, INITIATOR_SK_RESPONDER_SK);
+}
+static void test_suite2_sdhk(void) {
+    test_edhoc_p256(SUITE_2, INITIATOR_SDHK_RESPONDER_SDHK);
+}
+static void test_suite3_sk(void) {
+    test_edhoc_p256(SUITE_3, INITIATOR_SK_RESPONDER_SK);
+}
+static void test_suite3_sdhk(void) {
+    test_edhoc_p256(SUITE_3, INITIATOR_SDHK_RESPONDER_SDHK);
+}
+#endif
+
+static void test_responder_stateless1(void) {
+    test_edhoc_stateless(T1);
+}
+static void test_responder_stateless2(void) {
+    test_edhoc_stateless(T2);
+}
+
+/*the other tests use the fastest crypto backend of the CPU*/
+static void test_responder_portable1(void) {
+    crypto_backend_register(&crypto_backend_portable);
+    test_edhoc(RESPONDER, T1);
+    crypto_backend_register(NULL);
+}
+
+/**
+ * @brief   EDHOC-KeyUpdate of the PRK_4x3m of test vector 1 with the nonce 
+ *          00..0f. The expected PRK_4x3m is HMAC-SHA-256(nonce, PRK_4x3m).
+ */
+static void test_key_update1(void) {
+    EdhocError r;
+    uint8_t nonce[16];
+    for (uint8_t i = 0; i < sizeof(nonce); i++) nonce[i] = i;
+    uint8_t expected_prk_4x3m[32] = {
+        0x11, 0x8d, 0x57, 0x89, 0x80, 0xe7, 0xb6, 0xa5,
+        0x1b, 0x55, 0x7e, 0x45, 0x19, 0xf9, 0x81, 0xe3,
+        0x96, 0x36, 0xce, 0xd1, 0xf1, 0x58, 0xc9, 0x88,
+        0xcb, 0x5e, 0xb2, 0x2e, 0xaa, 0xe3, 0xed, 0x81};
+
+    uint8_t prk_4x3m[32];
+    memcpy(prk_4x3m, T1_PRK_4X3M, sizeof(prk_4x3m));
+    r = edhoc_key_update(
+        SHA_256, nonce, sizeof(nonce), prk_4x3m, sizeof(prk_4x3m));
+    zassert_equal(r, EdhocNoError, "Error in edhoc_key_update");
+    zassert_mem_equal__(
+        prk_4x3m, expected_prk_4x3m, sizeof(prk_4x3m),
+        "wrong updated PRK_4x3m");
+
+    /*the updated PRK_4x3m yields new OSCORE keys*/
+    uint8_t master_secret[16];
+    uint8_t master_salt[8];
+    r = edhoc_exporter_oscore(
+        SHA_256, AES_CCM_16_64_128,
+        prk_4x3m, sizeof(prk_4x3m),
+        T1_TH4, T1_TH4_LEN,
+        master_secret, sizeof(master_secret),
+        master_salt, sizeof(master_salt));
+    zassert_equal(r, EdhocNoError, "Error in edhoc_exporter_oscore");
+    zassert_not_equal(
+        memcmp(master_secret, T1_OSCORE_MSECRET, sizeof(master_secret)), 0,
+        "OSCORE Master Secret not updated");
+
+    r = edhoc_key_update(
+        SHA_256, nonce, sizeof(nonce), prk_4x3m, sizeof(prk_4x3m) - 1);
+    zassert_equal(r, DestBufferToSmall, "wrong PRK_4x3m length accepted");
+}
+
+/**
+ * @brief   Resolves ID_CRED_x = {x5t: [alg, hash]} with SHA-256 and 
+ *          SHA-256/64 thumbprints in an indexed and a not indexed 
+ *          cred_array. The indexed cred_array must be sorted by thumbprint.
+ */
+static void test_x5t1(void) {
+    struct other_party_cred creds[3] = {0};
+    uint8_t *cred, *pk, *g;
+    uint16_t cred_len, pk_len, g_len;
+    uint8_t th[SHA_DEFAULT_SIZE];
+    EdhocError r;
+
+    creds[0].cred = (struct byte_array){T1R__CRED_I_LEN, T1R__CRED_I};
+    creds[1].cred = (struct byte_array){T4I__CRED_I_LEN, T4I__CRED_I};
+    creds[2].cred = (struct byte_array){T3I__CRED_I_LEN, T3I__CRED_I};
+    creds[2].pk = (struct byte_array){T3I__PK_I_LEN, T3I__PK_I};
+
+    r = hash(SHA_256, T3I__CRED_I, T3I__CRED_I_LEN, th);
+    zassert_equal(r, EdhocNoError, "hash failed");
+    /*{34: [-16, h'..']} and {34: [-15, h'..']}*/
+    uint8_t id_cred[7 + SHA_DEFAULT_SIZE] = {0xa1, 0x18, 0x22, 0x82, 0x2f,
+                                             0x58, SHA_DEFAULT_SIZE};
+    memcpy(id_cred + 7, th, SHA_DEFAULT_SIZE);
+    uint8_t id_cred_64[6 + 8] = {0xa1, 0x18, 0x22, 0x82, 0x2e, 0x48};
+    memcpy(id_cred_64 + 6, th, 8);
+
+    for (int indexed = 0; indexed < 2; indexed++) {
+        if (indexed) {
+            r = edhoc_x5t_index(creds, 3);
+            zassert_equal(r, EdhocNoError, "edhoc_x5t_index failed");
+            for (int i = 1; i < 3; i++) {
+                zassert_true(memcmp(creds[i - 1].x5t_hash, creds[i].x5t_hash,
+                                    SHA_DEFAULT_SIZE) < 0,
+                             "credentials not sorted by thumbprint");
+            }
+        }
+
+        r = retrieve_cred(false, NULL, NULL, creds, 3,
+                          id_cred, sizeof(id_cred),
+                          &cred, &cred_len, &pk, &pk_len, &g, &g_len);
+        zassert_equal(r, EdhocNoError, "x5t not resolved");
+        zassert_equal(cred, T3I__CRED_I, "wrong credential");
+        zassert_equal(cred_len, T3I__CRED_I_LEN, "wrong credential length");
+        zassert_equal(pk, T3I__PK_I, "wrong public key");
+
+        cred = NULL;
+        r = retrieve_cred(false, NULL, NULL, creds, 3,
+                          id_cred_64, sizeof(id_cred_64),
+                          &cred, &cred_len, &pk, &pk_len, &g, &g_len);
+        zassert_equal(r, EdhocNoError, "x5t with SHA-256/64 not resolved");
+        zassert_equal(cred, T3I__CRED_I, "wrong credential (SHA-256/64)");
+
+        id_cred[7] ^= 0x01;
+        r = retrieve_cred(false, NULL, NULL, creds, 3,
+                          id_cred, sizeof(id_cred),
+                          &cred, &cred_len, &pk, &pk_len, &g, &g_len);
+        zassert_equal(r, CredentialNotFound, "unknown thumbprint resolved");
+        id_cred[7] ^= 0x01;
+    }
+}
+
+/*the certificates of the test vectors are valid from 2020-01-01 to 
+2021-02-02*/
+#define T3_CERT_VALID_TIME 1600000000
+#define T3_CERT_EXPIRED_TIME 1700000000
+
+/**
+ * @brief   Verifies ID_CRED_x = {x5bag: h'cert'} with the certificate of 
+ *          test vector 3 against a trust anchor store. A wrong CA key and 
+ *          an expired certificate must be rejected.
+ */
+static void test_x5bag1(void) {
+    uint8_t *cred, *pk, *g;
+    uint16_t cred_len, pk_len, g_len;
+    struct trust_anchor_store store;
+    uint8_t wrong_ca_pk[32];
+    EdhocError r;
+
+    struct trust_anchor anchors[1] = {{
+        .subject = {T3R__CA_LEN, T3R__CA},
+        .pk = {T3R__CA_PK_LEN, T3R__CA_PK},
+    }};
+    r = edhoc_trust_anchors_init(&store, anchors, 1, T3_CERT_VALID_TIME);
+    zassert_equal(r, EdhocNoError, "edhoc_trust_anchors_init failed");
+
+    /*{32: h'..'}*/
+    uint8_t id_cred[5 + 250] = {0xa1, 0x18, 0x20, 0x58,
+                                (uint8_t)T3I__CRED_I_LEN};
+    uint8_t id_cred_len = (uint8_t)(5 + T3I__CRED_I_LEN);
+    zassert_true(T3I__CRED_I_LEN <= 250, "certificate too long");
+    memcpy(id_cred + 5, T3I__CRED_I, T3I__CRED_I_LEN);
+
+    r = retrieve_cred(false, &store, NULL, NULL, 0,
+                      id_cred, id_cred_len,
+                      &cred, &cred_len, &pk, &pk_len, &g, &g_len);
+    zassert_equal(r, EdhocNoError, "x5bag not verified");
+    zassert_equal(cred_len, T3I__CRED_I_LEN, "wrong credential length");
+    zassert_mem_equal__(cred, T3I__CRED_I, T3I__CRED_I_LEN,
+                        "wrong credential");
+    zassert_equal(pk_len, T3I__PK_I_LEN, "wrong public key length");
+    zassert_mem_equal__(pk, T3I__PK_I, T3I__PK_I_LEN, "wrong public key");
+
+    store.now = T3_CERT_EXPIRED_TIME;
+    r = retrieve_cred(false, &store, NULL, NULL, 0,
+                      id_cred, id_cred_len,
+                      &cred, &cred_len, &pk, &pk_len, &g, &g_len);
+    zassert_equal(r, CertificateExpired, "expired certificate accepted");
+    store.now = T3_CERT_VALID_TIME;
+
+    memcpy(wrong_ca_pk, T3R__CA_PK, sizeof(wrong_ca_pk));
+    wrong_ca_pk[0] ^= 0x01;
+    anchors[0].pk = (struct byte_array){sizeof(wrong_ca_pk), wrong_ca_pk};
+    r = retrieve_cred(false, &store, NULL, NULL, 0,
+                      id_cred, id_cred_len,
+                      &cred, &cred_len, &pk, &pk_len, &g, &g_len);
+    zassert_equal(r, CertificateAuthenticationFailed,
+                  "x5bag verified with a wrong CA key");
+}
+
+/*key usage of the test certificates*/
+#define CERT_DIGITAL_SIGNATURE 0x01
+#define CERT_KEY_CERT_SIGN 0x20
+
+/**
+ * @brief   Encodes and signs a native CBOR certificate with an Ed25519 key. 
+ *          The names are text strings of at most 23 byte, a chain of two 
+ *          certificates fits into ID_CRED_x with names of one byte.
+ * @param   cert buffer of at least 128 byte
+ * @retval  the length of the certificate
+ */
+static uint8_t test_cert_build(
+    uint8_t *cert, const char *issuer, const char *subject,
+    uint32_t not_before, uint32_t not_after, const uint8_t *pk,
+    uint8_t key_usage, const uint8_t *issuer_sk, const uint8_t *issuer_pk) {
+    uint8_t len = 0;
+    uint32_t sig_len = 64;
+    EdhocError r;
+
+    cert[len++] = 0x00; /*type*/
+    cert[len++] = 0x40; /*empty serial number*/
+    cert[len++] = 0x60 | (uint8_t)strlen(issuer);
+    memcpy(cert + len, issuer, strlen(issuer));
+    len += strlen(issuer);
+    cert[len++] = 0x1a;
+    for (int i = 3; i >= 0; i--) cert[len++] = (uint8_t)(not_before >> (8 * i));
+    cert[len++] = 0x1a;
+    for (int i = 3; i >= 0; i--) cert[len++] = (uint8_t)(not_after >> (8 * i));
+    cert[len++] = 0x60 | (uint8_t)strlen(subject);
+    memcpy(cert + len, subject, strlen(subject));
+    len += strlen(subject);
+    cert[len++] = 0x58;
+    cert[len++] = 32;
+    memcpy(cert + len, pk, 32);
+    len += 32;
+    if (key_usage < 24) {
+        cert[len++] = key_usage;
+    } else {
+        cert[len++] = 0x18;
+        cert[len++] = key_usage;
+    }
+
+    cert[len] = 0x58;
+    cert[len + 1] = 64;
+    r = sign(Ed25519_SIGN, issuer_sk, 32, issuer_pk, 32, cert, len,
+             cert + len + 2, &sig_len);
+    zassert_equal(r, EdhocNoError, "certificate not signed");
+    return len + 2 + 64;
+}
+
+/**
+ * @brief   Resolves ID_CRED_x = {x5chain: [leaf, intermediate]}
+ */
+static EdhocError test_chain_verify(
+    const struct trust_anchor_store *store,
+    const uint8_t *leaf, uint8_t leaf_len,
+    const uint8_t *intermediate, uint8_t intermediate_len,
+    uint8_t **pk) {
+    uint8_t id_cred[255] = {0xa1, 0x18, 0x21, 0x82};
+    uint8_t len = 4;
+    uint8_t *cred, *g;
+    uint16_t cred_len, pk_len, g_len;
+
+    zassert_true(len + 4 + leaf_len + intermediate_len <= sizeof(id_cred),
+                 "ID_CRED_x too long");
+
+    id_cred[len++] = 0x58;
+    id_cred[len++] = leaf_len;
+    memcpy(id_cred + len, leaf, leaf_len);
+    len += leaf_len;
+    id_cred[len++] = 0x58;
+    id_cred[len++] = intermediate_len;
+    memcpy(id_cred + len, intermediate, intermediate_len);
+    len += intermediate_len;
+
+    return retrieve_cred(false, store, NULL, NULL, 0, id_cred, len,
+                         &cred, &cred_len, pk, &pk_len, &g, &g_len);
+}
+
+/**
+ * @brief   Verifies a chain leaf <- intermediate CA <- trust anchor. The 
+ *          chain must be rejected if the intermediate certificate has no 
+ *          keyCertSign key usage, if a certificate is expired or not yet 
+ *          valid and if a signature does not match.
+ */
+static void test_cert_path1(void) {
+    const uint32_t not_before = 1600000000, not_after = 1800000000;
+    uint8_t leaf[128], inter[128];
+    uint8_t leaf_len, inter_len;
+    struct trust_anchor_store store;
+    uint8_t *pk;
+    EdhocError r;
+
+    /*root CA R: key of the responder of T1, intermediate CA I: key of the 
+    initiator of T1, leaf L: key of the initiator of T3*/
+    struct trust_anchor anchors[1] = {{
+        .subject = {1, (uint8_t *)"R"},
+        .pk = {T1R__PK_R_LEN, T1R__PK_R},
+    }};
+    r = edhoc_trust_anchors_init(&store, anchors, 1, 1700000000);
+    zassert_equal(r, EdhocNoError, "edhoc_trust_anchors_init failed");
+
+    inter_len = test_cert_build(inter, "R", "I", not_before, not_after,
+                                T1I__PK_I,
+                                CERT_KEY_CERT_SIGN | CERT_DIGITAL_SIGNATURE,
+                                T1R__SK_R, T1R__PK_R);
+    leaf_len = test_cert_build(leaf, "I", "L", not_before, not_after,
+                               T3I__PK_I, CERT_DIGITAL_SIGNATURE,
+                               T1I__SK_I, T1I__PK_I);
+    r = test_chain_verify(&store, leaf, leaf_len, inter, inter_len, &pk);
+    zassert_equal(r, EdhocNoError, "valid chain rejected");
+    zassert_mem_equal__(pk, T3I__PK_I, 32, "wrong public key");
+
+    /*a leaf certificate acting as issuer*/
+    inter_len = test_cert_build(inter, "R", "I", not_before, not_after,
+                                T1I__PK_I, CERT_DIGITAL_SIGNATURE,
+                                T1R__SK_R, T1R__PK_R);
+    r = test_chain_verify(&store, leaf, leaf_len, inter, inter_len, &pk);
+    zassert_equal(r, NoSuchCA, "leaf certificate accepted as issuer");
+
+    /*expired intermediate, not yet valid leaf*/
+    inter_len = test_cert_build(inter, "R", "I", not_before,
+                                1650000000, T1I__PK_I, CERT_KEY_CERT_SIGN,
+                                T1R__SK_R, T1R__PK_R);
+    r = test_chain_verify(&store, leaf, leaf_len, inter, inter_len, &pk);
+    zassert_equal(r, CertificateExpired, "expired issuer accepted");
+    inter_len = test_cert_build(inter, "R", "I", not_before, not_after,
+                                T1I__PK_I, CERT_KEY_CERT_SIGN,
+                                T1R__SK_R, T1R__PK_R);
+    leaf_len = test_cert_build(leaf, "I", "L", 1750000000, not_after,
+                               T3I__PK_I, CERT_DIGITAL_SIGNATURE,
+                               T1I__SK_I, T1I__PK_I);
+    r = test_chain_verify(&store, leaf, leaf_len, inter, inter_len, &pk);
+    zassert_equal(r, CertificateExpired, "not yet valid leaf accepted");
+
+    /*broken chains: the leaf is not signed by the intermediate CA or names 
+    an issuer which is not in the chain*/
+    leaf_len = test_cert_build(leaf, "I", "L", not_before, not_after,
+                               T3I__PK_I, CERT_DIGITAL_SIGNATURE,
+                               T1R__SK_R, T1R__PK_R);
+    r = test_chain_verify(&store, leaf, leaf_len, inter, inter_len, &pk);
+    zassert_equal(r, CertificateAuthenticationFailed,
+                  "leaf with a wrong signature accepted");
+    leaf_len = test_cert_build(leaf, "O", "L", not_before, not_after,
+                               T3I__PK_I, CERT_DIGITAL_SIGNATURE,
+                               T1I__SK_I, T1I__PK_I);
+    r = test_chain_verify(&store, leaf, leaf_len, inter, inter_len, &pk);
+    zassert_equal(r, NoSuchCA, "leaf with an unknown issuer accepted");
+}
+
+#define RL_TEST_ENTRIES 16
+
+/**
+ * @brief   Encodes a revocation list, sets up a view on it and looks up 
+ *          revoked and not revoked entries. The Bloom filter of 8 bits has 
+ *          all bits set, so every lookup passes it and the sorted entries 
+ *          must resolve the false positives. Malformed lists, unsorted 
+ *          entries and entries missing in the filter are rejected.
+ */
+static void test_revocation_list1(void) {
+    uint8_t entries[RL_TEST_ENTRIES * REVOCATION_HASH_SIZE];
+    uint8_t buf[REVOCATION_LIST_HEADER_SIZE + 1 + sizeof(entries)];
+    uint32_t buf_len = sizeof(buf);
+    uint8_t entry[REVOCATION_HASH_SIZE];
+    struct revocation_list rl;
+    bool revoked;
+    EdhocError r;
+
+    /*entry j starts with 16 * j, i.e., the entries are sorted*/
+    for (uint32_t i = 0; i < sizeof(entries); i++) {
+        entries[i] = (uint8_t)(i * 7 + (i / REVOCATION_HASH_SIZE) * 9);
+    }
+    for (uint32_t j = 0; j < RL_TEST_ENTRIES; j++) {
+        entries[j * REVOCATION_HASH_SIZE] = (uint8_t)(16 * j);
+    }
+
+    r = revocation_list_encode(entries, RL_TEST_ENTRIES, 8, 4, buf, &buf_len);
+    zassert_equal(r, EdhocNoError, "revocation_list_encode failed");
+    zassert_equal(buf_len, sizeof(buf), "wrong revocation list length");
+    zassert_mem_equal__(buf, "EDRL", 4, "wrong magic");
+    zassert_mem_equal__(buf + REVOCATION_LIST_HEADER_SIZE + 1, entries,
+                        sizeof(entries), "wrong entries");
+
+    r = revocation_list_init(&rl, buf, buf_len);
+    zassert_equal(r, EdhocNoError, "revocation_list_init failed");
+    zassert_equal(rl.entry_num, RL_TEST_ENTRIES, "wrong number of entries");
+    zassert_equal(rl.bloom[0], 0xff, "Bloom filter not saturated");
+
+    for (uint32_t j = 0; j < RL_TEST_ENTRIES; j++) {
+        memcpy(entry, entries + j * REVOCATION_HASH_SIZE, sizeof(entry));
+        revocation_list_lookup(&rl, entry, &revoked);
+        zassert_true(revoked, "revoked entry not found");
+
+        /*passes the filter, but is not in the list*/
+        entry[REVOCATION_HASH_SIZE - 1] ^= 0x01;
+        revocation_list_lookup(&rl, entry, &revoked);
+        zassert_true(!revoked, "Bloom false positive reported as revoked");
+        entry[0] ^= 0x08;
+        revocation_list_lookup(&rl, entry, &revoked);
+        zassert_true(!revoked, "Bloom false positive reported as revoked");
+    }
+
+    r = revocation_list_init(&rl, buf, buf_len - 1);
+    zassert_equal(r, InvalidRevocationList, "truncated list accepted");
+    buf[0] ^= 0x01;
+    r = revocation_list_init(&rl, buf, buf_len);
+    zassert_equal(r, InvalidRevocationList, "wrong magic accepted");
+    buf[0] ^= 0x01;
+
+    /*entries 1 and 2 swapped, a lookup of entry 1 would miss it*/
+    uint8_t *e1 = buf + REVOCATION_LIST_HEADER_SIZE + 1 + REVOCATION_HASH_SIZE;
+    memcpy(e1, entries + 2 * REVOCATION_HASH_SIZE, REVOCATION_HASH_SIZE);
+    memcpy(e1 + REVOCATION_HASH_SIZE, entries + REVOCATION_HASH_SIZE,
+           REVOCATION_HASH_SIZE);
+    r = revocation_list_init(&rl, buf, buf_len);
+    zassert_equal(r, InvalidRevocationList, "unsorted entries accepted");
+    memcpy(e1, entries + REVOCATION_HASH_SIZE, 2 * REVOCATION_HASH_SIZE);
+    r = revocation_list_init(&rl, buf, buf_len);
+    zassert_equal(r, EdhocNoError, "revocation_list_init failed");
+
+    /*an entry which is not in the filter*/
+    buf[REVOCATION_LIST_HEADER_SIZE] = 0;
+    r = revocation_list_init(&rl, buf, buf_len);
+    zassert_equal(r, InvalidRevocationList, "entry not in the filter accepted");
+
+    buf_len = sizeof(buf) - 1;
+    r = revocation_list_encode(entries, RL_TEST_ENTRIES, 8, 4, buf, &buf_len);
+    zassert_equal(r, DestBufferToSmall, "buffer overflow");
+    buf_len = sizeof(buf);
+    r = revocation_list_encode(entries + REVOCATION_HASH_SIZE, 2, 8, 4, buf,
+                               &buf_len);
+    zassert_equal(r, EdhocNoError, "revocation_list_encode failed");
+    entries[2 * REVOCATION_HASH_SIZE] = 0;
+    buf_len = sizeof(buf);
+    r = revocation_list_encode(entries + REVOCATION_HASH_SIZE, 2, 8, 4, buf,
+                               &buf_len);
+    zassert_equal(r, InvalidRevocationList, "unsorted entries accepted");
+}
+
+/**
+ * @brief   A revoked certificate of test vector 3 must be rejected in an 
+ *          x5chain, the same certificate is accepted with an empty list.
+ */
+static void test_revocation_list2(void) {
+    uint8_t h[SHA_DEFAULT_SIZE];
+    uint8_t buf[REVOCATION_LIST_HEADER_SIZE + 128 + REVOCATION_HASH_SIZE];
+    uint32_t buf_len = sizeof(buf);
+    struct revocation_list rl;
+    struct other_party_cred cred_i = {0};
+    uint8_t *cred, *pk, *g;
+    uint16_t cred_len, pk_len, g_len;
+    bool revoked;
+    EdhocError r;
+
+    r = hash(SHA_256, T3I__CRED_I, T3I__CRED_I_LEN, h);
+    zassert_equal(r, EdhocNoError, "hash failed");
+    r = revocation_list_encode(h, 1, 1024, 7, buf, &buf_len);
+    zassert_equal(r, EdhocNoError, "revocation_list_encode failed");
+    r = revocation_list_init(&rl, buf, buf_len);
+    zassert_equal(r, EdhocNoError, "revocation_list_init failed");
+    r = revocation_list_check(&rl, T3I__CRED_I, T3I__CRED_I_LEN, &revoked);
+    zassert_equal(r, EdhocNoError, "revocation_list_check failed");
+    zassert_true(revoked, "revoked certificate not found");
+
+    init_other_party_cred_i(&cred_i, T3);
+    r = retrieve_cred(false, NULL, &rl, &cred_i, 1,
+                      T3I__ID_CRED_I, T3I__ID_CRED_I_LEN,
+                      &cred, &cred_len, &pk, &pk_len, &g, &g_len);
+    zassert_equal(r, CertificateRevoked, "revoked certificate accepted");
+
+    buf_len = sizeof(buf);
+    r = revocation_list_encode(NULL, 0, 1024, 7, buf, &buf_len);
+    zassert_equal(r, EdhocNoError, "revocation_list_encode failed");
+    r = revocation_list_init(&rl, buf, buf_len);
+    zassert_equal(r, EdhocNoError, "revocation_list_init failed");
+    r = retrieve_cred(false, NULL, &rl, &cred_i, 1,
+                      T3I__ID_CRED_I, T3I__ID_CRED_I_LEN,
+                      &cred, &cred_len, &pk, &pk_len, &g, &g_len);
+    zassert_equal(r, EdhocNoError, "certificate not verified");
+}
+
+#define VERIFY_BATCH_TEST_SIZE (VERIFY_BATCH_MAX_SIZE + 2)
+
+/**
+ * @brief   Runs verify_batch() on valid signatures, with one forged 
+ *          signature and with one unusual signature in a batch of valid 
+ *          ones. The batch spans two batch equations. Signatures with a 
+ *          small order or not canonically encoded R, a non canonical S or 
+ *          a small order public key must get the result of verify().
+ */
+static void test_verify_batch1(void) {
+    static uint8_t msgs[VERIFY_BATCH_TEST_SIZE][8];
+    static uint8_t sgns[VERIFY_BATCH_TEST_SIZE][64];
+    struct verify_batch_item items[VERIFY_BATCH_TEST_SIZE];
+    /*order of the base point, little endian*/
+    const uint8_t l[32] = {0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+                           0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+                           [31] = 0x10};
+    /*the neutral element, (0, -1) of order 2 and the neutral element
+    encoded with y = p + 1*/
+    const uint8_t neutral[32] = {0x01};
+    uint8_t order2[32], neutral_p1[32];
+    uint8_t valid[64];
+    uint32_t sgn_len;
+    bool all_valid, result;
+    uint16_t carry = 0;
+    EdhocError r;
+
+    memset(order2, 0xff, sizeof(order2));
+    order2[0] = 0xec;
+    order2[31] = 0x7f;
+    memcpy(neutral_p1, order2, sizeof(neutral_p1));
+    neutral_p1[0] = 0xee;
+
+    for (uint16_t i = 0; i < VERIFY_BATCH_TEST_SIZE; i++) {
+        memset(msgs[i], i, sizeof(msgs[i]));
+        sgn_len = sizeof(sgns[i]);
+        r = sign(Ed25519_SIGN, T1R__SK_R, T1R__SK_R_LEN, T1R__PK_R,
+                 T1R__PK_R_LEN, msgs[i], sizeof(msgs[i]), sgns[i], &sgn_len);
+        zassert_equal(r, EdhocNoError, "sign failed");
+        items[i].pk = T1R__PK_R;
+        items[i].pk_len = T1R__PK_R_LEN;
+        items[i].msg = msgs[i];
+        items[i].msg_len = sizeof(msgs[i]);
+        items[i].sgn = sgns[i];
+        items[i].sgn_len = sizeof(sgns[i]);
+    }
+
+    r = verify_batch(Ed25519_SIGN, items, VERIFY_BATCH_TEST_SIZE, &all_valid);
+    zassert_equal(r, EdhocNoError, "verify_batch failed");
+    zassert_true(all_valid, "valid batch rejected");
+    for (uint16_t i = 0; i < VERIFY_BATCH_TEST_SIZE; i++) {
+        zassert_true(items[i].result, "valid signature rejected");
+    }
+
+    /*a signature of another message*/
+    msgs[3][0] ^= 1;
+    r = verify_batch(Ed25519_SIGN, items, VERIFY_BATCH_TEST_SIZE, &all_valid);
+    zassert_equal(r, EdhocNoError, "verify_batch failed");
+    zassert_true(!all_valid, "forged signature accepted");
+    for (uint16_t i = 0; i < VERIFY_BATCH_TEST_SIZE; i++) {
+        zassert_equal(items[i].result, i != 3, "wrong result");
+    }
+    msgs[3][0] ^= 1;
+
+    memcpy(valid, sgns[1], sizeof(valid));
+    for (uint8_t k = 0; k < 5; k++) {
+        memcpy(sgns[1], valid, sizeof(valid));
+        if (k == 0) {
+            memcpy(sgns[1], order2, 32);
+        } else if (k == 1) {
+            memcpy(sgns[1], neutral_p1, 32);
+        } else if (k == 2) {
+            memcpy(sgns[1], neutral, 32);
+        } else if (k == 3) {
+            /*S + l*/
+            for (uint8_t i = 0; i < 32; i++) {
+                carry += sgns[1][32 + i] + l[i];
+                sgns[1][32 + i] = (uint8_t)carry;
+                carry >>= 8;
+            }
+        } else {
+            /*[8]S*B = [8](R + k*A) holds for any message*/
+            items[1].pk = neutral;
+            memcpy(sgns[1], neutral, 32);
+            memset(sgns[1] + 32, 0, 32);
+        }
+        r = verify(Ed25519_SIGN, items[1].pk, items[1].pk_len,
+                   items[1].msg, items[1].msg_len,
+                   items[1].sgn, items[1].sgn_len, &result);
+        zassert_equal(r, EdhocNoError, "verify failed");
+        if (k < 4) zassert_true(!result, "unusual signature accepted");
+        r = verify_batch(Ed25519_SIGN, items, VERIFY_BATCH_TEST_SIZE,
+                         &all_valid);
+        zassert_equal(r, EdhocNoError, "verify_batch failed");
+        zassert_equal(all_valid, result, "batch differs from verify()");
+        for (uint16_t i = 0; i < VERIFY_BATCH_TEST_SIZE; i++) {
+            zassert_equal(items[i].result, i == 1 ? result : true,
+                          "batch differs from verify()");
+        }
+    }
+    items[1].pk = T1R__PK_R;
+    memcpy(sgns[1], valid, sizeof(valid));
+}
+
 #endif
 
 #ifdef OSCORE_TESTS
@@ -584,6 +2120,10 @@ static void test_responder4(void) {
 
 #include "test_vectors_oscore.h"
 
+#ifdef OSCORE_WITH_ASYNC_CRYPTO
+#include <inc/crypto_async.h>
+#endif
+
 /**
  * Test 1:
  * - Client Key derivation with master salt see RFC8613 Appendix C.1.1
@@ -886,6 +2426,250 @@ static void oscore_server_test6(void) {
         c_server.cc.common_iv.len, "T6 common IV derivation failed");
 }
 
+
+/**
+ * Test 7:
+ * - Builds a combined EDHOC+OSCORE request from the OSCORE request of 
+ *   RFC8613 Appendix C.4, checks its encoding and splits it again
+ * - A request which already carries an EDHOC option and a too small payload
+ *   buffer are rejected
+ */
+static void oscore_combined_request_test7(void) {
+    OscoreError r;
+    uint8_t msg3[40];
+    memset(msg3, 0xA5, sizeof(msg3));
+
+    /*Uri-Host and OSCORE option of C.4, empty EDHOC option (delta 12), 
+    payload marker, bstr head of message 3*/
+    uint8_t expected_head[] = {
+        0x44, 0x02, 0x5d, 0x1f, 0x00, 0x00, 0x39, 0x74,
+        0x39, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x68, 0x6f,
+        0x73, 0x74, 0x62, 0x09, 0x14, 0xc0, 0xff, 0x58,
+        0x28};
+    /*OSCORE payload of C.4*/
+    uint8_t expected_tail[] = {
+        0x61, 0x2f, 0x10, 0x92, 0xf1, 0x77, 0x6f, 0x1c,
+        0x16, 0x68, 0xb3, 0x82, 0x5e};
+    uint8_t expected[sizeof(expected_head) + sizeof(msg3) +
+                     sizeof(expected_tail)];
+    memcpy(expected, expected_head, sizeof(expected_head));
+    memcpy(expected + sizeof(expected_head), msg3, sizeof(msg3));
+    memcpy(expected + sizeof(expected_head) + sizeof(msg3), expected_tail,
+           sizeof(expected_tail));
+
+    uint8_t payload_buf[64];
+    uint8_t combined_req[256];
+    uint16_t combined_req_len = sizeof(combined_req);
+    r = oscore_combined_request_build(
+        T1__OSCORE_REQ, T1__OSCORE_REQ_LEN,
+        msg3, sizeof(msg3),
+        payload_buf, sizeof(payload_buf),
+        combined_req, &combined_req_len);
+    zassert_equal(r, OscoreNoError, "Error in oscore_combined_request_build");
+    zassert_equal(combined_req_len, sizeof(expected),
+                  "wrong combined request length");
+    zassert_mem_equal__(combined_req, expected, sizeof(expected),
+                        "wrong combined request encoding");
+
+    uint8_t twice[256];
+    uint16_t twice_len = sizeof(twice);
+    uint8_t payload_buf2[128];
+    r = oscore_combined_request_build(
+        combined_req, combined_req_len,
+        msg3, sizeof(msg3),
+        payload_buf2, sizeof(payload_buf2),
+        twice, &twice_len);
+    zassert_equal(r, OscoreInvalidCombinedRequest,
+                  "EDHOC option added twice");
+
+    uint16_t small_len = sizeof(twice);
+    r = oscore_combined_request_build(
+        T1__OSCORE_REQ, T1__OSCORE_REQ_LEN,
+        msg3, sizeof(msg3),
+        payload_buf, sizeof(msg3),
+        twice, &small_len);
+    zassert_equal(r, DestBufferToSmall, "payload buffer overflow");
+
+    bool combined;
+    uint8_t msg3_out[64];
+    uint16_t msg3_out_len = sizeof(msg3_out);
+    uint8_t oscore_req[256];
+    uint16_t oscore_req_len = sizeof(oscore_req);
+    r = oscore_combined_request_split(
+        combined_req, combined_req_len, &combined,
+        msg3_out, &msg3_out_len,
+        oscore_req, &oscore_req_len);
+    zassert_equal(r, OscoreNoError, "Error in oscore_combined_request_split");
+    zassert_true(combined, "combined request not recognized");
+    zassert_equal(msg3_out_len, sizeof(msg3), "wrong message 3 length");
+    zassert_mem_equal__(msg3_out, msg3, sizeof(msg3), "wrong message 3");
+    zassert_equal(oscore_req_len, T1__OSCORE_REQ_LEN, "wrong request length");
+    zassert_mem_equal__(
+        oscore_req, T1__OSCORE_REQ, T1__OSCORE_REQ_LEN,
+        "combined request split failed");
+}
+
+/**
+ * Test 8:
+ * - Context initialized with a wrong master secret and then updated with the
+ *   key of RFC8613 Appendix C.1.1 with oscore_context_key_update()
+ * - Generating OSCORE request with the updated context see RFC8613 Appendix 
+ *   C.4
+ */
+static void oscore_key_update_test8(void) {
+    OscoreError r;
+    struct context c_client;
+    uint8_t old_master_secret[16] = {0};
+    struct oscore_init_params params = {
+        .dev_type = CLIENT,
+        .master_secret.ptr = old_master_secret,
+        .master_secret.len = sizeof(old_master_secret),
+        .sender_id.ptr = T1__SENDER_ID,
+        .sender_id.len = T1__SENDER_ID_LEN,
+        .recipient_id.ptr = T1__RECIPIENT_ID,
+        .recipient_id.len = T1__RECIPIENT_ID_LEN,
+        .master_salt.ptr = NULL,
+        .master_salt.len = 0,
+        .id_context.ptr = T1__ID_CONTEXT,
+        .id_context.len = T1__ID_CONTEXT_LEN,
+        .aead_alg = AES_CCM_16_64_128,
+        .hkdf = SHA_256,
+    };
+
+    r = oscore_context_init(&params, &c_client);
+    zassert_equal(r, OscoreNoError, "Error in oscore_context_init");
+
+    struct byte_array master_secret = {
+        .len = T1__MASTER_SECRET_LEN,
+        .ptr = T1__MASTER_SECRET,
+    };
+    struct byte_array master_salt = {
+        .len = T1__MASTER_SALT_LEN,
+        .ptr = T1__MASTER_SALT,
+    };
+    r = oscore_context_key_update(CLIENT, &master_secret, &master_salt, &c_client);
+    zassert_equal(r, OscoreNoError, "Error in oscore_context_key_update");
+
+    zassert_mem_equal__(
+        c_client.sc.sender_key.ptr, T1__SENDER_KEY,
+        c_client.sc.sender_key.len, "T8 sender key update failed");
+
+    zassert_mem_equal__(
+        c_client.rc.recipient_key.ptr, T1__RECIPIENT_KEY,
+        c_client.rc.recipient_key.len, "T8 recipient key update failed");
+
+    zassert_mem_equal__(
+        c_client.cc.common_iv.ptr, T1__COMMON_IV,
+        c_client.cc.common_iv.len, "T8 common IV update failed");
+
+    /*required only for the test vector*/
+    c_client.sc.sender_seq_num = 20;
+
+    uint8_t buf_oscore[256];
+    uint16_t buf_oscore_len = sizeof(buf_oscore);
+    r = coap2oscore(
+        T1__COAP_REQ, T1__COAP_REQ_LEN,
+        (uint8_t *)&buf_oscore, &buf_oscore_len,
+        &c_client);
+    zassert_equal(r, OscoreNoError, "Error in coap2oscore!");
+
+    zassert_mem_equal__(
+        &buf_oscore, T1__OSCORE_REQ,
+        T1__OSCORE_REQ_LEN, "coap2oscore with updated context failed");
+}
+
+#ifdef OSCORE_WITH_ASYNC_CRYPTO
+/*a provider which completes an operation only when the test asks for it*/
+struct oscore_deferred_provider {
+    struct oscore_crypto_provider p; /*first member*/
+    struct oscore_crypto_op *op;
+    uint32_t submitted;
+};
+
+static OscoreError oscore_deferred_submit(
+    struct oscore_crypto_provider *p, struct oscore_crypto_op *op) {
+    struct oscore_deferred_provider *d = (struct oscore_deferred_provider *)p;
+    d->op = op;
+    d->submitted++;
+    return OscoreNoError;
+}
+
+struct oscore_async_client {
+    struct oscore_init_params *params;
+    struct context c;
+    uint8_t buf_oscore[256];
+    uint16_t buf_oscore_len;
+};
+
+static OscoreError oscore_async_request(void *arg) {
+    struct oscore_async_client *a = (struct oscore_async_client *)arg;
+    OscoreError r = oscore_context_init(a->params, &a->c);
+    if (r != OscoreNoError) return r;
+
+    /*required only for the test vector*/
+    a->c.sc.sender_seq_num = 20;
+    a->buf_oscore_len = sizeof(a->buf_oscore);
+    return coap2oscore(
+        T1__COAP_REQ, T1__COAP_REQ_LEN,
+        a->buf_oscore, &a->buf_oscore_len,
+        &a->c);
+}
+
+/**
+ * Test 9:
+ * - Key derivation and OSCORE request of test 1 in a crypto task. Every
+ *   operation is handed to the provider and completed by the test, the
+ *   request must be the same as without a provider.
+ */
+static void oscore_async_test9(void) {
+    static uint64_t stack[2 * OSCORE_CRYPTO_TASK_MIN_STACK_SIZE /
+                          sizeof(uint64_t)];
+    static struct oscore_async_client a;
+    struct oscore_deferred_provider d = {
+        {oscore_deferred_submit, NULL}, NULL, 0};
+    struct oscore_crypto_task t;
+    OscoreError r;
+    struct oscore_init_params params = {
+        .dev_type = CLIENT,
+        .master_secret.ptr = T1__MASTER_SECRET,
+        .master_secret.len = T1__MASTER_SECRET_LEN,
+        .sender_id.ptr = T1__SENDER_ID,
+        .sender_id.len = T1__SENDER_ID_LEN,
+        .recipient_id.ptr = T1__RECIPIENT_ID,
+        .recipient_id.len = T1__RECIPIENT_ID_LEN,
+        .master_salt.ptr = T1__MASTER_SALT,
+        .master_salt.len = T1__MASTER_SALT_LEN,
+        .id_context.ptr = T1__ID_CONTEXT,
+        .id_context.len = T1__ID_CONTEXT_LEN,
+        .aead_alg = AES_CCM_16_64_128,
+        .hkdf = SHA_256,
+    };
+    a.params = &params;
+
+    r = oscore_crypto_task_init(&t, stack, sizeof(stack), &d.p, NULL, NULL);
+    zassert_equal(r, OscoreNoError, "oscore_crypto_task_init failed");
+
+    r = oscore_crypto_task_start(&t, oscore_async_request, &a);
+    while (r == OscoreCryptoPending) {
+        oscore_crypto_op_complete(d.op, oscore_crypto_op_run(d.op));
+        r = oscore_crypto_task_resume(&t);
+    }
+    zassert_equal(r, OscoreNoError, "Error in async coap2oscore!");
+    zassert_true(d.submitted > 0, "no operation handed to the provider");
+    zassert_equal(oscore_crypto_task_current(), NULL,
+                  "task still current after it returned");
+
+    zassert_mem_equal__(
+        a.c.sc.sender_key.ptr, T1__SENDER_KEY,
+        a.c.sc.sender_key.len, "T1 sender key derivation failed");
+    zassert_equal(a.buf_oscore_len, T1__OSCORE_REQ_LEN,
+                  "wrong OSCORE request length");
+    zassert_mem_equal__(
+        a.buf_oscore, T1__OSCORE_REQ,
+        T1__OSCORE_REQ_LEN, "async coap2oscore failed");
+}
+#endif
+
 #endif
 
 void test_main(void) {
@@ -902,11 +2686,64 @@ void test_main(void) {
         ztest_unit_test(test_responder1),
         ztest_unit_test(test_responder2),
         ztest_unit_test(test_responder3),
-        ztest_unit_test(test_responder4));
+        ztest_unit_test(test_responder4),
+        ztest_unit_test(test_responder_stateless1),
+        ztest_unit_test(test_responder_stateless2),
+        ztest_unit_test(test_responder_admission),
+        ztest_unit_test(test_responder_portable1),
+        ztest_unit_test(test_key_pool1),
+        ztest_unit_test(test_key_update1),
+        ztest_unit_test(test_x5t1),
+        ztest_unit_test(test_x5bag1),
+        ztest_unit_test(test_cert_path1),
+        ztest_unit_test(test_revocation_list1),
+        ztest_unit_test(test_revocation_list2),
+        ztest_unit_test(test_verify_batch1));
 
     ztest_run_test_suite(initiator_tests);
     ztest_run_test_suite(responder_tests);
 
+#ifdef EDHOC_WITH_P256
+    ztest_test_suite(
+        p256_tests,
+        ztest_unit_test(test_suite2_sk),
+        ztest_unit_test(test_suite2_sdhk),
+        ztest_unit_test(test_suite3_sk),
+        ztest_unit_test(test_suite3_sdhk));
+    ztest_run_test_suite(p256_tests);
+#endif
+
+    /*needs a host with <ucontext.h>*/
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    ztest_test_suite(
+        async_tests,
+        ztest_unit_test(test_responder_async1));
+    ztest_run_test_suite(async_tests);
+#endif
+
+    /*needs a host with POSIX threads*/
+#ifdef EDHOC_WITH_EXECUTOR
+    ztest_test_suite(
+        executor_tests,
+        ztest_unit_test(test_executor1),
+        ztest_unit_test(test_executor2),
+        ztest_unit_test(test_state_keys_rotate1));
+    ztest_run_test_suite(executor_tests);
+#ifdef EDHOC_WITH_ASYNC_CRYPTO
+    ztest_test_suite(
+        executor_async_tests,
+        ztest_unit_test(test_executor3));
+    ztest_run_test_suite(executor_async_tests);
+#endif
+#endif
+
+#ifdef EDHOC_WITH_TRACE
+    ztest_test_suite(
+        trace_tests,
+        ztest_unit_test(test_responder_trace1));
+    ztest_run_test_suite(trace_tests);
+#endif
+
 #endif
 
 #ifdef OSCORE_TESTS
@@ -917,8 +2754,18 @@ void test_main(void) {
         ztest_unit_test(oscore_client_test3),
         ztest_unit_test(oscore_server_test4),
         ztest_unit_test(oscore_client_test5),
-        ztest_unit_test(oscore_server_test6));
+        ztest_unit_test(oscore_server_test6),
+        ztest_unit_test(oscore_combined_request_test7),
+        ztest_unit_test(oscore_key_update_test8));
 
     ztest_run_test_suite(oscore_tests);
+
+    /*needs a host with <ucontext.h>*/
+#ifdef OSCORE_WITH_ASYNC_CRYPTO
+    ztest_test_suite(
+        oscore_async_tests,
+        ztest_unit_test(oscore_async_test9));
+    ztest_run_test_suite(oscore_async_tests);
+#endif
 #endif
 }
@@ -493,7 +493,7 @@ uint8_t* T3I__G_R = NULL;
 uint32_t T3I__G_R_LEN = 0;
 
 uint8_t T3I__CA[] = {"RFC test CA"};
-uint32_t T3I__CA_LEN = sizeof(T3I__CA);
+uint32_t T3I__CA_LEN = sizeof(T3I__CA) - 1;
 
 uint8_t T3I__CA_PK[] = {0xdb, 0xd9, 0xdc, 0x8c, 0xd0, 0x3f, 0xb7, 0xc3, 0x91, 0x35, 0x11, 0x46, 0x2b, 0xb2, 0x38, 0x16, 0x47, 0x7c, 0x6b, 0xd8, 0xd6, 0x6e, 0xf5, 0xa1, 0xa0, 0x70, 0xac, 0x85, 0x4e, 0xd7, 0x3f, 0xd2};
 uint32_t T3I__CA_PK_LEN = sizeof(T3I__CA_PK);
@@ -549,7 +549,7 @@ uint8_t* T3R__G_I = NULL;
 uint32_t T3R__G_I_LEN = 0;
 
 uint8_t T3R__CA[] = {"RFC test CA"};
-uint32_t T3R__CA_LEN = sizeof(T3R__CA);
+uint32_t T3R__CA_LEN = sizeof(T3R__CA) - 1;
 
 uint8_t T3R__CA_PK[] = {0xdb, 0xd9, 0xdc, 0x8c, 0xd0, 0x3f, 0xb7, 0xc3, 0x91, 0x35, 0x11, 0x46, 0x2b, 0xb2, 0x38, 0x16, 0x47, 0x7c, 0x6b, 0xd8, 0xd6, 0x6e, 0xf5, 0xa1, 0xa0, 0x70, 0xac, 0x85, 0x4e, 0xd7, 0x3f, 0xd2};
 uint32_t T3R__CA_PK_LEN = sizeof(T3R__CA_PK);
@@ -675,7 +675,7 @@ uint8_t* T4I__G_R = NULL;
 uint32_t T4I__G_R_LEN = 0;
 
 uint8_t T4I__CA[] = {"RFC test CA"};
-uint32_t T4I__CA_LEN = sizeof(T4I__CA);
+uint32_t T4I__CA_LEN = sizeof(T4I__CA) - 1;
 
 uint8_t T4I__CA_PK[] = {0xdb, 0xd9, 0xdc, 0x8c, 0xd0, 0x3f, 0xb7, 0xc3, 0x91, 0x35, 0x11, 0x46, 0x2b, 0xb2, 0x38, 0x16, 0x47, 0x7c, 0x6b, 0xd8, 0xd6, 0x6e, 0xf5, 0xa1, 0xa0, 0x70, 0xac, 0x85, 0x4e, 0xd7, 0x3f, 0xd2};
 uint32_t T4I__CA_PK_LEN = sizeof(T4I__CA_PK);
@@ -730,11 +730,79 @@ uint8_t* T4R__G_I = NULL;
 uint32_t T4R__G_I_LEN = 0;
 
 uint8_t T4R__CA[] = {"RFC test CA"};
-uint32_t T4R__CA_LEN = sizeof(T4R__CA);
+uint32_t T4R__CA_LEN = sizeof(T4R__CA) - 1;
 
 uint8_t T4R__CA_PK[] = {0xdb, 0xd9, 0xdc, 0x8c, 0xd0, 0x3f, 0xb7, 0xc3, 0x91, 0x35, 0x11, 0x46, 0x2b, 0xb2, 0x38, 0x16, 0x47, 0x7c, 0x6b, 0xd8, 0xd6, 0x6e, 0xf5, 0xa1, 0xa0, 0x70, 0xac, 0x85, 0x4e, 0xd7, 0x3f, 0xd2};
 uint32_t T4R__CA_PK_LEN = sizeof(T4R__CA_PK);
 
-
-
-
+/*P-256 keys generated for the cipher suites 2 and 3, there are no test 
+vectors for them. Each party uses its key for signatures and static DH, the 
+public keys are x || y, G_I and G_R are the x coordinates.*/
+uint8_t P256__SK_I[] = {
+    0x61, 0x8f, 0xcb, 0x6b, 0xcb, 0xc5, 0x1b, 0xe1,
+    0xd0, 0xcb, 0xf3, 0x01, 0x56, 0xff, 0x14, 0xdf,
+    0x96, 0xe5, 0x2d, 0xd9, 0x15, 0x57, 0x18, 0xe0,
+    0xf8, 0xfd, 0xb5, 0x9d, 0x57, 0xd8, 0x27, 0x28};
+uint32_t P256__SK_I_LEN = sizeof(P256__SK_I);
+
+uint8_t P256__PK_I[] = {
+    0x23, 0xbe, 0x69, 0xc3, 0x7f, 0xca, 0xd5, 0xd1,
+    0x6e, 0x43, 0x87, 0x09, 0x3d, 0xb1, 0x56, 0x7e,
+    0x54, 0xf4, 0xb2, 0x20, 0x6b, 0x40, 0x8d, 0x31,
+    0xeb, 0x54, 0xa8, 0xb9, 0x61, 0xbd, 0xba, 0xe6,
+    0x00, 0x53, 0x24, 0xcf, 0x87, 0xc9, 0x92, 0x28,
+    0x2c, 0x77, 0xe2, 0xc9, 0xd8, 0x3c, 0x20, 0xeb,
+    0x50, 0xd2, 0x43, 0x45, 0xc5, 0xd6, 0xf7, 0x3e,
+    0x11, 0x3f, 0x3d, 0xb2, 0x47, 0x6b, 0xd1, 0x47};
+uint32_t P256__PK_I_LEN = sizeof(P256__PK_I);
+
+uint8_t P256__SK_R[] = {
+    0xb2, 0x0f, 0xc6, 0x3c, 0x19, 0x43, 0xb3, 0xb2,
+    0x01, 0xb8, 0x59, 0x5c, 0xf6, 0xdc, 0xa0, 0xea,
+    0x4a, 0xad, 0x6f, 0x63, 0x0f, 0xb6, 0x8f, 0x84,
+    0x95, 0x0a, 0x92, 0xa9, 0xc2, 0x81, 0xcf, 0x80};
+uint32_t P256__SK_R_LEN = sizeof(P256__SK_R);
+
+uint8_t P256__PK_R[] = {
+    0x09, 0x23, 0x81, 0x13, 0xfa, 0xbb, 0x39, 0xec,
+    0x4e, 0x96, 0xcf, 0xe6, 0x22, 0x04, 0x0a, 0x39,
+    0x7a, 0xea, 0x83, 0x0d, 0x15, 0x1d, 0x01, 0xac,
+    0x61, 0xf6, 0x5d, 0x01, 0xb6, 0xfe, 0x09, 0xf6,
+    0xa9, 0x82, 0x73, 0x27, 0x72, 0x46, 0x62, 0x5d,
+    0x5e, 0x79, 0xc8, 0x5f, 0x3b, 0xd9, 0x4c, 0xbf,
+    0x52, 0x27, 0xee, 0xbf, 0x04, 0xc2, 0x03, 0x28,
+    0xcf, 0xed, 0x9d, 0x63, 0xeb, 0x39, 0xe5, 0x1e};
+uint32_t P256__PK_R_LEN = sizeof(P256__PK_R);
+
+/*ID_CRED_x = {4: h'23'} and {4: h'24'}, CRED_x is a COSE_Key*/
+uint8_t P256__ID_CRED_I[] = {0xa1, 0x04, 0x41, 0x23};
+uint32_t P256__ID_CRED_I_LEN = sizeof(P256__ID_CRED_I);
+
+uint8_t P256__ID_CRED_R[] = {0xa1, 0x04, 0x41, 0x24};
+uint32_t P256__ID_CRED_R_LEN = sizeof(P256__ID_CRED_R);
+
+uint8_t P256__CRED_I[] = {
+    0xa4, 0x01, 0x02, 0x20, 0x01, 0x21, 0x58, 0x20,
+    0x23, 0xbe, 0x69, 0xc3, 0x7f, 0xca, 0xd5, 0xd1,
+    0x6e, 0x43, 0x87, 0x09, 0x3d, 0xb1, 0x56, 0x7e,
+    0x54, 0xf4, 0xb2, 0x20, 0x6b, 0x40, 0x8d, 0x31,
+    0xeb, 0x54, 0xa8, 0xb9, 0x61, 0xbd, 0xba, 0xe6,
+    0x22, 0x58, 0x20, 0x00, 0x53, 0x24, 0xcf, 0x87,
+    0xc9, 0x92, 0x28, 0x2c, 0x77, 0xe2, 0xc9, 0xd8,
+    0x3c, 0x20, 0xeb, 0x50, 0xd2, 0x43, 0x45, 0xc5,
+    0xd6, 0xf7, 0x3e, 0x11, 0x3f, 0x3d, 0xb2, 0x47,
+    0x6b, 0xd1, 0x47};
+uint32_t P256__CRED_I_LEN = sizeof(P256__CRED_I);
+
+uint8_t P256__CRED_R[] = {
+    0xa4, 0x01, 0x02, 0x20, 0x01, 0x21, 0x58, 0x20,
+    0x09, 0x23, 0x81, 0x13, 0xfa, 0xbb, 0x39, 0xec,
+    0x4e, 0x96, 0xcf, 0xe6, 0x22, 0x04, 0x0a, 0x39,
+    0x7a, 0xea, 0x83, 0x0d, 0x15, 0x1d, 0x01, 0xac,
+    0x61, 0xf6, 0x5d, 0x01, 0xb6, 0xfe, 0x09, 0xf6,
+    0x22, 0x58, 0x20, 0xa9, 0x82, 0x73, 0x27, 0x72,
+    0x46, 0x62, 0x5d, 0x5e, 0x79, 0xc8, 0x5f, 0x3b,
+    0xd9, 0x4c, 0xbf, 0x52, 0x27, 0xee, 0xbf, 0x04,
+    0xc2, 0x03, 0x28, 0xcf, 0xed, 0x9d, 0x63, 0xeb,
+    0x39, 0xe5, 0x1e};
+uint32_t P256__CRED_R_LEN = sizeof(P256__CRED_R);
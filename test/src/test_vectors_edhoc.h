@@ -630,4 +630,31 @@ extern uint32_t T4R__CA_LEN;
 
 extern uint8_t T4R__CA_PK[];
 extern uint32_t T4R__CA_PK_LEN;
+
+/*
+ * P-256 credentials for the cipher suites 2 and 3, see test_vectors_edhoc.c
+ */
+extern uint8_t P256__SK_I[];
+extern uint32_t P256__SK_I_LEN;
+
+extern uint8_t P256__PK_I[];
+extern uint32_t P256__PK_I_LEN;
+
+extern uint8_t P256__SK_R[];
+extern uint32_t P256__SK_R_LEN;
+
+extern uint8_t P256__PK_R[];
+extern uint32_t P256__PK_R_LEN;
+
+extern uint8_t P256__ID_CRED_I[];
+extern uint32_t P256__ID_CRED_I_LEN;
+
+extern uint8_t P256__ID_CRED_R[];
+extern uint32_t P256__ID_CRED_R_LEN;
+
+extern uint8_t P256__CRED_I[];
+extern uint32_t P256__CRED_I_LEN;
+
+extern uint8_t P256__CRED_R[];
+extern uint32_t P256__CRED_R_LEN;
 #endif /*TEST_VECTORS_EDHOC*/
@@ -14,6 +14,7 @@
 #include <string.h>
 
 bool rx_initiator_switch = false;
+EdhocError (*tx_loopback)(uint8_t *data, uint32_t data_len) = NULL;
 
 extern struct byte_array M1, M2, M3;
 
@@ -63,5 +64,6 @@ EdhocError rx(uint8_t *data, uint32_t *data_len) {
 }
 
 EdhocError tx(uint8_t *data, uint32_t data_len) {
+    if (tx_loopback != NULL) return tx_loopback(data, data_len);
     return EdhocNoError;
 }
@@ -12,4 +12,7 @@
 #ifndef TXRX_WRAPPER_H
 #define TXRX_WRAPPER_H
 extern bool rx_initiator_switch;
+/*if set, tx() hands the messages to it, e.g., to a responder in the same 
+thread*/
+extern EdhocError (*tx_loopback)(uint8_t *data, uint32_t data_len);
 #endif
\ No newline at end of file